@@ -0,0 +1,68 @@
+/*
+Fills a SolveRecord from the memory of a CVODE or CVODES solver. Include the
+solver header (cvode/cvode.h or cvodes/cvodes.h) before this one, the
+optional output functions have the same names in both packages.
+
+For a backward problem of CVODES pass CVodeGetAdjCVodeBmem(cvode_mem, which)
+and the linear solver attached to it.
+
+The CVSpils getters of SUNDIALS 3.x do not check which interface is attached:
+with a CVDls solver they read its memory as CVSpils memory, and without a
+linear solver they report an error. They are only called for a linear solver
+of type SUNLINEARSOLVER_ITERATIVE.
+*/
+
+#ifndef CVODE_STATS_H
+#define CVODE_STATS_H
+
+#if defined(_CVODES_H)
+#include <cvodes/cvodes_spils.h> // access to CVSpils interface
+#else
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#endif
+
+#include <sundials/sundials_linearsolver.h> // generic SUNLinearSolver
+
+#include "solver_stats.h"
+
+// Sets the solver counters of rec, leaving label, flag, seconds and the timers
+// alone. LS is the linear solver attached to cvode_mem, NULL for none (e.g.
+// functional iteration). Returns the first negative flag of the CVodeGet
+// functions, 0 if all succeeded. The CVSpils counters are -1 unless LS is
+// iterative.
+inline int collect_cvode_stats(void *cvode_mem, SUNLinearSolver LS,
+                               SolveRecord *rec) {
+  long int nli, nlcf, njtv, npe, nps;
+  int flag = CVodeGetNumSteps(cvode_mem, &rec->steps);
+  if (flag < 0) return(flag);
+  flag = CVodeGetNumRhsEvals(cvode_mem, &rec->rhs_evals);
+  if (flag < 0) return(flag);
+  flag = CVodeGetNumLinSolvSetups(cvode_mem, &rec->lin_setups);
+  if (flag < 0) return(flag);
+  flag = CVodeGetNumErrTestFails(cvode_mem, &rec->err_test_fails);
+  if (flag < 0) return(flag);
+  flag = CVodeGetNonlinSolvStats(cvode_mem, &rec->nonlin_iters,
+                                 &rec->nonlin_conv_fails);
+  if (flag < 0) return(flag);
+
+  rec->lin_iters = rec->lin_conv_fails = rec->jtv_evals = -1;
+  rec->prec_evals = rec->prec_solves = -1;
+  if (LS == NULL || SUNLinSolGetType(LS) != SUNLINEARSOLVER_ITERATIVE) {
+    return(0);
+  }
+  if (CVSpilsGetNumLinIters(cvode_mem, &nli) == CVSPILS_SUCCESS &&
+      CVSpilsGetNumConvFails(cvode_mem, &nlcf) == CVSPILS_SUCCESS &&
+      CVSpilsGetNumJtimesEvals(cvode_mem, &njtv) == CVSPILS_SUCCESS &&
+      CVSpilsGetNumPrecEvals(cvode_mem, &npe) == CVSPILS_SUCCESS &&
+      CVSpilsGetNumPrecSolves(cvode_mem, &nps) == CVSPILS_SUCCESS) {
+    rec->lin_iters = nli;
+    rec->lin_conv_fails = nlcf;
+    rec->jtv_evals = njtv;
+    rec->prec_evals = npe;
+    rec->prec_solves = nps;
+  }
+  return(0);
+}
+
+#endif
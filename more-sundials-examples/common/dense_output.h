@@ -0,0 +1,91 @@
+/*
+Output of a CVODE solution at any number of times without stopping the
+integrator at them.
+
+With CV_NORMAL, CVode has to reach every output time tout, so every output
+time ends a step and many closely spaced output times force many short
+steps. CVODE's steps already carry an interpolating polynomial of the
+solution, which CVodeGetDky evaluates anywhere in the last step. A
+DenseOutput advances CVode with CV_ONE_STEP only until the last step covers
+the requested time and then interpolates there, so the steps are the ones
+the error control chooses, whatever the number of output times.
+
+  DenseOutput out(cvode_mem, y, end_time);
+  for (long int k = 1; k <= samples; k++) {
+    flag = out.evaluate(k * end_time / samples, yout);
+    ...
+  }
+
+cvode_mem has to come straight from CVodeInit or CVodeReInit, or have been
+advanced with CV_ONE_STEP only. y is the vector CVode integrates in: it holds
+the solution at the end of the last step, not at the requested time.
+Requested times have to be nondecreasing, up to going back into the last
+step; an earlier time gives CVodeGetDky's CV_BAD_T. end_time only sets the
+direction of the integration and the first step, the steps may go beyond it.
+
+The functions return the first negative flag of CVode or CVodeGetDky and 0
+on success. Include cvode/cvode.h or cvodes/cvodes.h before this header.
+*/
+
+#ifndef DENSE_OUTPUT_H
+#define DENSE_OUTPUT_H
+
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+class DenseOutput {
+ public:
+  // y is the solution vector of cvode_mem, see above.
+  DenseOutput(void *cvode_mem, N_Vector y, realtype end_time)
+      : cvode_mem_(cvode_mem), y_(y), end_time_(end_time), tcur_(0),
+        num_steps_(0) {
+    CVodeGetCurrentTime(cvode_mem_, &tcur_);
+    forward_ = (end_time >= tcur_);
+  }
+
+  // Steps until the solution covers t and interpolates y(t) into yout.
+  int evaluate(realtype t, N_Vector yout) {
+    int flag;
+    while (forward_ ? (tcur_ < t) : (tcur_ > t)) {
+      flag = CVode(cvode_mem_, end_time_, y_, &tcur_, CV_ONE_STEP);
+      if (flag < 0) return(flag);
+      num_steps_++;
+    }
+    // y is the solution at tcur, also before the first step when there is no
+    // polynomial yet.
+    if (t == tcur_) {
+      N_VScale(1, y_, yout);
+      return(0);
+    }
+    flag = CVodeGetDky(cvode_mem_, t, 0, yout);
+    return((flag < 0) ? flag : 0);
+  }
+
+  // The same for the n times t[0..n-1], for serial N_Vectors: y(t[k]) goes
+  // to out[k*N] .. out[k*N + N-1]. tmp is a serial vector of length N.
+  int evaluate(const realtype *t, long int n, realtype *out, N_Vector tmp) {
+    sunindextype N = NV_LENGTH_S(tmp);
+    const realtype *tmpdata = NV_DATA_S(tmp);
+    for (long int k = 0; k < n; k++) {
+      int flag = evaluate(t[k], tmp);
+      if (flag < 0) return(flag);
+      realtype *row = out + k * N;
+      for (sunindextype i = 0; i < N; i++) row[i] = tmpdata[i];
+    }
+    return(0);
+  }
+
+  // Time reached by the integrator, and the steps DenseOutput took to get
+  // there.
+  realtype current_time() const { return tcur_; }
+  long int num_steps() const { return num_steps_; }
+
+ private:
+  void *cvode_mem_;
+  N_Vector y_;
+  realtype end_time_, tcur_;
+  bool forward_;
+  long int num_steps_;
+};
+
+#endif
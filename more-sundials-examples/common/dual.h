@@ -0,0 +1,475 @@
+/*
+Forward mode automatic differentiation for the jacobian callbacks of CVODE.
+
+A Dual<D> carries a value and its derivatives in D directions at once. When
+the right hand side is written once as a template over the number type,
+
+  struct MyProblem {
+    template <class T>
+    static int rhs(realtype t, const T *y, T *ydot, void *user_data);
+  };
+
+the same code computes f with T = realtype and exact derivatives of f with
+T = Dual<D>. The functions below turn it into the SUNDIALS callbacks:
+
+  ad_rhs<MyProblem>  CVRhsFn, plain f.
+  ad_jtv<MyProblem>  CVSpilsJacTimesVecFn, the exact product J*v from one
+                     evaluation with Dual<1>.
+  ad_jac<MyProblem>  CVDlsJacFn, the exact jacobian into a dense, band or
+                     sparse (CSC) SUNMatrix, AD_LANES columns per evaluation.
+                     A band matrix with mu + ml + 1 < N takes columns that
+                     share no row in the same lane, like CVODE's band
+                     difference quotient, so it needs
+                     ceil((mu + ml + 1) / AD_LANES) evaluations. Dense and
+                     sparse matrices need ceil(N / AD_LANES).
+
+The sparse matrix gets the structural pattern of J, the entries that depend
+on y at all, with explicit zeros where a derivative happens to be zero at
+the current state (d(u*v)/du at v = 0). SUNKLU factors the pattern of the
+first jacobian once and only refactors it afterwards, so the pattern must not
+change from call to call. It is found on the first call, per problem, thread
+and N, by evaluating rhs with AdPattern, which tracks which inputs a value
+depends on, and is kept. Branches of rhs on y must therefore not change
+which entries of y an entry of ydot depends on.
+
+  CVodeInit(cvode_mem, ad_rhs<MyProblem>, t0, y);
+  CVSpilsSetJacTimes(cvode_mem, NULL, ad_jtv<MyProblem>);
+
+rhs has to assign every entry of ydot and may only use the operations
+defined here on T (arithmetic, comparisons, exp, log, sqrt, pow, sin, cos,
+tanh, fabs). Call the math functions unqualified, e.g. exp(y[0]), so the
+Dual overloads are found. The vectors have to be serial N_Vectors.
+
+A failing rhs has its return value passed on; ad_jac returns -1 when the
+sparse matrix has too little room for the structural nonzeros.
+
+Everything is in this header, an example only needs -I ../../common.
+*/
+
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <cmath>
+#include <vector>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunmatrix/sunmatrix_dense.h>  // access to dense SUNMatrix
+#include <sunmatrix/sunmatrix_band.h>  // access to band SUNMatrix
+#include <sunmatrix/sunmatrix_sparse.h>  // access to sparse SUNMatrix
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+// Directions of the Dual numbers used by ad_jac.
+#ifndef AD_LANES
+#define AD_LANES 8
+#endif
+
+template <int D>
+struct Dual {
+  realtype v; // value
+  realtype d[D]; // derivatives
+
+  Dual() : v(0) { for (int k = 0; k < D; k++) d[k] = 0; }
+  Dual(realtype value) : v(value) { for (int k = 0; k < D; k++) d[k] = 0; }
+
+  Dual &operator+=(const Dual &b) {
+    v += b.v;
+    for (int k = 0; k < D; k++) d[k] += b.d[k];
+    return *this;
+  }
+  Dual &operator-=(const Dual &b) {
+    v -= b.v;
+    for (int k = 0; k < D; k++) d[k] -= b.d[k];
+    return *this;
+  }
+  Dual &operator*=(const Dual &b) {
+    for (int k = 0; k < D; k++) d[k] = d[k] * b.v + v * b.d[k];
+    v *= b.v;
+    return *this;
+  }
+  Dual &operator/=(const Dual &b) {
+    realtype inv = 1 / b.v;
+    v *= inv;
+    for (int k = 0; k < D; k++) d[k] = (d[k] - v * b.d[k]) * inv;
+    return *this;
+  }
+  Dual &operator+=(realtype b) { v += b; return *this; }
+  Dual &operator-=(realtype b) { v -= b; return *this; }
+  Dual &operator*=(realtype b) {
+    v *= b;
+    for (int k = 0; k < D; k++) d[k] *= b;
+    return *this;
+  }
+  Dual &operator/=(realtype b) { return *this *= 1 / b; }
+};
+
+// Value part, for code that branches on y.
+inline realtype ad_value(realtype x) { return x; }
+template <int D> realtype ad_value(const Dual<D> &x) { return x.v; }
+
+// Arithmetic.
+template <int D> Dual<D> operator+(const Dual<D> &a) { return a; }
+template <int D> Dual<D> operator-(const Dual<D> &a) { return a * -1.0; }
+template <int D> Dual<D> operator+(Dual<D> a, const Dual<D> &b) {
+  return a += b;
+}
+template <int D> Dual<D> operator-(Dual<D> a, const Dual<D> &b) {
+  return a -= b;
+}
+template <int D> Dual<D> operator*(Dual<D> a, const Dual<D> &b) {
+  return a *= b;
+}
+template <int D> Dual<D> operator/(Dual<D> a, const Dual<D> &b) {
+  return a /= b;
+}
+template <int D> Dual<D> operator+(Dual<D> a, realtype b) { return a += b; }
+template <int D> Dual<D> operator-(Dual<D> a, realtype b) { return a -= b; }
+template <int D> Dual<D> operator*(Dual<D> a, realtype b) { return a *= b; }
+template <int D> Dual<D> operator/(Dual<D> a, realtype b) { return a /= b; }
+template <int D> Dual<D> operator+(realtype a, Dual<D> b) { return b += a; }
+template <int D> Dual<D> operator-(realtype a, const Dual<D> &b) {
+  Dual<D> r(a);
+  return r -= b;
+}
+template <int D> Dual<D> operator*(realtype a, Dual<D> b) { return b *= a; }
+template <int D> Dual<D> operator/(realtype a, const Dual<D> &b) {
+  Dual<D> r(a);
+  return r /= b;
+}
+
+// Comparisons look at the value only.
+template <int D> bool operator<(const Dual<D> &a, const Dual<D> &b) {
+  return a.v < b.v;
+}
+template <int D> bool operator>(const Dual<D> &a, const Dual<D> &b) {
+  return a.v > b.v;
+}
+template <int D> bool operator<(const Dual<D> &a, realtype b) {
+  return a.v < b;
+}
+template <int D> bool operator>(const Dual<D> &a, realtype b) {
+  return a.v > b;
+}
+template <int D> bool operator<(realtype a, const Dual<D> &b) {
+  return a < b.v;
+}
+template <int D> bool operator>(realtype a, const Dual<D> &b) {
+  return a > b.v;
+}
+
+// Math functions, f(a) with derivative f'(a)*a.d.
+template <int D> Dual<D> ad_chain(const Dual<D> &a, realtype value,
+                                  realtype deriv) {
+  Dual<D> r(value);
+  for (int k = 0; k < D; k++) r.d[k] = deriv * a.d[k];
+  return r;
+}
+template <int D> Dual<D> exp(const Dual<D> &a) {
+  realtype e = std::exp(a.v);
+  return ad_chain(a, e, e);
+}
+template <int D> Dual<D> log(const Dual<D> &a) {
+  return ad_chain(a, std::log(a.v), 1 / a.v);
+}
+template <int D> Dual<D> sqrt(const Dual<D> &a) {
+  realtype s = std::sqrt(a.v);
+  return ad_chain(a, s, 0.5 / s);
+}
+template <int D> Dual<D> pow(const Dual<D> &a, realtype p) {
+  return ad_chain(a, std::pow(a.v, p), p * std::pow(a.v, p - 1));
+}
+template <int D> Dual<D> sin(const Dual<D> &a) {
+  return ad_chain(a, std::sin(a.v), std::cos(a.v));
+}
+template <int D> Dual<D> cos(const Dual<D> &a) {
+  return ad_chain(a, std::cos(a.v), -std::sin(a.v));
+}
+template <int D> Dual<D> tanh(const Dual<D> &a) {
+  realtype th = std::tanh(a.v);
+  return ad_chain(a, th, 1 - th * th);
+}
+template <int D> Dual<D> fabs(const Dual<D> &a) {
+  return ad_chain(a, std::fabs(a.v), (a.v < 0) ? -1.0 : 1.0);
+}
+
+// A value and the inputs it depends on, one bit per input, for the
+// structural pattern of the sparse jacobian. Every operation combines the
+// dependencies of its operands whatever the values, so a derivative that is
+// zero at the current state is still in the pattern.
+struct AdPattern {
+  realtype v;
+  unsigned long long deps;
+
+  AdPattern() : v(0), deps(0) {}
+  AdPattern(realtype value) : v(value), deps(0) {}
+
+  AdPattern &operator+=(const AdPattern &b) {
+    v += b.v;
+    deps |= b.deps;
+    return *this;
+  }
+  AdPattern &operator-=(const AdPattern &b) {
+    v -= b.v;
+    deps |= b.deps;
+    return *this;
+  }
+  AdPattern &operator*=(const AdPattern &b) {
+    v *= b.v;
+    deps |= b.deps;
+    return *this;
+  }
+  AdPattern &operator/=(const AdPattern &b) {
+    v /= b.v;
+    deps |= b.deps;
+    return *this;
+  }
+  AdPattern &operator+=(realtype b) { v += b; return *this; }
+  AdPattern &operator-=(realtype b) { v -= b; return *this; }
+  AdPattern &operator*=(realtype b) { v *= b; return *this; }
+  AdPattern &operator/=(realtype b) { v /= b; return *this; }
+};
+
+// Inputs seeded per AdPattern evaluation.
+#define AD_PATTERN_LANES 64
+
+inline realtype ad_value(const AdPattern &x) { return x.v; }
+
+inline AdPattern operator+(const AdPattern &a) { return a; }
+inline AdPattern operator-(AdPattern a) { return a *= -1.0; }
+inline AdPattern operator+(AdPattern a, const AdPattern &b) { return a += b; }
+inline AdPattern operator-(AdPattern a, const AdPattern &b) { return a -= b; }
+inline AdPattern operator*(AdPattern a, const AdPattern &b) { return a *= b; }
+inline AdPattern operator/(AdPattern a, const AdPattern &b) { return a /= b; }
+inline AdPattern operator+(AdPattern a, realtype b) { return a += b; }
+inline AdPattern operator-(AdPattern a, realtype b) { return a -= b; }
+inline AdPattern operator*(AdPattern a, realtype b) { return a *= b; }
+inline AdPattern operator/(AdPattern a, realtype b) { return a /= b; }
+inline AdPattern operator+(realtype a, AdPattern b) { return b += a; }
+inline AdPattern operator-(realtype a, const AdPattern &b) {
+  AdPattern r(a);
+  return r -= b;
+}
+inline AdPattern operator*(realtype a, AdPattern b) { return b *= a; }
+inline AdPattern operator/(realtype a, const AdPattern &b) {
+  AdPattern r(a);
+  return r /= b;
+}
+
+inline bool operator<(const AdPattern &a, const AdPattern &b) {
+  return a.v < b.v;
+}
+inline bool operator>(const AdPattern &a, const AdPattern &b) {
+  return a.v > b.v;
+}
+inline bool operator<(const AdPattern &a, realtype b) { return a.v < b; }
+inline bool operator>(const AdPattern &a, realtype b) { return a.v > b; }
+inline bool operator<(realtype a, const AdPattern &b) { return a < b.v; }
+inline bool operator>(realtype a, const AdPattern &b) { return a > b.v; }
+
+inline AdPattern ad_pattern_chain(const AdPattern &a, realtype value) {
+  AdPattern r(value);
+  r.deps = a.deps;
+  return r;
+}
+inline AdPattern exp(const AdPattern &a) {
+  return ad_pattern_chain(a, std::exp(a.v));
+}
+inline AdPattern log(const AdPattern &a) {
+  return ad_pattern_chain(a, std::log(a.v));
+}
+inline AdPattern sqrt(const AdPattern &a) {
+  return ad_pattern_chain(a, std::sqrt(a.v));
+}
+inline AdPattern pow(const AdPattern &a, realtype p) {
+  return ad_pattern_chain(a, std::pow(a.v, p));
+}
+inline AdPattern sin(const AdPattern &a) {
+  return ad_pattern_chain(a, std::sin(a.v));
+}
+inline AdPattern cos(const AdPattern &a) {
+  return ad_pattern_chain(a, std::cos(a.v));
+}
+inline AdPattern tanh(const AdPattern &a) {
+  return ad_pattern_chain(a, std::tanh(a.v));
+}
+inline AdPattern fabs(const AdPattern &a) {
+  return ad_pattern_chain(a, std::fabs(a.v));
+}
+
+// Per-thread input and output arrays of the Dual evaluations, kept between
+// calls.
+template <int D>
+std::vector < Dual<D> > &ad_workspace(int which, sunindextype N) {
+  static thread_local std::vector < Dual<D> > work[2];
+  if ((sunindextype) work[which].size() < N) work[which].resize(N);
+  return work[which];
+}
+
+template <class Problem>
+int ad_rhs(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
+  return Problem::rhs(t, (const realtype *) N_VGetArrayPointer(y),
+                      N_VGetArrayPointer(ydot), user_data);
+}
+
+template <class Problem>
+int ad_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector y, N_Vector fy,
+           void *user_data, N_Vector tmp) {
+  sunindextype N = NV_LENGTH_S(y);
+  const realtype *ydata = N_VGetArrayPointer(y);
+  const realtype *vdata = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  std::vector < Dual<1> > &x = ad_workspace<1>(0, N);
+  std::vector < Dual<1> > &fx = ad_workspace<1>(1, N);
+
+  for (sunindextype i = 0; i < N; i++) {
+    x[i].v = ydata[i];
+    x[i].d[0] = vdata[i];
+  }
+  int flag = Problem::rhs(t, (const Dual<1> *) &x[0], &fx[0], user_data);
+  if (flag != 0) return(flag);
+  for (sunindextype i = 0; i < N; i++) Jvdata[i] = fx[i].d[0];
+
+  return(0);
+}
+
+// Structural pattern of the jacobian in CSC form: column j has the rows
+// rowind[colptr[j]] .. rowind[colptr[j+1]-1], in increasing order.
+struct AdSparsity {
+  sunindextype N; // -1 before the first call
+  std::vector < sunindextype > colptr, rowind;
+
+  AdSparsity() : N(-1) {}
+};
+
+// The pattern of Problem kept by ad_sparsity, one per thread.
+template <class Problem>
+AdSparsity &ad_sparsity_cache() {
+  static thread_local AdSparsity pattern;
+  return pattern;
+}
+
+// Drops the kept pattern of Problem, the next ad_sparsity (or sparse ad_jac)
+// finds it again from its own y, e.g. after user data that changes the
+// coupling.
+template <class Problem>
+void ad_sparsity_reset() {
+  ad_sparsity_cache<Problem>().N = -1;
+}
+
+// The pattern of the jacobian of Problem, found with AdPattern on the first
+// call for N and kept per thread. *sparsity is NULL when rhs fails, its
+// value is returned.
+template <class Problem>
+int ad_sparsity(realtype t, const realtype *ydata, sunindextype N,
+                void *user_data, const AdSparsity **sparsity) {
+  AdSparsity &pattern = ad_sparsity_cache<Problem>();
+  *sparsity = NULL;
+  if (pattern.N == N) {
+    *sparsity = &pattern;
+    return(0);
+  }
+
+  std::vector < AdPattern > x(N), fx(N);
+  std::vector < std::vector < sunindextype > > columns(N);
+  for (sunindextype first = 0; first < N; first += AD_PATTERN_LANES) {
+    for (sunindextype i = 0; i < N; i++) {
+      x[i] = AdPattern(ydata[i]);
+      if (i >= first && i - first < AD_PATTERN_LANES) {
+        x[i].deps = 1ULL << (i - first);
+      }
+    }
+    int flag = Problem::rhs(t, (const AdPattern *) &x[0], &fx[0], user_data);
+    if (flag != 0) {
+      pattern.N = -1;
+      return(flag);
+    }
+    // Rows in increasing order for every column.
+    for (sunindextype i = 0; i < N; i++) {
+      for (unsigned long long deps = fx[i].deps; deps != 0;
+           deps &= deps - 1) {
+        columns[first + __builtin_ctzll(deps)].push_back(i);
+      }
+    }
+  }
+
+  pattern.colptr.assign(N + 1, 0);
+  pattern.rowind.clear();
+  for (sunindextype j = 0; j < N; j++) {
+    pattern.rowind.insert(pattern.rowind.end(), columns[j].begin(),
+                          columns[j].end());
+    pattern.colptr[j + 1] = (sunindextype) pattern.rowind.size();
+  }
+  pattern.N = N;
+  *sparsity = &pattern;
+  return(0);
+}
+
+template <class Problem>
+int ad_jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data,
+           N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+  const int D = AD_LANES;
+  sunindextype N = NV_LENGTH_S(y);
+  const realtype *ydata = N_VGetArrayPointer(y);
+  std::vector < Dual<D> > &x = ad_workspace<D>(0, N);
+  std::vector < Dual<D> > &fx = ad_workspace<D>(1, N);
+
+  // Columns j with j % groups == g are seeded together in one lane.
+  SUNMatrix_ID id = SUNMatGetID(J);
+  sunindextype mu = 0, ml = 0, groups = N;
+  if (id == SUNMATRIX_BAND) {
+    mu = SM_UBAND_B(J);
+    ml = SM_LBAND_B(J);
+    if (mu + ml + 1 < N) groups = mu + ml + 1;
+  }
+  const AdSparsity *pattern = NULL;
+  if (id == SUNMATRIX_SPARSE) {
+    if (SM_SPARSETYPE_S(J) != CSC_MAT) return(-1);
+    int flag = ad_sparsity<Problem>(t, ydata, N, user_data, &pattern);
+    if (flag != 0) return(flag);
+    if (pattern->colptr[N] > SM_NNZ_S(J)) return(-1);
+  }
+
+  if (id != SUNMATRIX_SPARSE) SUNMatZero(J);
+  for (sunindextype first = 0; first < groups; first += D) {
+    int lanes = (groups - first < D) ? (int) (groups - first) : D;
+    for (sunindextype i = 0; i < N; i++) {
+      x[i] = Dual<D>(ydata[i]);
+      sunindextype g = i % groups - first;
+      if (g >= 0 && g < lanes) x[i].d[g] = 1;
+    }
+    int flag = Problem::rhs(t, (const Dual<D> *) &x[0], &fx[0], user_data);
+    if (flag != 0) return(flag);
+
+    for (int l = 0; l < lanes; l++) {
+      sunindextype g = first + l;
+      if (id == SUNMATRIX_DENSE) {
+        for (sunindextype i = 0; i < N; i++) {
+          SM_ELEMENT_D(J, i, g) = fx[i].d[l];
+        }
+      } else if (id == SUNMATRIX_BAND) {
+        // Row i has the one column of the group within the band.
+        for (sunindextype i = 0; i < N; i++) {
+          sunindextype j = g;
+          if (groups < N) {
+            j = i - ml + ((g - (i - ml)) % groups + groups) % groups;
+          }
+          if (j >= 0 && j < N && i - j <= ml && j - i <= mu) {
+            SM_ELEMENT_B(J, i, j) = fx[i].d[l];
+          }
+        }
+      } else {
+        // Every structural entry, zero or not.
+        SM_INDEXPTRS_S(J)[g] = pattern->colptr[g];
+        for (sunindextype p = pattern->colptr[g]; p < pattern->colptr[g + 1];
+             p++) {
+          sunindextype i = pattern->rowind[p];
+          SM_INDEXVALS_S(J)[p] = i;
+          SM_DATA_S(J)[p] = fx[i].d[l];
+        }
+      }
+    }
+  }
+  if (id == SUNMATRIX_SPARSE) SM_INDEXPTRS_S(J)[N] = pattern->colptr[N];
+
+  return(0);
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+Fills a SolveRecord from the memory of a KINSOL solver.
+
+The KINSpils getters of SUNDIALS 3.x do not check which interface is attached,
+so they are only called for a linear solver of type SUNLINEARSOLVER_ITERATIVE.
+*/
+
+#ifndef KINSOL_STATS_H
+#define KINSOL_STATS_H
+
+#include <kinsol/kinsol.h> // access to KINSOL func., consts.
+#include <kinsol/kinsol_spils.h> // access to KINSpils interface
+
+#include <sundials/sundials_linearsolver.h> // generic SUNLinearSolver
+
+#include "solver_stats.h"
+
+// Sets the solver counters of rec, leaving label, flag, seconds and the timers
+// alone. KINSOL has no time steps, setups or error tests, those stay -1.
+// LS is the linear solver attached to kin_mem, NULL for none. Returns the
+// first negative flag of the KINGet functions, 0 if all succeeded. The
+// KINSpils counters are -1 unless LS is iterative.
+inline int collect_kinsol_stats(void *kin_mem, SUNLinearSolver LS,
+                                SolveRecord *rec) {
+  long int nli, nlcf, njtv, npe, nps;
+  int flag = KINGetNumNonlinSolvIters(kin_mem, &rec->nonlin_iters);
+  if (flag < 0) return(flag);
+  flag = KINGetNumFuncEvals(kin_mem, &rec->rhs_evals);
+  if (flag < 0) return(flag);
+  flag = KINGetNumBacktrackOps(kin_mem, &rec->backtracks);
+  if (flag < 0) return(flag);
+
+  rec->lin_iters = rec->lin_conv_fails = rec->jtv_evals = -1;
+  rec->prec_evals = rec->prec_solves = -1;
+  if (LS == NULL || SUNLinSolGetType(LS) != SUNLINEARSOLVER_ITERATIVE) {
+    return(0);
+  }
+  if (KINSpilsGetNumLinIters(kin_mem, &nli) == KINSPILS_SUCCESS &&
+      KINSpilsGetNumConvFails(kin_mem, &nlcf) == KINSPILS_SUCCESS &&
+      KINSpilsGetNumJtimesEvals(kin_mem, &njtv) == KINSPILS_SUCCESS &&
+      KINSpilsGetNumPrecEvals(kin_mem, &npe) == KINSPILS_SUCCESS &&
+      KINSpilsGetNumPrecSolves(kin_mem, &nps) == KINSPILS_SUCCESS) {
+    rec->lin_iters = nli;
+    rec->lin_conv_fails = nlcf;
+    rec->jtv_evals = njtv;
+    rec->prec_evals = npe;
+    rec->prec_solves = nps;
+  }
+  return(0);
+}
+
+#endif
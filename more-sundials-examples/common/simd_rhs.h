@@ -0,0 +1,445 @@
+/*
+Structure-of-arrays evaluation of a right hand side over many instances of a
+small system, SIMD_LANES instances per evaluation.
+
+The right hand side of one instance is written once as a template over the
+number type, with the parameters of the instance as a second input:
+
+  struct MyModel {
+    static const int N = 2;  // equations of one instance
+    static const int NP = 4; // parameters of one instance
+    template <class T>
+    static int rhs(realtype t, const T *y, const T *p, T *ydot);
+  };
+
+T is SimdLanes<SIMD_LANES>, so one call computes SIMD_LANES instances with
+whole vector instructions, or SimdDual<SIMD_LANES>, which also carries one
+directional derivative per lane. The state of M instances is kept in one
+serial N_Vector, structure-of-arrays as in the ensemble example: component i
+of instance m is entry i*M + m. A vector of one instance (M = 1) is the
+ordinary vector of the system. The parameters are in a SimdBatch with the
+same layout. The functions below turn the model into the SUNDIALS callbacks,
+with the SimdBatch as user_data:
+
+  simd_rhs<MyModel>     CVRhsFn, f of every instance.
+  simd_jtv<MyModel>     CVSpilsJacTimesVecFn, the exact product J*v from one
+                        evaluation with SimdDual.
+  simd_psetup<MyModel>  CVSpilsPrecSetupFn and CVSpilsPrecSolveFn of a block
+  simd_psolve<MyModel>  Jacobi preconditioner, P = I - gamma*J of every
+                        instance from N evaluations with SimdDual, factored
+                        without pivoting. The jacobian is computed on every
+                        call, *jcurPtr is always SUNTRUE.
+
+  SimdBatch batch;
+  simd_batch_resize<MyModel>(&batch, M);
+  CVodeInit(cvode_mem, simd_rhs<MyModel>, t0, y);
+  CVodeSetUserData(cvode_mem, &batch);
+  CVSpilsSetJacTimes(cvode_mem, NULL, simd_jtv<MyModel>);
+  CVSpilsSetPreconditioner(cvode_mem, simd_psetup<MyModel>,
+                           simd_psolve<MyModel>);
+
+rhs has to assign every entry of ydot and may only use the operations defined
+here on T (arithmetic and exp, log, sqrt, pow, sin, cos, tanh, fabs). Only
+the arithmetic is done with vector instructions, the math functions go lane
+by lane. A lane cannot branch on its own values, so rhs may not compare y.
+Call the math functions unqualified, e.g. exp(y[0]). When M is not a multiple
+of SIMD_LANES the last lanes of the last evaluation repeat an instance and
+their results are dropped. The arrays of one evaluation are on the stack, the
+systems should be small (N up to a few dozen).
+
+SimdLanes uses the vector extensions of GCC and Clang. On x86-64 Linux with
+GCC the callbacks are compiled for AVX-512, AVX2 and the baseline and the
+best version is picked at load time, so no -march flag is needed. SIMD_LANES
+is 8 by default, one AVX-512 register of doubles, two AVX2 or four SSE2
+registers.
+
+A failing rhs has its return value passed on, psetup returns 1 (recoverable)
+when a pivot is zero.
+
+Everything is in this header, an example only needs -I ../../common.
+*/
+
+#ifndef SIMD_RHS_H
+#define SIMD_RHS_H
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#if !defined(__GNUC__)
+#error "simd_rhs.h needs the vector extensions of GCC or Clang"
+#endif
+
+// Instances per evaluation.
+#ifndef SIMD_LANES
+#define SIMD_LANES 8
+#endif
+
+// Versions of the callbacks for the instruction sets of x86-64.
+#if defined(__x86_64__) && defined(__linux__) && !defined(__clang__)
+#define SIMD_RHS_CLONES \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define SIMD_RHS_CLONES
+#endif
+
+template <int W>
+struct SimdLanes {
+  typedef realtype vector_type
+      __attribute__((vector_size(W * sizeof(realtype))));
+  vector_type v;
+
+  SimdLanes() : v() {}
+  SimdLanes(realtype value) : v() { v += value; }
+
+  SimdLanes &operator+=(const SimdLanes &b) { v += b.v; return *this; }
+  SimdLanes &operator-=(const SimdLanes &b) { v -= b.v; return *this; }
+  SimdLanes &operator*=(const SimdLanes &b) { v *= b.v; return *this; }
+  SimdLanes &operator/=(const SimdLanes &b) { v /= b.v; return *this; }
+};
+
+template <int W>
+struct SimdDual {
+  SimdLanes<W> v; // values
+  SimdLanes<W> d; // derivatives
+
+  SimdDual() {}
+  SimdDual(realtype value) : v(value) {}
+  SimdDual(const SimdLanes<W> &value) : v(value) {}
+
+  SimdDual &operator+=(const SimdDual &b) {
+    v += b.v;
+    d += b.d;
+    return *this;
+  }
+  SimdDual &operator-=(const SimdDual &b) {
+    v -= b.v;
+    d -= b.d;
+    return *this;
+  }
+  SimdDual &operator*=(const SimdDual &b) {
+    d.v = d.v * b.v.v + v.v * b.d.v;
+    v *= b.v;
+    return *this;
+  }
+  SimdDual &operator/=(const SimdDual &b) {
+    SimdLanes<W> inv(1);
+    inv /= b.v;
+    v *= inv;
+    d.v = (d.v - v.v * b.d.v) * inv.v;
+    return *this;
+  }
+};
+
+// Arithmetic of both types, also with a realtype on either side.
+#define SIMD_RHS_ARITHMETIC(Type) \
+  template <int W> Type<W> operator+(const Type<W> &a) { return a; } \
+  template <int W> Type<W> operator-(const Type<W> &a) { \
+    Type<W> r; \
+    return r -= a; \
+  } \
+  template <int W> Type<W> operator+(const Type<W> &a, const Type<W> &b) { \
+    Type<W> r(a); \
+    return r += b; \
+  } \
+  template <int W> Type<W> operator-(const Type<W> &a, const Type<W> &b) { \
+    Type<W> r(a); \
+    return r -= b; \
+  } \
+  template <int W> Type<W> operator*(const Type<W> &a, const Type<W> &b) { \
+    Type<W> r(a); \
+    return r *= b; \
+  } \
+  template <int W> Type<W> operator/(const Type<W> &a, const Type<W> &b) { \
+    Type<W> r(a); \
+    return r /= b; \
+  } \
+  template <int W> Type<W> operator+(const Type<W> &a, realtype b) { \
+    return a + Type<W>(b); \
+  } \
+  template <int W> Type<W> operator-(const Type<W> &a, realtype b) { \
+    return a - Type<W>(b); \
+  } \
+  template <int W> Type<W> operator*(const Type<W> &a, realtype b) { \
+    return a * Type<W>(b); \
+  } \
+  template <int W> Type<W> operator/(const Type<W> &a, realtype b) { \
+    return a / Type<W>(b); \
+  } \
+  template <int W> Type<W> operator+(realtype a, const Type<W> &b) { \
+    return Type<W>(a) + b; \
+  } \
+  template <int W> Type<W> operator-(realtype a, const Type<W> &b) { \
+    return Type<W>(a) - b; \
+  } \
+  template <int W> Type<W> operator*(realtype a, const Type<W> &b) { \
+    return Type<W>(a) * b; \
+  } \
+  template <int W> Type<W> operator/(realtype a, const Type<W> &b) { \
+    return Type<W>(a) / b; \
+  }
+
+SIMD_RHS_ARITHMETIC(SimdLanes)
+SIMD_RHS_ARITHMETIC(SimdDual)
+
+#undef SIMD_RHS_ARITHMETIC
+
+// Math functions of SimdLanes, one lane at a time.
+#define SIMD_RHS_LANEWISE(name, expr) \
+  template <int W> SimdLanes<W> name(const SimdLanes<W> &a) { \
+    SimdLanes<W> r; \
+    for (int k = 0; k < W; k++) { \
+      realtype x = a.v[k]; \
+      r.v[k] = (expr); \
+    } \
+    return r; \
+  }
+
+SIMD_RHS_LANEWISE(exp, std::exp(x))
+SIMD_RHS_LANEWISE(log, std::log(x))
+SIMD_RHS_LANEWISE(sqrt, std::sqrt(x))
+SIMD_RHS_LANEWISE(sin, std::sin(x))
+SIMD_RHS_LANEWISE(cos, std::cos(x))
+SIMD_RHS_LANEWISE(tanh, std::tanh(x))
+SIMD_RHS_LANEWISE(fabs, std::fabs(x))
+SIMD_RHS_LANEWISE(simd_sign, (x < 0) ? -1.0 : 1.0)
+
+#undef SIMD_RHS_LANEWISE
+
+template <int W> SimdLanes<W> pow(const SimdLanes<W> &a, realtype p) {
+  SimdLanes<W> r;
+  for (int k = 0; k < W; k++) r.v[k] = std::pow(a.v[k], p);
+  return r;
+}
+
+// Math functions of SimdDual, f(a) with derivative f'(a)*a.d.
+template <int W> SimdDual<W> simd_chain(const SimdDual<W> &a,
+                                        const SimdLanes<W> &value,
+                                        const SimdLanes<W> &deriv) {
+  SimdDual<W> r(value);
+  r.d = deriv * a.d;
+  return r;
+}
+template <int W> SimdDual<W> exp(const SimdDual<W> &a) {
+  SimdLanes<W> e = exp(a.v);
+  return simd_chain(a, e, e);
+}
+template <int W> SimdDual<W> log(const SimdDual<W> &a) {
+  return simd_chain(a, log(a.v), 1.0 / a.v);
+}
+template <int W> SimdDual<W> sqrt(const SimdDual<W> &a) {
+  SimdLanes<W> s = sqrt(a.v);
+  return simd_chain(a, s, 0.5 / s);
+}
+template <int W> SimdDual<W> pow(const SimdDual<W> &a, realtype p) {
+  return simd_chain(a, pow(a.v, p), p * pow(a.v, p - 1));
+}
+template <int W> SimdDual<W> sin(const SimdDual<W> &a) {
+  return simd_chain(a, sin(a.v), cos(a.v));
+}
+template <int W> SimdDual<W> cos(const SimdDual<W> &a) {
+  return simd_chain(a, cos(a.v), -sin(a.v));
+}
+template <int W> SimdDual<W> tanh(const SimdDual<W> &a) {
+  SimdLanes<W> th = tanh(a.v);
+  return simd_chain(a, th, 1.0 - th * th);
+}
+template <int W> SimdDual<W> fabs(const SimdDual<W> &a) {
+  return simd_chain(a, fabs(a.v), simd_sign(a.v));
+}
+
+// Parameters of M instances, parameter k of instance m at k*M + m, and the
+// factored preconditioner blocks, entry (i, j) of instance m at
+// (i*N + j)*M + m.
+struct SimdBatch {
+  sunindextype members;
+  std::vector < realtype > params;
+  std::vector < realtype > blocks;
+};
+
+template <class Model>
+void simd_batch_resize(SimdBatch *batch, sunindextype members) {
+  batch->members = members;
+  batch->params.assign((size_t) Model::NP * members, 0);
+  batch->blocks.assign((size_t) Model::N * Model::N * members, 0);
+}
+
+inline realtype &simd_param(SimdBatch *batch, int k, sunindextype m) {
+  return batch->params[(size_t) k * batch->members + m];
+}
+
+// Lanes from count consecutive reals, the missing ones repeat the first.
+template <int W>
+void simd_load(const realtype *src, int count, SimdLanes<W> *x) {
+  if (count == W) {
+    std::memcpy(&x->v, src, sizeof(x->v));
+    return;
+  }
+  for (int k = 0; k < W; k++) x->v[k] = src[(k < count) ? k : 0];
+}
+
+template <int W>
+void simd_store(const SimdLanes<W> &x, int count, realtype *dst) {
+  if (count == W) {
+    std::memcpy(dst, &x.v, sizeof(x.v));
+    return;
+  }
+  for (int k = 0; k < count; k++) dst[k] = x.v[k];
+}
+
+// Room for NP = 0.
+#define SIMD_RHS_PARAMS(Model) ((Model::NP > 0) ? Model::NP : 1)
+
+template <class Model>
+SIMD_RHS_CLONES
+int simd_rhs(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
+  const int W = SIMD_LANES;
+  SimdBatch *batch = (SimdBatch *) user_data;
+  sunindextype M = batch->members;
+  const realtype *ydata = N_VGetArrayPointer(y);
+  realtype *fdata = N_VGetArrayPointer(ydot);
+  SimdLanes<W> x[Model::N], fx[Model::N], p[SIMD_RHS_PARAMS(Model)];
+
+  for (sunindextype m = 0; m < M; m += W) {
+    int count = (M - m < W) ? (int) (M - m) : W;
+    for (int i = 0; i < Model::N; i++) {
+      simd_load(ydata + i * M + m, count, &x[i]);
+    }
+    for (int k = 0; k < Model::NP; k++) {
+      simd_load(&batch->params[k * M + m], count, &p[k]);
+    }
+    int flag = Model::rhs(t, (const SimdLanes<W> *) x,
+                          (const SimdLanes<W> *) p, fx);
+    if (flag != 0) return(flag);
+    for (int i = 0; i < Model::N; i++) {
+      simd_store(fx[i], count, fdata + i * M + m);
+    }
+  }
+
+  return(0);
+}
+
+template <class Model>
+SIMD_RHS_CLONES
+int simd_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector y, N_Vector fy,
+             void *user_data, N_Vector tmp) {
+  const int W = SIMD_LANES;
+  SimdBatch *batch = (SimdBatch *) user_data;
+  sunindextype M = batch->members;
+  const realtype *ydata = N_VGetArrayPointer(y);
+  const realtype *vdata = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  SimdDual<W> x[Model::N], fx[Model::N], p[SIMD_RHS_PARAMS(Model)];
+
+  for (sunindextype m = 0; m < M; m += W) {
+    int count = (M - m < W) ? (int) (M - m) : W;
+    for (int i = 0; i < Model::N; i++) {
+      simd_load(ydata + i * M + m, count, &x[i].v);
+      simd_load(vdata + i * M + m, count, &x[i].d);
+    }
+    for (int k = 0; k < Model::NP; k++) {
+      simd_load(&batch->params[k * M + m], count, &p[k].v);
+    }
+    int flag = Model::rhs(t, (const SimdDual<W> *) x,
+                          (const SimdDual<W> *) p, fx);
+    if (flag != 0) return(flag);
+    for (int i = 0; i < Model::N; i++) {
+      simd_store(fx[i].d, count, Jvdata + i * M + m);
+    }
+  }
+
+  return(0);
+}
+
+template <class Model>
+SIMD_RHS_CLONES
+int simd_psetup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+                booleantype *jcurPtr, realtype gamma, void *user_data) {
+  const int W = SIMD_LANES;
+  const int N = Model::N;
+  SimdBatch *batch = (SimdBatch *) user_data;
+  sunindextype M = batch->members;
+  const realtype *ydata = N_VGetArrayPointer(y);
+  SimdDual<W> x[N], fx[N], p[SIMD_RHS_PARAMS(Model)];
+  SimdLanes<W> A[N * N];
+
+  for (sunindextype m = 0; m < M; m += W) {
+    int count = (M - m < W) ? (int) (M - m) : W;
+    for (int i = 0; i < N; i++) simd_load(ydata + i * M + m, count, &x[i].v);
+    for (int k = 0; k < Model::NP; k++) {
+      simd_load(&batch->params[k * M + m], count, &p[k].v);
+    }
+
+    // Column j of I - gamma*J from the derivative in direction e_j.
+    for (int j = 0; j < N; j++) {
+      for (int i = 0; i < N; i++) x[i].d = SimdLanes<W>(i == j ? 1 : 0);
+      int flag = Model::rhs(t, (const SimdDual<W> *) x,
+                            (const SimdDual<W> *) p, fx);
+      if (flag != 0) return(flag);
+      for (int i = 0; i < N; i++) {
+        A[i * N + j] = SimdLanes<W>(i == j ? 1 : 0) - gamma * fx[i].d;
+      }
+    }
+
+    // LU without pivoting, L below the diagonal with a unit diagonal.
+    for (int k = 0; k < N; k++) {
+      for (int l = 0; l < count; l++) {
+        if (A[k * N + k].v[l] == 0) return(1);
+      }
+      SimdLanes<W> inv = 1.0 / A[k * N + k];
+      for (int i = k + 1; i < N; i++) {
+        A[i * N + k] *= inv;
+        for (int j = k + 1; j < N; j++) {
+          A[i * N + j] -= A[i * N + k] * A[k * N + j];
+        }
+      }
+    }
+    for (int e = 0; e < N * N; e++) {
+      simd_store(A[e], count, &batch->blocks[e * M + m]);
+    }
+  }
+
+  *jcurPtr = SUNTRUE;
+  return(0);
+}
+
+template <class Model>
+SIMD_RHS_CLONES
+int simd_psolve(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z,
+                realtype gamma, realtype delta, int lr, void *user_data) {
+  const int W = SIMD_LANES;
+  const int N = Model::N;
+  SimdBatch *batch = (SimdBatch *) user_data;
+  sunindextype M = batch->members;
+  const realtype *rdata = N_VGetArrayPointer(r);
+  realtype *zdata = N_VGetArrayPointer(z);
+  SimdLanes<W> x[N], a;
+
+  for (sunindextype m = 0; m < M; m += W) {
+    int count = (M - m < W) ? (int) (M - m) : W;
+    for (int i = 0; i < N; i++) simd_load(rdata + i * M + m, count, &x[i]);
+    for (int i = 1; i < N; i++) {
+      for (int j = 0; j < i; j++) {
+        simd_load(&batch->blocks[(i * N + j) * M + m], count, &a);
+        x[i] -= a * x[j];
+      }
+    }
+    for (int i = N - 1; i >= 0; i--) {
+      for (int j = i + 1; j < N; j++) {
+        simd_load(&batch->blocks[(i * N + j) * M + m], count, &a);
+        x[i] -= a * x[j];
+      }
+      simd_load(&batch->blocks[(i * N + i) * M + m], count, &a);
+      x[i] /= a;
+    }
+    for (int i = 0; i < N; i++) simd_store(x[i], count, zdata + i * M + m);
+  }
+
+  return(0);
+}
+
+#undef SIMD_RHS_PARAMS
+
+#endif
@@ -0,0 +1,184 @@
+/*
+Per-solve statistics of the SUNDIALS solvers, for finding slow or failing
+parameter sets.
+
+A SolveRecord holds the counters of one solve (steps, function evaluations,
+linear solver setups, nonlinear and Krylov iterations, failures) and the wall
+time of the solve and of the calls to f and jtv. collect_cvode_stats in
+cvode_stats.h and collect_kinsol_stats in kinsol_stats.h fill in the counters
+from the solver memory after the solve. A counter a solver does not have, or
+that needs a linear solver interface that is not attached, is -1.
+
+The time spent in f and jtv is measured by a StatsTimer at the top of the
+function, which costs two reads of the steady clock per call. Compiling with
+-D SOLVER_STATS_NO_TIMERS turns the timers into no-ops.
+
+A SolveLog collects the records of many solves and writes them as CSV (one
+line per solve, empty fields for -1) or JSON (an array of objects, null for
+-1).
+
+Everything is in headers, an example only needs -I ../../common.
+*/
+
+#ifndef SOLVER_STATS_H
+#define SOLVER_STATS_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct SolveRecord {
+  SolveRecord() { reset(); }
+
+  // Clears all counters, keeps the label.
+  void reset() {
+    flag = 0;
+    seconds = 0;
+    steps = rhs_evals = lin_setups = -1;
+    nonlin_iters = nonlin_conv_fails = err_test_fails = -1;
+    lin_iters = lin_conv_fails = jtv_evals = -1;
+    prec_evals = prec_solves = backtracks = -1;
+    f_calls = jtv_calls = 0;
+    f_seconds = jtv_seconds = 0;
+  }
+
+  std::string label; // e.g. the parameter set of the solve
+  int flag; // return flag of the last solver call
+  double seconds; // wall time of the whole solve
+
+  long int steps; // internal time steps (CVODE)
+  long int rhs_evals; // calls to f by the solver, without difference quotients
+  long int lin_setups; // linear solver setups (CVODE)
+  long int nonlin_iters; // Newton iterations
+  long int nonlin_conv_fails; // Newton convergence failures (CVODE)
+  long int err_test_fails; // local error test failures (CVODE)
+  long int lin_iters; // Krylov iterations
+  long int lin_conv_fails; // Krylov convergence failures
+  long int jtv_evals; // jacobian-times-vector evaluations
+  long int prec_evals, prec_solves; // preconditioner setups and solves
+  long int backtracks; // line search backtracks (KINSOL)
+
+  // Filled by StatsTimer in the user's f and jtv.
+  long int f_calls, jtv_calls;
+  double f_seconds, jtv_seconds;
+};
+
+// Seconds on the steady clock, for timing whole solves.
+inline double stats_now() {
+  return std::chrono::duration < double > (
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Adds one call and the lifetime of the timer to calls and seconds.
+class StatsTimer {
+ public:
+#ifdef SOLVER_STATS_NO_TIMERS
+  StatsTimer(long int &, double &) {}
+#else
+  StatsTimer(long int &calls, double &seconds)
+      : calls_(calls), seconds_(seconds),
+        start_(std::chrono::steady_clock::now()) {}
+  ~StatsTimer() {
+    calls_++;
+    seconds_ += std::chrono::duration < double > (
+        std::chrono::steady_clock::now() - start_).count();
+  }
+
+ private:
+  long int &calls_;
+  double &seconds_;
+  std::chrono::steady_clock::time_point start_;
+#endif
+};
+
+// Field names, in the order of the CSV columns and JSON members.
+#define SOLVE_RECORD_COUNTERS(X) \
+  X(steps) X(rhs_evals) X(lin_setups) X(nonlin_iters) X(nonlin_conv_fails) \
+  X(err_test_fails) X(lin_iters) X(lin_conv_fails) X(jtv_evals) \
+  X(prec_evals) X(prec_solves) X(backtracks) X(f_calls) X(jtv_calls)
+
+inline void write_csv_header(FILE *out) {
+#define SOLVE_RECORD_NAME(name) fprintf(out, "," #name);
+  fprintf(out, "label,flag,seconds");
+  SOLVE_RECORD_COUNTERS(SOLVE_RECORD_NAME)
+  fprintf(out, ",f_seconds,jtv_seconds\n");
+#undef SOLVE_RECORD_NAME
+}
+
+// Labels are written as they are, they should not contain commas.
+inline void write_csv_row(FILE *out, const SolveRecord &rec) {
+#define SOLVE_RECORD_CSV(name) \
+  if (rec.name >= 0) fprintf(out, ",%ld", rec.name); else fprintf(out, ",");
+  fprintf(out, "%s,%d,%.9g", rec.label.c_str(), rec.flag, rec.seconds);
+  SOLVE_RECORD_COUNTERS(SOLVE_RECORD_CSV)
+  fprintf(out, ",%.9g,%.9g\n", rec.f_seconds, rec.jtv_seconds);
+#undef SOLVE_RECORD_CSV
+}
+
+inline void write_json_record(FILE *out, const SolveRecord &rec) {
+#define SOLVE_RECORD_JSON(name) \
+  if (rec.name >= 0) fprintf(out, ", \"" #name "\": %ld", rec.name); \
+  else fprintf(out, ", \"" #name "\": null");
+  fprintf(out, "{\"label\": \"");
+  for (size_t i = 0; i < rec.label.size(); i++) {
+    char c = rec.label[i];
+    if (c == '"' || c == '\\') fputc('\\', out);
+    fputc(c, out);
+  }
+  fprintf(out, "\", \"flag\": %d, \"seconds\": %.9g", rec.flag, rec.seconds);
+  SOLVE_RECORD_COUNTERS(SOLVE_RECORD_JSON)
+  fprintf(out, ", \"f_seconds\": %.9g, \"jtv_seconds\": %.9g}", rec.f_seconds,
+          rec.jtv_seconds);
+#undef SOLVE_RECORD_JSON
+}
+
+// Human readable summary for the examples, counters that are -1 are skipped.
+inline void print_solve_record(FILE *out, const SolveRecord &rec) {
+#define SOLVE_RECORD_PRINT(name) \
+  if (rec.name >= 0) fprintf(out, "  %-18s %ld\n", #name ":", rec.name);
+  fprintf(out, "Solver statistics%s%s:\n", rec.label.empty() ? "" : " of ",
+          rec.label.c_str());
+  fprintf(out, "  %-18s %d\n", "flag:", rec.flag);
+  fprintf(out, "  %-18s %.6g\n", "seconds:", rec.seconds);
+  SOLVE_RECORD_COUNTERS(SOLVE_RECORD_PRINT)
+  fprintf(out, "  %-18s %.6g\n", "f_seconds:", rec.f_seconds);
+  fprintf(out, "  %-18s %.6g\n", "jtv_seconds:", rec.jtv_seconds);
+#undef SOLVE_RECORD_PRINT
+}
+
+class SolveLog {
+ public:
+  void reserve(size_t n) { records_.reserve(n); }
+  void add(const SolveRecord &rec) { records_.push_back(rec); }
+  const std::vector < SolveRecord > &records() const { return records_; }
+
+  // Return 0 on success or -1 if the file cannot be written.
+  int write_csv(const char *path) const {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) return(-1);
+    write_csv_header(out);
+    for (size_t i = 0; i < records_.size(); i++) {
+      write_csv_row(out, records_[i]);
+    }
+    return (fclose(out) == 0) ? 0 : -1;
+  }
+
+  int write_json(const char *path) const {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) return(-1);
+    fprintf(out, "[\n");
+    for (size_t i = 0; i < records_.size(); i++) {
+      fprintf(out, "  ");
+      write_json_record(out, records_[i]);
+      fprintf(out, (i + 1 < records_.size()) ? ",\n" : "\n");
+    }
+    fprintf(out, "]\n");
+    return (fclose(out) == 0) ? 0 : -1;
+  }
+
+ private:
+  std::vector < SolveRecord > records_;
+};
+
+#endif
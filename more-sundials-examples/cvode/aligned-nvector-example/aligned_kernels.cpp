@@ -0,0 +1,394 @@
+#include "aligned_kernels.h"
+
+#include <cstring>
+#include <sundials/sundials_config.h>
+
+// The SIMD kernels are written for double precision on x86 with GCC or clang.
+#if defined(SUNDIALS_DOUBLE_PRECISION) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define ALIGNED_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// The multi-vector kernels handle at most this many vectors per pass.
+#define KERNEL_GROUP 4
+
+
+// -----------------------------------------------------------------------------
+// Scalar kernels, also used for the tails of the SIMD kernels.
+// -----------------------------------------------------------------------------
+
+static void linear_sum_scalar(realtype a, const realtype *x, realtype b,
+                              const realtype *y, realtype *z, sunindextype n) {
+  for (sunindextype i = 0; i < n; i++) z[i] = a * x[i] + b * y[i];
+}
+
+static realtype dot_prod_scalar(const realtype *x, const realtype *y,
+                                sunindextype n) {
+  realtype sum = 0;
+  for (sunindextype i = 0; i < n; i++) sum += x[i] * y[i];
+  return(sum);
+}
+
+static realtype wsq_sum_scalar(const realtype *x, const realtype *w,
+                               sunindextype n) {
+  realtype sum = 0;
+  for (sunindextype i = 0; i < n; i++) {
+    realtype xw = x[i] * w[i];
+    sum += xw * xw;
+  }
+  return(sum);
+}
+
+// The multi-vector scalar kernels take a start index so the SIMD kernels can
+// use them for the remainder.
+static void linear_combination_tail(int nvec, const realtype *c,
+                                    realtype *const *X, realtype *z,
+                                    sunindextype start, sunindextype n) {
+  for (sunindextype i = start; i < n; i++) {
+    realtype sum = c[0] * X[0][i];
+    for (int k = 1; k < nvec; k++) sum += c[k] * X[k][i];
+    z[i] = sum;
+  }
+}
+
+static void scale_add_multi_tail(int nvec, const realtype *a,
+                                 const realtype *x, realtype *const *Y,
+                                 realtype *const *Z, sunindextype start,
+                                 sunindextype n) {
+  for (sunindextype i = start; i < n; i++) {
+    realtype xi = x[i];
+    for (int k = 0; k < nvec; k++) Z[k][i] = a[k] * xi + Y[k][i];
+  }
+}
+
+static void dot_prod_multi_tail(int nvec, const realtype *x,
+                                realtype *const *Y, realtype *d,
+                                sunindextype start, sunindextype n) {
+  for (sunindextype i = start; i < n; i++) {
+    realtype xi = x[i];
+    for (int k = 0; k < nvec; k++) d[k] += xi * Y[k][i];
+  }
+}
+
+static void linear_combination_scalar(int nvec, const realtype *c,
+                                      realtype *const *X, realtype *z,
+                                      sunindextype n) {
+  linear_combination_tail(nvec, c, X, z, 0, n);
+}
+
+static void scale_add_multi_scalar(int nvec, const realtype *a,
+                                   const realtype *x, realtype *const *Y,
+                                   realtype *const *Z, sunindextype n) {
+  scale_add_multi_tail(nvec, a, x, Y, Z, 0, n);
+}
+
+static void dot_prod_multi_scalar(int nvec, const realtype *x,
+                                  realtype *const *Y, realtype *d,
+                                  sunindextype n) {
+  for (int k = 0; k < nvec; k++) d[k] = 0;
+  dot_prod_multi_tail(nvec, x, Y, d, 0, n);
+}
+
+static const AlignedKernels scalar_kernels = {
+  "scalar", linear_sum_scalar, dot_prod_scalar, wsq_sum_scalar,
+  linear_combination_scalar, scale_add_multi_scalar, dot_prod_multi_scalar
+};
+
+#ifdef ALIGNED_KERNELS_X86
+
+// -----------------------------------------------------------------------------
+// AVX2 kernels, 4 doubles per register.
+//
+// The tails are handed to the scalar kernels, which are compiled without AVX.
+// GCC does not always clear the upper register halves before such a call (it
+// skips it for tail calls), and SSE code running with dirty upper halves is
+// several times slower, so every kernel calls _mm256_zeroupper first.
+// -----------------------------------------------------------------------------
+
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+
+AVX2_TARGET static inline double hsum_avx2(__m256d v) {
+  __m128d lo = _mm256_castpd256_pd128(v);
+  __m128d hi = _mm256_extractf128_pd(v, 1);
+  lo = _mm_add_pd(lo, hi);
+  return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+AVX2_TARGET static void linear_sum_avx2(realtype a, const realtype *x,
+                                        realtype b, const realtype *y,
+                                        realtype *z, sunindextype n) {
+  __m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b);
+  sunindextype i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d r = _mm256_mul_pd(vb, _mm256_loadu_pd(y + i));
+    _mm256_storeu_pd(z + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), r));
+  }
+  _mm256_zeroupper();
+  linear_sum_scalar(a, x + i, b, y + i, z + i, n - i);
+}
+
+AVX2_TARGET static realtype dot_prod_avx2(const realtype *x, const realtype *y,
+                                          sunindextype n) {
+  // Two accumulators hide the latency of the fused multiply-add.
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  sunindextype i = 0;
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4),
+                         s1);
+  }
+  double head = hsum_avx2(_mm256_add_pd(s0, s1));
+  _mm256_zeroupper();
+  return head + dot_prod_scalar(x + i, y + i, n - i);
+}
+
+AVX2_TARGET static realtype wsq_sum_avx2(const realtype *x, const realtype *w,
+                                         sunindextype n) {
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  sunindextype i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d p0 = _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(w + i));
+    __m256d p1 = _mm256_mul_pd(_mm256_loadu_pd(x + i + 4),
+                               _mm256_loadu_pd(w + i + 4));
+    s0 = _mm256_fmadd_pd(p0, p0, s0);
+    s1 = _mm256_fmadd_pd(p1, p1, s1);
+  }
+  double head = hsum_avx2(_mm256_add_pd(s0, s1));
+  _mm256_zeroupper();
+  return head + wsq_sum_scalar(x + i, w + i, n - i);
+}
+
+AVX2_TARGET static void linear_combination_avx2(int nvec, const realtype *c,
+                                                realtype *const *X,
+                                                realtype *z, sunindextype n) {
+  sunindextype i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d sum = _mm256_mul_pd(_mm256_set1_pd(c[0]),
+                                _mm256_loadu_pd(X[0] + i));
+    for (int k = 1; k < nvec; k++) {
+      sum = _mm256_fmadd_pd(_mm256_set1_pd(c[k]), _mm256_loadu_pd(X[k] + i),
+                            sum);
+    }
+    _mm256_storeu_pd(z + i, sum);
+  }
+  _mm256_zeroupper();
+  linear_combination_tail(nvec, c, X, z, i, n);
+}
+
+AVX2_TARGET static void scale_add_multi_avx2(int nvec, const realtype *a,
+                                             const realtype *x,
+                                             realtype *const *Y,
+                                             realtype *const *Z,
+                                             sunindextype n) {
+  sunindextype i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d vx = _mm256_loadu_pd(x + i);
+    for (int k = 0; k < nvec; k++) {
+      _mm256_storeu_pd(Z[k] + i, _mm256_fmadd_pd(_mm256_set1_pd(a[k]), vx,
+                                                 _mm256_loadu_pd(Y[k] + i)));
+    }
+  }
+  _mm256_zeroupper();
+  scale_add_multi_tail(nvec, a, x, Y, Z, i, n);
+}
+
+AVX2_TARGET static void dot_prod_multi_avx2(int nvec, const realtype *x,
+                                            realtype *const *Y, realtype *d,
+                                            sunindextype n) {
+  // x is read once for every group of KERNEL_GROUP vectors.
+  for (int k0 = 0; k0 < nvec; k0 += KERNEL_GROUP) {
+    int m = (nvec - k0 < KERNEL_GROUP) ? nvec - k0 : KERNEL_GROUP;
+    __m256d s[KERNEL_GROUP];
+    for (int k = 0; k < m; k++) s[k] = _mm256_setzero_pd();
+    sunindextype i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256d vx = _mm256_loadu_pd(x + i);
+      for (int k = 0; k < m; k++) {
+        s[k] = _mm256_fmadd_pd(vx, _mm256_loadu_pd(Y[k0 + k] + i), s[k]);
+      }
+    }
+    for (int k = 0; k < m; k++) d[k0 + k] = hsum_avx2(s[k]);
+    _mm256_zeroupper();
+    dot_prod_multi_tail(m, x, Y + k0, d + k0, i, n);
+  }
+}
+
+static const AlignedKernels avx2_kernels = {
+  "avx2", linear_sum_avx2, dot_prod_avx2, wsq_sum_avx2,
+  linear_combination_avx2, scale_add_multi_avx2, dot_prod_multi_avx2
+};
+
+// -----------------------------------------------------------------------------
+// AVX-512 kernels, 8 doubles per register.
+// -----------------------------------------------------------------------------
+
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+// Sum of the 8 lanes of v. The intrinsics of GCC 12 that reduce or shuffle
+// a register (_mm512_reduce_add_pd among them) start from an undefined one
+// and trip -Wuninitialized, so the lanes are summed from memory. It runs once
+// per kernel call.
+AVX512_TARGET static inline double hsum_avx512(__m512d v) {
+  double lanes[8];
+  _mm512_storeu_pd(lanes, v);
+  return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+         ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+AVX512_TARGET static void linear_sum_avx512(realtype a, const realtype *x,
+                                            realtype b, const realtype *y,
+                                            realtype *z, sunindextype n) {
+  __m512d va = _mm512_set1_pd(a), vb = _mm512_set1_pd(b);
+  sunindextype i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d r = _mm512_mul_pd(vb, _mm512_loadu_pd(y + i));
+    _mm512_storeu_pd(z + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), r));
+  }
+  _mm256_zeroupper();
+  linear_sum_scalar(a, x + i, b, y + i, z + i, n - i);
+}
+
+AVX512_TARGET static realtype dot_prod_avx512(const realtype *x,
+                                              const realtype *y,
+                                              sunindextype n) {
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  sunindextype i = 0;
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8),
+                         s1);
+  }
+  double head = hsum_avx512(_mm512_add_pd(s0, s1));
+  _mm256_zeroupper();
+  return head + dot_prod_scalar(x + i, y + i, n - i);
+}
+
+AVX512_TARGET static realtype wsq_sum_avx512(const realtype *x,
+                                             const realtype *w,
+                                             sunindextype n) {
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  sunindextype i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512d p0 = _mm512_mul_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(w + i));
+    __m512d p1 = _mm512_mul_pd(_mm512_loadu_pd(x + i + 8),
+                               _mm512_loadu_pd(w + i + 8));
+    s0 = _mm512_fmadd_pd(p0, p0, s0);
+    s1 = _mm512_fmadd_pd(p1, p1, s1);
+  }
+  double head = hsum_avx512(_mm512_add_pd(s0, s1));
+  _mm256_zeroupper();
+  return head + wsq_sum_scalar(x + i, w + i, n - i);
+}
+
+AVX512_TARGET static void linear_combination_avx512(int nvec, const realtype *c,
+                                                    realtype *const *X,
+                                                    realtype *z,
+                                                    sunindextype n) {
+  sunindextype i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d sum = _mm512_mul_pd(_mm512_set1_pd(c[0]),
+                                _mm512_loadu_pd(X[0] + i));
+    for (int k = 1; k < nvec; k++) {
+      sum = _mm512_fmadd_pd(_mm512_set1_pd(c[k]), _mm512_loadu_pd(X[k] + i),
+                            sum);
+    }
+    _mm512_storeu_pd(z + i, sum);
+  }
+  _mm256_zeroupper();
+  linear_combination_tail(nvec, c, X, z, i, n);
+}
+
+AVX512_TARGET static void scale_add_multi_avx512(int nvec, const realtype *a,
+                                                 const realtype *x,
+                                                 realtype *const *Y,
+                                                 realtype *const *Z,
+                                                 sunindextype n) {
+  sunindextype i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d vx = _mm512_loadu_pd(x + i);
+    for (int k = 0; k < nvec; k++) {
+      _mm512_storeu_pd(Z[k] + i, _mm512_fmadd_pd(_mm512_set1_pd(a[k]), vx,
+                                                 _mm512_loadu_pd(Y[k] + i)));
+    }
+  }
+  _mm256_zeroupper();
+  scale_add_multi_tail(nvec, a, x, Y, Z, i, n);
+}
+
+AVX512_TARGET static void dot_prod_multi_avx512(int nvec, const realtype *x,
+                                                realtype *const *Y,
+                                                realtype *d, sunindextype n) {
+  for (int k0 = 0; k0 < nvec; k0 += KERNEL_GROUP) {
+    int m = (nvec - k0 < KERNEL_GROUP) ? nvec - k0 : KERNEL_GROUP;
+    __m512d s[KERNEL_GROUP];
+    for (int k = 0; k < m; k++) s[k] = _mm512_setzero_pd();
+    sunindextype i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m512d vx = _mm512_loadu_pd(x + i);
+      for (int k = 0; k < m; k++) {
+        s[k] = _mm512_fmadd_pd(vx, _mm512_loadu_pd(Y[k0 + k] + i), s[k]);
+      }
+    }
+    for (int k = 0; k < m; k++) d[k0 + k] = hsum_avx512(s[k]);
+    _mm256_zeroupper();
+    dot_prod_multi_tail(m, x, Y + k0, d + k0, i, n);
+  }
+}
+
+static const AlignedKernels avx512_kernels = {
+  "avx512", linear_sum_avx512, dot_prod_avx512, wsq_sum_avx512,
+  linear_combination_avx512, scale_add_multi_avx512, dot_prod_multi_avx512
+};
+
+#endif
+
+// -----------------------------------------------------------------------------
+// Run time dispatch.
+// -----------------------------------------------------------------------------
+
+// Returns the kernels with the given name if the CPU supports them.
+static const AlignedKernels *find_kernels(const char *name) {
+  if (strcmp(name, "scalar") == 0) return &scalar_kernels;
+#ifdef ALIGNED_KERNELS_X86
+  __builtin_cpu_init();
+  if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma")) {
+    return &avx2_kernels;
+  }
+  if (strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f")) {
+    return &avx512_kernels;
+  }
+#endif
+  return NULL;
+}
+
+static const AlignedKernels *best_kernels() {
+  const char *names[] = {"avx512", "avx2"};
+  for (int k = 0; k < 2; k++) {
+    const AlignedKernels *kernels = find_kernels(names[k]);
+    if (kernels != NULL) return kernels;
+  }
+  return &scalar_kernels;
+}
+
+// Set by select_aligned_kernels, which is meant to be called before the
+// vectors are used and not while other threads use them.
+static const AlignedKernels *selected_kernels = NULL;
+
+const AlignedKernels *aligned_kernels() {
+  // The detection runs once, a function local static is thread safe.
+  static const AlignedKernels *best = best_kernels();
+  return (selected_kernels != NULL) ? selected_kernels : best;
+}
+
+const AlignedKernels *aligned_kernels_for(sunindextype n) {
+  return (n < ALIGNED_KERNELS_MIN_LENGTH) ? &scalar_kernels : aligned_kernels();
+}
+
+int select_aligned_kernels(const char *name) {
+  const AlignedKernels *kernels = find_kernels(name);
+  if (kernels == NULL) return(-1);
+  selected_kernels = kernels;
+  return(0);
+}
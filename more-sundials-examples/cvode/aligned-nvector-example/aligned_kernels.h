@@ -0,0 +1,53 @@
+/*
+Loop kernels of the aligned N_Vector. There is a scalar version of every kernel
+and, on x86 with double precision realtype, AVX2 and AVX-512 versions compiled
+with target attributes, so no -march flag is needed. The best version the CPU
+supports is picked at run time on first use.
+
+All kernels work one index at a time across their vector arguments, so an
+output may be the same array as one of the inputs.
+*/
+
+#ifndef ALIGNED_KERNELS_H
+#define ALIGNED_KERNELS_H
+
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+struct AlignedKernels {
+  const char *name;
+
+  // z = a*x + b*y
+  void (*linear_sum)(realtype a, const realtype *x, realtype b,
+                     const realtype *y, realtype *z, sunindextype n);
+  // sum of x*y
+  realtype (*dot_prod)(const realtype *x, const realtype *y, sunindextype n);
+  // sum of (x*w)^2, the weighted norms take the square root
+  realtype (*wsq_sum)(const realtype *x, const realtype *w, sunindextype n);
+  // z = sum of c[k]*X[k]
+  void (*linear_combination)(int nvec, const realtype *c,
+                             realtype *const *X, realtype *z, sunindextype n);
+  // Z[k] = a[k]*x + Y[k]
+  void (*scale_add_multi)(int nvec, const realtype *a, const realtype *x,
+                          realtype *const *Y, realtype *const *Z,
+                          sunindextype n);
+  // d[k] = sum of x*Y[k]
+  void (*dot_prod_multi)(int nvec, const realtype *x, realtype *const *Y,
+                         realtype *d, sunindextype n);
+};
+
+// Kernels in use, selected on the first call.
+const AlignedKernels *aligned_kernels();
+
+// Below this length the SIMD kernels lose to the scalar ones, their setup and
+// the register clearing cost more than the few loop iterations they save.
+#define ALIGNED_KERNELS_MIN_LENGTH 16
+
+// Kernels to use for vectors of length n: the scalar ones for short vectors,
+// aligned_kernels() otherwise.
+const AlignedKernels *aligned_kernels_for(sunindextype n);
+
+// Forces the "scalar", "avx2" or "avx512" kernels. Returns 0 on success or -1
+// if the kernels are not compiled in or not supported by the CPU.
+int select_aligned_kernels(const char *name);
+
+#endif
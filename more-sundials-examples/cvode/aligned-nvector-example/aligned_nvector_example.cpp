@@ -0,0 +1,221 @@
+/*
+The simple CVODE example with the serial N_Vector replaced by the 64-byte
+aligned N_Vector from nvector_aligned.h. With --bench the program instead runs
+a microbenchmark of the aligned vector against the serial one.
+
+Usage: ./executable                      solve the 2d system
+       ./executable --bench [max_length] microbenchmark up to max_length
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include "nvector_aligned.h"  // access to aligned N_Vector
+#include "nvector_benchmark.h"
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+// NV_Ith_A from nvector_aligned.h gives access to the individual components of
+// the data array of an aligned N Vector.
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    sunindextype max_length = (argc > 2) ? std::atol(argv[2]) : 10000000;
+    return(run_nvector_benchmark(max_length) == 0 ? 0 : 1);
+  }
+
+  int flag; // For checking if functions have run properly
+  realtype abstol = 1e-5; // real tolerance of system
+  realtype reltol = 1e-5; // absolute tolerance of system
+
+  // 1. Initialize parallel or multi-threaded environment, if appropriate.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 2. Defining the length of the problem.
+  // ---------------------------------------------------------------------------
+  sunindextype N = 2;
+  // ---------------------------------------------------------------------------
+
+  // 3. Set vector of initial values.
+  // ---------------------------------------------------------------------------
+  N_Vector y; // Problem vector.
+  // Aligned vector instead of N_VNew_Serial(N). CVODE and SPGMR create their
+  // work vectors by cloning y, so they are aligned vectors too.
+  y = N_VNew_Aligned(N);
+  if(check_flag((void *)y, "N_VNew_Aligned", 0)) return(1);
+  NV_Ith_A(y, 0) = 2.0;
+  NV_Ith_A(y, 1) = 1.0;
+  // ---------------------------------------------------------------------------
+
+  // 4. Create CVODE Object.
+  // ---------------------------------------------------------------------------
+  void *cvode_mem = NULL; // Problem dedicated memory.
+  cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  // ---------------------------------------------------------------------------
+
+  // 5. Initialize CVODE solver.
+  // ---------------------------------------------------------------------------
+  realtype t0 = 0; // Initiale value of time.
+  flag = CVodeInit(cvode_mem, f, t0, y);
+  if(check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 6. Specify integration tolerances.
+  // ---------------------------------------------------------------------------
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 7. Set Optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 8. Create Matrix Object.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 9. Create Linear Solver Object.
+  // ---------------------------------------------------------------------------
+  SUNLinearSolver LS;
+  // Here we chose one of the possible linear solver modules. SUNSPMR is an
+  // iterative solver that is designed to be compatible with any nvector
+  // implementation (serial, threaded, parallel,
+  // user-supplied)that supports a minimal subset of operations.
+  LS = SUNSPGMR(y, 0, 0);
+  if(check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 10. Set linear solver optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 11. Attach linear solver module.
+  // ---------------------------------------------------------------------------
+  // CVSpilsSetLinearSolver is for iterative linear solvers.
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return 1;
+  // ---------------------------------------------------------------------------
+
+  // 12. Set linear solver interface optional inputs.
+  // ---------------------------------------------------------------------------
+  // Sets the jacobian-times-vector function.
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if(check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  // ---------------------------------------------------------------------------
+
+  // 13. Specify rootfinding problem.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 14. Advance solution in time.
+  // ---------------------------------------------------------------------------
+  // Have the solution advance over time, but stop to log 100 of the steps.
+  int print_steps = 100;
+  realtype tout;
+  realtype end_time = 50;
+  realtype step_length = end_time / print_steps;
+  realtype t = 0;
+  // loop over output points, call CVode, print results, test for error
+  for (int k = 1; k <= print_steps; k++) {
+    // Output times from k, summing up step_length would drift.
+    tout = k * step_length;
+    flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
+    std::cout << "t: " << t;
+    std::cout << "\ny:";
+    N_VPrint_Aligned(y);
+    if(check_flag(&flag, "CVode", 1)) break;
+  }
+  // ---------------------------------------------------------------------------
+
+  // 15. Get optional outputs.
+  // ---------------------------------------------------------------------------
+  std::cout << "aligned N_Vector kernels: " << N_VKernelName_Aligned() << "\n";
+  // ---------------------------------------------------------------------------
+
+  // 16. Deallocate memory for solution vector.
+  // ---------------------------------------------------------------------------
+  N_VDestroy(y);
+  // ---------------------------------------------------------------------------
+
+  // 17. Free solver memory.
+  // ---------------------------------------------------------------------------
+  CVodeFree(&cvode_mem);
+  // ---------------------------------------------------------------------------
+
+  // 18. Free linear solver and matrix memory.
+  // ---------------------------------------------------------------------------
+  SUNLinSolFree(LS);
+  // ---------------------------------------------------------------------------
+
+  return(0);
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
+  realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
+  realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
+  Jvdata[1] = vdata[0] + 0 * vdata[1];
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,379 @@
+#include "nvector_aligned.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sundials/sundials_config.h>
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "aligned_kernels.h"
+
+// The fused operations are in the operations table from SUNDIALS 3.2 on.
+#if defined(SUNDIALS_VERSION_MAJOR) && (SUNDIALS_VERSION_MAJOR > 3 || \
+    (SUNDIALS_VERSION_MAJOR == 3 && SUNDIALS_VERSION_MINOR >= 2))
+#define NV_ALIGNED_FUSED_OPS
+#endif
+
+// Largest number of vectors handed to the fused kernels without allocating.
+#define NV_ALIGNED_MAX_STACK_VECS 32
+
+static struct _generic_N_Vector_Ops *aligned_ops();
+static realtype *aligned_data(sunindextype length);
+
+
+// -----------------------------------------------------------------------------
+// Constructors, destructor and utilities.
+// -----------------------------------------------------------------------------
+
+N_Vector N_VNewEmpty_Aligned(sunindextype length) {
+  N_Vector v = (N_Vector) malloc(sizeof *v);
+  if (v == NULL) return(NULL);
+  N_VectorContent_Aligned content =
+      (N_VectorContent_Aligned) malloc(sizeof *content);
+  if (content == NULL) { free(v); return(NULL); }
+
+  content->length = length;
+  content->own_data = SUNFALSE;
+  content->data = NULL;
+
+  // Every aligned vector shares one operations table.
+  v->content = content;
+  v->ops = aligned_ops();
+  return(v);
+}
+
+N_Vector N_VNew_Aligned(sunindextype length) {
+  N_Vector v = N_VNewEmpty_Aligned(length);
+  if (v == NULL) return(NULL);
+
+  if (length > 0) {
+    realtype *data = aligned_data(length);
+    if (data == NULL) { N_VDestroy_Aligned(v); return(NULL); }
+    NV_DATA_A(v) = data;
+    NV_CONTENT_A(v)->own_data = SUNTRUE;
+  }
+  return(v);
+}
+
+sunindextype N_VGetLength_Aligned(N_Vector v) {
+  return NV_LENGTH_A(v);
+}
+
+void N_VPrint_Aligned(N_Vector v) {
+  N_VPrintFile_Aligned(v, stdout);
+}
+
+// Same format as N_VPrint_Serial.
+void N_VPrintFile_Aligned(N_Vector v, FILE *outfile) {
+  for (sunindextype i = 0; i < NV_LENGTH_A(v); i++) {
+    fprintf(outfile, "%11.8g\n", (double) NV_Ith_A(v, i));
+  }
+  fprintf(outfile, "\n");
+}
+
+const char *N_VKernelName_Aligned() {
+  return aligned_kernels()->name;
+}
+
+// Allocates length values on a NV_ALIGNMENT_A byte boundary.
+static realtype *aligned_data(sunindextype length) {
+  void *data = NULL;
+  if (posix_memalign(&data, NV_ALIGNMENT_A, length * sizeof(realtype)) != 0) {
+    return(NULL);
+  }
+  return (realtype *) data;
+}
+
+// -----------------------------------------------------------------------------
+// Standard vector operations.
+// -----------------------------------------------------------------------------
+
+N_Vector_ID N_VGetVectorID_Aligned(N_Vector v) {
+  return SUNDIALS_NVEC_CUSTOM;
+}
+
+N_Vector N_VCloneEmpty_Aligned(N_Vector w) {
+  if (w == NULL) return(NULL);
+  return N_VNewEmpty_Aligned(NV_LENGTH_A(w));
+}
+
+N_Vector N_VClone_Aligned(N_Vector w) {
+  if (w == NULL) return(NULL);
+  return N_VNew_Aligned(NV_LENGTH_A(w));
+}
+
+void N_VDestroy_Aligned(N_Vector v) {
+  if (v == NULL) return;
+  if (NV_CONTENT_A(v)->own_data && NV_DATA_A(v) != NULL) free(NV_DATA_A(v));
+  free(v->content);
+  free(v);
+}
+
+void N_VSpace_Aligned(N_Vector v, sunindextype *lrw, sunindextype *liw) {
+  *lrw = NV_LENGTH_A(v);
+  *liw = 1;
+}
+
+realtype *N_VGetArrayPointer_Aligned(N_Vector v) {
+  return NV_DATA_A(v);
+}
+
+// The kernels use unaligned loads, so data set here does not have to be
+// aligned, it is only slower.
+void N_VSetArrayPointer_Aligned(realtype *v_data, N_Vector v) {
+  if (NV_LENGTH_A(v) > 0) NV_DATA_A(v) = v_data;
+}
+
+void N_VLinearSum_Aligned(realtype a, N_Vector x, realtype b, N_Vector y,
+                          N_Vector z) {
+  sunindextype N = NV_LENGTH_A(x);
+  aligned_kernels_for(N)->linear_sum(a, NV_DATA_A(x), b, NV_DATA_A(y),
+                                     NV_DATA_A(z), N);
+}
+
+void N_VConst_Aligned(realtype c, N_Vector z) {
+  realtype *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(z); i++) zd[i] = c;
+}
+
+void N_VProd_Aligned(N_Vector x, N_Vector y, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *yd = NV_DATA_A(y), *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) zd[i] = xd[i] * yd[i];
+}
+
+void N_VDiv_Aligned(N_Vector x, N_Vector y, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *yd = NV_DATA_A(y), *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) zd[i] = xd[i] / yd[i];
+}
+
+void N_VScale_Aligned(realtype c, N_Vector x, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) zd[i] = c * xd[i];
+}
+
+void N_VAbs_Aligned(N_Vector x, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) zd[i] = SUNRabs(xd[i]);
+}
+
+void N_VInv_Aligned(N_Vector x, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) zd[i] = 1.0 / xd[i];
+}
+
+void N_VAddConst_Aligned(N_Vector x, realtype b, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) zd[i] = xd[i] + b;
+}
+
+realtype N_VDotProd_Aligned(N_Vector x, N_Vector y) {
+  sunindextype N = NV_LENGTH_A(x);
+  return aligned_kernels_for(N)->dot_prod(NV_DATA_A(x), NV_DATA_A(y), N);
+}
+
+realtype N_VMaxNorm_Aligned(N_Vector x) {
+  realtype *xd = NV_DATA_A(x);
+  realtype max = 0;
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) {
+    if (SUNRabs(xd[i]) > max) max = SUNRabs(xd[i]);
+  }
+  return(max);
+}
+
+realtype N_VWrmsNorm_Aligned(N_Vector x, N_Vector w) {
+  sunindextype N = NV_LENGTH_A(x);
+  const AlignedKernels *kernels = aligned_kernels_for(N);
+  return SUNRsqrt(kernels->wsq_sum(NV_DATA_A(x), NV_DATA_A(w), N) / N);
+}
+
+realtype N_VWrmsNormMask_Aligned(N_Vector x, N_Vector w, N_Vector id) {
+  realtype *xd = NV_DATA_A(x), *wd = NV_DATA_A(w), *idd = NV_DATA_A(id);
+  sunindextype N = NV_LENGTH_A(x);
+  realtype sum = 0;
+  for (sunindextype i = 0; i < N; i++) {
+    if (idd[i] > 0) sum += SUNSQR(xd[i] * wd[i]);
+  }
+  return SUNRsqrt(sum / N);
+}
+
+realtype N_VMin_Aligned(N_Vector x) {
+  realtype *xd = NV_DATA_A(x);
+  realtype min = xd[0];
+  for (sunindextype i = 1; i < NV_LENGTH_A(x); i++) {
+    if (xd[i] < min) min = xd[i];
+  }
+  return(min);
+}
+
+realtype N_VWL2Norm_Aligned(N_Vector x, N_Vector w) {
+  sunindextype N = NV_LENGTH_A(x);
+  const AlignedKernels *kernels = aligned_kernels_for(N);
+  return SUNRsqrt(kernels->wsq_sum(NV_DATA_A(x), NV_DATA_A(w), N));
+}
+
+realtype N_VL1Norm_Aligned(N_Vector x) {
+  realtype *xd = NV_DATA_A(x);
+  realtype sum = 0;
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) sum += SUNRabs(xd[i]);
+  return(sum);
+}
+
+void N_VCompare_Aligned(realtype c, N_Vector x, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *zd = NV_DATA_A(z);
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) {
+    zd[i] = (SUNRabs(xd[i]) >= c) ? 1.0 : 0.0;
+  }
+}
+
+booleantype N_VInvTest_Aligned(N_Vector x, N_Vector z) {
+  realtype *xd = NV_DATA_A(x), *zd = NV_DATA_A(z);
+  booleantype no_zero = SUNTRUE;
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) {
+    if (xd[i] == 0) no_zero = SUNFALSE;
+    else zd[i] = 1.0 / xd[i];
+  }
+  return(no_zero);
+}
+
+// Same tests as N_VConstrMask_Serial: c = +-2 requires x*c > 0, c = +-1
+// requires x*c >= 0, m is 1 where a constraint fails.
+booleantype N_VConstrMask_Aligned(N_Vector c, N_Vector x, N_Vector m) {
+  realtype *cd = NV_DATA_A(c), *xd = NV_DATA_A(x), *md = NV_DATA_A(m);
+  booleantype test = SUNTRUE;
+  for (sunindextype i = 0; i < NV_LENGTH_A(x); i++) {
+    md[i] = 0;
+    if (cd[i] == 0) continue;
+    if (cd[i] > 1.5 || cd[i] < -1.5) {
+      if (xd[i] * cd[i] <= 0) { test = SUNFALSE; md[i] = 1.0; }
+      continue;
+    }
+    if (cd[i] > 0.5 || cd[i] < -0.5) {
+      if (xd[i] * cd[i] < 0) { test = SUNFALSE; md[i] = 1.0; }
+    }
+  }
+  return(test);
+}
+
+realtype N_VMinQuotient_Aligned(N_Vector num, N_Vector denom) {
+  realtype *nd = NV_DATA_A(num), *dd = NV_DATA_A(denom);
+  booleantype not_evaluated = SUNTRUE;
+  realtype min = BIG_REAL;
+  for (sunindextype i = 0; i < NV_LENGTH_A(num); i++) {
+    if (dd[i] == 0) continue;
+    if (not_evaluated) {
+      min = nd[i] / dd[i];
+      not_evaluated = SUNFALSE;
+    } else {
+      min = SUNMIN(min, nd[i] / dd[i]);
+    }
+  }
+  return(min);
+}
+
+// -----------------------------------------------------------------------------
+// Fused operations. The data pointers of the vector arrays are gathered on the
+// stack and handed to one kernel call, so x is read once instead of once per
+// vector.
+// -----------------------------------------------------------------------------
+
+// Gathers the data pointers of nvec vectors into buf, or into a heap array if
+// nvec is larger than the buffer. Returns NULL if the allocation fails.
+static realtype **gather_data(int nvec, N_Vector *V, realtype **buf) {
+  realtype **data = buf;
+  if (nvec > NV_ALIGNED_MAX_STACK_VECS) {
+    data = (realtype **) malloc(nvec * sizeof(realtype *));
+    if (data == NULL) return(NULL);
+  }
+  for (int k = 0; k < nvec; k++) data[k] = NV_DATA_A(V[k]);
+  return(data);
+}
+
+static void release_data(realtype **data, realtype **buf) {
+  if (data != buf) free(data);
+}
+
+int N_VLinearCombination_Aligned(int nvec, realtype *c, N_Vector *X,
+                                 N_Vector z) {
+  if (nvec < 1) return(-1);
+
+  realtype *buf[NV_ALIGNED_MAX_STACK_VECS];
+  realtype **xd = gather_data(nvec, X, buf);
+  if (xd == NULL) return(-1);
+  sunindextype N = NV_LENGTH_A(z);
+  aligned_kernels_for(N)->linear_combination(nvec, c, xd, NV_DATA_A(z), N);
+  release_data(xd, buf);
+  return(0);
+}
+
+int N_VScaleAddMulti_Aligned(int nvec, realtype *a, N_Vector x, N_Vector *Y,
+                             N_Vector *Z) {
+  if (nvec < 1) return(-1);
+
+  realtype *ybuf[NV_ALIGNED_MAX_STACK_VECS], *zbuf[NV_ALIGNED_MAX_STACK_VECS];
+  realtype **yd = gather_data(nvec, Y, ybuf);
+  if (yd == NULL) return(-1);
+  realtype **zd = gather_data(nvec, Z, zbuf);
+  if (zd == NULL) { release_data(yd, ybuf); return(-1); }
+  sunindextype N = NV_LENGTH_A(x);
+  aligned_kernels_for(N)->scale_add_multi(nvec, a, NV_DATA_A(x), yd, zd, N);
+  release_data(yd, ybuf);
+  release_data(zd, zbuf);
+  return(0);
+}
+
+int N_VDotProdMulti_Aligned(int nvec, N_Vector x, N_Vector *Y,
+                            realtype *dotprods) {
+  if (nvec < 1) return(-1);
+
+  realtype *buf[NV_ALIGNED_MAX_STACK_VECS];
+  realtype **yd = gather_data(nvec, Y, buf);
+  if (yd == NULL) return(-1);
+  sunindextype N = NV_LENGTH_A(x);
+  aligned_kernels_for(N)->dot_prod_multi(nvec, NV_DATA_A(x), yd, dotprods, N);
+  release_data(yd, buf);
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// Operations table.
+// -----------------------------------------------------------------------------
+
+static struct _generic_N_Vector_Ops make_aligned_ops() {
+  struct _generic_N_Vector_Ops ops;
+  memset(&ops, 0, sizeof(ops));
+  ops.nvgetvectorid = N_VGetVectorID_Aligned;
+  ops.nvclone = N_VClone_Aligned;
+  ops.nvcloneempty = N_VCloneEmpty_Aligned;
+  ops.nvdestroy = N_VDestroy_Aligned;
+  ops.nvspace = N_VSpace_Aligned;
+  ops.nvgetarraypointer = N_VGetArrayPointer_Aligned;
+  ops.nvsetarraypointer = N_VSetArrayPointer_Aligned;
+  ops.nvlinearsum = N_VLinearSum_Aligned;
+  ops.nvconst = N_VConst_Aligned;
+  ops.nvprod = N_VProd_Aligned;
+  ops.nvdiv = N_VDiv_Aligned;
+  ops.nvscale = N_VScale_Aligned;
+  ops.nvabs = N_VAbs_Aligned;
+  ops.nvinv = N_VInv_Aligned;
+  ops.nvaddconst = N_VAddConst_Aligned;
+  ops.nvdotprod = N_VDotProd_Aligned;
+  ops.nvmaxnorm = N_VMaxNorm_Aligned;
+  ops.nvwrmsnorm = N_VWrmsNorm_Aligned;
+  ops.nvwrmsnormmask = N_VWrmsNormMask_Aligned;
+  ops.nvmin = N_VMin_Aligned;
+  ops.nvwl2norm = N_VWL2Norm_Aligned;
+  ops.nvl1norm = N_VL1Norm_Aligned;
+  ops.nvcompare = N_VCompare_Aligned;
+  ops.nvinvtest = N_VInvTest_Aligned;
+  ops.nvconstrmask = N_VConstrMask_Aligned;
+  ops.nvminquotient = N_VMinQuotient_Aligned;
+#ifdef NV_ALIGNED_FUSED_OPS
+  ops.nvlinearcombination = N_VLinearCombination_Aligned;
+  ops.nvscaleaddmulti = N_VScaleAddMulti_Aligned;
+  ops.nvdotprodmulti = N_VDotProdMulti_Aligned;
+#endif
+  return(ops);
+}
+
+static struct _generic_N_Vector_Ops *aligned_ops() {
+  static struct _generic_N_Vector_Ops ops = make_aligned_ops();
+  return &ops;
+}
@@ -0,0 +1,93 @@
+/*
+A serial N_Vector whose data is 64-byte aligned (one cache line, one AVX-512
+register). It can be used in place of N_VNew_Serial:
+
+  N_Vector y = N_VNew_Aligned(N);
+  NV_Ith_A(y, 0) = 2.0;
+
+The streaming operations (N_VLinearSum, N_VDotProd, N_VWrmsNorm, N_VWL2Norm)
+and the fused operations N_VLinearCombination, N_VScaleAddMulti and
+N_VDotProdMulti run on AVX2 or AVX-512 kernels chosen at run time (see
+aligned_kernels.h), the remaining operations are plain loops.
+
+The fused operations are part of the N_Vector operations table only from
+SUNDIALS 3.2/4.0 on. With older versions they are still available as the
+*_Aligned functions below, but the integrators do not call them.
+*/
+
+#ifndef NVECTOR_ALIGNED_H
+#define NVECTOR_ALIGNED_H
+
+#include <cstdio>
+#include <sundials/sundials_nvector.h> // generic N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+// Alignment of the data array in bytes.
+#define NV_ALIGNMENT_A 64
+
+struct _N_VectorContent_Aligned {
+  sunindextype length;
+  booleantype own_data;
+  realtype *data;
+};
+
+typedef struct _N_VectorContent_Aligned *N_VectorContent_Aligned;
+
+// These macros give access to the content of an aligned N_Vector, like
+// NV_DATA_S and NV_Ith_S for the serial one.
+#define NV_CONTENT_A(v) ( (N_VectorContent_Aligned)(v->content) )
+#define NV_LENGTH_A(v) ( NV_CONTENT_A(v)->length )
+#define NV_DATA_A(v) ( NV_CONTENT_A(v)->data )
+#define NV_Ith_A(v,i) ( NV_DATA_A(v)[i] )
+
+// Constructors, destructor and utilities.
+N_Vector N_VNewEmpty_Aligned(sunindextype length);
+N_Vector N_VNew_Aligned(sunindextype length);
+sunindextype N_VGetLength_Aligned(N_Vector v);
+void N_VPrint_Aligned(N_Vector v);
+void N_VPrintFile_Aligned(N_Vector v, FILE *outfile);
+
+// Name of the kernels in use: "scalar", "avx2" or "avx512".
+const char *N_VKernelName_Aligned();
+
+// Standard vector operations.
+N_Vector_ID N_VGetVectorID_Aligned(N_Vector v);
+N_Vector N_VCloneEmpty_Aligned(N_Vector w);
+N_Vector N_VClone_Aligned(N_Vector w);
+void N_VDestroy_Aligned(N_Vector v);
+void N_VSpace_Aligned(N_Vector v, sunindextype *lrw, sunindextype *liw);
+realtype *N_VGetArrayPointer_Aligned(N_Vector v);
+void N_VSetArrayPointer_Aligned(realtype *v_data, N_Vector v);
+void N_VLinearSum_Aligned(realtype a, N_Vector x, realtype b, N_Vector y,
+                          N_Vector z);
+void N_VConst_Aligned(realtype c, N_Vector z);
+void N_VProd_Aligned(N_Vector x, N_Vector y, N_Vector z);
+void N_VDiv_Aligned(N_Vector x, N_Vector y, N_Vector z);
+void N_VScale_Aligned(realtype c, N_Vector x, N_Vector z);
+void N_VAbs_Aligned(N_Vector x, N_Vector z);
+void N_VInv_Aligned(N_Vector x, N_Vector z);
+void N_VAddConst_Aligned(N_Vector x, realtype b, N_Vector z);
+realtype N_VDotProd_Aligned(N_Vector x, N_Vector y);
+realtype N_VMaxNorm_Aligned(N_Vector x);
+realtype N_VWrmsNorm_Aligned(N_Vector x, N_Vector w);
+realtype N_VWrmsNormMask_Aligned(N_Vector x, N_Vector w, N_Vector id);
+realtype N_VMin_Aligned(N_Vector x);
+realtype N_VWL2Norm_Aligned(N_Vector x, N_Vector w);
+realtype N_VL1Norm_Aligned(N_Vector x);
+void N_VCompare_Aligned(realtype c, N_Vector x, N_Vector z);
+booleantype N_VInvTest_Aligned(N_Vector x, N_Vector z);
+booleantype N_VConstrMask_Aligned(N_Vector c, N_Vector x, N_Vector m);
+realtype N_VMinQuotient_Aligned(N_Vector num, N_Vector denom);
+
+// Fused operations, they return 0 on success and -1 for nvec < 1.
+// z = sum of c[k]*X[k], z may be X[0]
+int N_VLinearCombination_Aligned(int nvec, realtype *c, N_Vector *X,
+                                 N_Vector z);
+// Z[k] = a[k]*x + Y[k], Z may be Y
+int N_VScaleAddMulti_Aligned(int nvec, realtype *a, N_Vector x, N_Vector *Y,
+                             N_Vector *Z);
+// dotprods[k] = x . Y[k]
+int N_VDotProdMulti_Aligned(int nvec, N_Vector x, N_Vector *Y,
+                            realtype *dotprods);
+
+#endif
@@ -0,0 +1,153 @@
+#include "nvector_benchmark.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include "nvector_aligned.h"
+
+// Number of vectors of the fused operations.
+#define BENCH_NVEC 3
+// Number of timed operations.
+#define BENCH_OPS 6
+
+static const char *op_names[BENCH_OPS] = {
+  "LinearSum", "DotProd", "WrmsNorm",
+  "LinearCombination", "ScaleAddMulti", "DotProdMulti"
+};
+
+// Vectors of one benchmark run, all cloned from the same template.
+struct BenchVectors {
+  N_Vector x, w, z;
+  N_Vector Y[BENCH_NVEC];
+};
+
+static int make_vectors(N_Vector tmpl, BenchVectors &v);
+static void destroy_vectors(BenchVectors &v);
+static void time_ops(BenchVectors &v, bool fused, long int reps,
+                     double *ns_per_call, realtype &sink);
+
+
+int run_nvector_benchmark(sunindextype max_length) {
+  std::cout << "aligned N_Vector kernels: " << N_VKernelName_Aligned() << "\n";
+  std::cout << std::setw(10) << "length" << std::setw(19) << "operation"
+            << std::setw(14) << "serial ns" << std::setw(14) << "aligned ns"
+            << std::setw(10) << "speedup" << "\n";
+
+  realtype sink = 0;
+  for (sunindextype n = 2; n <= max_length;
+       n = (n == 2) ? 10 : n * 10) {
+    // Roughly the same amount of work for every length.
+    long int reps = (long int) (2e7 / n);
+    if (reps < 3) reps = 3;
+
+    // The vectors of one kind are freed before the other kind is created, so
+    // the largest lengths need only one set in memory.
+    double serial_ns[BENCH_OPS], aligned_ns[BENCH_OPS];
+    BenchVectors v;
+
+    N_Vector tmpl = N_VNew_Serial(n);
+    if (tmpl == NULL || make_vectors(tmpl, v) != 0) return(-1);
+    time_ops(v, false, reps, serial_ns, sink);
+    destroy_vectors(v);
+    N_VDestroy(tmpl);
+
+    tmpl = N_VNew_Aligned(n);
+    if (tmpl == NULL || make_vectors(tmpl, v) != 0) return(-1);
+    time_ops(v, true, reps, aligned_ns, sink);
+    destroy_vectors(v);
+    N_VDestroy(tmpl);
+
+    for (int op = 0; op < BENCH_OPS; op++) {
+      std::cout << std::setw(10) << n << std::setw(19) << op_names[op]
+                << std::setw(14) << serial_ns[op]
+                << std::setw(14) << aligned_ns[op]
+                << std::setw(10) << serial_ns[op] / aligned_ns[op] << "\n";
+    }
+  }
+  // Printing the sink keeps the compiler from dropping the reductions.
+  std::cout << "(checksum " << sink << ")\n";
+
+  return(0);
+}
+
+static int make_vectors(N_Vector tmpl, BenchVectors &v) {
+  v.x = N_VClone(tmpl);
+  v.w = N_VClone(tmpl);
+  v.z = N_VClone(tmpl);
+  for (int k = 0; k < BENCH_NVEC; k++) v.Y[k] = N_VClone(tmpl);
+  if (v.x == NULL || v.w == NULL || v.z == NULL) return(-1);
+  for (int k = 0; k < BENCH_NVEC; k++) if (v.Y[k] == NULL) return(-1);
+
+  N_VConst(1.0, v.x);
+  N_VConst(1e-3, v.w);
+  N_VConst(0, v.z);
+  for (int k = 0; k < BENCH_NVEC; k++) N_VConst(0.5 * k, v.Y[k]);
+  return(0);
+}
+
+static void destroy_vectors(BenchVectors &v) {
+  N_VDestroy(v.x);
+  N_VDestroy(v.w);
+  N_VDestroy(v.z);
+  for (int k = 0; k < BENCH_NVEC; k++) N_VDestroy(v.Y[k]);
+}
+
+// Times every operation reps times. With fused == false the fused operations
+// are composed from single vector operations.
+static void time_ops(BenchVectors &v, bool fused, long int reps,
+                     double *ns_per_call, realtype &sink) {
+  realtype c[BENCH_NVEC] = {0.5, -0.25, 0.125};
+  realtype d[BENCH_NVEC];
+
+  for (int op = 0; op < BENCH_OPS; op++) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (long int r = 0; r < reps; r++) {
+      switch (op) {
+        case 0:
+          N_VLinearSum(0.5, v.x, -0.5, v.z, v.z);
+          break;
+        case 1:
+          sink += N_VDotProd(v.x, v.Y[1]);
+          break;
+        case 2:
+          sink += N_VWrmsNorm(v.x, v.w);
+          break;
+        case 3:
+          // z = c0*Y0 + c1*Y1 + c2*Y2
+          if (fused) {
+            N_VLinearCombination_Aligned(BENCH_NVEC, c, v.Y, v.z);
+          } else {
+            N_VScale(c[0], v.Y[0], v.z);
+            for (int k = 1; k < BENCH_NVEC; k++) {
+              N_VLinearSum(c[k], v.Y[k], 1.0, v.z, v.z);
+            }
+          }
+          break;
+        case 4:
+          // Y[k] = c[k]*x + Y[k], the signs alternate so Y stays bounded.
+          if (fused) {
+            N_VScaleAddMulti_Aligned(BENCH_NVEC, c, v.x, v.Y, v.Y);
+          } else {
+            for (int k = 0; k < BENCH_NVEC; k++) {
+              N_VLinearSum(c[k], v.x, 1.0, v.Y[k], v.Y[k]);
+            }
+          }
+          for (int k = 0; k < BENCH_NVEC; k++) c[k] = -c[k];
+          break;
+        case 5:
+          if (fused) {
+            N_VDotProdMulti_Aligned(BENCH_NVEC, v.x, v.Y, d);
+          } else {
+            for (int k = 0; k < BENCH_NVEC; k++) d[k] = N_VDotProd(v.x, v.Y[k]);
+          }
+          sink += d[BENCH_NVEC - 1];
+          break;
+      }
+    }
+    double seconds = std::chrono::duration < double > (
+        std::chrono::steady_clock::now() - start).count();
+    ns_per_call[op] = 1e9 * seconds / reps;
+  }
+}
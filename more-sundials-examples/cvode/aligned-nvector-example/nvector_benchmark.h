@@ -0,0 +1,19 @@
+/*
+Microbenchmark of the aligned N_Vector against the serial N_Vector.
+
+For vector lengths 2, 10, 100, ... up to max_length it times N_VLinearSum,
+N_VDotProd, N_VWrmsNorm and the three fused operations with 3 vectors. The
+serial vector has no fused operations in SUNDIALS 3.x, so for it they are
+composed from N_VScale, N_VLinearSum and N_VDotProd the way the integrators
+do it. Prints nanoseconds per call and the speedup.
+*/
+
+#ifndef NVECTOR_BENCHMARK_H
+#define NVECTOR_BENCHMARK_H
+
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+// Returns 0 on success or -1 if a vector could not be allocated.
+int run_nvector_benchmark(sunindextype max_length);
+
+#endif
@@ -0,0 +1,61 @@
+#include "alloc_count.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+// Zero before any constructor runs, malloc may be called that early.
+static std::atomic < long int > allocations(0);
+
+long int heap_allocations() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+// Only counted when it allocates, not when it shrinks or frees.
+void *realloc(void *ptr, size_t size) {
+  if (size > 0) allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+  if (alignment % sizeof(void *) != 0 ||
+      (alignment & (alignment - 1)) != 0) {
+    return(EINVAL);
+  }
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = __libc_memalign(alignment, size);
+  if (ptr == NULL && size > 0) return(ENOMEM);
+  *memptr = ptr;
+  return(0);
+}
+
+}
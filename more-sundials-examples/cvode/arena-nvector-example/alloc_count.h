@@ -0,0 +1,24 @@
+/*
+Counts the heap allocations of the whole program, including the ones inside
+the SUNDIALS libraries and operator new.
+
+alloc_count.cpp defines malloc, calloc, realloc, posix_memalign,
+aligned_alloc and memalign. The definitions in the executable take the place
+of the ones of the C library for every shared library too, they count the
+call and forward it to glibc's __libc_malloc and friends. This only works
+with glibc, which exports those.
+
+The count of a piece of code is the difference of two calls:
+
+  long int before = heap_allocations();
+  ...
+  long int allocations = heap_allocations() - before;
+*/
+
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+// Allocations of all threads since the start of the program.
+long int heap_allocations();
+
+#endif
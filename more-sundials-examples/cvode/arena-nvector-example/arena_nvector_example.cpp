@@ -0,0 +1,321 @@
+/*
+Heap allocations and throughput of CVODE solves with the arena N_Vector of
+nvector_arena.h against the serial N_Vector.
+
+A 1d diffusion problem with a quadratic decay is solved many times from
+different initial values, and the heap allocations are counted with
+alloc_count.h:
+  serial: every solve creates and frees its N_Vector, CVODE memory and SPGMR
+          linear solver, like main() in the simple example.
+  arena:  the same, but y is an arena vector, so every vector cloned during
+          CVodeInit and SUNSPGMR comes from the thread's arena, which is
+          reset after the solve.
+  steady: one arena vector, CVODE memory and linear solver are created once
+          and every solve only calls CVodeReInit and CVode.
+Both fresh variants are timed on one thread and on all threads, each thread
+with its own arena, since concurrent solves contend on the heap.
+
+Usage: ./executable [solves] [N] [threads]
+*/
+
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "alloc_count.h"
+#include "nvector_arena.h"
+#include "solver_stats.h"  // stats_now
+
+// Vectors of length N an arena is made for, CVODE and SPGMR with the default
+// Krylov dimension clone about 25.
+#define ARENA_VECTORS 64
+
+struct DiffusionData {
+  sunindextype N;
+  realtype d; // diffusion coefficient / h^2
+  realtype k; // decay rate
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static void initial_values(const DiffusionData *data, long int i,
+                           realtype *y0);
+static int solve_fresh(DiffusionData *data, long int i, VectorArena *arena,
+                       realtype *y_out);
+static int solve_steady(DiffusionData *data, long int solves,
+                        VectorArena *arena, long int *allocations);
+static double run_threads(DiffusionData *data, long int solves, int threads,
+                          bool use_arena);
+static void fresh_thread(DiffusionData *data, long int solves, int threads,
+                         int p, bool use_arena, int *failed);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  long int solves = (argc > 1) ? std::atol(argv[1]) : 20000;
+  sunindextype N = (argc > 2) ? std::atol(argv[2]) : 100;
+  int threads = (argc > 3) ? std::atoi(argv[3]) :
+      (int) std::thread::hardware_concurrency();
+  if (solves < 1) solves = 1;
+  if (N < 1) N = 1;
+  if (threads < 1) threads = 1;
+
+  DiffusionData data;
+  data.N = N;
+  data.d = 0.01 * (N + 1) * (N + 1);
+  data.k = 1.0;
+
+  // Allocations of one fresh solve with each vector, and the results of the
+  // two, which have to agree. The first solves set up the operations tables
+  // and are not counted.
+  std::vector < realtype > y_serial(N), y_arena(N);
+  VectorArena arena;
+  if (arena.create(ARENA_VECTORS * N_VArenaBytes_Arena(N)) != 0) return(1);
+  if (solve_fresh(&data, 0, NULL, &y_serial[0]) != 0) return(1);
+  if (solve_fresh(&data, 0, &arena, &y_arena[0]) != 0) return(1);
+  long int before = heap_allocations();
+  if (solve_fresh(&data, 0, NULL, &y_serial[0]) != 0) return(1);
+  long int serial_allocations = heap_allocations() - before;
+  before = heap_allocations();
+  if (solve_fresh(&data, 0, &arena, &y_arena[0]) != 0) return(1);
+  long int arena_allocations = heap_allocations() - before;
+  realtype max_diff = 0;
+  for (sunindextype j = 0; j < N; j++) {
+    max_diff = SUNMAX(max_diff, SUNRabs(y_serial[j] - y_arena[j]));
+  }
+
+  long int steady_allocations;
+  if (solve_steady(&data, solves, &arena, &steady_allocations) != 0) {
+    return(1);
+  }
+
+  printf("N = %ld, solves = %ld, threads = %d\n\n", (long) N, solves, threads);
+  printf("heap allocations per fresh solve: serial %ld, arena %ld\n",
+         serial_allocations, arena_allocations);
+  printf("arena used: %zu bytes (%zu vectors) of %zu\n", arena.high_water(),
+         arena.high_water() / N_VArenaBytes_Arena(N), arena.capacity());
+  printf("largest difference serial - arena: %.2e\n", (double) max_diff);
+  printf("heap allocations in %ld steady state solves: %ld\n\n", solves,
+         steady_allocations);
+
+  printf("%-8s %14s %14s\n", "vector", "solves/s (1)", "solves/s (all)");
+  for (int k = 0; k < 2; k++) {
+    bool use_arena = (k == 1);
+    double one = run_threads(&data, solves, 1, use_arena);
+    double all = run_threads(&data, solves, threads, use_arena);
+    if (one <= 0 || all <= 0) return(1);
+    printf("%-8s %14.0f %14.0f\n", use_arena ? "arena" : "serial",
+           solves / one, solves / all);
+  }
+
+  return(0);
+}
+
+// Solves solves fresh problems on threads threads and returns the wall time,
+// or -1 if a solve failed.
+static double run_threads(DiffusionData *data, long int solves, int threads,
+                          bool use_arena) {
+  std::vector < int > failed(threads, 0);
+  std::vector < std::thread > workers;
+  double start = stats_now();
+  for (int p = 0; p < threads; p++) {
+    workers.push_back(std::thread(fresh_thread, data, solves, threads, p,
+                                  use_arena, &failed[p]));
+  }
+  for (int p = 0; p < threads; p++) workers[p].join();
+  double seconds = stats_now() - start;
+
+  for (int p = 0; p < threads; p++) {
+    if (failed[p]) return(-1);
+  }
+  return(seconds);
+}
+
+// Thread p of run_threads, solves p, p + threads, p + 2*threads, ...
+static void fresh_thread(DiffusionData *data, long int solves, int threads,
+                         int p, bool use_arena, int *failed) {
+  VectorArena arena;
+  if (use_arena &&
+      arena.create(ARENA_VECTORS * N_VArenaBytes_Arena(data->N)) != 0) {
+    *failed = 1;
+    return;
+  }
+  std::vector < realtype > y(data->N);
+  for (long int i = p; i < solves; i += threads) {
+    if (solve_fresh(data, i, use_arena ? &arena : NULL, &y[0]) != 0) {
+      *failed = 1;
+      return;
+    }
+  }
+}
+
+// Initial values of solve i, a parabola whose height depends on i.
+static void initial_values(const DiffusionData *data, long int i,
+                           realtype *y0) {
+  realtype amplitude = 1.0 + 0.001 * (i % 1000);
+  for (sunindextype j = 0; j < data->N; j++) {
+    realtype x = (j + 1.0) / (data->N + 1);
+    y0[j] = amplitude * x * (1.0 - x) * 4.0;
+  }
+}
+
+// Full setup and teardown around one solve. With an arena, y and all its
+// clones come from it and are given back with one reset.
+static int solve_fresh(DiffusionData *data, long int i, VectorArena *arena,
+                       realtype *y_out) {
+  int flag;
+  sunindextype N = data->N;
+
+  N_Vector y = (arena != NULL) ? N_VNew_Arena(N, arena) : N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew", 0)) return(1);
+  initial_values(data, i, NV_DATA_S(y));
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, 1e-5, 1e-8);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  SUNLinearSolver LS = SUNSPGMR(y, 0, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  realtype t;
+  flag = CVode(cvode_mem, 1.0, y, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(1);
+  for (sunindextype j = 0; j < N; j++) y_out[j] = NV_DATA_S(y)[j];
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  if (arena != NULL) arena->reset();
+  return(0);
+}
+
+// Objects created once, then solves solves with CVodeReInit. Only the solves
+// are counted.
+static int solve_steady(DiffusionData *data, long int solves,
+                        VectorArena *arena, long int *allocations) {
+  int flag;
+  sunindextype N = data->N;
+
+  N_Vector y = N_VNew_Arena(N, arena);
+  if (check_flag((void *)y, "N_VNew_Arena", 0)) return(1);
+  initial_values(data, 0, NV_DATA_S(y));
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, 1e-5, 1e-8);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  SUNLinearSolver LS = SUNSPGMR(y, 0, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  long int before = heap_allocations();
+  for (long int i = 0; i < solves; i++) {
+    initial_values(data, i, NV_DATA_S(y));
+    flag = CVodeReInit(cvode_mem, 0, y);
+    if (check_flag(&flag, "CVodeReInit", 1)) return(1);
+    realtype t;
+    flag = CVode(cvode_mem, 1.0, y, &t, CV_NORMAL);
+    if (check_flag(&flag, "CVode", 1)) return(1);
+  }
+  *allocations = heap_allocations() - before;
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  arena->reset();
+  return(0);
+}
+
+// 1d diffusion with a quadratic decay, zero at both ends of the domain.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  sunindextype N = data->N;
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left  = (i > 0) ? udata[i - 1] : 0;
+    realtype right = (i < N - 1) ? udata[i + 1] : 0;
+    dudata[i] = data->d * (left - 2.0 * udata[i] + right)
+                - data->k * udata[i] * udata[i];
+  }
+
+  return(0);
+}
+
+// Jacobian function vector routine of the diffusion-reaction problem.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  sunindextype N = data->N;
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left  = (i > 0) ? vdata[i - 1] : 0;
+    realtype right = (i < N - 1) ? vdata[i + 1] : 0;
+    Jvdata[i] = data->d * (left - 2.0 * vdata[i] + right)
+                - 2.0 * data->k * udata[i] * vdata[i];
+  }
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
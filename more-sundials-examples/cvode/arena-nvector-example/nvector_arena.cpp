@@ -0,0 +1,82 @@
+#include "nvector_arena.h"
+
+// Size of the N_Vector and its content at the start of a piece, the data
+// follows on the next aligned address.
+static const size_t arena_header_bytes =
+    (sizeof(struct _generic_N_Vector) + sizeof(struct _N_VectorContent_Arena) +
+     ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+static struct _generic_N_Vector_Ops *arena_ops();
+static N_Vector arena_vector(sunindextype length, VectorArena *arena,
+                             bool with_data);
+
+
+N_Vector N_VNewEmpty_Arena(sunindextype length, VectorArena *arena) {
+  return arena_vector(length, arena, false);
+}
+
+N_Vector N_VNew_Arena(sunindextype length, VectorArena *arena) {
+  return arena_vector(length, arena, true);
+}
+
+size_t N_VArenaBytes_Arena(sunindextype length) {
+  size_t data = length * sizeof(realtype);
+  return arena_header_bytes +
+      (data + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+N_Vector N_VCloneEmpty_Arena(N_Vector w) {
+  if (w == NULL) return(NULL);
+  return arena_vector(NV_LENGTH_S(w), NV_ARENA_AR(w), false);
+}
+
+N_Vector N_VClone_Arena(N_Vector w) {
+  if (w == NULL) return(NULL);
+  return arena_vector(NV_LENGTH_S(w), NV_ARENA_AR(w), true);
+}
+
+// The memory goes back to the arena with VectorArena::reset.
+void N_VDestroy_Arena(N_Vector v) {}
+
+// One piece of the arena holds the N_Vector, the content and the data.
+static N_Vector arena_vector(sunindextype length, VectorArena *arena,
+                             bool with_data) {
+  if (arena == NULL || arena_ops() == NULL) return(NULL);
+  size_t bytes = with_data ? N_VArenaBytes_Arena(length) : arena_header_bytes;
+  char *piece = (char *) arena->allocate(bytes);
+  if (piece == NULL) return(NULL);
+
+  N_Vector v = (N_Vector) piece;
+  N_VectorContent_Arena content =
+      (N_VectorContent_Arena) (piece + sizeof(struct _generic_N_Vector));
+  content->length = length;
+  // own_data stays false, the arena owns the data.
+  content->own_data = SUNFALSE;
+  content->data = (with_data && length > 0) ?
+      (realtype *) (piece + arena_header_bytes) : NULL;
+  content->arena = arena;
+
+  v->content = content;
+  v->ops = arena_ops();
+  return(v);
+}
+
+// The operations table of the serial N_Vector with clone and destroy
+// replaced. It is copied from a serial vector once, so it has every
+// operation of the SUNDIALS version in use.
+static struct _generic_N_Vector_Ops *make_arena_ops() {
+  N_Vector w = N_VNewEmpty_Serial(0);
+  if (w == NULL) return(NULL);
+  static struct _generic_N_Vector_Ops ops = *w->ops;
+  N_VDestroy(w);
+
+  ops.nvclone = N_VClone_Arena;
+  ops.nvcloneempty = N_VCloneEmpty_Arena;
+  ops.nvdestroy = N_VDestroy_Arena;
+  return(&ops);
+}
+
+static struct _generic_N_Vector_Ops *arena_ops() {
+  static struct _generic_N_Vector_Ops *ops = make_arena_ops();
+  return(ops);
+}
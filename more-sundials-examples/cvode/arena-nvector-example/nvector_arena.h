@@ -0,0 +1,57 @@
+/*
+A serial N_Vector whose memory comes from a VectorArena (vector_arena.h)
+instead of the heap. It can be used in place of N_VNew_Serial:
+
+  VectorArena arena;
+  arena.create(64 * N_VArenaBytes_Arena(N));
+  N_Vector y = N_VNew_Arena(N, &arena);
+
+Every vector that CVODE and the linear solver clone from y (N_VClone and
+N_VCloneVectorArray during CVodeInit and SUNSPGMR) is placed in the same
+arena. The N_Vector, its content and its data are one piece of the arena, so
+a vector costs no heap allocation at all. N_VDestroy does nothing, the memory
+of all vectors is given back at once with VectorArena::reset or when the
+arena is destroyed. The vectors must not be used after that.
+
+The content starts with the fields of the serial content, so NV_DATA_S and
+NV_Ith_S work on these vectors and the vector operations are the ones of the
+serial N_Vector. N_VGetVectorID returns SUNDIALS_NVEC_SERIAL for the same
+reason, which lets the dense and band linear solvers accept the vectors.
+*/
+
+#ifndef NVECTOR_ARENA_H
+#define NVECTOR_ARENA_H
+
+#include <cstddef>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_nvector.h> // generic N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include "vector_arena.h"
+
+struct _N_VectorContent_Arena {
+  // Same layout as _N_VectorContent_Serial.
+  sunindextype length;
+  booleantype own_data;
+  realtype *data;
+  // Where the clones of this vector go.
+  VectorArena *arena;
+};
+
+typedef struct _N_VectorContent_Arena *N_VectorContent_Arena;
+
+#define NV_CONTENT_AR(v) ( (N_VectorContent_Arena)(v->content) )
+#define NV_ARENA_AR(v) ( NV_CONTENT_AR(v)->arena )
+
+// Return NULL when the arena is full.
+N_Vector N_VNewEmpty_Arena(sunindextype length, VectorArena *arena);
+N_Vector N_VNew_Arena(sunindextype length, VectorArena *arena);
+
+// Bytes of the arena taken by one vector of the given length.
+size_t N_VArenaBytes_Arena(sunindextype length);
+
+// The operations that differ from the serial N_Vector.
+N_Vector N_VCloneEmpty_Arena(N_Vector w);
+N_Vector N_VClone_Arena(N_Vector w);
+void N_VDestroy_Arena(N_Vector v);
+
+#endif
@@ -0,0 +1,47 @@
+#include "vector_arena.h"
+
+#include <cstdlib>
+
+VectorArena::VectorArena()
+    : block_(NULL), capacity_(0), used_(0), high_water_(0),
+      num_allocations_(0), num_resets_(0) {}
+
+VectorArena::~VectorArena() {
+  free(block_);
+}
+
+int VectorArena::create(size_t capacity) {
+  free(block_);
+  block_ = NULL;
+  capacity_ = 0;
+  used_ = 0;
+  high_water_ = 0;
+
+  // Round up so the block ends on an aligned piece.
+  capacity = (capacity + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT *
+      ARENA_ALIGNMENT;
+  void *block = NULL;
+  if (capacity == 0 || posix_memalign(&block, ARENA_ALIGNMENT, capacity) != 0) {
+    return(-1);
+  }
+  block_ = (char *) block;
+  capacity_ = capacity;
+  return(0);
+}
+
+void *VectorArena::allocate(size_t bytes) {
+  size_t size = (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT *
+      ARENA_ALIGNMENT;
+  if (size == 0 || size > capacity_ - used_) return(NULL);
+
+  void *piece = block_ + used_;
+  used_ += size;
+  if (used_ > high_water_) high_water_ = used_;
+  num_allocations_++;
+  return(piece);
+}
+
+void VectorArena::reset() {
+  used_ = 0;
+  num_resets_++;
+}
@@ -0,0 +1,52 @@
+/*
+A bump allocator over one block of memory. create() allocates the block once,
+allocate() hands out pieces of it by moving a pointer forward, and reset()
+gives back every piece at once, without a call to free for each of them.
+
+An arena belongs to one solver context (one thread), it is not thread safe.
+allocate() returns NULL once the block is full, the arena never grows.
+*/
+
+#ifndef VECTOR_ARENA_H
+#define VECTOR_ARENA_H
+
+#include <cstddef>
+
+// Alignment of every piece in bytes (one cache line).
+#define ARENA_ALIGNMENT 64
+
+class VectorArena {
+ public:
+  VectorArena();
+  ~VectorArena(); // frees the block
+
+  // Allocates the block of capacity bytes. Returns 0 on success, -1 on
+  // failure.
+  int create(size_t capacity);
+
+  void *allocate(size_t bytes);
+
+  // Every piece handed out so far becomes invalid.
+  void reset();
+
+  size_t capacity() const { return capacity_; }
+  size_t used() const { return used_; }
+  // Largest used() since create(), to size the block of the next arena.
+  size_t high_water() const { return high_water_; }
+  long int num_allocations() const { return num_allocations_; }
+  long int num_resets() const { return num_resets_; }
+
+ private:
+  // The arena owns its block, copying it would free it twice.
+  VectorArena(const VectorArena&);
+  VectorArena& operator=(const VectorArena&);
+
+  char *block_;
+  size_t capacity_;
+  size_t used_;
+  size_t high_water_;
+  long int num_allocations_;
+  long int num_resets_;
+};
+
+#endif
@@ -0,0 +1,182 @@
+/*
+Puts CVODE behind the AsyncSolver of async_solver.h the way a request
+handler would use it.
+
+One solve of the stiff 2d system of the simple example is first submitted
+with submit_future and waited for. Then several producer threads submit
+requests (the same system with different initial values, 10 output times
+up to t = 50) with try_submit, at a given total rate or as fast as they can,
+and retry a request the queue rejects. The main thread consumes the results
+as they finish and records their end-to-end latency.
+
+Printed are the requests per second, how often the request queue rejected a
+request and the result queue held a worker back, and p50, p99 and the
+largest time in the request queue, in the solve and end to end.
+
+Usage: ./executable [workers] [requests] [producers] [qps] [queue_capacity]
+
+qps = 0 submits as fast as possible. queue_capacity is the size of both
+queues.
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "async_solver.h"
+#include "solver_stats.h"  // stats_now
+
+// What one producer thread submits.
+struct ProducerArgs {
+  AsyncSolver *solver;
+  long int first; // index of the first request
+  long int count;
+  double interval; // seconds between two requests, 0 for no pacing
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static AsyncProblem make_problem(long int index, long int requests);
+static void producer(ProducerArgs args, long int total);
+static void print_latency(const char *name, const LatencyHistogram &h);
+
+
+int main(int argc, char *argv[]) {
+  int workers = (argc > 1) ? std::atoi(argv[1]) :
+      (int) std::thread::hardware_concurrency();
+  long int requests = (argc > 2) ? std::atol(argv[2]) : 100000;
+  int producers = (argc > 3) ? std::atoi(argv[3]) : 2;
+  double qps = (argc > 4) ? std::atof(argv[4]) : 0;
+  long int capacity = (argc > 5) ? std::atol(argv[5]) : 1024;
+  if (workers < 1) workers = 1;
+  if (requests < 1) requests = 1;
+  if (producers < 1) producers = 1;
+  if (capacity < 2) capacity = 2;
+
+  AsyncSolver solver(workers, capacity, capacity);
+
+  // One request through a future.
+  std::future < AsyncResult > future =
+      solver.submit_future(make_problem(0, 1));
+  AsyncResult first = future.get();
+  // A failed solve may have no output to print.
+  if (first.flag < 0 || first.t.empty() || first.y.size() < 2) {
+    printf("future: failed with flag %d\n\n", first.flag);
+  } else {
+    printf("future: flag %d, t = %g, y = (%g, %g), %ld steps, %.1f us\n\n",
+           first.flag, (double) first.t.back(),
+           (double) first.y[first.y.size() - 2], (double) first.y.back(),
+           first.nsteps, 1e6 * (first.queued_seconds + first.solve_seconds));
+  }
+
+  // The load: producers submit, this thread consumes.
+  double start = stats_now();
+  std::vector < std::thread > threads;
+  for (int p = 0; p < producers; p++) {
+    ProducerArgs args;
+    args.solver = &solver;
+    args.first = requests * p / producers;
+    args.count = requests * (p + 1) / producers - args.first;
+    args.interval = (qps > 0) ? producers / qps : 0;
+    threads.push_back(std::thread(producer, args, requests));
+  }
+
+  LatencyHistogram end_to_end;
+  long int failed = 0;
+  for (long int received = 0; received < requests; received++) {
+    AsyncResult result;
+    solver.wait_result(result);
+    end_to_end.record(stats_now() - result.submitted);
+    if (result.flag < 0) failed++;
+  }
+  double seconds = stats_now() - start;
+  for (size_t p = 0; p < threads.size(); p++) threads[p].join();
+
+  printf("%d workers, %d producers, queues of %ld\n", workers, producers,
+         (long) capacity);
+  printf("%ld requests in %.3f s, %.0f requests/s", requests, seconds,
+         requests / seconds);
+  if (qps > 0) printf(" (offered %.0f)", qps);
+  printf("\nrejected submits: %ld, stalled results: %ld, failed: %ld\n\n",
+         solver.rejected(), solver.stalled(), failed);
+  printf("%-11s %10s %10s %10s %10s\n", "latency", "p50 us", "p99 us",
+         "max us", "mean us");
+  // The first entry also holds the request of the future.
+  print_latency("queue", solver.queue_latency());
+  print_latency("solve", solver.solve_latency());
+  print_latency("end to end", end_to_end);
+
+  return(failed > 0);
+}
+
+// Submits args.count requests, at most one per args.interval seconds.
+// try_submit is retried after a short pause while the queue is full, as a
+// client would on a "busy" answer.
+static void producer(ProducerArgs args, long int total) {
+  double start = stats_now();
+  for (long int i = 0; i < args.count; i++) {
+    if (args.interval > 0) {
+      double wait = start + i * args.interval - stats_now();
+      if (wait > 0) {
+        std::this_thread::sleep_for(std::chrono::duration < double >(wait));
+      }
+    }
+    AsyncProblem problem = make_problem(args.first + i, total);
+    while (args.solver->try_submit(problem) < 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+  }
+}
+
+// The stiff 2d system with initial values spread around (2, 1).
+static AsyncProblem make_problem(long int index, long int requests) {
+  AsyncProblem p;
+  realtype s = (realtype) index / requests;
+  p.N = 2;
+  p.f = f;
+  p.jtv = jtv;
+  p.user_data = NULL;
+  p.y0.resize(2);
+  p.y0[0] = 2.0 + s;
+  p.y0[1] = 1.0 - s;
+  p.t0 = 0;
+  p.tout = 50;
+  p.outputs = 10;
+  p.reltol = 1e-5;
+  p.abstol = 1e-5;
+  return p;
+}
+
+static void print_latency(const char *name, const LatencyHistogram &h) {
+  printf("%-11s %10.1f %10.1f %10.1f %10.1f\n", name,
+         1e6 * h.percentile(0.5), 1e6 * h.percentile(0.99), 1e6 * h.max(),
+         1e6 * h.mean());
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
+  realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
+  realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
+  Jvdata[1] = vdata[0] + 0 * vdata[1];
+
+  return(0);
+}
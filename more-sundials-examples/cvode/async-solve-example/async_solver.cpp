@@ -0,0 +1,311 @@
+#include "async_solver.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include "solver_stats.h"  // stats_now
+
+static void backoff(int &spins);
+static int rhs_trampoline(realtype t, N_Vector y, N_Vector ydot,
+                          void *user_data);
+static int jtv_trampoline(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                          N_Vector fy, void *user_data, N_Vector tmp);
+static int create_context(WorkerContext &ctx, const AsyncProblem &p);
+static void free_context(WorkerContext &ctx);
+static int solve_problem(WorkerContext &ctx, const AsyncProblem &p,
+                         AsyncResult &r);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+AsyncSolver::AsyncSolver(int num_workers, size_t request_capacity,
+                         size_t result_capacity)
+    : requests_(request_capacity), results_(result_capacity), next_token_(0),
+      rejected_(0), stalled_(0), shutdown_(false), sleepers_(0) {
+  if (num_workers < 1) num_workers = 1;
+  for (int i = 0; i < num_workers; i++) {
+    Worker *w = new Worker();
+    w->ctx.N = 0;
+    w->ctx.y = NULL;
+    w->ctx.cvode_mem = NULL;
+    w->ctx.LS = NULL;
+    w->ctx.problem = NULL;
+    workers_.push_back(w);
+  }
+  for (int i = 0; i < num_workers; i++) {
+    workers_[i]->thread = std::thread(&AsyncSolver::worker_loop, this, i);
+  }
+}
+
+AsyncSolver::~AsyncSolver() {
+  shutdown_.store(true);
+  {
+    std::lock_guard < std::mutex > guard(idle_lock_);
+    idle_.notify_all();
+  }
+  for (size_t i = 0; i < workers_.size(); i++) {
+    workers_[i]->thread.join();
+    free_context(workers_[i]->ctx);
+    delete workers_[i];
+  }
+}
+
+long int AsyncSolver::try_submit(const AsyncProblem &problem) {
+  Task task;
+  task.problem = problem;
+  return push_task(task, false);
+}
+
+long int AsyncSolver::submit(const AsyncProblem &problem) {
+  Task task;
+  task.problem = problem;
+  return push_task(task, true);
+}
+
+std::future < AsyncResult > AsyncSolver::submit_future(
+    const AsyncProblem &problem) {
+  Task task;
+  task.problem = problem;
+  task.promise.reset(new std::promise < AsyncResult >());
+  std::future < AsyncResult > future = task.promise->get_future();
+  push_task(task, true);
+  return future;
+}
+
+bool AsyncSolver::poll(AsyncResult &result) {
+  return results_.try_pop(result);
+}
+
+void AsyncSolver::wait_result(AsyncResult &result) {
+  int spins = 0;
+  while (!results_.try_pop(result)) backoff(spins);
+}
+
+// Queues task, waiting for room if wait is set, and wakes a sleeping worker.
+long int AsyncSolver::push_task(Task &task, bool wait) {
+  long int token = next_token_.fetch_add(1);
+  task.token = token;
+  task.submitted = stats_now();
+
+  int spins = 0;
+  while (!requests_.try_push(task)) {
+    if (!wait) {
+      rejected_.fetch_add(1);
+      return(-1);
+    }
+    backoff(spins);
+  }
+
+  // Pairs with the fence in next_task: either this thread sees the sleeper
+  // or the sleeper sees the task.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers_.load() > 0) {
+    std::lock_guard < std::mutex > guard(idle_lock_);
+    idle_.notify_one();
+  }
+  return(token);
+}
+
+void AsyncSolver::worker_loop(int id) {
+  Worker *w = workers_[id];
+  Task task;
+
+  while (next_task(task)) {
+    AsyncResult result;
+    double start = stats_now();
+    result.token = task.token;
+    result.submitted = task.submitted;
+    result.queued_seconds = start - task.submitted;
+    solve_problem(w->ctx, task.problem, result);
+    result.worker = id;
+    result.solve_seconds = stats_now() - start;
+    queue_latency_.record(result.queued_seconds);
+    solve_latency_.record(result.solve_seconds);
+
+    if (task.promise) {
+      task.promise->set_value(result);
+      task.promise.reset();
+      continue;
+    }
+
+    // A full result queue holds the worker back until a consumer polls.
+    int spins = 0;
+    bool counted = false;
+    while (!results_.try_push(result)) {
+      if (shutdown_.load()) return;
+      if (!counted) stalled_.fetch_add(1);
+      counted = true;
+      backoff(spins);
+    }
+  }
+}
+
+// Takes the next request. A worker that finds none for a while sleeps until
+// submit wakes it. Returns false on shutdown.
+bool AsyncSolver::next_task(Task &task) {
+  int spins = 0;
+  for (;;) {
+    if (shutdown_.load()) return false;
+    if (requests_.try_pop(task)) return true;
+    if (spins < 64) {
+      spins++;
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock < std::mutex > lock(idle_lock_);
+    sleepers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool found = requests_.try_pop(task);
+    if (!found && !shutdown_.load()) idle_.wait(lock);
+    sleepers_.fetch_sub(1);
+    if (found) return true;
+    spins = 0;
+  }
+}
+
+// Yields for the first waits, then sleeps for 50 us at a time.
+static void backoff(int &spins) {
+  if (spins < 64) {
+    spins++;
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
+
+// CVODE always calls these two with the worker context as user data, they
+// forward to the functions of the problem being solved.
+static int rhs_trampoline(realtype t, N_Vector y, N_Vector ydot,
+                          void *user_data) {
+  WorkerContext *ctx = (WorkerContext*) user_data;
+  return ctx->problem->f(t, y, ydot, ctx->problem->user_data);
+}
+
+static int jtv_trampoline(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                          N_Vector fy, void *user_data, N_Vector tmp) {
+  WorkerContext *ctx = (WorkerContext*) user_data;
+  return ctx->problem->jtv(v, Jv, t, y, fy, ctx->problem->user_data, tmp);
+}
+
+// Builds the vector, CVODE object and linear solver for problems of size p.N,
+// following steps 3 to 11 of the simple example.
+static int create_context(WorkerContext &ctx, const AsyncProblem &p) {
+  int flag;
+
+  free_context(ctx);
+  ctx.N = p.N;
+
+  ctx.y = N_VNew_Serial(p.N);
+  if (check_flag((void *)ctx.y, "N_VNew_Serial", 0)) return(1);
+  for (sunindextype i = 0; i < p.N; i++) NV_DATA_S(ctx.y)[i] = p.y0[i];
+
+  ctx.cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)ctx.cvode_mem, "CVodeCreate", 0)) return(1);
+
+  flag = CVodeInit(ctx.cvode_mem, rhs_trampoline, p.t0, ctx.y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+
+  flag = CVodeSetUserData(ctx.cvode_mem, &ctx);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+
+  ctx.LS = SUNSPGMR(ctx.y, 0, 0);
+  if (check_flag((void *)ctx.LS, "SUNSPGMR", 0)) return(1);
+
+  flag = CVSpilsSetLinearSolver(ctx.cvode_mem, ctx.LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+
+  return(0);
+}
+
+static void free_context(WorkerContext &ctx) {
+  if (ctx.y != NULL) N_VDestroy(ctx.y);
+  if (ctx.cvode_mem != NULL) CVodeFree(&ctx.cvode_mem);
+  if (ctx.LS != NULL) SUNLinSolFree(ctx.LS);
+  ctx.y = NULL;
+  ctx.cvode_mem = NULL;
+  ctx.LS = NULL;
+  ctx.N = 0;
+}
+
+// Solves one problem through its output times, reusing the worker's CVODE
+// objects when the size matches the previous problem.
+static int solve_problem(WorkerContext &ctx, const AsyncProblem &p,
+                         AsyncResult &r) {
+  int flag;
+  int outputs = (p.outputs > 0) ? p.outputs : 1;
+
+  r.flag = CV_MEM_NULL;
+  r.t.clear();
+  r.y.clear();
+  r.nsteps = 0;
+  ctx.problem = &p;
+
+  if (ctx.cvode_mem == NULL || ctx.N != p.N) {
+    if (create_context(ctx, p)) {
+      free_context(ctx);
+      return(1);
+    }
+  } else {
+    for (sunindextype i = 0; i < p.N; i++) NV_DATA_S(ctx.y)[i] = p.y0[i];
+    flag = CVodeReInit(ctx.cvode_mem, p.t0, ctx.y);
+    if (check_flag(&flag, "CVodeReInit", 1)) return(1);
+  }
+
+  flag = CVodeSStolerances(ctx.cvode_mem, p.reltol, p.abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+
+  // NULL restores CVODE's difference quotient jacobian-times-vector.
+  flag = CVSpilsSetJacTimes(ctx.cvode_mem, NULL,
+                            (p.jtv != NULL) ? jtv_trampoline : NULL);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  r.t.reserve(outputs);
+  r.y.reserve(outputs * p.N);
+  for (int k = 1; k <= outputs; k++) {
+    realtype tout = (k == outputs) ? p.tout :
+        p.t0 + (p.tout - p.t0) * k / outputs;
+    realtype t;
+    r.flag = CVode(ctx.cvode_mem, tout, ctx.y, &t, CV_NORMAL);
+    if (check_flag(&r.flag, "CVode", 1)) break;
+    r.t.push_back(t);
+    r.y.insert(r.y.end(), NV_DATA_S(ctx.y), NV_DATA_S(ctx.y) + p.N);
+  }
+  CVodeGetNumSteps(ctx.cvode_mem, &r.nsteps);
+
+  return(r.flag < 0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
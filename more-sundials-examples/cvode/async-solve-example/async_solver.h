@@ -0,0 +1,151 @@
+/*
+Asynchronous CVODE solves for a request handler. submit hands a problem to a
+pool of worker threads and returns at once with a token, the finished
+trajectory comes back later through a result queue that any number of
+threads can poll. submit_future returns a std::future instead.
+
+Requests and results both go through a bounded lock-free MpmcQueue
+(mpmc_queue.h), so the submitting threads, the workers and the consumers
+never wait for a lock of each other. The bounds give backpressure:
+
+  - a full request queue makes try_submit fail (counted by rejected) and
+    submit wait until a worker has taken a request;
+  - a full result queue makes the workers wait (counted by stalled) until a
+    consumer has polled, so they stop taking requests and the request queue
+    fills up in turn.
+
+Every worker owns its N_Vector, CVODE memory and SPGMR linear solver, which
+are created on its first problem and reset with CVodeReInit afterwards, as
+in the thread pool example. An idle worker sleeps on a condition variable
+and submit wakes it.
+
+The workers record the time a request waited in the queue and the time its
+solve took into two LatencyHistograms. A result carries the time it was
+submitted, so a consumer can record the end-to-end latency.
+
+Tokens are unique and increasing, but a failed try_submit uses one up too.
+Requests still queued when the AsyncSolver is destroyed are dropped, their
+futures get a broken_promise error.
+*/
+
+#ifndef ASYNC_SOLVER_H
+#define ASYNC_SOLVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "latency_histogram.h"
+#include "mpmc_queue.h"
+
+// One initial value problem, solved from t0 to tout with outputs points at
+// equal spacing, the last at tout. f and jtv have the same signatures as in
+// the simple example, jtv may be NULL to use CVODE's difference quotient.
+// user_data has to stay valid until the result is delivered.
+struct AsyncProblem {
+  sunindextype N;
+  CVRhsFn f;
+  CVSpilsJacTimesVecFn jtv;
+  void *user_data;
+  std::vector < realtype > y0;
+  realtype t0, tout;
+  int outputs;
+  realtype reltol, abstol;
+};
+
+struct AsyncResult {
+  long int token;
+  int flag; // return flag of the last CVode call
+  std::vector < realtype > t; // output times reached
+  std::vector < realtype > y; // N values per output time
+  long int nsteps;
+  int worker; // which worker solved the problem
+  double submitted; // stats_now() at submission
+  double queued_seconds; // from submission to the start of the solve
+  double solve_seconds;
+};
+
+// CVODE objects owned by a worker, rebuilt only when the problem size changes.
+struct WorkerContext {
+  sunindextype N;
+  N_Vector y;
+  void *cvode_mem;
+  SUNLinearSolver LS;
+  const AsyncProblem *problem; // problem currently being solved
+};
+
+class AsyncSolver {
+ public:
+  // Starts num_workers threads. The capacities are rounded up to powers of
+  // two.
+  AsyncSolver(int num_workers, size_t request_capacity,
+              size_t result_capacity);
+  ~AsyncSolver();
+
+  // Queues a problem and returns its token, or -1 if the request queue is
+  // full.
+  long int try_submit(const AsyncProblem &problem);
+  // Queues a problem, waiting for room if the request queue is full.
+  long int submit(const AsyncProblem &problem);
+  // Like submit, but the result is delivered to the future and not to the
+  // result queue.
+  std::future < AsyncResult > submit_future(const AsyncProblem &problem);
+
+  // Takes a finished result, returns false if there is none.
+  bool poll(AsyncResult &result);
+  // Waits until a result is finished and takes it.
+  void wait_result(AsyncResult &result);
+
+  const LatencyHistogram &queue_latency() const { return queue_latency_; }
+  const LatencyHistogram &solve_latency() const { return solve_latency_; }
+  long int rejected() const { return rejected_.load(); }
+  long int stalled() const { return stalled_.load(); }
+  int num_workers() const { return (int) workers_.size(); }
+
+ private:
+  struct Task {
+    long int token;
+    AsyncProblem problem;
+    double submitted;
+    std::shared_ptr < std::promise < AsyncResult > > promise;
+  };
+
+  struct Worker {
+    WorkerContext ctx;
+    std::thread thread;
+  };
+
+  AsyncSolver(const AsyncSolver &);
+  AsyncSolver &operator=(const AsyncSolver &);
+
+  long int push_task(Task &task, bool wait);
+  void worker_loop(int id);
+  bool next_task(Task &task);
+
+  std::vector < Worker* > workers_;
+  MpmcQueue < Task > requests_;
+  MpmcQueue < AsyncResult > results_;
+  std::atomic < long int > next_token_;
+  std::atomic < long int > rejected_;
+  std::atomic < long int > stalled_;
+  std::atomic < bool > shutdown_;
+
+  // Idle workers sleep here, sleepers_ tells submit whether to wake one.
+  std::mutex idle_lock_;
+  std::condition_variable idle_;
+  std::atomic < int > sleepers_;
+
+  LatencyHistogram queue_latency_;
+  LatencyHistogram solve_latency_;
+};
+
+#endif
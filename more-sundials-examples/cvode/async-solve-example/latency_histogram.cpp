@@ -0,0 +1,65 @@
+#include "latency_histogram.h"
+
+#include <cmath>
+
+// Adds x to a, atomic<double> has no fetch_add in C++11.
+static void atomic_add(std::atomic < double > &a, double x);
+
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::record(double seconds) {
+  int b = 0;
+  if (seconds > 0) {
+    b = (int) std::floor((std::log2(seconds) - MIN_EXPONENT) *
+                         BUCKETS_PER_OCTAVE);
+    if (b < 0) b = 0;
+    if (b >= BUCKETS) b = BUCKETS - 1;
+  }
+  buckets_[b].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  atomic_add(sum_, seconds);
+
+  double old = max_.load(std::memory_order_relaxed);
+  while (seconds > old &&
+         !max_.compare_exchange_weak(old, seconds,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+double LatencyHistogram::mean() const {
+  long int n = count();
+  return (n > 0) ? sum_.load(std::memory_order_relaxed) / n : 0;
+}
+
+double LatencyHistogram::percentile(double p) const {
+  long int n = count();
+  if (n == 0) return(0);
+  // The sample of rank ceil(p*n), at least the first one.
+  long int rank = (long int) std::ceil(p * n);
+  if (rank < 1) rank = 1;
+  long int seen = 0;
+  for (int b = 0; b < BUCKETS; b++) {
+    seen += buckets_[b].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::ldexp(1.0, MIN_EXPONENT) *
+          std::exp2((double) (b + 1) / BUCKETS_PER_OCTAVE);
+    }
+  }
+  return max();
+}
+
+void LatencyHistogram::reset() {
+  for (int b = 0; b < BUCKETS; b++) buckets_[b].store(0);
+  count_.store(0);
+  sum_.store(0);
+  max_.store(0);
+}
+
+static void atomic_add(std::atomic < double > &a, double x) {
+  double old = a.load(std::memory_order_relaxed);
+  while (!a.compare_exchange_weak(old, old + x, std::memory_order_relaxed)) {
+  }
+}
@@ -0,0 +1,45 @@
+/*
+A latency histogram that many threads can record into without a lock. The
+buckets grow geometrically, 8 per factor of two from 2^-24 s (about 60 ns)
+to 2^8 s, so a percentile is known to within 9%. Times outside that range go
+to the first or last bucket. percentile returns the upper edge of the bucket
+that holds the requested fraction of the samples.
+*/
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  // Thread safe.
+  void record(double seconds);
+
+  long int count() const { return count_.load(std::memory_order_relaxed); }
+  double max() const { return max_.load(std::memory_order_relaxed); }
+  double mean() const;
+  // Seconds below which the fraction p (0 to 1) of the samples fall, 0 when
+  // nothing was recorded.
+  double percentile(double p) const;
+
+  // Not thread safe, nothing may record at the same time.
+  void reset();
+
+ private:
+  static const int BUCKETS_PER_OCTAVE = 8;
+  static const int MIN_EXPONENT = -24;
+  static const int BUCKETS = 32 * BUCKETS_PER_OCTAVE;
+
+  LatencyHistogram(const LatencyHistogram &);
+  LatencyHistogram &operator=(const LatencyHistogram &);
+
+  std::atomic < long int > buckets_[BUCKETS];
+  std::atomic < long int > count_;
+  std::atomic < double > sum_;
+  std::atomic < double > max_;
+};
+
+#endif
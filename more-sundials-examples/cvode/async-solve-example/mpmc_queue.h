@@ -0,0 +1,110 @@
+/*
+A bounded lock-free queue for many producers and many consumers (the ring
+buffer of D. Vyukov). Every cell has a sequence number that says whether it
+is free for the producer of a given position or holds the value for the
+consumer of that position. A producer claims a position with one
+compare-and-swap on the enqueue counter, writes the value and publishes it
+by advancing the sequence of the cell; consumers do the same on the dequeue
+counter. No thread ever waits for another one inside the queue.
+
+The capacity is rounded up to a power of two. try_push fails when the queue
+is full and try_pop when it is empty, it is up to the caller to wait or to
+report the failure (backpressure).
+*/
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template <class T>
+class MpmcQueue {
+ public:
+  explicit MpmcQueue(size_t capacity) : enqueue_pos_(0), dequeue_pos_(0) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    mask_ = size - 1;
+    cells_ = new Cell[size];
+    for (size_t i = 0; i < size; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  ~MpmcQueue() { delete[] cells_; }
+
+  // Moves value into the queue, returns false if the queue is full.
+  bool try_push(T &value) {
+    Cell *cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      ptrdiff_t diff = (ptrdiff_t) seq - (ptrdiff_t) pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // the cell still holds the value of the last round
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves the oldest value into value, returns false if the queue is empty.
+  bool try_pop(T &value) {
+    Cell *cell;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      ptrdiff_t diff = (ptrdiff_t) seq - (ptrdiff_t) (pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // nothing published at this position yet
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Values in the queue, only a snapshot while other threads use it.
+  size_t size_approx() const {
+    size_t in = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t out = dequeue_pos_.load(std::memory_order_relaxed);
+    return (in > out) ? in - out : 0;
+  }
+
+ private:
+  struct Cell {
+    std::atomic < size_t > sequence;
+    T value;
+  };
+
+  MpmcQueue(const MpmcQueue &);
+  MpmcQueue &operator=(const MpmcQueue &);
+
+  Cell *cells_;
+  size_t mask_;
+  // The two counters are written by different threads, each gets its own
+  // cache line.
+  alignas(64) std::atomic < size_t > enqueue_pos_;
+  alignas(64) std::atomic < size_t > dequeue_pos_;
+};
+
+#endif
@@ -0,0 +1,299 @@
+/*
+Exact jacobians by automatic differentiation (common/dual.h) compared with
+CVODE's difference quotients.
+
+The right hand side of the 1D Brusselator
+
+  u_t = d*u_xx + a - (b + 1)*u + u^2*v
+  v_t = d*v_xx + b*u - u^2*v
+
+on cells cells with zero flux at the ends (u and v of a cell next to each
+other, N = 2*cells) is written once, as a template over the number type. The
+problem is solved with BDF and Newton iteration and
+  spgmr-dq:  SPGMR, jacobian-times-vector by CVODE's difference quotient
+  spgmr-ad:  SPGMR, exact jacobian-times-vector from ad_jtv
+  band-dq:   band solver, jacobian by CVODE's band difference quotient
+  band-ad:   band solver, exact jacobian from ad_jac
+For every run the time, steps, Newton and Krylov iterations, calls of f (by
+CVODE, including those of the difference quotients), jacobian or jtv
+evaluations and the largest difference to the first solution are printed.
+
+Before the runs, the sparse jacobian of ad_jac is checked to have the same
+structural pattern at u = 0, where du_t/dv = u^2 is zero, as at the initial
+values.
+
+Usage: ./executable [cells] [end_time]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <cvode/cvode_direct.h> // access to CVDls interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sunlinsol/sunlinsol_band.h> // access to band SUNLinearSolver
+#include <sunmatrix/sunmatrix_band.h> // access to band SUNMatrix
+#include <sunmatrix/sunmatrix_sparse.h> // access to sparse SUNMatrix
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "dual.h"  // Dual, ad_rhs, ad_jtv, ad_jac
+#include "cvode_stats.h"  // SolveRecord, collect_cvode_stats
+
+struct UserData {
+  sunindextype cells;
+  realtype a, b;
+  realtype diff; // d/h^2
+};
+
+// The right hand side, for realtype and for Dual numbers.
+struct Brusselator {
+  template <class T>
+  static int rhs(realtype t, const T *y, T *ydot, void *user_data) {
+    UserData *data = (UserData*) user_data;
+    sunindextype cells = data->cells;
+    realtype a = data->a;
+    realtype b = data->b;
+    realtype diff = data->diff;
+
+    for (sunindextype i = 0; i < cells; i++) {
+      sunindextype c = 2 * i;
+      sunindextype left = (i > 0) ? c - 2 : c;
+      sunindextype right = (i < cells - 1) ? c + 2 : c;
+      T u = y[c];
+      T v = y[c + 1];
+      T uuv = u * u * v;
+      ydot[c] = diff * (y[left] + y[right] - 2.0 * u) + a - (b + 1) * u + uuv;
+      ydot[c + 1] = diff * (y[left + 1] + y[right + 1] - 2.0 * v) + b * u -
+          uuv;
+    }
+
+    return(0);
+  }
+};
+
+static int check_sparse_pattern(UserData *data);
+static int run(const char *name, UserData *data, realtype end_time,
+               const realtype *y_first, realtype *y_out);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  sunindextype cells = (argc > 1) ? std::atol(argv[1]) : 2000;
+  realtype end_time = (argc > 2) ? std::atof(argv[2]) : 10.0;
+  if (cells < 2) cells = 2;
+
+  UserData data;
+  data.cells = cells;
+  data.a = 1.0;
+  data.b = 3.0;
+  data.diff = 0.02 * cells * cells;
+
+  if (check_sparse_pattern(&data) != 0) return(1);
+
+  const char *names[4] = {"spgmr-dq", "spgmr-ad", "band-dq", "band-ad"};
+  std::vector < realtype > y_first, y(2 * cells);
+  printf("%-9s %9s %7s %8s %9s %9s %9s %10s\n", "jacobian", "seconds", "steps",
+         "nonlin", "lin_iters", "rhs_evals", "jac/jtv", "max_diff");
+  for (int k = 0; k < 4; k++) {
+    const realtype *ref = y_first.empty() ? NULL : &y_first[0];
+    if (run(names[k], &data, end_time, ref, &y[0]) != 0) return(1);
+    if (y_first.empty()) y_first = y;
+  }
+
+  return(0);
+}
+
+// ad_jac into a CSC matrix at the initial values and at u = 0. SUNKLU keeps
+// the pattern of the first jacobian, so both have to give the same pattern,
+// with the zero entries du_t/dv of the second kept explicitly. The kept
+// pattern is dropped before each call, so each state finds its own.
+static int check_sparse_pattern(UserData *data) {
+  sunindextype N = 2 * data->cells;
+  int failed = 0;
+
+  // A row couples to the other species of its cell and to the same species
+  // of the two neighbours, at most 4 entries.
+  SUNMatrix J = SUNSparseMatrix(N, N, 4 * N, CSC_MAT);
+  if (check_flag((void *)J, "SUNSparseMatrix", 0)) return(1);
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  realtype *ydata = N_VGetArrayPointer(y);
+
+  std::vector < sunindextype > colptr[2], rowind[2];
+  for (int k = 0; k < 2; k++) {
+    for (sunindextype i = 0; i < data->cells; i++) {
+      realtype x = (i + 0.5) / data->cells;
+      ydata[2 * i] = (k == 0) ? data->a + 0.5 * sin(2 * M_PI * x) : 0;
+      ydata[2 * i + 1] = data->b / data->a;
+    }
+    ad_sparsity_reset<Brusselator>();
+    int flag = ad_jac<Brusselator>(0, y, y, J, data, NULL, NULL, NULL);
+    if (check_flag(&flag, "ad_jac", 1)) return(1);
+    sunindextype *ptrs = SM_INDEXPTRS_S(J);
+    colptr[k].assign(ptrs, ptrs + N + 1);
+    rowind[k].assign(SM_INDEXVALS_S(J), SM_INDEXVALS_S(J) + ptrs[N]);
+  }
+  ad_sparsity_reset<Brusselator>();
+
+  if (colptr[0] != colptr[1] || rowind[0] != rowind[1]) {
+    fprintf(stderr, "sparse pattern check: the pattern changed at u = 0\n");
+    failed = 1;
+  }
+  // Entry (0, 1), du_t/dv of the first cell, is u^2 = 0 in the second.
+  sunindextype *ptrs = SM_INDEXPTRS_S(J);
+  bool found = false;
+  for (sunindextype p = ptrs[1]; p < ptrs[2]; p++) {
+    if (SM_INDEXVALS_S(J)[p] == 0) {
+      found = true;
+      if (SM_DATA_S(J)[p] != 0) {
+        fprintf(stderr, "sparse pattern check: du_t/dv is not 0 at u = 0\n");
+        failed = 1;
+      }
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "sparse pattern check: du_t/dv is missing at u = 0\n");
+    failed = 1;
+  }
+  if (!failed) {
+    printf("sparse pattern check: %ld structural nonzeros at both states\n",
+           (long) colptr[0][N]);
+  }
+
+  N_VDestroy(y);
+  SUNMatDestroy(J);
+  return(failed);
+}
+
+// One solve with the named linear solver and jacobian, prints its line.
+// y_first is the solution to compare with, NULL for the first run.
+static int run(const char *name, UserData *data, realtype end_time,
+               const realtype *y_first, realtype *y_out) {
+  int flag;
+  realtype reltol = 1e-6;
+  realtype abstol = 1e-9;
+  sunindextype N = 2 * data->cells;
+  std::string kind(name);
+
+  double start = stats_now();
+
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  realtype *ydata = N_VGetArrayPointer(y);
+  for (sunindextype i = 0; i < data->cells; i++) {
+    realtype x = (i + 0.5) / data->cells;
+    ydata[2 * i] = data->a + 0.5 * sin(2 * M_PI * x);
+    ydata[2 * i + 1] = data->b / data->a;
+  }
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, ad_rhs<Brusselator>, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  flag = CVodeSetMaxNumSteps(cvode_mem, 100000);
+  if (check_flag(&flag, "CVodeSetMaxNumSteps", 1)) return(1);
+
+  SUNMatrix A = NULL;
+  SUNLinearSolver LS = NULL;
+  bool krylov = (kind == "spgmr-dq" || kind == "spgmr-ad");
+  if (krylov) {
+    LS = SUNSPGMR(y, PREC_NONE, 0);
+    if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+    flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+    if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+    if (kind == "spgmr-ad") {
+      flag = CVSpilsSetJacTimes(cvode_mem, NULL, ad_jtv<Brusselator>);
+      if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+    }
+  } else {
+    // Cells are coupled to their neighbours two entries away.
+    A = SUNBandMatrix(N, 2, 2, 4);
+    if (check_flag((void *)A, "SUNBandMatrix", 0)) return(1);
+    LS = SUNBandLinearSolver(y, A);
+    if (check_flag((void *)LS, "SUNBandLinearSolver", 0)) return(1);
+    flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+    if (check_flag(&flag, "CVDlsSetLinearSolver", 1)) return(1);
+    if (kind == "band-ad") {
+      flag = CVDlsSetJacFn(cvode_mem, ad_jac<Brusselator>);
+      if (check_flag(&flag, "CVDlsSetJacFn", 1)) return(1);
+    }
+  }
+
+  realtype t;
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(1);
+  double seconds = stats_now() - start;
+
+  // Calls of f by CVODE and by its difference quotients.
+  SolveRecord stats;
+  collect_cvode_stats(cvode_mem, LS, &stats);
+  long int dq_rhs_evals = 0, jac_evals = 0;
+  if (krylov) {
+    CVSpilsGetNumRhsEvals(cvode_mem, &dq_rhs_evals);
+    jac_evals = stats.jtv_evals;
+  } else {
+    CVDlsGetNumRhsEvals(cvode_mem, &dq_rhs_evals);
+    CVDlsGetNumJacEvals(cvode_mem, &jac_evals);
+  }
+
+  for (sunindextype i = 0; i < N; i++) y_out[i] = ydata[i];
+  realtype max_diff = 0;
+  if (y_first != NULL) {
+    for (sunindextype i = 0; i < N; i++) {
+      max_diff = SUNMAX(max_diff, SUNRabs(y_out[i] - y_first[i]));
+    }
+  }
+  printf("%-9s %9.3f %7ld %8ld %9ld %9ld %9ld %10.2e\n", name, seconds,
+         stats.steps, stats.nonlin_iters, krylov ? stats.lin_iters : 0,
+         stats.rhs_evals + dq_rhs_evals, jac_evals, (double) max_diff);
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  if (A != NULL) SUNMatDestroy(A);
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
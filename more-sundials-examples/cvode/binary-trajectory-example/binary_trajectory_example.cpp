@@ -0,0 +1,248 @@
+/*
+The simple CVODE example with its per-step std::cout/N_VPrint_Serial output
+replaced by a binary trajectory file. The integration loop only copies each
+(t, y) record into a buffer, a background thread writes the buffers to disk
+(see trajectory.h). The same program converts a trajectory file back to the
+text output of the simple example.
+
+Usage: ./executable [file] [end_time] [step_length]   integrate and write file
+       ./executable --to-text file                    print file as text
+*/
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "trajectory.h"
+
+// This macro gives access to the individual components of the data array of an
+// N Vector.
+#define NV_Ith_S(v,i) ( NV_DATA_S(v)[i] )
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int to_text(const char *path);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 2 && strcmp(argv[1], "--to-text") == 0) return(to_text(argv[2]));
+
+  const char *path = (argc > 1) ? argv[1] : "trajectory.bin";
+  realtype end_time = (argc > 2) ? std::atof(argv[2]) : 50;
+  realtype step_length = (argc > 3) ? std::atof(argv[3]) : 0.5;
+
+  int flag; // For checking if functions have run properly
+  realtype abstol = 1e-5; // real tolerance of system
+  realtype reltol = 1e-5; // absolute tolerance of system
+
+  // 1. Initialize parallel or multi-threaded environment, if appropriate.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 2. Defining the length of the problem.
+  // ---------------------------------------------------------------------------
+  sunindextype N = 2;
+  // ---------------------------------------------------------------------------
+
+  // 3. Set vector of initial values.
+  // ---------------------------------------------------------------------------
+  N_Vector y; // Problem vector.
+  y = N_VNew_Serial(N);
+  NV_Ith_S(y, 0) = 2.0;
+  NV_Ith_S(y, 1) = 1.0;
+  // ---------------------------------------------------------------------------
+
+  // 4. Create CVODE Object.
+  // ---------------------------------------------------------------------------
+  void *cvode_mem = NULL; // Problem dedicated memory.
+  cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  // ---------------------------------------------------------------------------
+
+  // 5. Initialize CVODE solver.
+  // ---------------------------------------------------------------------------
+  realtype t0 = 0; // Initiale value of time.
+  flag = CVodeInit(cvode_mem, f, t0, y);
+  if(check_flag(&flag, "CVodeInit", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 6. Specify integration tolerances.
+  // ---------------------------------------------------------------------------
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 7. Set Optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 8. Create Matrix Object.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 9. Create Linear Solver Object.
+  // ---------------------------------------------------------------------------
+  SUNLinearSolver LS;
+  LS = SUNSPGMR(y, 0, 0);
+  if(check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 10. Set linear solver optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 11. Attach linear solver module.
+  // ---------------------------------------------------------------------------
+  // CVSpilsSetLinearSolver is for iterative linear solvers.
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return 1;
+  // ---------------------------------------------------------------------------
+
+  // 12. Set linear solver interface optional inputs.
+  // ---------------------------------------------------------------------------
+  // Sets the jacobian-times-vector function.
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if(check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 13. Specify rootfinding problem.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 14. Advance solution in time.
+  // ---------------------------------------------------------------------------
+  // Every output point is appended to the trajectory file instead of being
+  // printed. Each buffer holds 4096 records.
+  TrajectoryWriter writer;
+  flag = writer.open(path, N, 4096);
+  if (check_flag(&flag, "TrajectoryWriter::open", 1)) return(1);
+  writer.append(t0, NV_DATA_S(y));
+
+  long int num_outputs = (long int) (end_time / step_length + 0.5);
+  realtype t = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  // loop over output points, call CVode, store results, test for error
+  for (long int i = 1; i <= num_outputs; i++) {
+    // Computing tout from the index avoids the drift of adding step_length.
+    realtype tout = t0 + i * step_length;
+    flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
+    if(check_flag(&flag, "CVode", 1)) break;
+    writer.append(t, NV_DATA_S(y));
+  }
+  double loop_seconds = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+
+  flag = writer.close();
+  if (check_flag(&flag, "TrajectoryWriter::close", 1)) return(1);
+
+  std::cout << "wrote " << writer.records() << " records to " << path
+            << " in " << loop_seconds << " s\n";
+  std::cout << "convert to text with: ./executable --to-text " << path << "\n";
+  // ---------------------------------------------------------------------------
+
+  // 15. Get optional outputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 16. Deallocate memory for solution vector.
+  // ---------------------------------------------------------------------------
+  N_VDestroy(y);
+  // ---------------------------------------------------------------------------
+
+  // 17. Free solver memory.
+  // ---------------------------------------------------------------------------
+  CVodeFree(&cvode_mem);
+  // ---------------------------------------------------------------------------
+
+  // 18. Free linear solver and matrix memory.
+  // ---------------------------------------------------------------------------
+  SUNLinSolFree(LS);
+  // ---------------------------------------------------------------------------
+
+  return(0);
+}
+
+// Prints a trajectory file in the format of the simple example's output.
+static int to_text(const char *path) {
+  TrajectoryReader reader;
+  int flag = reader.open(path);
+  if (check_flag(&flag, "TrajectoryReader::open", 1)) return(1);
+
+  realtype t;
+  std::vector < realtype > y(reader.N());
+  while (reader.next(t, &y[0]) == 0) {
+    std::cout << "t: " << t;
+    std::cout << "\ny:";
+    for (sunindextype i = 0; i < reader.N(); i++) printf("%11.8g\n", y[i]);
+    printf("\n");
+  }
+
+  return(0);
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
+  realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
+  realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
+  Jvdata[1] = vdata[0] + 0 * vdata[1];
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
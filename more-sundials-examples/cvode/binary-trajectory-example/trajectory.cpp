@@ -0,0 +1,184 @@
+#include "trajectory.h"
+
+#include <cstddef>
+#include <cstring>
+
+static const char trajectory_magic[8] = {'C', 'V', 'T', 'R', 'A', 'J', 0, 0};
+static const int32_t trajectory_version = 1;
+
+
+TrajectoryWriter::TrajectoryWriter()
+    : file_(NULL), N_(0), capacity_(0), active_(0), records_(0),
+      closing_(false), failed_(false) {
+  count_[0] = count_[1] = 0;
+  pending_[0] = pending_[1] = false;
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+  if (file_ != NULL) close();
+}
+
+int TrajectoryWriter::open(const char *path, sunindextype N,
+                           size_t records_per_buffer) {
+  if (file_ != NULL || N < 1 || records_per_buffer < 1) return(-1);
+
+  file_ = fopen(path, "wb");
+  if (file_ == NULL) return(-1);
+
+  TrajectoryHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, trajectory_magic, sizeof(header.magic));
+  header.version = trajectory_version;
+  header.real_size = sizeof(realtype);
+  header.N = N;
+  header.records = 0;
+  if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+    fclose(file_);
+    file_ = NULL;
+    return(-1);
+  }
+
+  // Both buffers are allocated here so append never allocates.
+  N_ = N;
+  capacity_ = records_per_buffer;
+  buffers_[0].assign(capacity_ * (N_ + 1), 0);
+  buffers_[1].assign(capacity_ * (N_ + 1), 0);
+  count_[0] = count_[1] = 0;
+  pending_[0] = pending_[1] = false;
+  active_ = 0;
+  records_ = 0;
+  closing_ = false;
+  failed_ = false;
+
+  thread_ = std::thread(&TrajectoryWriter::writer_loop, this);
+  return(0);
+}
+
+void TrajectoryWriter::append(realtype t, const realtype *y) {
+  if (count_[active_] == capacity_) hand_off();
+
+  realtype *record = &buffers_[active_][count_[active_] * (N_ + 1)];
+  record[0] = t;
+  memcpy(record + 1, y, N_ * sizeof(realtype));
+  count_[active_]++;
+  records_++;
+}
+
+int TrajectoryWriter::close() {
+  if (file_ == NULL) return(-1);
+
+  if (count_[active_] > 0) hand_off();
+  {
+    std::lock_guard < std::mutex > guard(lock_);
+    closing_ = true;
+  }
+  ready_.notify_one();
+  thread_.join();
+
+  // Store the number of records now that it is known.
+  int64_t records = records_;
+  if (fseek(file_, offsetof(TrajectoryHeader, records), SEEK_SET) != 0 ||
+      fwrite(&records, sizeof(records), 1, file_) != 1) {
+    failed_ = true;
+  }
+  if (fclose(file_) != 0) failed_ = true;
+  file_ = NULL;
+
+  return(failed_ ? -1 : 0);
+}
+
+// Marks the active buffer as ready for the writer thread and switches to the
+// other one, waiting for it to be written out first if necessary.
+void TrajectoryWriter::hand_off() {
+  std::unique_lock < std::mutex > lock(lock_);
+  pending_[active_] = true;
+  ready_.notify_one();
+
+  int other = 1 - active_;
+  while (pending_[other]) written_.wait(lock);
+  count_[other] = 0;
+  active_ = other;
+}
+
+// Writes the buffers in the order they were handed off until the writer is
+// closed and nothing is left pending.
+void TrajectoryWriter::writer_loop() {
+  int next = 0;
+
+  for (;;) {
+    size_t count;
+    {
+      std::unique_lock < std::mutex > lock(lock_);
+      while (!pending_[next] && !closing_) ready_.wait(lock);
+      if (!pending_[next]) return; // closing and fully drained
+      count = count_[next];
+    }
+
+    size_t values = count * (N_ + 1);
+    bool ok = fwrite(&buffers_[next][0], sizeof(realtype), values, file_)
+              == values;
+
+    {
+      std::lock_guard < std::mutex > guard(lock_);
+      if (!ok) failed_ = true;
+      pending_[next] = false;
+    }
+    written_.notify_one();
+    next = 1 - next;
+  }
+}
+
+TrajectoryReader::TrajectoryReader() : file_(NULL) {
+  memset(&header_, 0, sizeof(header_));
+}
+
+TrajectoryReader::~TrajectoryReader() {
+  close();
+}
+
+int TrajectoryReader::open(const char *path) {
+  close();
+
+  file_ = fopen(path, "rb");
+  if (file_ == NULL) return(-1);
+
+  if (fread(&header_, sizeof(header_), 1, file_) != 1 ||
+      memcmp(header_.magic, trajectory_magic, sizeof(header_.magic)) != 0 ||
+      header_.version != trajectory_version ||
+      header_.real_size != (int32_t) sizeof(realtype) || header_.N < 1) {
+    fprintf(stderr, "\nTRAJECTORY_ERROR: %s is not a trajectory file\n\n",
+            path);
+    close();
+    return(-1);
+  }
+
+  // A writer that did not get to close leaves the count at zero, count the
+  // complete records in the file instead.
+  if (header_.records == 0) {
+    long int record_size = (header_.N + 1) * sizeof(realtype);
+    if (fseek(file_, 0, SEEK_END) == 0) {
+      header_.records = (ftell(file_) - (long int) sizeof(header_))
+                        / record_size;
+    }
+    fseek(file_, sizeof(header_), SEEK_SET);
+  }
+
+  record_.resize(header_.N + 1);
+  return(0);
+}
+
+int TrajectoryReader::next(realtype &t, realtype *y) {
+  if (file_ == NULL) return(-1);
+  if (fread(&record_[0], sizeof(realtype), record_.size(), file_)
+      != record_.size()) {
+    return(-1);
+  }
+  t = record_[0];
+  memcpy(y, &record_[1], header_.N * sizeof(realtype));
+  return(0);
+}
+
+void TrajectoryReader::close() {
+  if (file_ != NULL) fclose(file_);
+  file_ = NULL;
+}
@@ -0,0 +1,97 @@
+/*
+Binary trajectory files. A TrajectoryWriter copies (t, y[]) records into one of
+two preallocated buffers. When a buffer fills up it is handed to a background
+thread that writes it to disk while the integration keeps filling the other
+buffer, so the solver thread never waits on formatting or stdio unless the
+disk falls a whole buffer behind. A TrajectoryReader reads the records back.
+
+File layout (native byte order):
+  header:  char magic[8], int32 version, int32 real_size, int64 N, int64 records
+  records: realtype t, realtype y[N]   (repeated)
+
+open, close and next return 0, or -1 on failure and next at the end of file.
+*/
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+struct TrajectoryHeader {
+  char magic[8];
+  int32_t version;
+  int32_t real_size; // sizeof(realtype) of the writer
+  int64_t N; // length of y in every record
+  int64_t records; // filled in when the writer is closed
+};
+
+class TrajectoryWriter {
+ public:
+  TrajectoryWriter();
+  ~TrajectoryWriter(); // closes the file if still open
+
+  // Creates the file, allocates two buffers of records_per_buffer records
+  // each and starts the writer thread.
+  int open(const char *path, sunindextype N, size_t records_per_buffer);
+
+  // Copies one record into the active buffer. Only blocks when both buffers
+  // are full because the writer thread is behind.
+  void append(realtype t, const realtype *y);
+
+  // Writes out the partly filled buffer, stops the writer thread, stores the
+  // record count in the header and closes the file. Returns -1 if any write
+  // failed.
+  int close();
+
+  int64_t records() const { return records_; }
+
+ private:
+  void hand_off(); // gives the active buffer to the writer thread
+  void writer_loop();
+
+  FILE *file_;
+  sunindextype N_;
+  size_t capacity_; // records per buffer
+  std::vector < realtype > buffers_[2];
+  size_t count_[2]; // records in each buffer
+  bool pending_[2]; // buffer is waiting for or being written by the thread
+  int active_; // buffer being filled by append
+  int64_t records_;
+  bool closing_;
+  bool failed_;
+
+  std::mutex lock_; // guards count_, pending_, closing_ and failed_
+  std::condition_variable ready_; // a buffer was handed off or closing
+  std::condition_variable written_; // a buffer was written
+  std::thread thread_;
+};
+
+class TrajectoryReader {
+ public:
+  TrajectoryReader();
+  ~TrajectoryReader();
+
+  // Opens the file and checks its header.
+  int open(const char *path);
+
+  // Reads the next record, returns -1 at the end of the file.
+  int next(realtype &t, realtype *y);
+
+  void close();
+
+  sunindextype N() const { return (sunindextype) header_.N; }
+  int64_t records() const { return header_.records; }
+
+ private:
+  FILE *file_;
+  TrajectoryHeader header_;
+  std::vector < realtype > record_;
+};
+
+#endif
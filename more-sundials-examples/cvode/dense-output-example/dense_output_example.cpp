@@ -0,0 +1,198 @@
+/*
+Many output times of the stiff 2d system of the simple example, taken three
+ways:
+  tstop:   CVodeSetStopTime and CVode in CV_NORMAL mode for every output
+           time, so every output time ends a step.
+  normal:  CVode in CV_NORMAL mode for every output time. CVODE steps past
+           the output time and interpolates back to it.
+  dense:   all output times at once from a DenseOutput (common/
+           dense_output.h), which steps with CV_ONE_STEP and interpolates
+           with CVodeGetDky.
+For each the steps, calls of f, time and the largest error against the
+exact solution at the output times are printed.
+
+Usage: ./executable [samples] [end_time]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "dense_output.h"  // DenseOutput
+#include "cvode_stats.h"  // SolveRecord, collect_cvode_stats
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static void exact(realtype t, realtype *y);
+static int run(const char *mode, const std::vector < realtype > &times);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  long int samples = (argc > 1) ? std::atol(argv[1]) : 100000;
+  realtype end_time = (argc > 2) ? std::atof(argv[2]) : 50;
+  if (samples < 1) samples = 1;
+
+  std::vector < realtype > times(samples);
+  for (long int k = 0; k < samples; k++) {
+    times[k] = (k + 1) * end_time / samples;
+  }
+
+  printf("%ld output times in (0, %g]\n\n", samples, (double) end_time);
+  printf("%-7s %8s %10s %9s %10s\n", "mode", "steps", "rhs_evals", "seconds",
+         "max_error");
+  const char *modes[3] = {"tstop", "normal", "dense"};
+  for (int m = 0; m < 3; m++) {
+    if (run(modes[m], times) != 0) return(1);
+  }
+
+  return(0);
+}
+
+// Integrates to all the times with the given mode and prints its line.
+static int run(const char *mode, const std::vector < realtype > &times) {
+  int flag;
+  std::string kind(mode);
+  sunindextype N = 2;
+  long int samples = times.size();
+  realtype end_time = times[samples - 1];
+
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  exact(0, N_VGetArrayPointer(y));
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, 1e-5, 1e-5);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetMaxNumSteps(cvode_mem, 10 * samples + 1000);
+  if (check_flag(&flag, "CVodeSetMaxNumSteps", 1)) return(1);
+  SUNLinearSolver LS = SUNSPGMR(y, 0, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  // The solution at every output time, one row each.
+  std::vector < realtype > out(samples * N);
+  double start = stats_now();
+  if (kind == "dense") {
+    N_Vector tmp = N_VNew_Serial(N);
+    if (check_flag((void *)tmp, "N_VNew_Serial", 0)) return(1);
+    DenseOutput dense(cvode_mem, y, end_time);
+    flag = dense.evaluate(&times[0], samples, &out[0], tmp);
+    N_VDestroy(tmp);
+    if (check_flag(&flag, "DenseOutput::evaluate", 1)) return(1);
+  } else {
+    realtype t;
+    realtype *ydata = N_VGetArrayPointer(y);
+    for (long int k = 0; k < samples; k++) {
+      if (kind == "tstop") {
+        flag = CVodeSetStopTime(cvode_mem, times[k]);
+        if (check_flag(&flag, "CVodeSetStopTime", 1)) return(1);
+      }
+      flag = CVode(cvode_mem, times[k], y, &t, CV_NORMAL);
+      if (check_flag(&flag, "CVode", 1)) return(1);
+      for (sunindextype i = 0; i < N; i++) out[k * N + i] = ydata[i];
+    }
+  }
+  double seconds = stats_now() - start;
+
+  realtype max_error = 0;
+  realtype y_exact[2];
+  for (long int k = 0; k < samples; k++) {
+    exact(times[k], y_exact);
+    for (sunindextype i = 0; i < N; i++) {
+      max_error = SUNMAX(max_error, SUNRabs(out[k * N + i] - y_exact[i]));
+    }
+  }
+
+  SolveRecord stats;
+  collect_cvode_stats(cvode_mem, LS, &stats);
+  printf("%-7s %8ld %10ld %9.3f %10.2e\n", mode, stats.steps, stats.rhs_evals,
+         seconds, (double) max_error);
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  return(0);
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
+  Jvdata[1] = vdata[0];
+
+  return(0);
+}
+
+// The eigenvalues of the system are -1 and -100 with eigenvectors (1, -1)
+// and (-100, 1). y(0) = (2, 1) as in the simple example.
+static void exact(realtype t, realtype *y) {
+  realtype c2 = -1.0 / 33.0;
+  realtype c1 = c2 - 1;
+  y[0] = c1 * exp(-t) - 100 * c2 * exp(-100 * t);
+  y[1] = -c1 * exp(-t) + c2 * exp(-100 * t);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
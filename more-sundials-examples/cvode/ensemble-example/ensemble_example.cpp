@@ -0,0 +1,487 @@
+/*
+An ensemble version of the simple CVODE example. Instead of setting up one
+CVODE object per parameter set, every member of the ensemble is stacked into a
+single N_Vector and all of them are advanced together by one CVODE object.
+
+Each member solves the stiff 2d system of the simple example with its own
+coefficients (the UserData::coeffs idea from the user data example):
+
+  u0' = a00 * u0 + a01 * u1 + c0
+  u1' = u0 + c1
+
+The state is stored structure-of-arrays: the first "members" entries of the
+N_Vector hold u0 of every member and the next "members" entries hold u1. The
+rhs, the jacobian-times-vector product and the preconditioner are each a single
+sweep over these contiguous arrays.
+
+Usage: ./executable [members] [baseline_members]
+*/
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+// This macro gives access to the individual components of the data array of an
+// N Vector.
+#define NV_Ith_S(v,i) ( NV_DATA_S(v)[i] )
+
+// Struct for holding the coefficients of every member of the ensemble. Each
+// coefficient is its own array (structure-of-arrays) so the loops in f, jtv
+// and the preconditioner read contiguous memory.
+struct EnsembleData {
+  sunindextype members;
+  std::vector < realtype > a00; // -101.0 in the simple example
+  std::vector < realtype > a01; // -100.0 in the simple example
+  std::vector < realtype > c0;  // forcing of u0, coeffs[0] in user data example
+  std::vector < realtype > c1;  // forcing of u1, coeffs[1] in user data example
+
+  // Inverse of the 2x2 block (I - gamma*J) of every member, filled by psetup.
+  std::vector < realtype > p00, p01, p10, p11;
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int psetup(realtype t, N_Vector u, N_Vector fu, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data);
+static int psolve(realtype t, N_Vector u, N_Vector fu, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data);
+static int f_single(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv_single(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                      N_Vector fu, void *user_data, N_Vector tmp);
+static int solve_single(const realtype coeffs[4], const realtype y_init[2],
+                        realtype end_time, realtype y_final[2]);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+EnsembleData* alloc_ensemble_data(sunindextype members);
+
+
+int main(int argc, char *argv[]) {
+  int flag; // For checking if functions have run properly
+  realtype abstol = 1e-5; // real tolerance of system
+  realtype reltol = 1e-5; // absolute tolerance of system
+  realtype end_time = 50;
+
+  // Number of ensemble members, and how many of them are also solved one at a
+  // time the way the simple example does it to get a baseline.
+  sunindextype members = (argc > 1) ? std::atol(argv[1]) : 10000;
+  sunindextype baseline_members = (argc > 2) ? std::atol(argv[2]) : 1000;
+  if (members < 1) members = 1;
+  if (baseline_members > members) baseline_members = members;
+
+  // Setup the coefficients of every member.
+  EnsembleData *data = alloc_ensemble_data(members);
+
+  // 1. Initialize parallel or multi-threaded environment, if appropriate.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 2. Defining the length of the problem.
+  // ---------------------------------------------------------------------------
+  // Two unknowns per member.
+  sunindextype N = 2 * members;
+  // ---------------------------------------------------------------------------
+
+  // 3. Set vector of initial values.
+  // ---------------------------------------------------------------------------
+  N_Vector y; // Problem vector.
+  y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  for (sunindextype i = 0; i < members; i++) {
+    realtype s = (members > 1) ? (realtype) i / (members - 1) : 0;
+    NV_Ith_S(y, i) = 2.0 + s;           // u0 of member i
+    NV_Ith_S(y, members + i) = 1.0 - s; // u1 of member i
+  }
+  // Keep a copy of the initial values for the baseline runs.
+  std::vector < realtype > y_init(NV_DATA_S(y), NV_DATA_S(y) + N);
+  // ---------------------------------------------------------------------------
+
+  // 4. Create CVODE Object.
+  // ---------------------------------------------------------------------------
+  void *cvode_mem = NULL; // Problem dedicated memory.
+  cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 5. Initialize CVODE solver.
+  // ---------------------------------------------------------------------------
+  realtype t0 = 0; // Initiale value of time.
+  flag = CVodeInit(cvode_mem, f, t0, y);
+  if(check_flag(&flag, "CVodeInit", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 6. Specify integration tolerances.
+  // ---------------------------------------------------------------------------
+  // Note that the error test uses a norm over the whole ensemble, so the
+  // members are expected to be of a similar scale.
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 7. Set Optional inputs.
+  // ---------------------------------------------------------------------------
+  /* Set the pointer to user-defined data */
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 8. Create Matrix Object.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 9. Create Linear Solver Object.
+  // ---------------------------------------------------------------------------
+  // The ensemble jacobian is block diagonal with one 2x2 block per member. The
+  // preconditioner below inverts those blocks exactly, so SPGMR converges in a
+  // single iteration no matter how many members there are.
+  SUNLinearSolver LS;
+  LS = SUNSPGMR(y, PREC_LEFT, 0);
+  if(check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 10. Set linear solver optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 11. Attach linear solver module.
+  // ---------------------------------------------------------------------------
+  // CVSpilsSetLinearSolver is for iterative linear solvers.
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return 1;
+  // ---------------------------------------------------------------------------
+
+  // 12. Set linear solver interface optional inputs.
+  // ---------------------------------------------------------------------------
+  // Sets the jacobian-times-vector function.
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if(check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  // Sets the block diagonal preconditioner.
+  flag = CVSpilsSetPreconditioner(cvode_mem, psetup, psolve);
+  if(check_flag(&flag, "CVSpilsSetPreconditioner", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 13. Specify rootfinding problem.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 14. Advance solution in time.
+  // ---------------------------------------------------------------------------
+  // The whole ensemble is advanced to the end time in one pass.
+  realtype t = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  if(check_flag(&flag, "CVode", 1)) return(1);
+  double ensemble_seconds = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+
+  // The same members solved one at a time, each with its own CVODE object,
+  // linear solver and vector as in the simple example.
+  std::vector < realtype > y_baseline(2 * baseline_members);
+  start = std::chrono::steady_clock::now();
+  for (sunindextype i = 0; i < baseline_members; i++) {
+    realtype coeffs[4] = {data->a00[i], data->a01[i], data->c0[i], data->c1[i]};
+    realtype y_member[2] = {y_init[i], y_init[members + i]};
+    flag = solve_single(coeffs, y_member, end_time, &y_baseline[2 * i]);
+    if (flag != 0) return(1);
+  }
+  double baseline_seconds = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "t: " << t << "\n";
+  std::cout << "first member y:\n";
+  std::cout << NV_Ith_S(y, 0) << "\n" << NV_Ith_S(y, members) << "\n";
+
+  // Difference between the ensemble and the one at a time solutions.
+  realtype max_diff = 0;
+  for (sunindextype i = 0; i < baseline_members; i++) {
+    max_diff = SUNMAX(max_diff,
+                      SUNRabs(NV_Ith_S(y, i) - y_baseline[2 * i]));
+    max_diff = SUNMAX(max_diff,
+                      SUNRabs(NV_Ith_S(y, members + i) - y_baseline[2 * i + 1]));
+  }
+
+  double ensemble_rate = members / ensemble_seconds;
+  std::cout << "\nensemble members:        " << members << "\n";
+  std::cout << "ensemble time (s):       " << ensemble_seconds << "\n";
+  std::cout << "ensemble members/s:      " << ensemble_rate << "\n";
+  if (baseline_members > 0) {
+    double baseline_rate = baseline_members / baseline_seconds;
+    std::cout << "baseline members:        " << baseline_members << "\n";
+    std::cout << "baseline time (s):       " << baseline_seconds << "\n";
+    std::cout << "baseline members/s:      " << baseline_rate << "\n";
+    std::cout << "speedup:                 " << ensemble_rate / baseline_rate
+              << "\n";
+    std::cout << "max |ensemble-baseline|: " << max_diff << "\n";
+  }
+  // ---------------------------------------------------------------------------
+
+  // 15. Get optional outputs.
+  // ---------------------------------------------------------------------------
+  long int nsteps, nfevals, nliters;
+  flag = CVodeGetNumSteps(cvode_mem, &nsteps);
+  check_flag(&flag, "CVodeGetNumSteps", 1);
+  flag = CVodeGetNumRhsEvals(cvode_mem, &nfevals);
+  check_flag(&flag, "CVodeGetNumRhsEvals", 1);
+  flag = CVSpilsGetNumLinIters(cvode_mem, &nliters);
+  check_flag(&flag, "CVSpilsGetNumLinIters", 1);
+  std::cout << "ensemble steps: " << nsteps << ", rhs evals: " << nfevals
+            << ", linear iters: " << nliters << "\n";
+  // ---------------------------------------------------------------------------
+
+  // 16. Deallocate memory for solution vector.
+  // ---------------------------------------------------------------------------
+  N_VDestroy(y);
+  // ---------------------------------------------------------------------------
+
+  // 17. Free solver memory.
+  // ---------------------------------------------------------------------------
+  CVodeFree(&cvode_mem);
+  // ---------------------------------------------------------------------------
+
+  // 18. Free linear solver and matrix memory.
+  // ---------------------------------------------------------------------------
+  SUNLinSolFree(LS);
+  delete data; // Remember to free the user data memory.
+  // ---------------------------------------------------------------------------
+
+  return(0);
+}
+
+// Right hand side of every member in one sweep over the ensemble.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  EnsembleData *data = (EnsembleData*) user_data;
+  sunindextype M = data->members;
+
+  const realtype *u0 = N_VGetArrayPointer(u);
+  const realtype *u1 = u0 + M;
+  realtype *du0 = N_VGetArrayPointer(u_dot);
+  realtype *du1 = du0 + M;
+
+  const realtype *a00 = &data->a00[0];
+  const realtype *a01 = &data->a01[0];
+  const realtype *c0 = &data->c0[0];
+  const realtype *c1 = &data->c1[0];
+
+  for (sunindextype i = 0; i < M; i++) {
+    du0[i] = a00[i] * u0[i] + a01[i] * u1[i] + c0[i];
+    du1[i] = u0[i] + c1[i];
+  }
+
+  return(0);
+}
+
+// Jacobian function vector routine for the block diagonal ensemble jacobian.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  EnsembleData *data = (EnsembleData*) user_data;
+  sunindextype M = data->members;
+
+  const realtype *v0 = N_VGetArrayPointer(v);
+  const realtype *v1 = v0 + M;
+  realtype *Jv0 = N_VGetArrayPointer(Jv);
+  realtype *Jv1 = Jv0 + M;
+
+  const realtype *a00 = &data->a00[0];
+  const realtype *a01 = &data->a01[0];
+
+  for (sunindextype i = 0; i < M; i++) {
+    Jv0[i] = a00[i] * v0[i] + a01[i] * v1[i];
+    Jv1[i] = v0[i];
+  }
+
+  return(0);
+}
+
+// Preconditioner setup. The jacobian of each member is constant, so every call
+// only has to invert the 2x2 blocks of I - gamma*J for the new gamma.
+static int psetup(realtype t, N_Vector u, N_Vector fu, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data) {
+  EnsembleData *data = (EnsembleData*) user_data;
+  sunindextype M = data->members;
+
+  const realtype *a00 = &data->a00[0];
+  const realtype *a01 = &data->a01[0];
+  realtype *p00 = &data->p00[0];
+  realtype *p01 = &data->p01[0];
+  realtype *p10 = &data->p10[0];
+  realtype *p11 = &data->p11[0];
+
+  for (sunindextype i = 0; i < M; i++) {
+    realtype m00 = 1.0 - gamma * a00[i];
+    realtype m01 = -gamma * a01[i];
+    realtype m10 = -gamma;
+    realtype det = m00 - m01 * m10; // m11 is 1
+    if (det == 0) return(1); // recoverable, CVODE will retry with a new gamma
+
+    p00[i] = 1.0 / det;
+    p01[i] = -m01 / det;
+    p10[i] = -m10 / det;
+    p11[i] = m00 / det;
+  }
+
+  // The jacobian used is always the exact one.
+  *jcurPtr = SUNTRUE;
+
+  return(0);
+}
+
+// Preconditioner solve, z = (I - gamma*J)^-1 r one member block at a time.
+static int psolve(realtype t, N_Vector u, N_Vector fu, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data) {
+  EnsembleData *data = (EnsembleData*) user_data;
+  sunindextype M = data->members;
+
+  const realtype *r0 = N_VGetArrayPointer(r);
+  const realtype *r1 = r0 + M;
+  realtype *z0 = N_VGetArrayPointer(z);
+  realtype *z1 = z0 + M;
+
+  const realtype *p00 = &data->p00[0];
+  const realtype *p01 = &data->p01[0];
+  const realtype *p10 = &data->p10[0];
+  const realtype *p11 = &data->p11[0];
+
+  for (sunindextype i = 0; i < M; i++) {
+    realtype a = r0[i];
+    realtype b = r1[i];
+    z0[i] = p00[i] * a + p01[i] * b;
+    z1[i] = p10[i] * a + p11[i] * b;
+  }
+
+  return(0);
+}
+
+// Right hand side of a single member, user_data points to its 4 coefficients.
+static int f_single(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  realtype *coeffs = (realtype*) user_data;
+
+  dudata[0] = coeffs[0] * udata[0] + coeffs[1] * udata[1] + coeffs[2];
+  dudata[1] = udata[0] + coeffs[3];
+
+  return(0);
+}
+
+// Jacobian function vector routine of a single member.
+static int jtv_single(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                      N_Vector fu, void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  realtype *coeffs = (realtype*) user_data;
+
+  Jvdata[0] = coeffs[0] * vdata[0] + coeffs[1] * vdata[1];
+  Jvdata[1] = vdata[0];
+
+  return(0);
+}
+
+// Solves one member the way the simple example does, with its own vector,
+// CVODE object and linear solver. Used as the baseline for the ensemble.
+static int solve_single(const realtype coeffs[4], const realtype y_init[2],
+                        realtype end_time, realtype y_final[2]) {
+  int flag;
+  realtype member_coeffs[4] = {coeffs[0], coeffs[1], coeffs[2], coeffs[3]};
+
+  N_Vector y = N_VNew_Serial(2);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  NV_Ith_S(y, 0) = y_init[0];
+  NV_Ith_S(y, 1) = y_init[1];
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f_single, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, 1e-5, 1e-5);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, member_coeffs);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+
+  SUNLinearSolver LS = SUNSPGMR(y, 0, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv_single);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  realtype t = 0;
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(1);
+  y_final[0] = NV_Ith_S(y, 0);
+  y_final[1] = NV_Ith_S(y, 1);
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
+
+// Initalizes the coefficients of every member. The members are spread evenly
+// around the coefficients of the simple example.
+EnsembleData* alloc_ensemble_data(sunindextype members) {
+  EnsembleData *data;
+  data = new EnsembleData();
+
+  data->members = members;
+  data->a00.resize(members);
+  data->a01.resize(members);
+  data->c0.resize(members);
+  data->c1.resize(members);
+  data->p00.resize(members);
+  data->p01.resize(members);
+  data->p10.resize(members);
+  data->p11.resize(members);
+
+  for (sunindextype i = 0; i < members; i++) {
+    realtype s = (members > 1) ? (realtype) i / (members - 1) : 0;
+    data->a00[i] = -101.0 * (1.0 + 0.1 * s);
+    data->a01[i] = -100.0 * (1.0 + 0.1 * s);
+    data->c0[i] = 0.01 * s;
+    data->c1[i] = 0.02 * s;
+  }
+
+  return data;
+}
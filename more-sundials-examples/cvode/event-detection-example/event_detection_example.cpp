@@ -0,0 +1,258 @@
+/*
+Thermostats of a row of rooms, driven by an EventEngine.
+
+Room i has the temperature T_i (in degrees, time in hours),
+
+  T_i' = -k_i*(T_i - T_out(t)) + a*(T_{i-1} - 2*T_i + T_{i+1}) + P*heater_i
+
+with the outside temperature T_out(t) = 5 + 5*sin(2*pi*t/24), heat exchange
+with the neighbouring rooms (only the rooms that exist) and a heater that is
+on or off. The last component E' = P*(heaters on) is the energy used. There
+are 2*rooms + 1 events, all computed by one root function:
+  2*i:          T_i - 21, rising: the heater of room i switches off.
+  2*i + 1:      T_i - 19, falling: the heater of room i switches on.
+  2*rooms:      E - budget, rising, terminal: the energy budget is used up.
+Switching a heater changes f, so the handlers ask for a reinitialization.
+
+Only the events stop the integration, there is no output grid. At the end
+the events, CVODE steps, calls of f and g, reinitializations, time and the
+largest distance of a switching temperature from its threshold are printed.
+
+Usage: ./executable [rooms] [end_time] [budget_per_room]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "event_engine.h"
+#include "solver_stats.h"  // stats_now
+
+struct UserData {
+  sunindextype rooms;
+  std::vector < realtype > k; // heat loss to the outside per room
+  realtype a; // heat exchange between neighbouring rooms
+  realtype P; // heating rate of a heater
+  realtype T_low, T_high, budget;
+  std::vector < int > heater; // 1 if on
+  long int switches;
+  realtype max_miss; // largest |T_i - threshold| at a switch
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int g(realtype t, N_Vector u, realtype *gout, void *user_data);
+static int switch_heater(int event, int direction, realtype t, N_Vector u,
+                         void *user_data);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  int flag;
+  sunindextype rooms = (argc > 1) ? std::atol(argv[1]) : 100;
+  realtype end_time = (argc > 2) ? std::atof(argv[2]) : 72;
+  realtype budget_per_room = (argc > 3) ? std::atof(argv[3]) : 200;
+  if (rooms < 1) rooms = 1;
+
+  UserData data;
+  data.rooms = rooms;
+  data.k.resize(rooms);
+  data.heater.resize(rooms);
+  for (sunindextype i = 0; i < rooms; i++) {
+    data.k[i] = 0.2 + 0.025 * (i % 5);
+    data.heater[i] = (i % 2 == 0);
+  }
+  data.a = 0.5;
+  data.P = 8;
+  data.T_low = 19;
+  data.T_high = 21;
+  data.budget = budget_per_room * rooms;
+  data.switches = 0;
+  data.max_miss = 0;
+
+  sunindextype N = rooms + 1;
+  N_Vector u = N_VNew_Serial(N);
+  if (check_flag((void *)u, "N_VNew_Serial", 0)) return(1);
+  realtype *udata = N_VGetArrayPointer(u);
+  for (sunindextype i = 0; i < rooms; i++) udata[i] = 20;
+  udata[rooms] = 0;
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, u);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, 1e-6, 1e-8);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, &data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  SUNLinearSolver LS = SUNSPGMR(u, 0, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  // The rootfinding problem: two events per room and one for the budget.
+  int num_events = 2 * rooms + 1;
+  EventEngine events;
+  flag = events.create(cvode_mem, num_events, g, &data);
+  if (check_flag(&flag, "EventEngine::create", 1)) return(1);
+  for (sunindextype i = 0; i < rooms; i++) {
+    flag = events.set_event(2 * i, 1, false, switch_heater);
+    if (check_flag(&flag, "EventEngine::set_event", 1)) return(1);
+    flag = events.set_event(2 * i + 1, -1, false, switch_heater);
+    if (check_flag(&flag, "EventEngine::set_event", 1)) return(1);
+  }
+  flag = events.set_event(2 * rooms, 1, true, NULL);
+  if (check_flag(&flag, "EventEngine::set_event", 1)) return(1);
+
+  // Advance the solution in time, stopping only at the events.
+  realtype t = 0;
+  double start = stats_now();
+  flag = events.integrate(end_time, u, &t);
+  double seconds = stats_now() - start;
+  if (check_flag(&flag, "EventEngine::integrate", 1)) return(1);
+
+  const std::vector < EventRecord > &log = events.log();
+  printf("%ld rooms, %ld events, stopped at t = %.4f h: %s\n", (long) rooms,
+         (long) log.size(), (double) t,
+         (flag == CV_ROOT_RETURN) ? "energy budget used up" : "end time");
+  printf("first events:\n");
+  for (size_t e = 0; e < log.size() && e < 8; e++) {
+    int room = log[e].event / 2;
+    if (log[e].event == num_events - 1) {
+      printf("  t = %9.5f  budget\n", (double) log[e].t);
+    } else {
+      printf("  t = %9.5f  room %d heater %s\n", (double) log[e].t, room,
+             (log[e].event % 2 == 0) ? "off" : "on");
+    }
+  }
+  printf("heater switches:  %ld\n", data.switches);
+  printf("steps:            %ld\n", events.num_steps());
+  printf("rhs evals:        %ld\n", events.num_rhs_evals());
+  printf("root fn evals:    %ld\n", events.num_g_evals());
+  printf("reinits:          %ld\n", events.num_reinits());
+  printf("seconds:          %.3f\n", seconds);
+  printf("max |T - threshold| at a switch: %.2e\n", (double) data.max_miss);
+
+  N_VDestroy(u);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  return(0);
+}
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype rooms = data->rooms;
+  realtype *udata = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  realtype T_out = 5 + 5 * sin(2 * M_PI * t / 24);
+
+  realtype heating = 0;
+  for (sunindextype i = 0; i < rooms; i++) {
+    realtype exchange = 0;
+    if (i > 0) exchange += udata[i - 1] - udata[i];
+    if (i < rooms - 1) exchange += udata[i + 1] - udata[i];
+    dudata[i] = -data->k[i] * (udata[i] - T_out) + data->a * exchange +
+        data->P * data->heater[i];
+    heating += data->P * data->heater[i];
+  }
+  dudata[rooms] = heating;
+
+  return(0);
+}
+
+// Jacobian function vector routine. The heaters do not depend on u, so the
+// energy row is zero.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  UserData *data = (UserData*) user_data;
+  sunindextype rooms = data->rooms;
+  realtype *vdata = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  for (sunindextype i = 0; i < rooms; i++) {
+    realtype exchange = 0;
+    if (i > 0) exchange += vdata[i - 1] - vdata[i];
+    if (i < rooms - 1) exchange += vdata[i + 1] - vdata[i];
+    Jvdata[i] = -data->k[i] * vdata[i] + data->a * exchange;
+  }
+  Jvdata[rooms] = 0;
+
+  return(0);
+}
+
+// All event functions in one call.
+static int g(realtype t, N_Vector u, realtype *gout, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype rooms = data->rooms;
+  realtype *udata = N_VGetArrayPointer(u);
+
+  for (sunindextype i = 0; i < rooms; i++) {
+    gout[2 * i] = udata[i] - data->T_high;
+    gout[2 * i + 1] = udata[i] - data->T_low;
+  }
+  gout[2 * rooms] = udata[rooms] - data->budget;
+
+  return(0);
+}
+
+// Events 2*i and 2*i + 1 switch the heater of room i off and on.
+static int switch_heater(int event, int direction, realtype t, N_Vector u,
+                         void *user_data) {
+  UserData *data = (UserData*) user_data;
+  int room = event / 2;
+  bool on = (event % 2 == 1);
+  realtype threshold = on ? data->T_low : data->T_high;
+  realtype T = N_VGetArrayPointer(u)[room];
+
+  data->max_miss = SUNMAX(data->max_miss, SUNRabs(T - threshold));
+  if (data->heater[room] == on) return(EVENT_CONTINUE);
+  data->heater[room] = on;
+  data->switches++;
+
+  return(EVENT_REINIT);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
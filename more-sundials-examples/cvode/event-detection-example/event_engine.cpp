@@ -0,0 +1,100 @@
+#include "event_engine.h"
+
+EventEngine::EventEngine()
+    : cvode_mem_(NULL), num_events_(0), user_data_(NULL), steps_(0),
+      rhs_evals_(0), g_evals_(0), num_reinits_(0) {
+}
+
+int EventEngine::create(void *cvode_mem, int num_events, CVRootFn g,
+                        void *user_data) {
+  if (cvode_mem == NULL) return(CV_MEM_NULL);
+  if (num_events < 1 || g == NULL) return(CV_ILL_INPUT);
+
+  cvode_mem_ = cvode_mem;
+  num_events_ = num_events;
+  user_data_ = user_data;
+  direction_.assign(num_events, 0);
+  rootsfound_.assign(num_events, 0);
+  terminal_.assign(num_events, false);
+  handler_.assign(num_events, (EventHandler) NULL);
+  log_.clear();
+  steps_ = rhs_evals_ = g_evals_ = num_reinits_ = 0;
+
+  return(CVodeRootInit(cvode_mem, num_events, g));
+}
+
+int EventEngine::set_event(int event, int direction, bool terminal,
+                           EventHandler handler) {
+  if (event < 0 || event >= num_events_) return(CV_ILL_INPUT);
+  if (direction < -1 || direction > 1) return(CV_ILL_INPUT);
+
+  direction_[event] = direction;
+  terminal_[event] = terminal;
+  handler_[event] = handler;
+
+  return(CVodeSetRootDirection(cvode_mem_, &direction_[0]));
+}
+
+int EventEngine::integrate(realtype tend, N_Vector y, realtype *tret) {
+  int flag;
+
+  if (cvode_mem_ == NULL) return(CV_MEM_NULL);
+
+  for (;;) {
+    flag = CVode(cvode_mem_, tend, y, tret, CV_NORMAL);
+    if (flag != CV_ROOT_RETURN) return(flag);
+
+    flag = CVodeGetRootInfo(cvode_mem_, &rootsfound_[0]);
+    if (flag < 0) return(flag);
+
+    // All the events at this time are handled before stopping or
+    // reinitializing.
+    bool stop = false, reinit = false;
+    for (int i = 0; i < num_events_; i++) {
+      if (rootsfound_[i] == 0) continue;
+      EventRecord record = {*tret, i, rootsfound_[i]};
+      log_.push_back(record);
+      if (terminal_[i]) stop = true;
+      if (handler_[i] == NULL) continue;
+
+      int action = handler_[i](i, rootsfound_[i], *tret, y, user_data_);
+      if (action < 0) return(action);
+      if (action == EVENT_REINIT) reinit = true;
+      if (action == EVENT_STOP) stop = true;
+    }
+
+    if (reinit) {
+      // The counters are set back to zero by CVodeReInit.
+      long int steps, rhs_evals, g_evals;
+      CVodeGetNumSteps(cvode_mem_, &steps);
+      CVodeGetNumRhsEvals(cvode_mem_, &rhs_evals);
+      CVodeGetNumGEvals(cvode_mem_, &g_evals);
+      steps_ += steps;
+      rhs_evals_ += rhs_evals;
+      g_evals_ += g_evals;
+      num_reinits_++;
+
+      flag = CVodeReInit(cvode_mem_, *tret, y);
+      if (flag < 0) return(flag);
+    }
+    if (stop) return(CV_ROOT_RETURN);
+  }
+}
+
+long int EventEngine::num_steps() const {
+  long int steps = 0;
+  if (cvode_mem_ != NULL) CVodeGetNumSteps(cvode_mem_, &steps);
+  return(steps_ + steps);
+}
+
+long int EventEngine::num_rhs_evals() const {
+  long int rhs_evals = 0;
+  if (cvode_mem_ != NULL) CVodeGetNumRhsEvals(cvode_mem_, &rhs_evals);
+  return(rhs_evals_ + rhs_evals);
+}
+
+long int EventEngine::num_g_evals() const {
+  long int g_evals = 0;
+  if (cvode_mem_ != NULL) CVodeGetNumGEvals(cvode_mem_, &g_evals);
+  return(g_evals_ + g_evals);
+}
@@ -0,0 +1,88 @@
+/*
+Events on top of CVODE's rootfinding: the integration stops where one of
+the components of g(t, y) crosses zero, found by CVODE between its steps, and
+nowhere else.
+
+create() registers a CVRootFn g with CVodeRootInit. g computes all the event
+functions at once into gout[0..num_events-1], so many events cost one call.
+set_event() gives an event
+
+  - a direction: only rising (+1, g goes from negative to positive), only
+    falling (-1) or both (0), passed on to CVodeSetRootDirection;
+  - whether it is terminal, i.e. integrate() returns when it happens;
+  - a handler, called with the event, the direction of the crossing and the
+    solution at the event. It returns EVENT_CONTINUE, EVENT_REINIT when it
+    changed y or something f depends on (CVODE is then reinitialized at the
+    event, as its history no longer fits), EVENT_STOP to make the event
+    terminal this time, or a negative value for an error.
+
+integrate() advances with CV_NORMAL to tend and handles the events found on
+the way. Every event that happens is added to log().
+
+CVodeReInit sets CVODE's counters back to zero, so the engine keeps totals
+of the steps, calls of f and calls of g over all reinitializations.
+
+create, set_event and integrate return a CVODE flag, negative on failure.
+integrate also passes on the negative value of a handler.
+*/
+
+#ifndef EVENT_ENGINE_H
+#define EVENT_ENGINE_H
+
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+// Return values of an EventHandler.
+#define EVENT_CONTINUE 0
+#define EVENT_REINIT 1
+#define EVENT_STOP 2
+
+// direction is +1 for a rising and -1 for a falling crossing, y the solution
+// at t. user_data is the one given to create().
+typedef int (*EventHandler)(int event, int direction, realtype t, N_Vector y,
+                            void *user_data);
+
+struct EventRecord {
+  realtype t;
+  int event;
+  int direction;
+};
+
+class EventEngine {
+ public:
+  EventEngine();
+
+  // After CVodeInit. All events start non-terminal, in both directions and
+  // without handler.
+  int create(void *cvode_mem, int num_events, CVRootFn g, void *user_data);
+
+  int set_event(int event, int direction, bool terminal,
+                EventHandler handler);
+
+  // Integrates towards tend, y is the vector given to CVodeInit. Returns
+  // CV_SUCCESS at tend and CV_ROOT_RETURN at a terminal event, *tret is the
+  // time reached.
+  int integrate(realtype tend, N_Vector y, realtype *tret);
+
+  const std::vector < EventRecord > &log() const { return log_; }
+
+  // Totals over all reinitializations.
+  long int num_steps() const;
+  long int num_rhs_evals() const;
+  long int num_g_evals() const;
+  long int num_reinits() const { return num_reinits_; }
+
+ private:
+  void *cvode_mem_;
+  int num_events_;
+  void *user_data_;
+  std::vector < int > direction_, rootsfound_;
+  std::vector < bool > terminal_;
+  std::vector < EventHandler > handler_;
+  std::vector < EventRecord > log_;
+  long int steps_, rhs_evals_, g_evals_, num_reinits_;
+};
+
+#endif
@@ -0,0 +1,352 @@
+/*
+The simple dense example with SUNDenseMatrix/SUNDenseLinearSolver replaced by
+the fixed size matrix and linear solver from small_dense.h. The size of the
+system (2) is a template argument, so the jacobian, the matrix operations and
+the solve of the Newton iteration use loops of known length and, for N <= 4, a
+closed-form inverse.
+
+After the integration the program checks the solver kernels for several sizes
+and times repeated integrations with the generic dense path and the fixed size
+path.
+
+Usage: ./executable [repeats]
+*/
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
+#include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
+#include <cvode/cvode_direct.h> // access to CVDls interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "small_dense.h"
+
+// These macro gives access to the individual components of the data array of an
+// N Vector (NV_Ith_S) and the fixed size SUNMatrix (IJth).
+#define NV_Ith_S(v,i) ( NV_DATA_S(v)[i] )
+#define IJth(A,i,j) SmallDenseElement<2>(A,i,j)
+
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix Jac,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+static int jac_dense(realtype t, N_Vector y, N_Vector fy, SUNMatrix Jac,
+                     void *user_data, N_Vector tmp1, N_Vector tmp2,
+                     N_Vector tmp3);
+template <int N> static realtype check_kernels();
+static double time_solves(bool small, long int repeats, realtype *y_end);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  int flag; // For checking if functions have run properly
+  realtype abstol = 1e-5; // real tolerance of system
+  realtype reltol = 1e-5; // absolute tolerance of system
+  long int repeats = (argc > 1) ? std::atol(argv[1]) : 20000;
+  if (repeats < 1) repeats = 1;
+
+  // 1. Initialize parallel or multi-threaded environment, if appropriate.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 2. Defining the length of the problem.
+  // ---------------------------------------------------------------------------
+  // The length is also the template argument of the matrix and linear solver.
+  const int N = 2;
+  // ---------------------------------------------------------------------------
+
+  // 3. Set vector of initial values.
+  // ---------------------------------------------------------------------------
+  N_Vector y; // Problem vector.
+  y = N_VNew_Serial(N);
+  NV_Ith_S(y, 0) = 2.0;
+  NV_Ith_S(y, 1) = 1.0;
+  // ---------------------------------------------------------------------------
+
+  // 4. Create CVODE Object.
+  // ---------------------------------------------------------------------------
+  void *cvode_mem = NULL; // Problem dedicated memory.
+  cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  // ---------------------------------------------------------------------------
+
+  // 5. Initialize CVODE solver.
+  // ---------------------------------------------------------------------------
+  realtype t0 = 0; // Initiale value of time.
+  flag = CVodeInit(cvode_mem, f, t0, y);
+  if(check_flag(&flag, "CVodeInit", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 6. Specify integration tolerances.
+  // ---------------------------------------------------------------------------
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 7. Set Optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 8. Create Matrix Object.
+  // ---------------------------------------------------------------------------
+  // Fixed size matrix instead of SUNDenseMatrix(N, N).
+  SUNMatrix A = SUNSmallDenseMatrix<N>();
+  if(check_flag((void *)A, "SUNSmallDenseMatrix", 0)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 9. Create Linear Solver Object.
+  // ---------------------------------------------------------------------------
+  // Fixed size direct solver instead of SUNDenseLinearSolver(y, A).
+  SUNLinearSolver LS = SUNSmallDenseLinearSolver<N>(y, A);
+  if(check_flag((void *)LS, "SUNSmallDenseLinearSolver", 0)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 10. Set linear solver optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 11. Attach linear solver module.
+  // ---------------------------------------------------------------------------
+  // The fixed size solver is a direct solver, so it is attached the same way
+  // as the dense one.
+  flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+  if(check_flag(&flag, "CVDlsSetLinearSolver", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 12. Set linear solver interface optional inputs.
+  // ---------------------------------------------------------------------------
+  // Sets the jacobian function. CVODE's difference quotient jacobian only
+  // knows the dense and band matrices, so it is required here.
+  flag = CVDlsSetJacFn(cvode_mem, jac);
+  if(check_flag(&flag, "CVDlsSetJacFn", 1)) return(1);
+  // ---------------------------------------------------------------------------
+
+  // 13. Specify rootfinding problem.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 14. Advance solution in time.
+  // ---------------------------------------------------------------------------
+  // Have the solution advance over time, but stop to log 100 of the steps.
+  realtype end_time = 50;
+  realtype step_length = 0.5;
+  realtype t = 0;
+  long int num_outputs = (long int) (end_time / step_length + 0.5);
+  // loop over output points, call CVode, print results, test for error
+  for (long int i = 1; i <= num_outputs; i++) {
+    realtype tout = t0 + i * step_length;
+    flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
+    std::cout << "t: " << t;
+    std::cout << "\ny:";
+    N_VPrint_Serial(y);
+    if(check_flag(&flag, "CVode", 1)) break;
+  }
+  // ---------------------------------------------------------------------------
+
+  // 15. Get optional outputs.
+  // ---------------------------------------------------------------------------
+  long int nsteps, nsetups;
+  flag = CVodeGetNumSteps(cvode_mem, &nsteps);
+  if(check_flag(&flag, "CVodeGetNumSteps", 1)) return(1);
+  flag = CVodeGetNumLinSolvSetups(cvode_mem, &nsetups);
+  if(check_flag(&flag, "CVodeGetNumLinSolvSetups", 1)) return(1);
+  std::cout << "steps: " << nsteps << ", linear solver setups: " << nsetups
+            << "\n\n";
+
+  // Largest relative residual |A x - b| / |b| of the kernels for a few sizes.
+  std::cout << "kernel residuals: N=2 " << check_kernels<2>()
+            << ", N=3 " << check_kernels<3>()
+            << ", N=4 " << check_kernels<4>()
+            << ", N=5 " << check_kernels<5>()
+            << ", N=8 " << check_kernels<8>()
+            << ", N=16 " << check_kernels<16>() << "\n";
+
+  // Repeated integrations to t = 50 with both linear solvers.
+  realtype y_dense[2], y_small[2];
+  double dense_seconds = time_solves(false, repeats, y_dense);
+  double small_seconds = time_solves(true, repeats, y_small);
+  if (dense_seconds < 0 || small_seconds < 0) return(1);
+  realtype max_diff = SUNMAX(SUNRabs(y_dense[0] - y_small[0]),
+                             SUNRabs(y_dense[1] - y_small[1]));
+  std::cout << "repeats: " << repeats << "\n";
+  std::cout << "SUNDenseMatrix/SUNDenseLinearSolver: " << dense_seconds
+            << " s\n";
+  std::cout << "SUNSmallDenseMatrix<2>/LinearSolver: " << small_seconds
+            << " s\n";
+  std::cout << "speedup:                             "
+            << dense_seconds / small_seconds << "\n";
+  std::cout << "max |dense-small| at t = 50:         " << max_diff << "\n";
+  // ---------------------------------------------------------------------------
+
+  // 16. Deallocate memory for solution vector.
+  // ---------------------------------------------------------------------------
+  N_VDestroy(y);
+  // ---------------------------------------------------------------------------
+
+  // 17. Free solver memory.
+  // ---------------------------------------------------------------------------
+  CVodeFree(&cvode_mem);
+  // ---------------------------------------------------------------------------
+
+  // 18. Free linear solver and matrix memory.
+  // ---------------------------------------------------------------------------
+  SUNLinSolFree(LS);
+  SUNMatDestroy(A);
+  // ---------------------------------------------------------------------------
+
+  return(0);
+}
+
+// Integrates the system from t = 0 to 50 repeats times with one CVODE object,
+// using either the generic dense or the fixed size matrix and linear solver.
+// Returns the elapsed seconds or -1 on failure.
+static double time_solves(bool small, long int repeats, realtype *y_end) {
+  int flag;
+
+  N_Vector y = N_VNew_Serial(2);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(-1);
+  NV_Ith_S(y, 0) = 2.0;
+  NV_Ith_S(y, 1) = 1.0;
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(-1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(-1);
+  flag = CVodeSStolerances(cvode_mem, 1e-5, 1e-5);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(-1);
+
+  SUNMatrix A = small ? SUNSmallDenseMatrix<2>() : SUNDenseMatrix(2, 2);
+  if (check_flag((void *)A, "SUNMatrix", 0)) return(-1);
+  SUNLinearSolver LS = small ? SUNSmallDenseLinearSolver<2>(y, A)
+                             : SUNDenseLinearSolver(y, A);
+  if (check_flag((void *)LS, "SUNLinearSolver", 0)) return(-1);
+  flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+  if (check_flag(&flag, "CVDlsSetLinearSolver", 1)) return(-1);
+  flag = CVDlsSetJacFn(cvode_mem, small ? jac : jac_dense);
+  if (check_flag(&flag, "CVDlsSetJacFn", 1)) return(-1);
+
+  realtype t = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long int r = 0; r < repeats; r++) {
+    NV_Ith_S(y, 0) = 2.0;
+    NV_Ith_S(y, 1) = 1.0;
+    flag = CVodeReInit(cvode_mem, 0, y);
+    if (check_flag(&flag, "CVodeReInit", 1)) return(-1);
+    flag = CVode(cvode_mem, 50, y, &t, CV_NORMAL);
+    if (check_flag(&flag, "CVode", 1)) return(-1);
+  }
+  double seconds = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+  y_end[0] = NV_Ith_S(y, 0);
+  y_end[1] = NV_Ith_S(y, 1);
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  SUNMatDestroy(A);
+
+  return(seconds);
+}
+
+// Factors and solves a nonsingular N x N system (N >= 2) with the fixed size
+// kernels and returns the relative residual of the solution.
+template <int N>
+static realtype check_kernels() {
+  realtype A[N * N], F[N * N], b[N], x[N];
+  int piv[N];
+
+  // The first two diagonal entries are small so that the LU version has to
+  // pivot.
+  for (int j = 0; j < N; j++) {
+    for (int i = 0; i < N; i++) {
+      A[j * N + i] = (i == j) ? N + 1.0 + i : 1.0 / (1.0 + i + 2 * j);
+    }
+    b[j] = 1.0 + j;
+  }
+  A[0] = 1e-3;
+  A[N + 1] = 1e-3;
+
+  if (SmallDenseKernels<N>::factor(A, F, piv) != 0) return(-1);
+  SmallDenseKernels<N>::solve(F, piv, b, x);
+
+  realtype max_res = 0, max_b = 0;
+  for (int i = 0; i < N; i++) {
+    realtype Ax = 0;
+    for (int j = 0; j < N; j++) Ax += A[j * N + i] * x[j];
+    max_res = SUNMAX(max_res, SUNRabs(Ax - b[i]));
+    max_b = SUNMAX(max_b, SUNRabs(b[i]));
+  }
+  return(max_res / max_b);
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
+  realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
+  realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function for the fixed size matrix.
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix Jac,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+  IJth(Jac, 0, 0) = -101.0;
+  IJth(Jac, 0, 1) = -100.0;
+  IJth(Jac, 1, 0) = 1.0;
+  IJth(Jac, 1, 1) = 0.0;
+
+  return(0);
+}
+
+// The same jacobian for the generic dense matrix of the timing comparison.
+static int jac_dense(realtype t, N_Vector y, N_Vector fy, SUNMatrix Jac,
+                     void *user_data, N_Vector tmp1, N_Vector tmp2,
+                     N_Vector tmp3) {
+  SM_ELEMENT_D(Jac, 0, 0) = -101.0;
+  SM_ELEMENT_D(Jac, 0, 1) = -100.0;
+  SM_ELEMENT_D(Jac, 1, 0) = 1.0;
+  SM_ELEMENT_D(Jac, 1, 1) = 0.0;
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,443 @@
+/*
+A SUNMatrix and a direct SUNLinearSolver for tiny dense systems whose size N
+(2 to 16) is fixed at compile time. They plug into CVDlsSetLinearSolver in
+place of SUNDenseMatrix/SUNDenseLinearSolver.
+
+ - The matrix is one contiguous column-major array of N*N values inside the
+   content, so there are no column pointers to follow and every loop has a
+   compile-time trip count the compiler can unroll.
+ - For N <= 4 the linear solver setup computes the inverse in closed form and
+   the solve is a single matrix-vector product. For larger N it uses an LU
+   factorization with partial pivoting.
+
+Usage:
+  SUNMatrix A = SUNSmallDenseMatrix<2>();
+  SUNLinearSolver LS = SUNSmallDenseLinearSolver<2>(y, A);
+  flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+and in the jacobian function SmallDenseElement<2>(J, i, j) = ...
+*/
+
+#ifndef SMALL_DENSE_H
+#define SMALL_DENSE_H
+
+#include <cstring>
+#include <sundials/sundials_linearsolver.h> // generic SUNLinearSolver
+#include <sundials/sundials_matrix.h> // generic SUNMatrix
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include <sundials/sundials_nvector.h> // generic N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+// Content of the fixed size matrix, element (i,j) is data[j*N + i].
+template <int N>
+struct SmallDenseMatrixContent {
+  realtype data[N * N];
+};
+
+// Content of the fixed size linear solver. factor holds the inverse for
+// N <= 4 and the LU factors otherwise.
+template <int N>
+struct SmallDenseSolverContent {
+  realtype factor[N * N];
+  int pivots[N];
+  long int last_flag;
+};
+
+template <int N>
+inline realtype *SmallDenseData(SUNMatrix A) {
+  return ((SmallDenseMatrixContent<N>*) A->content)->data;
+}
+
+template <int N>
+inline realtype &SmallDenseElement(SUNMatrix A, int i, int j) {
+  return SmallDenseData<N>(A)[j * N + i];
+}
+
+// Factor and solve kernels. The general version is LU with partial pivoting,
+// the specializations below use the closed-form inverse for N = 2, 3, 4.
+// factor returns 0 on success or the 1-based column of a zero pivot.
+template <int N>
+struct SmallDenseKernels {
+  static int factor(const realtype *A, realtype *F, int *piv) {
+    for (int k = 0; k < N * N; k++) F[k] = A[k];
+
+    for (int k = 0; k < N; k++) {
+      realtype *col_k = F + k * N;
+
+      // Find the pivot row.
+      int p = k;
+      for (int i = k + 1; i < N; i++) {
+        if (SUNRabs(col_k[i]) > SUNRabs(col_k[p])) p = i;
+      }
+      piv[k] = p;
+      if (col_k[p] == 0) return(k + 1);
+
+      // Swap rows k and p in every column.
+      if (p != k) {
+        for (int j = 0; j < N; j++) {
+          realtype tmp = F[j * N + k];
+          F[j * N + k] = F[j * N + p];
+          F[j * N + p] = tmp;
+        }
+      }
+
+      // Multipliers, then update the trailing columns.
+      realtype inv_pivot = 1.0 / col_k[k];
+      for (int i = k + 1; i < N; i++) col_k[i] *= inv_pivot;
+      for (int j = k + 1; j < N; j++) {
+        realtype *col_j = F + j * N;
+        realtype a_kj = col_j[k];
+        if (a_kj == 0) continue;
+        for (int i = k + 1; i < N; i++) col_j[i] -= a_kj * col_k[i];
+      }
+    }
+    return(0);
+  }
+
+  static void solve(const realtype *F, const int *piv, const realtype *b,
+                    realtype *x) {
+    realtype y[N];
+    for (int i = 0; i < N; i++) y[i] = b[i];
+
+    // Apply the row swaps, then forward and back substitution.
+    for (int k = 0; k < N; k++) {
+      if (piv[k] != k) {
+        realtype tmp = y[k];
+        y[k] = y[piv[k]];
+        y[piv[k]] = tmp;
+      }
+    }
+    for (int k = 0; k < N; k++) {
+      const realtype *col_k = F + k * N;
+      for (int i = k + 1; i < N; i++) y[i] -= col_k[i] * y[k];
+    }
+    for (int k = N - 1; k >= 0; k--) {
+      const realtype *col_k = F + k * N;
+      y[k] /= col_k[k];
+      for (int i = 0; i < k; i++) y[i] -= col_k[i] * y[k];
+    }
+
+    for (int i = 0; i < N; i++) x[i] = y[i];
+  }
+};
+
+// x = F b for the closed-form inverses, F is column-major.
+template <int N>
+inline void SmallDenseApplyInverse(const realtype *F, const realtype *b,
+                                   realtype *x) {
+  realtype y[N];
+  for (int i = 0; i < N; i++) {
+    realtype sum = 0;
+    for (int j = 0; j < N; j++) sum += F[j * N + i] * b[j];
+    y[i] = sum;
+  }
+  for (int i = 0; i < N; i++) x[i] = y[i];
+}
+
+template <>
+struct SmallDenseKernels<2> {
+  static int factor(const realtype *A, realtype *F, int *piv) {
+    realtype a = A[0], c = A[1], b = A[2], d = A[3];
+    realtype det = a * d - b * c;
+    if (det == 0) return(1);
+    realtype inv_det = 1.0 / det;
+    F[0] = d * inv_det;
+    F[1] = -c * inv_det;
+    F[2] = -b * inv_det;
+    F[3] = a * inv_det;
+    return(0);
+  }
+
+  static void solve(const realtype *F, const int *piv, const realtype *b,
+                    realtype *x) {
+    SmallDenseApplyInverse<2>(F, b, x);
+  }
+};
+
+template <>
+struct SmallDenseKernels<3> {
+  static int factor(const realtype *A, realtype *F, int *piv) {
+    // a_ij = A[j*3 + i]
+    realtype a00 = A[0], a10 = A[1], a20 = A[2];
+    realtype a01 = A[3], a11 = A[4], a21 = A[5];
+    realtype a02 = A[6], a12 = A[7], a22 = A[8];
+
+    // Cofactors of the first row give the determinant.
+    realtype c00 = a11 * a22 - a12 * a21;
+    realtype c01 = a12 * a20 - a10 * a22;
+    realtype c02 = a10 * a21 - a11 * a20;
+    realtype det = a00 * c00 + a01 * c01 + a02 * c02;
+    if (det == 0) return(1);
+    realtype inv_det = 1.0 / det;
+
+    // inverse = adjugate / det, the adjugate is the transposed cofactors.
+    F[0] = c00 * inv_det;                          // (0,0)
+    F[1] = c01 * inv_det;                          // (1,0)
+    F[2] = c02 * inv_det;                          // (2,0)
+    F[3] = (a02 * a21 - a01 * a22) * inv_det;      // (0,1)
+    F[4] = (a00 * a22 - a02 * a20) * inv_det;      // (1,1)
+    F[5] = (a01 * a20 - a00 * a21) * inv_det;      // (2,1)
+    F[6] = (a01 * a12 - a02 * a11) * inv_det;      // (0,2)
+    F[7] = (a02 * a10 - a00 * a12) * inv_det;      // (1,2)
+    F[8] = (a00 * a11 - a01 * a10) * inv_det;      // (2,2)
+    return(0);
+  }
+
+  static void solve(const realtype *F, const int *piv, const realtype *b,
+                    realtype *x) {
+    SmallDenseApplyInverse<3>(F, b, x);
+  }
+};
+
+template <>
+struct SmallDenseKernels<4> {
+  static int factor(const realtype *A, realtype *F, int *piv) {
+    // a_ij = A[j*4 + i]
+    realtype a00 = A[0], a10 = A[1], a20 = A[2],  a30 = A[3];
+    realtype a01 = A[4], a11 = A[5], a21 = A[6],  a31 = A[7];
+    realtype a02 = A[8], a12 = A[9], a22 = A[10], a32 = A[11];
+    realtype a03 = A[12], a13 = A[13], a23 = A[14], a33 = A[15];
+
+    // 2x2 determinants of the top two rows (s) and bottom two rows (c).
+    realtype s0 = a00 * a11 - a10 * a01;
+    realtype s1 = a00 * a12 - a10 * a02;
+    realtype s2 = a00 * a13 - a10 * a03;
+    realtype s3 = a01 * a12 - a11 * a02;
+    realtype s4 = a01 * a13 - a11 * a03;
+    realtype s5 = a02 * a13 - a12 * a03;
+    realtype c5 = a22 * a33 - a32 * a23;
+    realtype c4 = a21 * a33 - a31 * a23;
+    realtype c3 = a21 * a32 - a31 * a22;
+    realtype c2 = a20 * a33 - a30 * a23;
+    realtype c1 = a20 * a32 - a30 * a22;
+    realtype c0 = a20 * a31 - a30 * a21;
+
+    realtype det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (det == 0) return(1);
+    realtype inv_det = 1.0 / det;
+
+    // F[j*4 + i] is element (i,j) of the inverse.
+    F[0]  = ( a11 * c5 - a12 * c4 + a13 * c3) * inv_det;
+    F[4]  = (-a01 * c5 + a02 * c4 - a03 * c3) * inv_det;
+    F[8]  = ( a31 * s5 - a32 * s4 + a33 * s3) * inv_det;
+    F[12] = (-a21 * s5 + a22 * s4 - a23 * s3) * inv_det;
+    F[1]  = (-a10 * c5 + a12 * c2 - a13 * c1) * inv_det;
+    F[5]  = ( a00 * c5 - a02 * c2 + a03 * c1) * inv_det;
+    F[9]  = (-a30 * s5 + a32 * s2 - a33 * s1) * inv_det;
+    F[13] = ( a20 * s5 - a22 * s2 + a23 * s1) * inv_det;
+    F[2]  = ( a10 * c4 - a11 * c2 + a13 * c0) * inv_det;
+    F[6]  = (-a00 * c4 + a01 * c2 - a03 * c0) * inv_det;
+    F[10] = ( a30 * s4 - a31 * s2 + a33 * s0) * inv_det;
+    F[14] = (-a20 * s4 + a21 * s2 - a23 * s0) * inv_det;
+    F[3]  = (-a10 * c3 + a11 * c1 - a12 * c0) * inv_det;
+    F[7]  = ( a00 * c3 - a01 * c1 + a02 * c0) * inv_det;
+    F[11] = (-a30 * s3 + a31 * s1 - a32 * s0) * inv_det;
+    F[15] = ( a20 * s3 - a21 * s1 + a22 * s0) * inv_det;
+    return(0);
+  }
+
+  static void solve(const realtype *F, const int *piv, const realtype *b,
+                    realtype *x) {
+    SmallDenseApplyInverse<4>(F, b, x);
+  }
+};
+
+// SUNMatrix operations of the fixed size matrix.
+template <int N>
+struct SmallDenseMatrixOps {
+  static SUNMatrix_ID getid(SUNMatrix A) {
+    return SUNMATRIX_CUSTOM;
+  }
+
+  static SUNMatrix clone(SUNMatrix A);
+
+  static void destroy(SUNMatrix A) {
+    if (A == NULL) return;
+    delete (SmallDenseMatrixContent<N>*) A->content;
+    delete A;
+  }
+
+  static int zero(SUNMatrix A) {
+    realtype *a = SmallDenseData<N>(A);
+    for (int k = 0; k < N * N; k++) a[k] = 0;
+    return SUNMAT_SUCCESS;
+  }
+
+  static int copy(SUNMatrix A, SUNMatrix B) {
+    memcpy(SmallDenseData<N>(B), SmallDenseData<N>(A),
+           N * N * sizeof(realtype));
+    return SUNMAT_SUCCESS;
+  }
+
+  // A = c*A + B
+  static int scaleadd(realtype c, SUNMatrix A, SUNMatrix B) {
+    realtype *a = SmallDenseData<N>(A);
+    const realtype *b = SmallDenseData<N>(B);
+    for (int k = 0; k < N * N; k++) a[k] = c * a[k] + b[k];
+    return SUNMAT_SUCCESS;
+  }
+
+  // A = c*A + I
+  static int scaleaddi(realtype c, SUNMatrix A) {
+    realtype *a = SmallDenseData<N>(A);
+    for (int k = 0; k < N * N; k++) a[k] *= c;
+    for (int i = 0; i < N; i++) a[i * N + i] += 1.0;
+    return SUNMAT_SUCCESS;
+  }
+
+  // y = A x
+  static int matvec(SUNMatrix A, N_Vector x, N_Vector y) {
+    const realtype *a = SmallDenseData<N>(A);
+    const realtype *xd = N_VGetArrayPointer(x);
+    realtype *yd = N_VGetArrayPointer(y);
+    if (xd == NULL || yd == NULL || xd == yd) return SUNMAT_MEM_FAIL;
+    for (int i = 0; i < N; i++) {
+      realtype sum = 0;
+      for (int j = 0; j < N; j++) sum += a[j * N + i] * xd[j];
+      yd[i] = sum;
+    }
+    return SUNMAT_SUCCESS;
+  }
+
+  static int space(SUNMatrix A, long int *lenrw, long int *leniw) {
+    *lenrw = N * N;
+    *leniw = 0;
+    return SUNMAT_SUCCESS;
+  }
+
+  // One operations table shared by every matrix of size N.
+  static struct _generic_SUNMatrix_Ops make_table() {
+    struct _generic_SUNMatrix_Ops ops;
+    memset(&ops, 0, sizeof(ops));
+    ops.getid = getid;
+    ops.clone = clone;
+    ops.destroy = destroy;
+    ops.zero = zero;
+    ops.copy = copy;
+    ops.scaleadd = scaleadd;
+    ops.scaleaddi = scaleaddi;
+    ops.matvec = matvec;
+    ops.space = space;
+    return ops;
+  }
+
+  static struct _generic_SUNMatrix_Ops *table() {
+    static struct _generic_SUNMatrix_Ops ops = make_table();
+    return &ops;
+  }
+};
+
+template <int N>
+SUNMatrix SUNSmallDenseMatrix() {
+  static_assert(N >= 2 && N <= 16, "SUNSmallDenseMatrix supports N = 2..16");
+
+  SUNMatrix A = new struct _generic_SUNMatrix;
+  SmallDenseMatrixContent<N> *content = new SmallDenseMatrixContent<N>;
+  memset(content->data, 0, sizeof(content->data));
+  A->content = content;
+  A->ops = SmallDenseMatrixOps<N>::table();
+  return A;
+}
+
+template <int N>
+SUNMatrix SmallDenseMatrixOps<N>::clone(SUNMatrix A) {
+  return SUNSmallDenseMatrix<N>();
+}
+
+// SUNLinearSolver operations of the fixed size direct solver.
+template <int N>
+struct SmallDenseSolverOps {
+  static SmallDenseSolverContent<N> *content(SUNLinearSolver S) {
+    return (SmallDenseSolverContent<N>*) S->content;
+  }
+
+  static SUNLinearSolver_Type gettype(SUNLinearSolver S) {
+    return SUNLINEARSOLVER_DIRECT;
+  }
+
+  static int initialize(SUNLinearSolver S) {
+    content(S)->last_flag = SUNLS_SUCCESS;
+    return SUNLS_SUCCESS;
+  }
+
+  // Factors A, a zero pivot is reported as a recoverable failure so CVODE
+  // retries with a smaller step.
+  static int setup(SUNLinearSolver S, SUNMatrix A) {
+    SmallDenseSolverContent<N> *c = content(S);
+    int zero_pivot = SmallDenseKernels<N>::factor(SmallDenseData<N>(A),
+                                                  c->factor, c->pivots);
+    c->last_flag = zero_pivot;
+    return (zero_pivot > 0) ? SUNLS_LUFACT_FAIL : SUNLS_SUCCESS;
+  }
+
+  static int solve(SUNLinearSolver S, SUNMatrix A, N_Vector x, N_Vector b,
+                   realtype tol) {
+    SmallDenseSolverContent<N> *c = content(S);
+    const realtype *bd = N_VGetArrayPointer(b);
+    realtype *xd = N_VGetArrayPointer(x);
+    if (bd == NULL || xd == NULL) {
+      c->last_flag = SUNLS_MEM_FAIL;
+      return SUNLS_MEM_FAIL;
+    }
+    SmallDenseKernels<N>::solve(c->factor, c->pivots, bd, xd);
+    c->last_flag = SUNLS_SUCCESS;
+    return SUNLS_SUCCESS;
+  }
+
+  static long int lastflag(SUNLinearSolver S) {
+    return content(S)->last_flag;
+  }
+
+  static int space(SUNLinearSolver S, long int *lenrw, long int *leniw) {
+    *lenrw = N * N;
+    *leniw = N + 1;
+    return SUNLS_SUCCESS;
+  }
+
+  static int free_solver(SUNLinearSolver S) {
+    if (S == NULL) return SUNLS_SUCCESS;
+    delete content(S);
+    delete S;
+    return SUNLS_SUCCESS;
+  }
+
+  // One operations table shared by every solver of size N. The iterative
+  // solver operations are not needed by a direct solver.
+  static struct _generic_SUNLinearSolver_Ops make_table() {
+    struct _generic_SUNLinearSolver_Ops ops;
+    memset(&ops, 0, sizeof(ops));
+    ops.gettype = gettype;
+    ops.initialize = initialize;
+    ops.setup = setup;
+    ops.solve = solve;
+    ops.lastflag = lastflag;
+    ops.space = space;
+    ops.free = free_solver;
+    return ops;
+  }
+
+  static struct _generic_SUNLinearSolver_Ops *table() {
+    static struct _generic_SUNLinearSolver_Ops ops = make_table();
+    return &ops;
+  }
+};
+
+// The template vector y is only used to check that its length matches N.
+template <int N>
+SUNLinearSolver SUNSmallDenseLinearSolver(N_Vector y, SUNMatrix A) {
+  static_assert(N >= 2 && N <= 16,
+                "SUNSmallDenseLinearSolver supports N = 2..16");
+
+  if (A == NULL || A->ops != SmallDenseMatrixOps<N>::table()) return NULL;
+  sunindextype lrw, liw;
+  N_VSpace(y, &lrw, &liw);
+  if (lrw != N) return NULL;
+
+  SUNLinearSolver S = new struct _generic_SUNLinearSolver;
+  SmallDenseSolverContent<N> *content = new SmallDenseSolverContent<N>;
+  memset(content, 0, sizeof(*content));
+  S->content = content;
+  S->ops = SmallDenseSolverOps<N>::table();
+  return S;
+}
+
+#endif
@@ -0,0 +1,401 @@
+#include "jacobian_cache.h"
+
+#include <cmath>
+#include <cstring>
+#include <sundials/sundials_dense.h>  // denseGETRF, denseGETRS
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
+
+// Gammas closer than this (relative) are the same for JAC_REUSE_EXACT. The
+// gamma recovered from M = I - gamma*J is only right to rounding.
+#define EXACT_GAMMA_TOL 1e-10
+
+// Content of the cached linear solver.
+struct JacCacheSolverContent {
+  JacobianCache *cache;
+  long int last_flag;
+};
+
+
+JacCacheOptions default_jac_cache_options() {
+  JacCacheOptions options;
+  options.policy = JAC_REUSE_EXACT;
+  options.gamma_tol = 0.2;
+  options.constant_checks = 2;
+  options.constant_tol = 0;
+  options.max_entries = 16;
+  return options;
+}
+
+long int parameter_bucket(const realtype *params, int n, realtype width) {
+  // FNV-1a over the bytes of the rounded parameters.
+  unsigned long long hash = 14695981039346656037ULL;
+  for (int k = 0; k < n; k++) {
+    long long q = (long long) std::floor(params[k] / width);
+    for (int b = 0; b < 8; b++) {
+      hash ^= (unsigned long long) ((q >> (8 * b)) & 0xff);
+      hash *= 1099511628211ULL;
+    }
+  }
+  return (long int) hash;
+}
+
+JacobianCache::JacobianCache()
+    : N_(0), jac_(NULL), bucket_(0), current_(NULL), factors_(NULL),
+      jmat_(NULL), clock_(0), num_jac_evals_(0), num_jac_reuses_(0),
+      num_factorizations_(0), num_saved_(0) {
+  options_ = default_jac_cache_options();
+  tmp_[0] = tmp_[1] = tmp_[2] = NULL;
+}
+
+JacobianCache::~JacobianCache() {
+  if (jmat_ != NULL) SUNMatDestroy(jmat_);
+  for (int k = 0; k < 3; k++) {
+    if (tmp_[k] != NULL) N_VDestroy(tmp_[k]);
+  }
+}
+
+int JacobianCache::create(sunindextype N, CVDlsJacFn jac,
+                          const JacCacheOptions &options) {
+  if (N < 1 || jac == NULL || options.max_entries < 1) return(-1);
+  if (options.policy == JAC_REUSE_NEAREST && options.gamma_tol < 0) {
+    return(-1);
+  }
+
+  if (jmat_ != NULL) SUNMatDestroy(jmat_);
+  jmat_ = SUNDenseMatrix(N, N);
+  if (jmat_ == NULL) return(-1);
+  for (int k = 0; k < 3; k++) {
+    if (tmp_[k] != NULL) N_VDestroy(tmp_[k]);
+    tmp_[k] = NULL;
+  }
+
+  N_ = N;
+  jac_ = jac;
+  options_ = options;
+  cols_.assign(N, NULL);
+  buckets_.clear();
+  factors_ = NULL;
+  reset_counters();
+  set_bucket(0);
+  return(0);
+}
+
+void JacobianCache::set_bucket(long int bucket) {
+  std::map < long int, Bucket >::iterator it = buckets_.find(bucket);
+  if (it == buckets_.end()) {
+    it = buckets_.insert(std::make_pair(bucket, Bucket())).first;
+    Bucket &b = it->second;
+    b.have_jac = false;
+    b.constant = false;
+    b.equal_evals = 0;
+    b.max_row = b.max_col = 0;
+    // Entries are never moved, so factors_ can point at one.
+    b.entries.reserve(options_.max_entries);
+  }
+  bucket_ = bucket;
+  current_ = &it->second;
+  factors_ = NULL;
+}
+
+void JacobianCache::clear() {
+  buckets_.clear();
+  current_ = NULL;
+  set_bucket(bucket_);
+}
+
+long int JacobianCache::num_constant_buckets() const {
+  long int count = 0;
+  std::map < long int, Bucket >::const_iterator it;
+  for (it = buckets_.begin(); it != buckets_.end(); ++it) {
+    if (it->second.constant) count++;
+  }
+  return count;
+}
+
+void JacobianCache::reset_counters() {
+  num_jac_evals_ = num_jac_reuses_ = 0;
+  num_factorizations_ = num_saved_ = 0;
+}
+
+int JacobianCache::jacobian(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+                            void *user_data, N_Vector tmp1, N_Vector tmp2,
+                            N_Vector tmp3) {
+  if (SUNMatGetID(J) != SUNMATRIX_DENSE) return(-1);
+  int flag = update_jacobian(t, y, fy, user_data, tmp1, tmp2, tmp3);
+  if (flag != 0) return(flag);
+  memcpy(SUNDenseMatrix_Data(J), &current_->jac[0],
+         N_ * N_ * sizeof(realtype));
+  return(0);
+}
+
+int JacobianCache::prec_setup(realtype t, N_Vector y, N_Vector fy,
+                              booleantype jok, booleantype *jcurPtr,
+                              realtype gamma, void *user_data) {
+  // A new jacobian only when CVODE asks for one.
+  if (!jok || !current_->have_jac) {
+    for (int k = 0; k < 3; k++) {
+      if (tmp_[k] == NULL) tmp_[k] = N_VClone(y);
+      if (tmp_[k] == NULL) return(-1);
+    }
+    int flag = update_jacobian(t, y, fy, user_data, tmp_[0], tmp_[1],
+                               tmp_[2]);
+    if (flag != 0) return(flag);
+    *jcurPtr = SUNTRUE;
+  } else {
+    *jcurPtr = SUNFALSE;
+  }
+
+  Entry *entry = lookup(gamma);
+  if (entry != NULL) {
+    num_saved_++;
+    entry->last_use = ++clock_;
+    select(entry);
+    return(0);
+  }
+
+  // Miss: factor I - gamma*J.
+  entry = new_entry(gamma);
+  const realtype *jac = &current_->jac[0];
+  for (sunindextype k = 0; k < N_ * N_; k++) entry->lu[k] = -gamma * jac[k];
+  for (sunindextype i = 0; i < N_; i++) entry->lu[i * N_ + i] += 1;
+  return factor(entry);
+}
+
+int JacobianCache::prec_solve(N_Vector r, N_Vector z) {
+  const realtype *rdata = N_VGetArrayPointer(r);
+  realtype *zdata = N_VGetArrayPointer(z);
+  if (zdata != rdata) memcpy(zdata, rdata, N_ * sizeof(realtype));
+  return solve(zdata);
+}
+
+int JacobianCache::setup_matrix(SUNMatrix M) {
+  const Bucket &b = *current_;
+  if (!b.have_jac) return(-1);
+
+  // M = I - gamma*J, so gamma follows from the largest entry of J.
+  const realtype *m = SUNDenseMatrix_Data(M);
+  sunindextype k = b.max_col * N_ + b.max_row;
+  realtype identity = (b.max_row == b.max_col) ? 1 : 0;
+  realtype gamma = (b.jac[k] != 0) ? (identity - m[k]) / b.jac[k] : 0;
+
+  Entry *entry = lookup(gamma);
+  if (entry != NULL) {
+    num_saved_++;
+    entry->last_use = ++clock_;
+    select(entry);
+    return(0);
+  }
+
+  entry = new_entry(gamma);
+  memcpy(&entry->lu[0], m, N_ * N_ * sizeof(realtype));
+  return factor(entry);
+}
+
+int JacobianCache::solve(realtype *x) {
+  if (factors_ == NULL) return(-1);
+  denseGETRS(&cols_[0], N_, &factors_->pivots[0], x);
+  return(0);
+}
+
+// Evaluates the jacobian into the current bucket unless it is constant. A
+// jacobian that differs from the saved one replaces it and drops the
+// factorizations of the old one.
+int JacobianCache::update_jacobian(realtype t, N_Vector y, N_Vector fy,
+                                   void *user_data, N_Vector tmp1,
+                                   N_Vector tmp2, N_Vector tmp3) {
+  Bucket &b = *current_;
+  if (b.constant) {
+    num_jac_reuses_++;
+    return(0);
+  }
+
+  int flag = jac_(t, y, fy, jmat_, user_data, tmp1, tmp2, tmp3);
+  if (flag != 0) return(flag);
+  num_jac_evals_++;
+
+  const realtype *jac = SUNDenseMatrix_Data(jmat_);
+  sunindextype NN = N_ * N_;
+  if (b.have_jac) {
+    realtype diff = 0, scale = 0;
+    for (sunindextype k = 0; k < NN; k++) {
+      diff = SUNMAX(diff, SUNRabs(jac[k] - b.jac[k]));
+      scale = SUNMAX(scale, SUNRabs(b.jac[k]));
+    }
+    if (diff <= options_.constant_tol * scale) {
+      b.equal_evals++;
+      if (options_.constant_checks >= 0 &&
+          b.equal_evals >= options_.constant_checks) {
+        b.constant = true;
+      }
+      return(0);
+    }
+  }
+
+  b.jac.assign(jac, jac + NN);
+  b.have_jac = true;
+  b.equal_evals = 0;
+  b.constant = (options_.constant_checks == 0);
+  b.entries.clear();
+  factors_ = NULL;
+
+  sunindextype kmax = 0;
+  for (sunindextype k = 1; k < NN; k++) {
+    if (SUNRabs(jac[k]) > SUNRabs(jac[kmax])) kmax = k;
+  }
+  b.max_row = kmax % N_;
+  b.max_col = kmax / N_;
+  return(0);
+}
+
+// The factorization of the current bucket to use for gamma, NULL for none.
+JacobianCache::Entry *JacobianCache::lookup(realtype gamma) {
+  if (options_.policy == JAC_REUSE_NONE) return(NULL);
+  realtype tol = (options_.policy == JAC_REUSE_EXACT) ?
+      EXACT_GAMMA_TOL : options_.gamma_tol;
+
+  Entry *best = NULL;
+  realtype best_diff = 0;
+  std::vector < Entry > &entries = current_->entries;
+  for (size_t k = 0; k < entries.size(); k++) {
+    realtype diff = SUNRabs(entries[k].gamma - gamma);
+    if (diff > tol * SUNRabs(gamma)) continue;
+    if (best == NULL || diff < best_diff) {
+      best = &entries[k];
+      best_diff = diff;
+    }
+  }
+  return(best);
+}
+
+// A free entry of the current bucket, or the least recently used one.
+JacobianCache::Entry *JacobianCache::new_entry(realtype gamma) {
+  std::vector < Entry > &entries = current_->entries;
+  int capacity = (options_.policy == JAC_REUSE_NONE) ?
+      1 : options_.max_entries;
+  Entry *entry;
+  if ((int) entries.size() < capacity) {
+    entries.push_back(Entry());
+    entry = &entries.back();
+    entry->lu.resize(N_ * N_);
+    entry->pivots.resize(N_);
+  } else {
+    entry = &entries[0];
+    for (size_t k = 1; k < entries.size(); k++) {
+      if (entries[k].last_use < entry->last_use) entry = &entries[k];
+    }
+  }
+  entry->gamma = gamma;
+  entry->last_use = ++clock_;
+  return(entry);
+}
+
+// LU factors entry->lu in place. An entry with a zero pivot is dropped.
+int JacobianCache::factor(Entry *entry) {
+  num_factorizations_++;
+  select(entry);
+  if (denseGETRF(&cols_[0], N_, N_, &entry->pivots[0]) != 0) {
+    std::vector < Entry > &entries = current_->entries;
+    entries.erase(entries.begin() + (entry - &entries[0]));
+    factors_ = NULL;
+    return(1);
+  }
+  return(0);
+}
+
+void JacobianCache::select(Entry *entry) {
+  factors_ = entry;
+  for (sunindextype j = 0; j < N_; j++) cols_[j] = &entry->lu[j * N_];
+}
+
+// SUNLinearSolver operations of the cached direct solver.
+static JacCacheSolverContent *solver_content(SUNLinearSolver S) {
+  return (JacCacheSolverContent*) S->content;
+}
+
+static SUNLinearSolver_Type jac_cache_gettype(SUNLinearSolver S) {
+  return SUNLINEARSOLVER_DIRECT;
+}
+
+static int jac_cache_initialize(SUNLinearSolver S) {
+  solver_content(S)->last_flag = SUNLS_SUCCESS;
+  return SUNLS_SUCCESS;
+}
+
+// A zero pivot is a recoverable failure, CVODE retries with a smaller step.
+static int jac_cache_setup(SUNLinearSolver S, SUNMatrix A) {
+  JacCacheSolverContent *c = solver_content(S);
+  int flag = c->cache->setup_matrix(A);
+  c->last_flag = flag;
+  if (flag > 0) return SUNLS_LUFACT_FAIL;
+  return (flag < 0) ? SUNLS_PACKAGE_FAIL_UNREC : SUNLS_SUCCESS;
+}
+
+static int jac_cache_solve(SUNLinearSolver S, SUNMatrix A, N_Vector x,
+                           N_Vector b, realtype tol) {
+  JacCacheSolverContent *c = solver_content(S);
+  N_VScale(1, b, x);
+  realtype *xd = N_VGetArrayPointer(x);
+  if (xd == NULL || c->cache->solve(xd) != 0) {
+    c->last_flag = SUNLS_MEM_FAIL;
+    return SUNLS_MEM_FAIL;
+  }
+  c->last_flag = SUNLS_SUCCESS;
+  return SUNLS_SUCCESS;
+}
+
+static long int jac_cache_lastflag(SUNLinearSolver S) {
+  return solver_content(S)->last_flag;
+}
+
+// The factorizations are counted with the cache, not the solver.
+static int jac_cache_space(SUNLinearSolver S, long int *lenrw,
+                           long int *leniw) {
+  *lenrw = 0;
+  *leniw = 2;
+  return SUNLS_SUCCESS;
+}
+
+static int jac_cache_free(SUNLinearSolver S) {
+  if (S == NULL) return SUNLS_SUCCESS;
+  delete solver_content(S);
+  delete S;
+  return SUNLS_SUCCESS;
+}
+
+static struct _generic_SUNLinearSolver_Ops make_jac_cache_ops() {
+  struct _generic_SUNLinearSolver_Ops ops;
+  memset(&ops, 0, sizeof(ops));
+  ops.gettype = jac_cache_gettype;
+  ops.initialize = jac_cache_initialize;
+  ops.setup = jac_cache_setup;
+  ops.solve = jac_cache_solve;
+  ops.lastflag = jac_cache_lastflag;
+  ops.space = jac_cache_space;
+  ops.free = jac_cache_free;
+  return ops;
+}
+
+SUNLinearSolver SUNJacCacheLinearSolver(N_Vector y, SUNMatrix A,
+                                        JacobianCache *cache) {
+  static struct _generic_SUNLinearSolver_Ops ops = make_jac_cache_ops();
+
+  if (cache == NULL || A == NULL || SUNMatGetID(A) != SUNMATRIX_DENSE) {
+    return NULL;
+  }
+  sunindextype N = cache->size();
+  if (SUNDenseMatrix_Rows(A) != N || SUNDenseMatrix_Columns(A) != N) {
+    return NULL;
+  }
+  sunindextype lrw, liw;
+  N_VSpace(y, &lrw, &liw);
+  if (lrw != N) return NULL;
+
+  SUNLinearSolver S = new struct _generic_SUNLinearSolver;
+  JacCacheSolverContent *content = new JacCacheSolverContent;
+  content->cache = cache;
+  content->last_flag = 0;
+  S->content = content;
+  S->ops = &ops;
+  return S;
+}
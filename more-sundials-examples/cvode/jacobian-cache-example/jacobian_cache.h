@@ -0,0 +1,182 @@
+/*
+A cache of jacobians and LU factorizations of M = I - gamma*J that outlives
+a single solve, for dense systems solved many times: re-solves of the same
+problem and ensembles of problems with nearby parameters.
+
+CVODE evaluates the jacobian and factors M whenever it decides to, and keeps
+nothing from one CVodeReInit to the next. For the linear 2d system of the
+simple examples J is constant, and the members of an ensemble with nearby
+parameters have nearly the same J, yet every solve pays for its own jacobian
+evaluations and factorizations. The cache keeps them by key:
+
+  parameter bucket  set with set_bucket() before a solve. The problems of a
+                    bucket are taken to have the same jacobian, up to the
+                    width of the bucket (parameter_bucket() quantizes a
+                    parameter vector).
+  gamma             every bucket keeps up to max_entries factorizations of
+                    I - gamma*J, the least recently used one is dropped.
+
+The reuse policies are
+
+  JAC_REUSE_NONE     factor at every setup, as CVODE does. Only counts.
+  JAC_REUSE_EXACT    reuse a factorization with the same gamma (to rounding).
+                     Hits on re-solves, whose step sizes repeat.
+  JAC_REUSE_NEAREST  reuse the factorization with the nearest gamma when it
+                     is within gamma_tol (relative). Newton then runs with a
+                     slightly wrong matrix and may need more iterations, the
+                     same trade CVODE makes when it keeps an old gamma.
+
+Constant jacobian detection: a new jacobian evaluation that differs from the
+saved J of the bucket replaces it and drops the bucket's factorizations, so
+the cache is also right for nonlinear problems. Once constant_checks
+re-evaluations in a row are equal to the saved J, the jacobian of the bucket
+counts as constant and the jacobian function is not called for it again.
+constant_checks = 0 trusts the first evaluation, -1 never stops evaluating.
+
+The cache plugs into both linear solver paths of CVODE:
+
+  direct    jacobian() is the body of the CVDlsJacFn, and
+            SUNJacCacheLinearSolver(y, A, &cache) replaces
+            SUNDenseLinearSolver(y, A). Its setup receives M = I - gamma*J
+            and recovers gamma from M and the J that jacobian() returned.
+  iterative prec_setup() and prec_solve() are the bodies of the
+            CVSpilsPrecSetupFn and CVSpilsPrecSolveFn, with P = M (the whole
+            dense matrix) as preconditioner, so SPGMR converges at once.
+
+  static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+                 void *user_data, N_Vector tmp1, N_Vector tmp2,
+                 N_Vector tmp3) {
+    UserData *data = (UserData*) user_data;
+    return data->cache->jacobian(t, y, fy, J, user_data, tmp1, tmp2, tmp3);
+  }
+
+A cache belongs to one CVODE object at a time and is not thread safe. The
+functions returning int return 0 on success, 1 (recoverable) for a zero
+pivot, the value of a failing jacobian function, or -1 on other failures.
+*/
+
+#ifndef JACOBIAN_CACHE_H
+#define JACOBIAN_CACHE_H
+
+#include <map>
+#include <vector>
+#include <cvode/cvode_direct.h> // access to CVDls interface
+#include <sundials/sundials_linearsolver.h> // generic SUNLinearSolver
+#include <sundials/sundials_matrix.h> // generic SUNMatrix
+#include <sundials/sundials_nvector.h>  // N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+enum JacReusePolicy { JAC_REUSE_NONE, JAC_REUSE_EXACT, JAC_REUSE_NEAREST };
+
+struct JacCacheOptions {
+  JacReusePolicy policy;
+  realtype gamma_tol; // JAC_REUSE_NEAREST: largest |gamma - gamma'|/gamma
+  long int constant_checks; // equal re-evaluations before J is constant
+  realtype constant_tol; // relative difference that still counts as equal
+  int max_entries; // factorizations kept per bucket
+};
+
+// policy = JAC_REUSE_EXACT, gamma_tol = 0.2, constant_checks = 2,
+// constant_tol = 0, max_entries = 16.
+JacCacheOptions default_jac_cache_options();
+
+// Bucket of a parameter vector: every parameter is rounded down to a
+// multiple of width and the results are hashed. Different buckets can share
+// a hash, but only by chance.
+long int parameter_bucket(const realtype *params, int n, realtype width);
+
+class JacobianCache {
+ public:
+  JacobianCache();
+  ~JacobianCache();
+
+  // N unknowns, the jacobian of the problem as a CVDlsJacFn filling a dense
+  // N x N SUNMatrix.
+  int create(sunindextype N, CVDlsJacFn jac, const JacCacheOptions &options);
+
+  // The bucket of the problems solved from now on, created when it is new.
+  void set_bucket(long int bucket);
+
+  // Drops every bucket, the counters stay.
+  void clear();
+
+  // Body of the CVDlsJacFn: J of the current bucket, evaluated with the
+  // jacobian function unless the bucket's J is constant.
+  int jacobian(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+
+  // Body of the CVSpilsPrecSetupFn: factors of I - gamma*J, from the cache
+  // when the policy allows. A new J only when CVODE asks for one.
+  int prec_setup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+                 booleantype *jcurPtr, realtype gamma, void *user_data);
+
+  // Body of the CVSpilsPrecSolveFn: z = P^-1 r. r and z may be the same.
+  int prec_solve(N_Vector r, N_Vector z);
+
+  // Setup and solve of SUNJacCacheLinearSolver. setup_matrix takes
+  // M = I - gamma*J, with J the last one jacobian() returned.
+  int setup_matrix(SUNMatrix M);
+  int solve(realtype *x);
+
+  sunindextype size() const { return N_; }
+  const JacCacheOptions &options() const { return options_; }
+  long int num_buckets() const { return (long int) buckets_.size(); }
+  long int num_constant_buckets() const;
+  long int num_jac_evals() const { return num_jac_evals_; }
+  long int num_jac_reuses() const { return num_jac_reuses_; }
+  long int num_factorizations() const { return num_factorizations_; }
+  long int num_factorizations_saved() const { return num_saved_; }
+  void reset_counters();
+
+ private:
+  // The factors of I - gamma*J, column major. The pivots are those of
+  // denseGETRF.
+  struct Entry {
+    realtype gamma;
+    long int last_use;
+    std::vector < realtype > lu;
+    std::vector < sunindextype > pivots;
+  };
+
+  struct Bucket {
+    bool have_jac;
+    bool constant;
+    long int equal_evals;
+    std::vector < realtype > jac; // column major
+    sunindextype max_row, max_col; // largest |J| entry, to recover gamma
+    std::vector < Entry > entries; // capacity max_entries, never reallocated
+  };
+
+  JacobianCache(const JacobianCache&);
+  JacobianCache& operator=(const JacobianCache&);
+
+  int update_jacobian(realtype t, N_Vector y, N_Vector fy, void *user_data,
+                      N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+  Entry *lookup(realtype gamma);
+  Entry *new_entry(realtype gamma);
+  int factor(Entry *entry);
+  void select(Entry *entry);
+
+  sunindextype N_;
+  CVDlsJacFn jac_;
+  JacCacheOptions options_;
+  std::map < long int, Bucket > buckets_;
+  long int bucket_;
+  Bucket *current_;
+  Entry *factors_; // factors used by solve(), NULL before the first setup
+  std::vector < realtype* > cols_; // columns of factors_ for denseGETRS
+  SUNMatrix jmat_; // the jacobian function writes here
+  N_Vector tmp_[3]; // workspace of the jacobian function in prec_setup
+  long int clock_;
+
+  long int num_jac_evals_, num_jac_reuses_;
+  long int num_factorizations_, num_saved_;
+};
+
+// A direct SUNLinearSolver for a dense N x N SUNMatrix that takes its
+// factorizations from cache. The cache must outlive the solver and
+// cache->jacobian() must be the jacobian function of the solve.
+SUNLinearSolver SUNJacCacheLinearSolver(N_Vector y, SUNMatrix A,
+                                        JacobianCache *cache);
+
+#endif
@@ -0,0 +1,347 @@
+/*
+Benchmark of the JacobianCache from jacobian_cache.h on the stiff 2d system
+of the simple examples, whose jacobian is constant:
+
+  u0' = a00 * u0 + a01 * u1 + c0
+  u1' = u0 + c1
+
+Two workloads are solved with one CVODE object, reset with CVodeReInit for
+every solve:
+  re-solves: the system of the simple examples, solved resolves times.
+  ensemble:  members with a00 = -101*(1 + 0.1*s), a01 = -100*(1 + 0.1*s),
+             c0 = 0.01*s, c1 = 0.02*s for s from 0 to 1, initial values
+             spread around (2, 1). The parameter bucket of a member is that
+             of s with the given bucket width.
+Each workload runs on the direct path (dense matrix, CVDlsSetJacFn and the
+cached dense linear solver) and the iterative path (SPGMR with the cache as
+preconditioner), once per reuse policy. The time, the jacobian evaluations
+and reuses, the factorizations done and saved, the Newton iterations and the
+largest difference from the solutions without reuse are printed.
+
+Usage: ./executable [members] [resolves] [bucket_width]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_direct.h> // access to CVDls interface
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+#include "jacobian_cache.h"
+#include "solver_stats.h"  // stats_now
+
+// These macro gives access to the individual components of the data array of an
+// N Vector (NV_Ith_S) and SUNMatrix (IJth).
+#define NV_Ith_S(v,i) ( NV_DATA_S(v)[i] )
+#define IJth(A,i,j) SM_ELEMENT_D(A,i,j)
+
+enum { PATH_DENSE, PATH_SPGMR };
+
+// Coefficients of one member, as in the ensemble example.
+struct Coeffs {
+  realtype a00, a01, c0, c1;
+};
+
+struct UserData {
+  Coeffs coeffs;
+  JacobianCache *cache;
+};
+
+// Counters of one run over a workload.
+struct RunCounts {
+  double seconds;
+  long int jac_evals, jac_reuses, factorizations, saved, newton_iters;
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jac_2d(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+                  void *user_data, N_Vector tmp1, N_Vector tmp2,
+                  N_Vector tmp3);
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int psetup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data);
+static int psolve(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data);
+static int run(int path, JacReusePolicy policy,
+               const std::vector < Coeffs > &members,
+               const std::vector < long int > &buckets,
+               const std::vector < realtype > &y0, realtype tout,
+               std::vector < realtype > &y_out, RunCounts *counts);
+static int run_workload(const char *name,
+                        const std::vector < Coeffs > &members,
+                        const std::vector < long int > &buckets,
+                        const std::vector < realtype > &y0, realtype tout);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  long int members = (argc > 1) ? std::atol(argv[1]) : 1000;
+  long int resolves = (argc > 2) ? std::atol(argv[2]) : 100;
+  realtype width = (argc > 3) ? std::atof(argv[3]) : 0.05;
+  if (members < 1) members = 1;
+  if (resolves < 1) resolves = 1;
+  if (width <= 0) width = 0.05;
+  realtype tout = 50;
+
+  // Re-solves of the system of the simple examples.
+  Coeffs simple = {-101.0, -100.0, 0, 0};
+  std::vector < Coeffs > coeffs(resolves, simple);
+  std::vector < long int > buckets(resolves, 0);
+  std::vector < realtype > y0(2 * resolves);
+  for (long int m = 0; m < resolves; m++) {
+    y0[2 * m] = 2.0;
+    y0[2 * m + 1] = 1.0;
+  }
+  if (run_workload("re-solves", coeffs, buckets, y0, tout)) return(1);
+
+  // Ensemble of nearby parameter sets.
+  coeffs.resize(members);
+  buckets.resize(members);
+  y0.resize(2 * members);
+  for (long int m = 0; m < members; m++) {
+    realtype s = (members > 1) ? (realtype) m / (members - 1) : 0;
+    coeffs[m].a00 = -101.0 * (1.0 + 0.1 * s);
+    coeffs[m].a01 = -100.0 * (1.0 + 0.1 * s);
+    coeffs[m].c0 = 0.01 * s;
+    coeffs[m].c1 = 0.02 * s;
+    buckets[m] = parameter_bucket(&s, 1, width);
+    y0[2 * m] = 2.0 + s;
+    y0[2 * m + 1] = 1.0 - s;
+  }
+  if (run_workload("ensemble", coeffs, buckets, y0, tout)) return(1);
+
+  return(0);
+}
+
+// Runs a workload on both paths with every policy and prints one line each.
+static int run_workload(const char *name,
+                        const std::vector < Coeffs > &members,
+                        const std::vector < long int > &buckets,
+                        const std::vector < realtype > &y0, realtype tout) {
+  const char *path_names[] = {"dense", "spgmr"};
+  const char *policy_names[] = {"none", "exact", "nearest"};
+  std::vector < realtype > reference, y_out;
+  RunCounts counts;
+
+  printf("\n%s, %ld solves to t = %g\n", name, (long) members.size(),
+         (double) tout);
+  printf("%-6s %-8s %10s %10s %10s %10s %10s %10s %10s\n", "path", "policy",
+         "seconds", "jac evals", "jac reuse", "factors", "saved", "newton",
+         "max diff");
+  for (int path = PATH_DENSE; path <= PATH_SPGMR; path++) {
+    for (int policy = JAC_REUSE_NONE; policy <= JAC_REUSE_NEAREST; policy++) {
+      int flag = run(path, (JacReusePolicy) policy, members, buckets, y0,
+                     tout, y_out, &counts);
+      if (check_flag(&flag, "run", 1)) return(1);
+      if (policy == JAC_REUSE_NONE) reference = y_out;
+
+      realtype max_diff = 0;
+      for (size_t i = 0; i < y_out.size(); i++) {
+        max_diff = SUNMAX(max_diff, SUNRabs(y_out[i] - reference[i]));
+      }
+      printf("%-6s %-8s %10.6f %10ld %10ld %10ld %10ld %10ld %10.2e\n",
+             path_names[path], policy_names[policy], counts.seconds,
+             counts.jac_evals, counts.jac_reuses, counts.factorizations,
+             counts.saved, counts.newton_iters, (double) max_diff);
+    }
+  }
+  return(0);
+}
+
+// Solves every member with one CVODE object and one cache, in order.
+static int run(int path, JacReusePolicy policy,
+               const std::vector < Coeffs > &members,
+               const std::vector < long int > &buckets,
+               const std::vector < realtype > &y0, realtype tout,
+               std::vector < realtype > &y_out, RunCounts *counts) {
+  int flag;
+  realtype abstol = 1e-5; // real tolerance of system
+  realtype reltol = 1e-5; // absolute tolerance of system
+  sunindextype N = 2;
+  size_t n = members.size();
+  y_out.assign(2 * n, 0);
+
+  double start = stats_now();
+  JacobianCache cache;
+  JacCacheOptions options = default_jac_cache_options();
+  options.policy = policy;
+  flag = cache.create(N, jac_2d, options);
+  if (check_flag(&flag, "JacobianCache::create", 1)) return(-1);
+
+  UserData data;
+  data.coeffs = members[0];
+  data.cache = &cache;
+
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(-1);
+  NV_Ith_S(y, 0) = y0[0];
+  NV_Ith_S(y, 1) = y0[1];
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(-1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(-1);
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(-1);
+  flag = CVodeSetUserData(cvode_mem, &data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(-1);
+
+  SUNMatrix A = NULL;
+  SUNLinearSolver LS;
+  if (path == PATH_DENSE) {
+    A = SUNDenseMatrix(N, N);
+    if (check_flag((void *)A, "SUNDenseMatrix", 0)) return(-1);
+    LS = SUNJacCacheLinearSolver(y, A, &cache);
+    if (check_flag((void *)LS, "SUNJacCacheLinearSolver", 0)) return(-1);
+    flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+    if (check_flag(&flag, "CVDlsSetLinearSolver", 1)) return(-1);
+    flag = CVDlsSetJacFn(cvode_mem, jac);
+    if (check_flag(&flag, "CVDlsSetJacFn", 1)) return(-1);
+  } else {
+    LS = SUNSPGMR(y, PREC_LEFT, 0);
+    if (check_flag((void *)LS, "SUNSPGMR", 0)) return(-1);
+    flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+    if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(-1);
+    flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+    if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(-1);
+    flag = CVSpilsSetPreconditioner(cvode_mem, psetup, psolve);
+    if (check_flag(&flag, "CVSpilsSetPreconditioner", 1)) return(-1);
+  }
+
+  counts->newton_iters = 0;
+  for (size_t m = 0; m < n; m++) {
+    data.coeffs = members[m];
+    cache.set_bucket(buckets[m]);
+    NV_Ith_S(y, 0) = y0[2 * m];
+    NV_Ith_S(y, 1) = y0[2 * m + 1];
+    flag = CVodeReInit(cvode_mem, 0, y);
+    if (check_flag(&flag, "CVodeReInit", 1)) return(-1);
+
+    realtype t = 0;
+    flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
+    if (check_flag(&flag, "CVode", 1)) return(-1);
+    y_out[2 * m] = NV_Ith_S(y, 0);
+    y_out[2 * m + 1] = NV_Ith_S(y, 1);
+
+    long int iters;
+    flag = CVodeGetNumNonlinSolvIters(cvode_mem, &iters);
+    if (check_flag(&flag, "CVodeGetNumNonlinSolvIters", 1)) return(-1);
+    counts->newton_iters += iters;
+  }
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  if (A != NULL) SUNMatDestroy(A);
+
+  counts->seconds = stats_now() - start;
+  counts->jac_evals = cache.num_jac_evals();
+  counts->jac_reuses = cache.num_jac_reuses();
+  counts->factorizations = cache.num_factorizations();
+  counts->saved = cache.num_factorizations_saved();
+  return(0);
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  Coeffs *c = &((UserData*) user_data)->coeffs;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+
+  dudata[0] = c->a00 * udata[0] + c->a01 * udata[1] + c->c0;
+  dudata[1] = udata[0] + c->c1;
+
+  return(0);
+}
+
+// The jacobian of the system, called by the cache.
+static int jac_2d(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+                  void *user_data, N_Vector tmp1, N_Vector tmp2,
+                  N_Vector tmp3) {
+  Coeffs *c = &((UserData*) user_data)->coeffs;
+
+  IJth(J, 0, 0) = c->a00;
+  IJth(J, 0, 1) = c->a01;
+  IJth(J, 1, 0) = 1.0;
+  IJth(J, 1, 1) = 0.0;
+
+  return(0);
+}
+
+// CVDlsJacFn, the jacobian comes through the cache.
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+  UserData *data = (UserData*) user_data;
+  return data->cache->jacobian(t, y, fy, J, user_data, tmp1, tmp2, tmp3);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  Coeffs *c = &((UserData*) user_data)->coeffs;
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = c->a00 * vdata[0] + c->a01 * vdata[1];
+  Jvdata[1] = vdata[0];
+
+  return(0);
+}
+
+// Preconditioner setup and solve, the factors come through the cache.
+static int psetup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  return data->cache->prec_setup(t, y, fy, jok, jcurPtr, gamma, user_data);
+}
+
+static int psolve(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  return data->cache->prec_solve(r, z);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
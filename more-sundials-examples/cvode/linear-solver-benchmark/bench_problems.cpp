@@ -0,0 +1,224 @@
+#include "bench_problems.h"
+
+#include <cmath>
+#include <string>
+#include "solver_stats.h"  // stats_now
+
+// Right hand sides fail unrecoverably past the deadline, which stops CVode
+// with CV_RHSFUNC_FAIL instead of letting a hopeless run go on.
+static inline bool past_deadline(void *user_data) {
+  BenchData *data = (BenchData *) user_data;
+  return data->deadline > 0 && stats_now() > data->deadline;
+}
+
+// stiff2d -----------------------------------------------------------------
+
+static void stiff2d_initial(sunindextype N, realtype *y) {
+  y[0] = 2.0;
+  y[1] = 1.0;
+}
+
+static int stiff2d_f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  if (past_deadline(user_data)) return(-1);
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+static int stiff2d_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                       N_Vector fu, void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] - 100.0 * vdata[1];
+  Jvdata[1] = vdata[0];
+
+  return(0);
+}
+
+static void stiff2d_jac(realtype t, const realtype *y, sunindextype N,
+                        sunindextype *colptr, sunindextype *rowind,
+                        realtype *vals) {
+  colptr[0] = 0;
+  rowind[0] = 0; vals[0] = -101.0;
+  rowind[1] = 1; vals[1] = 1.0;
+  colptr[1] = 2;
+  rowind[2] = 0; vals[2] = -100.0;
+  colptr[2] = 3;
+}
+
+// The eigenvalues are -1 and -100, y1 = 34/33 e^-t - 1/33 e^-100t.
+static void stiff2d_exact(realtype t, sunindextype N, realtype *y) {
+  realtype a = 34.0 / 33.0, b = -1.0 / 33.0;
+  y[0] = -a * std::exp(-t) - 100.0 * b * std::exp(-100.0 * t);
+  y[1] = a * std::exp(-t) + b * std::exp(-100.0 * t);
+}
+
+// robertson ---------------------------------------------------------------
+
+static void robertson_initial(sunindextype N, realtype *y) {
+  y[0] = 1.0;
+  y[1] = 0.0;
+  y[2] = 0.0;
+}
+
+static int robertson_f(realtype t, N_Vector u, N_Vector u_dot,
+                       void *user_data) {
+  if (past_deadline(user_data)) return(-1);
+  realtype *y  = N_VGetArrayPointer(u);
+  realtype *dy = N_VGetArrayPointer(u_dot);
+
+  dy[0] = -0.04 * y[0] + 1e4 * y[1] * y[2];
+  dy[2] = 3e7 * y[1] * y[1];
+  dy[1] = -dy[0] - dy[2];
+
+  return(0);
+}
+
+static int robertson_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                         N_Vector fu, void *user_data, N_Vector tmp) {
+  realtype *y  = N_VGetArrayPointer(u);
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -0.04 * vdata[0] + 1e4 * y[2] * vdata[1] + 1e4 * y[1] * vdata[2];
+  Jvdata[2] = 6e7 * y[1] * vdata[1];
+  Jvdata[1] = -Jvdata[0] - Jvdata[2];
+
+  return(0);
+}
+
+static void robertson_jac(realtype t, const realtype *y, sunindextype N,
+                          sunindextype *colptr, sunindextype *rowind,
+                          realtype *vals) {
+  // Column 0: d/dy0
+  colptr[0] = 0;
+  rowind[0] = 0; vals[0] = -0.04;
+  rowind[1] = 1; vals[1] = 0.04;
+  // Column 1: d/dy1
+  colptr[1] = 2;
+  rowind[2] = 0; vals[2] = 1e4 * y[2];
+  rowind[3] = 1; vals[3] = -1e4 * y[2] - 6e7 * y[1];
+  rowind[4] = 2; vals[4] = 6e7 * y[1];
+  // Column 2: d/dy2
+  colptr[2] = 5;
+  rowind[5] = 0; vals[5] = 1e4 * y[1];
+  rowind[6] = 1; vals[6] = -1e4 * y[1];
+  colptr[3] = 7;
+}
+
+// diffusion ---------------------------------------------------------------
+
+static void diffusion_initial(sunindextype N, realtype *y) {
+  realtype dx = 1.0 / (N + 1);
+  for (sunindextype i = 0; i < N; i++) y[i] = std::sin(M_PI * (i + 1) * dx);
+}
+
+static int diffusion_f(realtype t, N_Vector u, N_Vector u_dot,
+                       void *user_data) {
+  if (past_deadline(user_data)) return(-1);
+  sunindextype N = ((BenchData *) user_data)->N;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  realtype c = (N + 1.0) * (N + 1.0); // 1/dx^2
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left = (i > 0) ? udata[i - 1] : 0;
+    realtype right = (i < N - 1) ? udata[i + 1] : 0;
+    dudata[i] = c * (left - 2 * udata[i] + right) - udata[i];
+  }
+
+  return(0);
+}
+
+static int diffusion_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                         N_Vector fu, void *user_data, N_Vector tmp) {
+  sunindextype N = ((BenchData *) user_data)->N;
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  realtype c = (N + 1.0) * (N + 1.0);
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left = (i > 0) ? vdata[i - 1] : 0;
+    realtype right = (i < N - 1) ? vdata[i + 1] : 0;
+    Jvdata[i] = c * (left - 2 * vdata[i] + right) - vdata[i];
+  }
+
+  return(0);
+}
+
+static void diffusion_jac(realtype t, const realtype *y, sunindextype N,
+                          sunindextype *colptr, sunindextype *rowind,
+                          realtype *vals) {
+  realtype c = (N + 1.0) * (N + 1.0);
+  sunindextype k = 0;
+  for (sunindextype j = 0; j < N; j++) {
+    colptr[j] = k;
+    if (j > 0) {
+      rowind[k] = j - 1; vals[k++] = c;
+    }
+    rowind[k] = j; vals[k++] = -2 * c - 1;
+    if (j < N - 1) {
+      rowind[k] = j + 1; vals[k++] = c;
+    }
+  }
+  colptr[N] = k;
+}
+
+// sin(pi*x) is an eigenvector of the discrete second difference, with the
+// eigenvalue -4/dx^2 sin^2(pi*dx/2).
+static void diffusion_exact(realtype t, sunindextype N, realtype *y) {
+  realtype dx = 1.0 / (N + 1);
+  realtype s = std::sin(M_PI * dx / 2);
+  realtype decay = std::exp(-(4 * s * s / (dx * dx) + 1) * t);
+  for (sunindextype i = 0; i < N; i++) {
+    y[i] = decay * std::sin(M_PI * (i + 1) * dx);
+  }
+}
+
+// -------------------------------------------------------------------------
+
+int make_bench_problem(const char *name, sunindextype N, BenchProblem *p) {
+  std::string problem(name);
+  p->name = name;
+  p->reltol = 1e-6;
+  p->abstol = 1e-10;
+  if (problem == "stiff2d") {
+    p->N = 2;
+    p->end_time = 10;
+    p->mu = p->ml = 1;
+    p->nnz = 3;
+    p->initial = stiff2d_initial;
+    p->f = stiff2d_f;
+    p->jtv = stiff2d_jtv;
+    p->jac = stiff2d_jac;
+    p->exact = stiff2d_exact;
+  } else if (problem == "robertson") {
+    p->N = 3;
+    p->end_time = 1e5;
+    p->mu = p->ml = 2;
+    p->nnz = 7;
+    p->initial = robertson_initial;
+    p->f = robertson_f;
+    p->jtv = robertson_jtv;
+    p->jac = robertson_jac;
+    p->exact = NULL;
+  } else if (problem == "diffusion") {
+    p->N = N;
+    p->end_time = 0.1;
+    p->mu = p->ml = 1;
+    p->nnz = 3 * N - 2;
+    p->initial = diffusion_initial;
+    p->f = diffusion_f;
+    p->jtv = diffusion_jtv;
+    p->jac = diffusion_jac;
+    p->exact = diffusion_exact;
+  } else {
+    return(-1);
+  }
+  return(0);
+}
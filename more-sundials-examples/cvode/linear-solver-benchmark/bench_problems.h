@@ -0,0 +1,52 @@
+/*
+Stiff test problems for the linear solver benchmark. Every problem gives its
+right hand side, jacobian-times-vector function and the jacobian as a
+compressed sparse column (CSC) pattern, which the benchmark copies into a
+dense, band or sparse SUNMatrix. Where the exact solution is known it is
+used to report the error at the end time.
+
+  stiff2d:   the 2d system of the simple examples (N = 2).
+  robertson: Robertson's chemical kinetics (N = 3).
+  diffusion: u_t = u_xx - u on N interior points of [0, 1] with u = 0 at both
+             ends, starting from sin(pi*x). Tridiagonal jacobian.
+*/
+
+#ifndef BENCH_PROBLEMS_H
+#define BENCH_PROBLEMS_H
+
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+// User data of every problem.
+struct BenchData {
+  sunindextype N;
+  double deadline; // stats_now() time after which f fails, 0 for none
+};
+
+// Fills the jacobian at (t, y) in CSC form: column j has the rows
+// rowind[colptr[j]] .. rowind[colptr[j+1]-1] with values vals[...]. The
+// pattern must not depend on t or y.
+typedef void (*BenchJacFn)(realtype t, const realtype *y, sunindextype N,
+                           sunindextype *colptr, sunindextype *rowind,
+                           realtype *vals);
+
+struct BenchProblem {
+  const char *name;
+  sunindextype N;
+  realtype end_time, reltol, abstol;
+  sunindextype mu, ml; // upper and lower bandwidth of the jacobian
+  sunindextype nnz; // nonzeros of the jacobian
+  void (*initial)(sunindextype N, realtype *y);
+  CVRhsFn f;
+  CVSpilsJacTimesVecFn jtv;
+  BenchJacFn jac;
+  // Exact solution at t, NULL if not known.
+  void (*exact)(realtype t, sunindextype N, realtype *y);
+};
+
+// The problem called name with N unknowns (ignored for the fixed size ones).
+// Returns 0 on success or -1 for an unknown name.
+int make_bench_problem(const char *name, sunindextype N, BenchProblem *p);
+
+#endif
@@ -0,0 +1,333 @@
+/*
+Benchmark of the CVODE linear solver modules on stiff problems of growing
+size, to pick the configuration for a model size.
+
+Every problem of bench_problems.h (the 2d system, Robertson's kinetics and 1D
+diffusion with N = 10, 100, ... up to max_N) is solved with BDF and Newton
+iteration and each of the linear solvers
+  spgmr, spbcgs, sptfqmr: matrix-free Krylov solvers with the problem's jtv,
+                          no preconditioner (CVSpils interface)
+  dense, band:            direct solvers with the problem's jacobian
+                          (CVDls interface)
+  klu:                    sparse direct solver, only when compiled with
+                          -D BENCH_WITH_KLU and linked against SUNDIALS' KLU
+                          module
+One comma separated line is printed per run:
+  status      ok, failed, timeout (the run took longer than max_seconds),
+              skipped (dense above max_dense_N) or unavailable (klu)
+  seconds     time to solution, including the setup of matrix and solver
+  steps, rhs_evals, lin_iters, jac_evals, lin_setups
+              lin_iters only for the Krylov solvers and jac_evals only for
+              the direct ones, "-" for the solvers that do not have them
+  workspace   bytes of CVODE, the linear solver and the matrix as reported by
+              CVodeGetWorkSpace, SUNLinSolSpace and SUNMatSpace. KLU's own
+              factors are not included.
+  max_error   largest error at the end time where the exact solution is known
+
+Usage: ./executable [max_N] [max_seconds] [max_dense_N]
+       make bench   (builds and writes benchmark.csv)
+*/
+
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <cvode/cvode_direct.h> // access to CVDls interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  // access to SPGMR SUNLinearSolver
+#include <sunlinsol/sunlinsol_spbcgs.h>  // access to SPBCGS SUNLinearSolver
+#include <sunlinsol/sunlinsol_sptfqmr.h>  // access to SPTFQMR SUNLinearSolver
+#include <sunlinsol/sunlinsol_dense.h>  // access to dense SUNLinearSolver
+#include <sunlinsol/sunlinsol_band.h>  // access to band SUNLinearSolver
+#include <sunmatrix/sunmatrix_dense.h>  // access to dense SUNMatrix
+#include <sunmatrix/sunmatrix_band.h>  // access to band SUNMatrix
+#include <sunmatrix/sunmatrix_sparse.h>  // access to sparse SUNMatrix
+#ifdef BENCH_WITH_KLU
+#include <sunlinsol/sunlinsol_klu.h>  // access to KLU SUNLinearSolver
+#endif
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "bench_problems.h"
+#include "cvode_stats.h"  // SolveRecord, collect_cvode_stats
+
+// User data of one run. The problem functions only see the BenchData at the
+// start, the jacobian function also uses the CSC scratch arrays.
+struct CaseData {
+  BenchData bench;
+  const BenchProblem *problem;
+  std::vector < sunindextype > colptr, rowind;
+  std::vector < realtype > vals;
+};
+
+struct CaseResult {
+  std::string status;
+  SolveRecord stats;
+  long int jac_evals;
+  long int workspace; // bytes
+  realtype max_error; // negative if the exact solution is not known
+};
+
+static const char *solver_names[] = {"spgmr", "spbcgs", "sptfqmr", "dense",
+                                     "band", "klu"};
+static const int num_solvers = 6;
+
+static int run_case(const BenchProblem &problem, const char *solver,
+                    double max_seconds, CaseResult *result);
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+static void print_result(const BenchProblem &problem, const char *solver,
+                         const CaseResult &result);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  long int max_N = (argc > 1) ? std::atol(argv[1]) : 1000000;
+  double max_seconds = (argc > 2) ? std::atof(argv[2]) : 60;
+  long int max_dense_N = (argc > 3) ? std::atol(argv[3]) : 2000;
+
+  // The fixed size problems, then diffusion of growing size.
+  std::vector < BenchProblem > problems;
+  BenchProblem p;
+  make_bench_problem("stiff2d", 2, &p);
+  problems.push_back(p);
+  make_bench_problem("robertson", 3, &p);
+  problems.push_back(p);
+  for (long int N = 10; N <= max_N; N *= 10) {
+    make_bench_problem("diffusion", N, &p);
+    problems.push_back(p);
+  }
+
+  std::cout << "problem,N,solver,status,seconds,steps,rhs_evals,lin_iters," <<
+      "jac_evals,lin_setups,workspace_bytes,max_error\n";
+  for (size_t k = 0; k < problems.size(); k++) {
+    for (int s = 0; s < num_solvers; s++) {
+      CaseResult result;
+      const char *solver = solver_names[s];
+      if (strcmp(solver, "dense") == 0 && problems[k].N > max_dense_N) {
+        result.status = "skipped";
+      } else if (run_case(problems[k], solver, max_seconds, &result) != 0) {
+        return(1);
+      }
+      print_result(problems[k], solver, result);
+    }
+  }
+
+  return(0);
+}
+
+// Solves the problem with the named linear solver. Failures of the solve are
+// reported in result, only setup errors return 1.
+static int run_case(const BenchProblem &problem, const char *solver,
+                    double max_seconds, CaseResult *result) {
+  int flag;
+  std::string name(solver);
+  sunindextype N = problem.N;
+  result->status = "ok";
+  result->jac_evals = -1;
+  result->workspace = 0;
+  result->max_error = -1;
+
+#ifndef BENCH_WITH_KLU
+  if (name == "klu") {
+    result->status = "unavailable";
+    return(0);
+  }
+#endif
+
+  CaseData data;
+  data.bench.N = N;
+  data.problem = &problem;
+  data.colptr.resize(N + 1);
+  data.rowind.resize(problem.nnz);
+  data.vals.resize(problem.nnz);
+
+  double start = stats_now();
+  data.bench.deadline = start + max_seconds;
+
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  problem.initial(N, N_VGetArrayPointer(y));
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, problem.f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, problem.reltol, problem.abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, &data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  // Large unpreconditioned problems need many steps, the deadline stops them.
+  flag = CVodeSetMaxNumSteps(cvode_mem, 10000000);
+  if (check_flag(&flag, "CVodeSetMaxNumSteps", 1)) return(1);
+
+  SUNMatrix A = NULL;
+  SUNLinearSolver LS = NULL;
+  if (name == "spgmr" || name == "spbcgs" || name == "sptfqmr") {
+    if (name == "spgmr") LS = SUNSPGMR(y, 0, 0);
+    if (name == "spbcgs") LS = SUNSPBCGS(y, 0, 0);
+    if (name == "sptfqmr") LS = SUNSPTFQMR(y, 0, 0);
+    if (check_flag((void *)LS, solver, 0)) return(1);
+    flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+    if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+    flag = CVSpilsSetJacTimes(cvode_mem, NULL, problem.jtv);
+    if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+  } else {
+    if (name == "dense") {
+      A = SUNDenseMatrix(N, N);
+      if (check_flag((void *)A, "SUNDenseMatrix", 0)) return(1);
+      LS = SUNDenseLinearSolver(y, A);
+    } else if (name == "band") {
+      // The LU factors need room for ml extra upper diagonals.
+      A = SUNBandMatrix(N, problem.mu, problem.ml, problem.mu + problem.ml);
+      if (check_flag((void *)A, "SUNBandMatrix", 0)) return(1);
+      LS = SUNBandLinearSolver(y, A);
+    }
+#ifdef BENCH_WITH_KLU
+    else if (name == "klu") {
+      A = SUNSparseMatrix(N, N, problem.nnz, CSC_MAT);
+      if (check_flag((void *)A, "SUNSparseMatrix", 0)) return(1);
+      LS = SUNKLU(y, A);
+    }
+#endif
+    if (check_flag((void *)LS, solver, 0)) return(1);
+    flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+    if (check_flag(&flag, "CVDlsSetLinearSolver", 1)) return(1);
+    flag = CVDlsSetJacFn(cvode_mem, jac);
+    if (check_flag(&flag, "CVDlsSetJacFn", 1)) return(1);
+  }
+
+  // Integrate straight to the end time.
+  realtype t = 0;
+  flag = CVode(cvode_mem, problem.end_time, y, &t, CV_NORMAL);
+  result->stats.seconds = stats_now() - start;
+  result->stats.flag = flag;
+  if (flag < 0) {
+    result->status = (stats_now() > data.bench.deadline) ? "timeout" :
+        "failed";
+  }
+
+  // Counters, workspace and error.
+  collect_cvode_stats(cvode_mem, LS, &result->stats);
+  if (A != NULL) CVDlsGetNumJacEvals(cvode_mem, &result->jac_evals);
+  long int lenrw, leniw;
+  if (CVodeGetWorkSpace(cvode_mem, &lenrw, &leniw) == CV_SUCCESS) {
+    result->workspace += lenrw * sizeof(realtype) + leniw * sizeof(long int);
+  }
+  if (SUNLinSolSpace(LS, &lenrw, &leniw) == SUNLS_SUCCESS) {
+    result->workspace += lenrw * sizeof(realtype) + leniw * sizeof(long int);
+  }
+  if (A != NULL && SUNMatSpace(A, &lenrw, &leniw) == SUNMAT_SUCCESS) {
+    result->workspace += lenrw * sizeof(realtype) + leniw * sizeof(long int);
+  }
+  if (flag >= 0 && problem.exact != NULL) {
+    std::vector < realtype > exact(N);
+    problem.exact(t, N, &exact[0]);
+    realtype *ydata = N_VGetArrayPointer(y);
+    result->max_error = 0;
+    for (sunindextype i = 0; i < N; i++) {
+      result->max_error = SUNMAX(result->max_error,
+                                 SUNRabs(ydata[i] - exact[i]));
+    }
+  }
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  if (A != NULL) SUNMatDestroy(A);
+  return(0);
+}
+
+// Jacobian for the direct solvers. The problem fills it in CSC form, straight
+// into a sparse matrix or through the scratch arrays into a dense or band one.
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+  CaseData *data = (CaseData *) user_data;
+  const BenchProblem *problem = data->problem;
+  sunindextype N = problem->N;
+  realtype *ydata = N_VGetArrayPointer(y);
+
+  if (SUNMatGetID(J) == SUNMATRIX_SPARSE) {
+    problem->jac(t, ydata, N, SM_INDEXPTRS_S(J), SM_INDEXVALS_S(J),
+                 SM_DATA_S(J));
+    return(0);
+  }
+
+  sunindextype *colptr = &data->colptr[0];
+  sunindextype *rowind = &data->rowind[0];
+  realtype *vals = &data->vals[0];
+  problem->jac(t, ydata, N, colptr, rowind, vals);
+  SUNMatZero(J);
+  bool dense = (SUNMatGetID(J) == SUNMATRIX_DENSE);
+  for (sunindextype j = 0; j < N; j++) {
+    for (sunindextype k = colptr[j]; k < colptr[j + 1]; k++) {
+      if (dense) {
+        SM_ELEMENT_D(J, rowind[k], j) = vals[k];
+      } else {
+        SM_ELEMENT_B(J, rowind[k], j) = vals[k];
+      }
+    }
+  }
+  return(0);
+}
+
+// One CSV line. Counters the solver does not have are "-", the fields of a
+// run that did not happen stay empty.
+static void print_result(const BenchProblem &problem, const char *solver,
+                         const CaseResult &result) {
+  const SolveRecord &s = result.stats;
+  printf("%s,%ld,%s,%s,", problem.name, (long int) problem.N, solver,
+         result.status.c_str());
+  if (result.status == "skipped" || result.status == "unavailable") {
+    printf(",,,,,,,\n");
+    return;
+  }
+  long int counters[5] = {s.steps, s.rhs_evals, s.lin_iters, result.jac_evals,
+                          s.lin_setups};
+  printf("%.6g", s.seconds);
+  for (int i = 0; i < 5; i++) {
+    if (counters[i] >= 0) printf(",%ld", counters[i]); else printf(",-");
+  }
+  printf(",%ld,", result.workspace);
+  if (result.max_error >= 0) printf("%.3e", (double) result.max_error);
+  printf("\n");
+  fflush(stdout);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
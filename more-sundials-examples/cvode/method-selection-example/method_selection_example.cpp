@@ -0,0 +1,367 @@
+/*
+Solves three families of problems with BDF/Newton, Adams/functional
+iteration, ARKODE IMEX and the automatic choice of method_solver.h, and
+prints for every family and method the time, the mean steps and f
+evaluations and the largest error against a BDF solve with tight
+tolerances.
+
+  non-stiff 2d:  the 2d system of the ensemble example with coefficients of
+                 a lightly damped oscillator, u0' = -0.2*u0 - w*u1 + c0,
+                 u1' = u0, w from 1 to 2, to t = 50.
+  stiff 2d:      the coefficients of the ensemble example (eigenvalues near
+                 -1 and -100), to t = 50.
+  diffusion:     1d diffusion with logistic growth on 100 grid points, to
+                 t = 1. The diffusion is the stiff part fi (linear), the
+                 growth the non-stiff part fe.
+
+The 2d systems are split into fi (the linear part) and fe (the constant
+forcing) so IMEX can be run on them too. For the automatic choice, the
+number of members that finished with each method is printed.
+
+Usage: ./executable [members] [probe_steps]
+
+The diffusion family has members/10 members.
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+#include "method_solver.h"
+
+// Coefficients of one member of the 2d system, as in the ensemble example.
+struct Coeffs {
+  realtype a00, a01, c0, c1;
+};
+
+// Struct for holding the variables of the diffusion problem.
+struct DiffusionData {
+  sunindextype N;
+  realtype d; // diffusion coefficient divided by the grid spacing squared
+  realtype k; // growth rate
+};
+
+static int f_2d(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int fe_2d(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int fi_2d(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv_2d(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                  N_Vector fu, void *user_data, N_Vector tmp);
+static int f_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                       void *user_data);
+static int fe_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                        void *user_data);
+static int fi_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                        void *user_data);
+static int jtv_diffusion(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                         N_Vector fu, void *user_data, N_Vector tmp);
+static int jtv_i_diffusion(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                           N_Vector fu, void *user_data, N_Vector tmp);
+static MethodProblem make_2d(Coeffs *coeffs, realtype s);
+static int run_family(const char *name,
+                      const std::vector < MethodProblem > &problems,
+                      const StiffnessOptions &options);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  int members = (argc > 1) ? std::atoi(argv[1]) : 200;
+  StiffnessOptions options = default_stiffness_options();
+  if (argc > 2) options.probe_steps = std::atol(argv[2]);
+  if (members < 1) members = 1;
+  int diffusion_members = (members >= 10) ? members / 10 : 1;
+
+  printf("probe of %ld steps, stiff when h*rho >= %g or failures >= %g of "
+         "the steps\n", options.probe_steps, (double) options.hrho_limit,
+         (double) options.fail_ratio);
+
+  std::vector < Coeffs > non_stiff(members), stiff(members);
+  std::vector < MethodProblem > problems(members);
+  for (int m = 0; m < members; m++) {
+    realtype s = (members > 1) ? (realtype) m / (members - 1) : 0;
+    non_stiff[m].a00 = -0.2;
+    non_stiff[m].a01 = -(1.0 + s);
+    non_stiff[m].c0 = 0.1 * s;
+    non_stiff[m].c1 = 0;
+    problems[m] = make_2d(&non_stiff[m], s);
+  }
+  if (run_family("non-stiff 2d", problems, options)) return(1);
+
+  for (int m = 0; m < members; m++) {
+    realtype s = (members > 1) ? (realtype) m / (members - 1) : 0;
+    stiff[m].a00 = -101.0 * (1.0 + 0.1 * s);
+    stiff[m].a01 = -100.0 * (1.0 + 0.1 * s);
+    stiff[m].c0 = 0.01 * s;
+    stiff[m].c1 = 0.02 * s;
+    problems[m] = make_2d(&stiff[m], s);
+  }
+  if (run_family("stiff 2d", problems, options)) return(1);
+
+  DiffusionData diffusion;
+  diffusion.N = 100;
+  diffusion.d = 0.01 * (diffusion.N + 1) * (diffusion.N + 1);
+  diffusion.k = 1.0;
+  problems.resize(diffusion_members);
+  for (int m = 0; m < diffusion_members; m++) {
+    realtype amplitude = 0.5 + 0.5 * m / diffusion_members;
+    MethodProblem &p = problems[m];
+    p.N = diffusion.N;
+    p.f = f_diffusion;
+    p.jtv = jtv_diffusion;
+    p.fe = fe_diffusion;
+    p.fi = fi_diffusion;
+    p.jtv_i = jtv_i_diffusion;
+    p.fi_linear = SUNTRUE;
+    p.user_data = &diffusion;
+    p.y0.resize(diffusion.N);
+    for (sunindextype j = 0; j < diffusion.N; j++) {
+      realtype x = (realtype) (j + 1) / (diffusion.N + 1);
+      p.y0[j] = amplitude * x * (1.0 - x) * 4.0;
+    }
+    p.t0 = 0;
+    p.tout = 1;
+    p.reltol = 1e-5;
+    p.abstol = 1e-8;
+  }
+  if (run_family("diffusion, N = 100", problems, options)) return(1);
+
+  return(0);
+}
+
+// One member of the 2d system, initial values spread around (2, 1).
+static MethodProblem make_2d(Coeffs *coeffs, realtype s) {
+  MethodProblem p;
+  p.N = 2;
+  p.f = f_2d;
+  p.jtv = jtv_2d;
+  p.fe = fe_2d;
+  p.fi = fi_2d;
+  p.jtv_i = jtv_2d; // fe is constant, fi has the whole jacobian
+  p.fi_linear = SUNTRUE;
+  p.user_data = coeffs;
+  p.y0.resize(2);
+  p.y0[0] = 2.0 + s;
+  p.y0[1] = 1.0 - s;
+  p.t0 = 0;
+  p.tout = 50;
+  p.reltol = 1e-5;
+  p.abstol = 1e-5;
+  return p;
+}
+
+// Solves every problem with every method and prints one line per method.
+static int run_family(const char *name,
+                      const std::vector < MethodProblem > &problems,
+                      const StiffnessOptions &options) {
+  int flag;
+  size_t n = problems.size();
+  MethodResult result;
+
+  // Reference solutions with tight tolerances.
+  std::vector < std::vector < realtype > > reference(n);
+  for (size_t m = 0; m < n; m++) {
+    MethodProblem tight = problems[m];
+    tight.reltol = 1e-10;
+    tight.abstol = 1e-12;
+    flag = solve_with_method(tight, METHOD_BDF, options, &result);
+    if (check_flag(&flag, "solve_with_method", 1)) return(1);
+    reference[m] = result.y;
+  }
+
+  printf("\n%s, %ld members\n", name, (long) n);
+  printf("%-6s %11s %9s %9s %10s %10s %7s\n", "method", "seconds", "steps",
+         "f evals", "max error", "vs bdf", "failed");
+  double bdf_seconds = 0;
+  for (int method = METHOD_BDF; method <= METHOD_AUTO; method++) {
+    double seconds = 0;
+    double steps = 0, evals = 0;
+    realtype max_error = 0;
+    int failed = 0;
+    int finished[METHOD_AUTO] = {0, 0, 0};
+    for (size_t m = 0; m < n; m++) {
+      flag = solve_with_method(problems[m], method, options, &result);
+      seconds += result.record.seconds;
+      if (flag < 0) {
+        failed++;
+        continue;
+      }
+      steps += result.record.steps;
+      evals += result.record.rhs_evals;
+      finished[result.method]++;
+      for (size_t i = 0; i < result.y.size(); i++) {
+        max_error = SUNMAX(max_error, SUNRabs(result.y[i] - reference[m][i]));
+      }
+    }
+    if (method == METHOD_BDF) bdf_seconds = seconds;
+    int solved = (int) n - failed;
+    printf("%-6s %11.6f %9.1f %9.1f %10.2e %10.2f %7d", method_name(method),
+           seconds, (solved > 0) ? steps / solved : 0,
+           (solved > 0) ? evals / solved : 0, (double) max_error,
+           (seconds > 0) ? bdf_seconds / seconds : 0, failed);
+    if (method == METHOD_AUTO) {
+      printf("   finished with bdf %d, adams %d, imex %d",
+             finished[METHOD_BDF], finished[METHOD_ADAMS],
+             finished[METHOD_IMEX]);
+    }
+    printf("\n");
+  }
+  return(0);
+}
+
+// The 2d system, f = fe + fi with fe the forcing and fi the linear part.
+static int f_2d(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  Coeffs *c = (Coeffs*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+
+  dudata[0] = c->a00 * udata[0] + c->a01 * udata[1] + c->c0;
+  dudata[1] = udata[0] + c->c1;
+
+  return(0);
+}
+
+static int fe_2d(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  Coeffs *c = (Coeffs*) user_data;
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+
+  dudata[0] = c->c0;
+  dudata[1] = c->c1;
+
+  return(0);
+}
+
+static int fi_2d(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  Coeffs *c = (Coeffs*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+
+  dudata[0] = c->a00 * udata[0] + c->a01 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function vector routine of f and of fi.
+static int jtv_2d(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                  N_Vector fu, void *user_data, N_Vector tmp) {
+  Coeffs *c = (Coeffs*) user_data;
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = c->a00 * vdata[0] + c->a01 * vdata[1];
+  Jvdata[1] = vdata[0];
+
+  return(0);
+}
+
+// 1d diffusion with logistic growth, zero at both ends of the domain.
+static int f_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                       void *user_data) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  sunindextype N = data->N;
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left  = (i > 0) ? udata[i - 1] : 0;
+    realtype right = (i < N - 1) ? udata[i + 1] : 0;
+    dudata[i] = data->d * (left - 2.0 * udata[i] + right)
+                + data->k * udata[i] * (1.0 - udata[i]);
+  }
+
+  return(0);
+}
+
+// The growth, the non-stiff part.
+static int fe_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                        void *user_data) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+
+  for (sunindextype i = 0; i < data->N; i++) {
+    dudata[i] = data->k * udata[i] * (1.0 - udata[i]);
+  }
+
+  return(0);
+}
+
+// The diffusion, the stiff part.
+static int fi_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                        void *user_data) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  sunindextype N = data->N;
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left  = (i > 0) ? udata[i - 1] : 0;
+    realtype right = (i < N - 1) ? udata[i + 1] : 0;
+    dudata[i] = data->d * (left - 2.0 * udata[i] + right);
+  }
+
+  return(0);
+}
+
+// Jacobian function vector routine of f.
+static int jtv_diffusion(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                         N_Vector fu, void *user_data, N_Vector tmp) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  sunindextype N = data->N;
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left  = (i > 0) ? vdata[i - 1] : 0;
+    realtype right = (i < N - 1) ? vdata[i + 1] : 0;
+    Jvdata[i] = data->d * (left - 2.0 * vdata[i] + right)
+                + data->k * (1.0 - 2.0 * udata[i]) * vdata[i];
+  }
+
+  return(0);
+}
+
+// Jacobian function vector routine of fi, which is linear.
+static int jtv_i_diffusion(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                           N_Vector fu, void *user_data, N_Vector tmp) {
+  return fi_diffusion(t, v, Jv, user_data);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
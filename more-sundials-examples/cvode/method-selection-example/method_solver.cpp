@@ -0,0 +1,263 @@
+#include "method_solver.h"
+
+#include <arkode/arkode.h> // prototypes for ARKODE fcts., consts.
+#include <arkode/arkode_spils.h> // access to ARKSpils interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+
+#include "cvode_stats.h"  // collect_cvode_stats
+
+#define MAX_STEPS 100000
+
+static int run_method(const MethodProblem &p, int method, N_Vector y,
+                      realtype t0, SolveRecord *rec);
+static int run_auto(const MethodProblem &p, const StiffnessOptions &options,
+                    N_Vector y, StiffnessProbe *probe, SolveRecord *rec,
+                    int *finish);
+static int run_imex(const MethodProblem &p, N_Vector y, realtype t0,
+                    SolveRecord *part);
+static void *create_cvode(const MethodProblem &p, int method, N_Vector y,
+                          realtype t0, SUNLinearSolver *LS);
+static void add_counts(SolveRecord *sum, const SolveRecord &part);
+
+
+const char *method_name(int method) {
+  switch (method) {
+    case METHOD_BDF: return "bdf";
+    case METHOD_ADAMS: return "adams";
+    case METHOD_IMEX: return "imex";
+    case METHOD_AUTO: return "auto";
+  }
+  return "unknown";
+}
+
+int solve_with_method(const MethodProblem &problem, int method,
+                      const StiffnessOptions &options, MethodResult *result) {
+  if (method == METHOD_IMEX && (problem.fe == NULL || problem.fi == NULL)) {
+    return(-1);
+  }
+  double start = stats_now();
+  int flag;
+
+  result->method = method;
+  result->record.reset();
+  result->probe.steps = result->probe.conv_fails = 0;
+  result->probe.err_test_fails = 0;
+  result->probe.t = problem.t0;
+  result->probe.h = result->probe.rho = 0;
+  result->probe.rho_explicit = -1;
+  result->probe.stiff = SUNFALSE;
+
+  N_Vector y = N_VNew_Serial(problem.N);
+  if (y == NULL) return(-1);
+  for (sunindextype i = 0; i < problem.N; i++) {
+    NV_DATA_S(y)[i] = problem.y0[i];
+  }
+
+  if (method == METHOD_AUTO) {
+    flag = run_auto(problem, options, y, &result->probe, &result->record,
+                    &result->method);
+  } else {
+    flag = run_method(problem, method, y, problem.t0, &result->record);
+  }
+
+  result->record.seconds = stats_now() - start;
+  result->y.assign(NV_DATA_S(y), NV_DATA_S(y) + problem.N);
+  N_VDestroy(y);
+  return(flag);
+}
+
+// Integrates y from t0 to tout with one method and adds its counters to rec.
+static int run_method(const MethodProblem &p, int method, N_Vector y,
+                      realtype t0, SolveRecord *rec) {
+  SolveRecord part;
+  if (method == METHOD_IMEX) {
+    int flag = run_imex(p, y, t0, &part);
+    add_counts(rec, part);
+    rec->flag = part.flag;
+    return(flag);
+  }
+
+  SUNLinearSolver LS;
+  void *cvode_mem = create_cvode(p, method, y, t0, &LS);
+  if (cvode_mem == NULL) return(-1);
+  realtype t;
+  part.flag = CVode(cvode_mem, p.tout, y, &t, CV_NORMAL);
+  int flag = collect_cvode_stats(cvode_mem, LS, &part);
+  add_counts(rec, part);
+  rec->flag = part.flag;
+  CVodeFree(&cvode_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+  return((part.flag < 0) ? part.flag : flag);
+}
+
+// Takes the first options.probe_steps steps with Adams, decides and finishes
+// the solve with the method picked from there.
+static int run_auto(const MethodProblem &p, const StiffnessOptions &options,
+                    N_Vector y, StiffnessProbe *probe, SolveRecord *rec,
+                    int *finish) {
+  SUNLinearSolver LS;
+  void *cvode_mem = create_cvode(p, METHOD_ADAMS, y, p.t0, &LS);
+  if (cvode_mem == NULL) return(-1);
+  N_Vector tmp1 = N_VClone(y);
+  N_Vector tmp2 = N_VClone(y);
+  N_Vector tmp3 = N_VClone(y);
+  SolveRecord part;
+  realtype t = p.t0;
+  int flag = -1;
+  if (tmp1 == NULL || tmp2 == NULL || tmp3 == NULL) goto cleanup;
+
+  // The probe, one step at a time. y is the solution at t after each step.
+  while (t < p.tout && probe->steps < options.probe_steps) {
+    rec->flag = CVode(cvode_mem, p.tout, y, &t, CV_ONE_STEP);
+    if (rec->flag < 0) {
+      flag = rec->flag;
+      goto cleanup;
+    }
+    CVodeGetNumSteps(cvode_mem, &probe->steps);
+  }
+  probe->t = t;
+  if (CVodeGetNumNonlinSolvConvFails(cvode_mem, &probe->conv_fails) < 0 ||
+      CVodeGetNumErrTestFails(cvode_mem, &probe->err_test_fails) < 0 ||
+      CVodeGetLastStep(cvode_mem, &probe->h) < 0 ||
+      estimate_spectral_radius(p.f, p.user_data, t, y,
+                               options.power_iterations, tmp1, tmp2, tmp3,
+                               &probe->rho) < 0) {
+    goto cleanup;
+  }
+  if (p.fe != NULL && p.fi != NULL &&
+      estimate_spectral_radius(p.fe, p.user_data, t, y,
+                               options.power_iterations, tmp1, tmp2, tmp3,
+                               &probe->rho_explicit) < 0) {
+    goto cleanup;
+  }
+  decide_stiffness(options, probe);
+
+  if (!probe->stiff) {
+    // Adams goes on where it is.
+    *finish = METHOD_ADAMS;
+    if (t < p.tout) {
+      rec->flag = CVode(cvode_mem, p.tout, y, &t, CV_NORMAL);
+      if (rec->flag < 0) {
+        flag = rec->flag;
+        goto cleanup;
+      }
+    }
+    flag = collect_cvode_stats(cvode_mem, LS, &part);
+    add_counts(rec, part);
+    goto cleanup;
+  }
+
+  // The probe's steps count too, the stiff method starts at (t, y).
+  if (collect_cvode_stats(cvode_mem, LS, &part) < 0) goto cleanup;
+  add_counts(rec, part);
+  *finish = (probe->rho_explicit >= 0 &&
+             probe->h * probe->rho_explicit < options.hrho_limit) ?
+      METHOD_IMEX : METHOD_BDF;
+  flag = run_method(p, *finish, y, t, rec);
+
+cleanup:
+  CVodeFree(&cvode_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+  if (tmp1 != NULL) N_VDestroy(tmp1);
+  if (tmp2 != NULL) N_VDestroy(tmp2);
+  if (tmp3 != NULL) N_VDestroy(tmp3);
+  return(flag);
+}
+
+// ARKODE with fe explicit and fi implicit, SPGMR for the Newton systems.
+static int run_imex(const MethodProblem &p, N_Vector y, realtype t0,
+                    SolveRecord *part) {
+  int flag = -1;
+  realtype t;
+  long int nfe, nfi;
+  SUNLinearSolver LS = NULL;
+  void *arkode_mem = ARKodeCreate();
+  if (arkode_mem == NULL) return(-1);
+
+  if (ARKodeInit(arkode_mem, p.fe, p.fi, t0, y) < 0 ||
+      ARKodeSetIMEX(arkode_mem) < 0 ||
+      ARKodeSStolerances(arkode_mem, p.reltol, p.abstol) < 0 ||
+      ARKodeSetUserData(arkode_mem, p.user_data) < 0 ||
+      ARKodeSetMaxNumSteps(arkode_mem, MAX_STEPS) < 0 ||
+      (p.fi_linear && ARKodeSetLinear(arkode_mem, 0) < 0)) {
+    goto cleanup;
+  }
+  LS = SUNSPGMR(y, 0, 0);
+  if (LS == NULL ||
+      ARKSpilsSetLinearSolver(arkode_mem, LS) < 0 ||
+      (p.jtv_i != NULL &&
+       ARKSpilsSetJacTimes(arkode_mem, NULL, p.jtv_i) < 0)) {
+    goto cleanup;
+  }
+
+  part->flag = ARKode(arkode_mem, p.tout, y, &t, ARK_NORMAL);
+  if (part->flag < 0) {
+    flag = part->flag;
+    goto cleanup;
+  }
+  if (ARKodeGetNumSteps(arkode_mem, &part->steps) < 0 ||
+      ARKodeGetNumRhsEvals(arkode_mem, &nfe, &nfi) < 0 ||
+      ARKodeGetNumLinSolvSetups(arkode_mem, &part->lin_setups) < 0 ||
+      ARKodeGetNumErrTestFails(arkode_mem, &part->err_test_fails) < 0 ||
+      ARKodeGetNumNonlinSolvIters(arkode_mem, &part->nonlin_iters) < 0 ||
+      ARKSpilsGetNumLinIters(arkode_mem, &part->lin_iters) < 0) {
+    goto cleanup;
+  }
+  part->rhs_evals = nfe + nfi;
+  flag = 0;
+
+cleanup:
+  ARKodeFree(&arkode_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+  return(flag);
+}
+
+// CVODE memory for BDF with Newton and SPGMR or Adams with functional
+// iteration, started at (t0, y). Returns NULL on failure, with everything
+// created so far freed.
+static void *create_cvode(const MethodProblem &p, int method, N_Vector y,
+                          realtype t0, SUNLinearSolver *LS) {
+  *LS = NULL;
+  void *cvode_mem = (method == METHOD_ADAMS) ?
+      CVodeCreate(CV_ADAMS, CV_FUNCTIONAL) : CVodeCreate(CV_BDF, CV_NEWTON);
+  if (cvode_mem == NULL) return(NULL);
+  // The stop time keeps the CV_ONE_STEP probe from stepping past tout.
+  if (CVodeInit(cvode_mem, p.f, t0, y) < 0 ||
+      CVodeSStolerances(cvode_mem, p.reltol, p.abstol) < 0 ||
+      CVodeSetUserData(cvode_mem, p.user_data) < 0 ||
+      CVodeSetMaxNumSteps(cvode_mem, MAX_STEPS) < 0 ||
+      CVodeSetStopTime(cvode_mem, p.tout) < 0) {
+    CVodeFree(&cvode_mem);
+    return(NULL);
+  }
+  if (method == METHOD_ADAMS) return(cvode_mem);
+
+  *LS = SUNSPGMR(y, 0, 0);
+  if (*LS == NULL ||
+      CVSpilsSetLinearSolver(cvode_mem, *LS) < 0 ||
+      (p.jtv != NULL && CVSpilsSetJacTimes(cvode_mem, NULL, p.jtv) < 0)) {
+    CVodeFree(&cvode_mem);
+    if (*LS != NULL) SUNLinSolFree(*LS);
+    *LS = NULL;
+    return(NULL);
+  }
+  return(cvode_mem);
+}
+
+// Adds the counters of part that it has (not -1) to sum.
+static void add_counts(SolveRecord *sum, const SolveRecord &part) {
+  long int SolveRecord::*counters[] = {
+    &SolveRecord::steps, &SolveRecord::rhs_evals, &SolveRecord::lin_setups,
+    &SolveRecord::nonlin_iters, &SolveRecord::nonlin_conv_fails,
+    &SolveRecord::err_test_fails, &SolveRecord::lin_iters,
+    &SolveRecord::lin_conv_fails, &SolveRecord::jtv_evals,
+    &SolveRecord::prec_evals, &SolveRecord::prec_solves
+  };
+  for (size_t k = 0; k < sizeof(counters) / sizeof(counters[0]); k++) {
+    long int value = part.*counters[k];
+    if (value < 0) continue;
+    long int &total = sum->*counters[k];
+    total = (total < 0) ? value : total + value;
+  }
+}
@@ -0,0 +1,67 @@
+/*
+Solves an initial value problem with the integration method that fits it,
+instead of always CVodeCreate(CV_BDF, CV_NEWTON):
+
+  METHOD_BDF    CVODE with BDF and Newton iteration, SPGMR for the linear
+                systems. For stiff problems.
+  METHOD_ADAMS  CVODE with Adams and functional iteration. No jacobian and no
+                linear solver, so nothing to set up, but the step size is
+                bounded by 1/rho (rho the spectral radius of df/dy). For
+                non-stiff problems.
+  METHOD_IMEX   ARKODE with an additive Runge-Kutta method, f = fe + fi.
+                fe is integrated explicitly and fi implicitly with Newton
+                iteration and SPGMR. For problems whose stiffness is in a
+                part that is cheap to solve with (often linear, like
+                diffusion) and whose other part is expensive or non-stiff.
+  METHOD_AUTO   Probes the first steps with Adams (stiffness.h) and finishes
+                from the state the probe reached with Adams when the problem
+                is not stiff, otherwise with IMEX when a split is given and
+                fe alone is not stiff, otherwise with BDF.
+*/
+
+#ifndef METHOD_SOLVER_H
+#define METHOD_SOLVER_H
+
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "solver_stats.h"  // SolveRecord
+#include "stiffness.h"
+
+enum { METHOD_BDF, METHOD_ADAMS, METHOD_IMEX, METHOD_AUTO };
+
+struct MethodProblem {
+  sunindextype N;
+  CVRhsFn f;
+  CVSpilsJacTimesVecFn jtv; // NULL for CVODE's difference quotient
+  // The split f = fe + fi for METHOD_IMEX, NULL without one. jtv_i is the
+  // jacobian of fi times a vector, NULL for ARKODE's difference quotient.
+  CVRhsFn fe;
+  CVRhsFn fi;
+  CVSpilsJacTimesVecFn jtv_i;
+  booleantype fi_linear; // fi is linear in y and does not depend on t
+  void *user_data;
+  std::vector < realtype > y0;
+  realtype t0, tout;
+  realtype reltol, abstol;
+};
+
+struct MethodResult {
+  int method; // the method that finished the solve
+  std::vector < realtype > y; // solution at tout
+  // Counters of the whole solve, including the probe of METHOD_AUTO. For
+  // IMEX rhs_evals counts the calls to fe and fi together.
+  SolveRecord record;
+  StiffnessProbe probe; // METHOD_AUTO only
+};
+
+const char *method_name(int method);
+
+// Returns 0, the negative flag of the solver that failed, or -1 for
+// METHOD_IMEX without a split and when a solver cannot be created.
+int solve_with_method(const MethodProblem &problem, int method,
+                      const StiffnessOptions &options, MethodResult *result);
+
+#endif
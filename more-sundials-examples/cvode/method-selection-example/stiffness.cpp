@@ -0,0 +1,48 @@
+#include "stiffness.h"
+
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+
+StiffnessOptions default_stiffness_options() {
+  StiffnessOptions options;
+  options.probe_steps = 100;
+  options.hrho_limit = 0.5;
+  options.fail_ratio = 0.2;
+  options.power_iterations = 20;
+  return options;
+}
+
+int estimate_spectral_radius(CVRhsFn f, void *user_data, realtype t,
+                             N_Vector y, int iterations, N_Vector tmp1,
+                             N_Vector tmp2, N_Vector tmp3, realtype *rho) {
+  N_Vector v = tmp1, fy = tmp2, work = tmp3;
+  realtype norm_y = SUNRsqrt(N_VDotProd(y, y));
+  realtype sigma = SUNRsqrt(UNIT_ROUNDOFF) * (1 + norm_y);
+
+  if (f(t, y, fy, user_data) != 0) return(-1);
+  // Start from a vector with every component, so no mode is missed.
+  N_VConst(1, v);
+  N_VScale(1 / SUNRsqrt(N_VDotProd(v, v)), v, v);
+
+  *rho = 0;
+  for (int k = 0; k < iterations; k++) {
+    // work = J*v by a forward difference, v has norm 1 and is overwritten
+    // by f(y + sigma*v).
+    N_VLinearSum(1, y, sigma, v, work);
+    if (f(t, work, v, user_data) != 0) return(-1);
+    N_VLinearSum(1 / sigma, v, -1 / sigma, fy, work);
+    realtype norm = SUNRsqrt(N_VDotProd(work, work));
+    *rho = norm;
+    if (norm == 0) break; // J*v = 0, the estimate stays 0
+    N_VScale(1 / norm, work, v);
+  }
+  return(0);
+}
+
+void decide_stiffness(const StiffnessOptions &options, StiffnessProbe *probe) {
+  long int fails = probe->conv_fails + probe->err_test_fails;
+  probe->stiff = (probe->h * probe->rho >= options.hrho_limit ||
+                  (probe->steps > 0 &&
+                   fails >= options.fail_ratio * probe->steps)) ?
+      SUNTRUE : SUNFALSE;
+}
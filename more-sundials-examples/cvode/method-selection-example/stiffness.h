@@ -0,0 +1,62 @@
+/*
+Stiffness detection from the first steps of a solve.
+
+A problem is stiff when the step size of an explicit method or of functional
+iteration is held down by stability, not by accuracy. The first probe_steps
+steps are taken with Adams and functional iteration (CV_ADAMS,
+CV_FUNCTIONAL), which converges only while h*l0*rho < 1 with l0 <= 1 and rho
+the spectral radius of df/dy. After the probe
+
+  - the spectral radius rho of df/dy is estimated at the current state by
+    power iteration on difference quotients of f, and
+  - the problem counts as stiff when h*rho >= hrho_limit (the step is at the
+    bound of the iteration) or when the convergence and error test failures
+    are at least fail_ratio of the steps (the step controller keeps pushing
+    against that bound).
+
+The probe has to get past the initial transient: while the fast modes of a
+stiff problem still move, the step is held down by accuracy and the problem
+looks non-stiff.
+*/
+
+#ifndef STIFFNESS_H
+#define STIFFNESS_H
+
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+struct StiffnessOptions {
+  long int probe_steps; // Adams steps before the decision
+  realtype hrho_limit;
+  realtype fail_ratio;
+  int power_iterations;
+};
+
+// Counters of the probe and the decision.
+struct StiffnessProbe {
+  long int steps;
+  long int conv_fails; // of functional iteration
+  long int err_test_fails;
+  realtype t; // time reached
+  realtype h; // last step size
+  realtype rho; // spectral radius estimate of df/dy at t
+  realtype rho_explicit; // the same for the non-stiff part fe, -1 without
+  booleantype stiff;
+};
+
+// probe_steps = 100, hrho_limit = 0.5, fail_ratio = 0.2,
+// power_iterations = 20.
+StiffnessOptions default_stiffness_options();
+
+// Estimates the spectral radius of df/dy at (t, y) with iterations steps of
+// power iteration on (f(y + sigma*v) - f(y))/sigma. For complex eigenvalues
+// the estimate is only right to within a small factor. The vectors tmp1 to
+// tmp3 are workspace of the size of y. Returns 0, or -1 when f fails.
+int estimate_spectral_radius(CVRhsFn f, void *user_data, realtype t,
+                             N_Vector y, int iterations, N_Vector tmp1,
+                             N_Vector tmp2, N_Vector tmp3, realtype *rho);
+
+// Sets probe->stiff from the counters, h and rho of the probe.
+void decide_stiffness(const StiffnessOptions &options, StiffnessProbe *probe);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+OpenMP N_Vectors with NUMA-aware placement.
+
+On a machine with several memory nodes a page of memory is placed on the node
+of the thread that first writes to it. N_VNew_OpenMP allocates the data with
+malloc and leaves the first write to the user, who usually fills the initial
+values in a serial loop: all pages then end up on the node of the main
+thread, and the other threads read them over the interconnect in every
+vector operation.
+
+first_touch_vector() allocates the data itself and zeroes it with the same
+static schedule the operations of NVECTOR_OPENMP use, so every thread first
+touches the block it works on later. The initial values should then also be
+set in a loop with schedule(static). The vectors CVODE clones from it are
+first written inside NVECTOR_OPENMP's own static loops, so they are placed
+the same way.
+
+The vector owns its data, N_VDestroy frees it.
+*/
+
+#ifndef FIRST_TOUCH_H
+#define FIRST_TOUCH_H
+
+#include <cstdlib>
+#include <nvector/nvector_openmp.h>  // access to OpenMP N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+inline N_Vector first_touch_vector(sunindextype N, int num_threads) {
+  N_Vector v = N_VNewEmpty_OpenMP(N, num_threads);
+  if (v == NULL) return(NULL);
+
+  realtype *data = (realtype *) malloc(N * sizeof(realtype));
+  if (data == NULL) {
+    N_VDestroy(v);
+    return(NULL);
+  }
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+  for (sunindextype i = 0; i < N; i++) data[i] = 0;
+
+  // N_VDestroy frees owned data with free().
+  NV_DATA_OMP(v) = data;
+  NV_OWN_DATA_OMP(v) = SUNTRUE;
+  return(v);
+}
+
+#endif
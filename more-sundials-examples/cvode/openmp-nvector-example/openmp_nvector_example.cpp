@@ -0,0 +1,222 @@
+/*
+Thread scaling of one large system with the OpenMP N_Vector.
+
+The bistable reaction-diffusion equation
+
+  u_t = d*u_xx + u*(1 - u)*(u - alpha)
+
+on N cells with zero flux at the ends (d/h^2 = 100, alpha = 0.3) is solved
+with BDF, Newton iteration and SPGMR for 1, 2, 4, ... threads up to
+max_threads. The vector operations of CVODE and SPGMR run on the threads of
+the OpenMP N_Vector, f and jtv split their loops the same way, and the
+solution vector is placed with first_touch_vector (first_touch.h).
+
+For every thread count the time, speedup and parallel efficiency against one
+thread, the steps and the largest difference to the solution with one thread
+are printed.
+
+Usage: ./executable [N] [end_time] [max_threads]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <omp.h>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <nvector/nvector_openmp.h>  // access to OpenMP N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "first_touch.h"  // first_touch_vector
+#include "cvode_stats.h"  // SolveRecord, collect_cvode_stats
+
+struct UserData {
+  sunindextype N;
+  realtype diff; // d/h^2
+  realtype alpha;
+  int num_threads;
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int run(UserData *data, realtype end_time, std::vector < realtype > &u,
+               SolveRecord *stats);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  sunindextype N = (argc > 1) ? std::atol(argv[1]) : 1000000;
+  realtype end_time = (argc > 2) ? std::atof(argv[2]) : 1.0;
+  int max_threads = (argc > 3) ? std::atoi(argv[3]) : omp_get_max_threads();
+  if (N < 2) N = 2;
+  if (max_threads < 1) max_threads = 1;
+
+  UserData data;
+  data.N = N;
+  data.diff = 100;
+  data.alpha = 0.3;
+
+  // 1, 2, 4, ... and max_threads itself.
+  std::vector < int > threads;
+  for (int p = 1; p < max_threads; p *= 2) threads.push_back(p);
+  threads.push_back(max_threads);
+
+  printf("N = %ld, end_time = %g\n\n", (long) N, (double) end_time);
+  printf("%7s %9s %8s %10s %7s %10s\n", "threads", "seconds", "speedup",
+         "efficiency", "steps", "max_diff");
+  std::vector < realtype > u_first, u;
+  double first_seconds = 0;
+  for (size_t k = 0; k < threads.size(); k++) {
+    data.num_threads = threads[k];
+    SolveRecord stats;
+    if (run(&data, end_time, u, &stats) != 0) return(1);
+    if (k == 0) {
+      u_first = u;
+      first_seconds = stats.seconds;
+    }
+
+    realtype max_diff = 0;
+    for (sunindextype i = 0; i < N; i++) {
+      max_diff = SUNMAX(max_diff, SUNRabs(u[i] - u_first[i]));
+    }
+    double speedup = first_seconds / stats.seconds;
+    printf("%7d %9.3f %8.2f %9.0f%% %7ld %10.2e\n", threads[k], stats.seconds,
+           speedup, 100 * speedup / threads[k], stats.steps,
+           (double) max_diff);
+  }
+
+  return(0);
+}
+
+// One solve with data->num_threads threads, the solution is copied into u.
+static int run(UserData *data, realtype end_time, std::vector < realtype > &u,
+               SolveRecord *stats) {
+  int flag;
+  sunindextype N = data->N;
+  int num_threads = data->num_threads;
+
+  double start = stats_now();
+
+  // The initial values are written with the static schedule of the vector
+  // operations, after first_touch_vector placed the pages.
+  N_Vector y = first_touch_vector(N, num_threads);
+  if (check_flag((void *)y, "first_touch_vector", 0)) return(1);
+  realtype *ydata = NV_DATA_OMP(y);
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+  for (sunindextype i = 0; i < N; i++) {
+    realtype x = (i + 0.5) / N;
+    ydata[i] = 0.5 + 0.4 * sin(8 * M_PI * x);
+  }
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, 1e-6, 1e-8);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  flag = CVodeSetMaxNumSteps(cvode_mem, 100000);
+  if (check_flag(&flag, "CVodeSetMaxNumSteps", 1)) return(1);
+  SUNLinearSolver LS = SUNSPGMR(y, PREC_NONE, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  realtype t;
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(1);
+
+  stats->seconds = stats_now() - start;
+  stats->flag = flag;
+  collect_cvode_stats(cvode_mem, LS, stats);
+  u.assign(ydata, ydata + N);
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  return(0);
+}
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype N = data->N;
+  realtype diff = data->diff;
+  realtype alpha = data->alpha;
+  realtype *udata = NV_DATA_OMP(u);
+  realtype *dudata = NV_DATA_OMP(u_dot);
+
+#pragma omp parallel for schedule(static) num_threads(data->num_threads)
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left = udata[(i > 0) ? i - 1 : i];
+    realtype right = udata[(i < N - 1) ? i + 1 : i];
+    realtype ui = udata[i];
+    dudata[i] = diff * (left - 2 * ui + right) +
+        ui * (1 - ui) * (ui - alpha);
+  }
+
+  return(0);
+}
+
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  UserData *data = (UserData*) user_data;
+  sunindextype N = data->N;
+  realtype diff = data->diff;
+  realtype alpha = data->alpha;
+  realtype *udata = NV_DATA_OMP(u);
+  realtype *vdata = NV_DATA_OMP(v);
+  realtype *Jvdata = NV_DATA_OMP(Jv);
+
+#pragma omp parallel for schedule(static) num_threads(data->num_threads)
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left = vdata[(i > 0) ? i - 1 : i];
+    realtype right = vdata[(i < N - 1) ? i + 1 : i];
+    realtype ui = udata[i];
+    realtype dreact = -3 * ui * ui + 2 * (1 + alpha) * ui - alpha;
+    Jvdata[i] = diff * (left - 2 * vdata[i] + right) + dreact * vdata[i];
+  }
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,85 @@
+#include "halo_grid.h"
+
+#include <cstring>
+#include <nvector/nvector_parallel.h>  // PVEC_REAL_MPI_TYPE
+
+// Message tags, named after the direction the data travels.
+#define TAG_TO_RIGHT 1
+#define TAG_TO_LEFT 2
+
+
+HaloGrid1D::HaloGrid1D()
+    : comm_(MPI_COMM_NULL), rank_(0), size_(1), ncomp_(0),
+      left_rank_(MPI_PROC_NULL), right_rank_(MPI_PROC_NULL), n_global_(0),
+      n_local_(0), first_(0), wait_seconds_(0), num_exchanges_(0) {
+  for (int k = 0; k < 4; k++) requests_[k] = MPI_REQUEST_NULL;
+}
+
+int HaloGrid1D::create(MPI_Comm comm, sunindextype n_global, int ncomp,
+                       bool periodic) {
+  comm_ = comm;
+  if (MPI_Comm_rank(comm, &rank_) != MPI_SUCCESS) return(-1);
+  if (MPI_Comm_size(comm, &size_) != MPI_SUCCESS) return(-1);
+  if (ncomp < 1 || n_global < size_) return(-1);
+
+  // The first n_global % size ranks get one extra cell.
+  ncomp_ = ncomp;
+  n_global_ = n_global;
+  sunindextype base = n_global / size_;
+  sunindextype extra = n_global % size_;
+  n_local_ = base + (rank_ < extra ? 1 : 0);
+  first_ = rank_ * base + (rank_ < extra ? rank_ : extra);
+
+  if (periodic) {
+    left_rank_ = (rank_ + size_ - 1) % size_;
+    right_rank_ = (rank_ + 1) % size_;
+  } else {
+    left_rank_ = (rank_ > 0) ? rank_ - 1 : MPI_PROC_NULL;
+    right_rank_ = (rank_ < size_ - 1) ? rank_ + 1 : MPI_PROC_NULL;
+  }
+
+  ghost_left_.assign(ncomp, 0);
+  ghost_right_.assign(ncomp, 0);
+  wait_seconds_ = 0;
+  num_exchanges_ = 0;
+  return(0);
+}
+
+int HaloGrid1D::start_exchange(const realtype *u) {
+  const int nc = ncomp_;
+  realtype *first = (realtype *) u; // MPI-2 send buffers are not const
+  realtype *last = first + (n_local_ - 1) * nc;
+
+  // Receives are posted first so the sends can complete without buffering.
+  // Messages to or from MPI_PROC_NULL complete at once.
+  if (MPI_Irecv(&ghost_left_[0], nc, PVEC_REAL_MPI_TYPE, left_rank_,
+                TAG_TO_RIGHT, comm_, &requests_[0]) != MPI_SUCCESS ||
+      MPI_Irecv(&ghost_right_[0], nc, PVEC_REAL_MPI_TYPE, right_rank_,
+                TAG_TO_LEFT, comm_, &requests_[1]) != MPI_SUCCESS ||
+      MPI_Isend(first, nc, PVEC_REAL_MPI_TYPE, left_rank_, TAG_TO_LEFT, comm_,
+                &requests_[2]) != MPI_SUCCESS ||
+      MPI_Isend(last, nc, PVEC_REAL_MPI_TYPE, right_rank_, TAG_TO_RIGHT, comm_,
+                &requests_[3]) != MPI_SUCCESS) {
+    return(-1);
+  }
+  num_exchanges_++;
+
+  return(0);
+}
+
+int HaloGrid1D::finish_exchange(const realtype *u) {
+  double start = MPI_Wtime();
+  int err = MPI_Waitall(4, requests_, MPI_STATUSES_IGNORE);
+  wait_seconds_ += MPI_Wtime() - start;
+  if (err != MPI_SUCCESS) return(-1);
+
+  // Zero flux at the ends of a non-periodic grid.
+  const int nc = ncomp_;
+  if (left_rank_ == MPI_PROC_NULL) {
+    memcpy(&ghost_left_[0], u, nc * sizeof(realtype));
+  }
+  if (right_rank_ == MPI_PROC_NULL) {
+    memcpy(&ghost_right_[0], u + (n_local_ - 1) * nc, nc * sizeof(realtype));
+  }
+  return(0);
+}
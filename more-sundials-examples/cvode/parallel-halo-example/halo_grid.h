@@ -0,0 +1,103 @@
+/*
+Domain decomposition of a 1D grid for right hand sides of spatially coupled
+systems (diffusion-reaction and other nearest-neighbour stencils) on an
+N_VNew_Parallel vector.
+
+Every rank owns a contiguous block of cells, each cell holds ncomp values, so
+the local part of the N_Vector has n_local()*ncomp() entries. Instead of
+gathering the whole vector on every rank, apply() only exchanges the first and
+last cell with the neighbouring ranks using MPI_Isend/MPI_Irecv. While those
+messages are in flight it computes all interior cells, which need no remote
+values, and finishes the two boundary cells once the ghost cells arrived.
+
+The kernel given to apply() is called for every local cell i as
+
+  kernel(i, u_left, u_cell, u_right, out_cell)
+
+where the pointers point to the ncomp values of the left neighbour, the cell
+itself, the right neighbour and the output. At the ends of a non-periodic grid
+the missing neighbour is a copy of the boundary cell (zero flux).
+
+The functions returning int return 0 on success or -1 on failure (an MPI
+error or invalid sizes).
+*/
+
+#ifndef HALO_GRID_H
+#define HALO_GRID_H
+
+#include <mpi.h>
+#include <vector>
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+class HaloGrid1D {
+ public:
+  HaloGrid1D();
+
+  // Splits n_global cells as evenly as possible over the ranks of comm. Every
+  // rank needs at least one cell. With periodic the first and last rank are
+  // neighbours.
+  int create(MPI_Comm comm, sunindextype n_global, int ncomp, bool periodic);
+
+  // Computes out from u with the stencil kernel, see above. u and out are the
+  // local data arrays of the N_Vectors.
+  template <class Kernel>
+  int apply(const realtype *u, realtype *out, Kernel &kernel);
+
+  // The two halves of the exchange, for callers that want to do their own
+  // overlap. u must not change between them.
+  int start_exchange(const realtype *u);
+  int finish_exchange(const realtype *u);
+  const realtype *left_ghost() const { return &ghost_left_[0]; }
+  const realtype *right_ghost() const { return &ghost_right_[0]; }
+
+  MPI_Comm comm() const { return comm_; }
+  int rank() const { return rank_; }
+  int size() const { return size_; }
+  int ncomp() const { return ncomp_; }
+  sunindextype n_global() const { return n_global_; }
+  sunindextype n_local() const { return n_local_; }
+  sunindextype first() const { return first_; } // global index of cell 0
+  sunindextype local_length() const { return n_local_ * ncomp_; }
+
+  // Time spent in finish_exchange waiting for the ghost cells.
+  double wait_seconds() const { return wait_seconds_; }
+  long int num_exchanges() const { return num_exchanges_; }
+
+ private:
+  MPI_Comm comm_;
+  int rank_, size_, ncomp_;
+  int left_rank_, right_rank_; // MPI_PROC_NULL at the ends of the grid
+  sunindextype n_global_, n_local_, first_;
+  std::vector < realtype > ghost_left_, ghost_right_;
+  MPI_Request requests_[4];
+  double wait_seconds_;
+  long int num_exchanges_;
+};
+
+template <class Kernel>
+int HaloGrid1D::apply(const realtype *u, realtype *out, Kernel &kernel) {
+  const int nc = ncomp_;
+  const sunindextype n = n_local_;
+
+  if (start_exchange(u) != 0) return(-1);
+
+  // Interior cells only need local values.
+  for (sunindextype i = 1; i + 1 < n; i++) {
+    kernel(i, u + (i - 1) * nc, u + i * nc, u + (i + 1) * nc, out + i * nc);
+  }
+
+  if (finish_exchange(u) != 0) return(-1);
+
+  // Boundary cells of the block, using the ghost cells.
+  if (n == 1) {
+    kernel(0, left_ghost(), u, right_ghost(), out);
+  } else {
+    kernel(0, left_ghost(), u, u + nc, out);
+    kernel(n - 1, u + (n - 2) * nc, u + (n - 1) * nc, right_ghost(),
+           out + (n - 1) * nc);
+  }
+
+  return(0);
+}
+
+#endif
@@ -0,0 +1,410 @@
+/*
+A parallel example using the CVODE library to solve a 1D diffusion-reaction
+system (the Brusselator) on a N_VNew_Parallel vector, treating it as a stiff
+system.
+
+    u_t = a - (b + 1) u + u^2 v + alpha u_xx
+    v_t = b u - u^2 v + alpha v_xx
+
+with zero flux at both ends. Every rank owns a contiguous block of grid cells
+(see halo_grid.h). The right hand side and the jacobian-times-vector function
+only exchange the boundary cells with the neighbouring ranks, overlapped with
+the computation of the interior cells. For comparison the same functions can
+instead gather the whole vector on every rank with MPI_Allgatherv, the way the
+simple parallel example does.
+
+Usage: mpirun -np P ./halo [strong|weak] [cells] [halo|allgather] [end_time]
+                           [csv]
+  strong: cells is the global number of cells (default 100000)
+  weak:   cells is the number of cells per rank (default 10000)
+  csv:    print one comma separated line, used by scaling.sh
+*/
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_parallel.h>  // access to parallel N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "halo_grid.h"
+
+// This macro gives access to the individual components of the data array of an
+// N Vector.
+#define NV_Ith_P(v,i) ( NV_DATA_P(v)[i] )
+
+// Stencil kernel of the right hand side, called by HaloGrid1D::apply for every
+// cell with the (u, v) values of the cell and its two neighbours.
+struct BrusselatorRhs {
+  realtype a, b, d; // d = alpha / dx^2
+
+  void operator()(sunindextype i, const realtype *left, const realtype *cell,
+                  const realtype *right, realtype *out) const {
+    realtype u = cell[0], v = cell[1];
+    realtype uuv = u * u * v;
+    out[0] = a - (b + 1.0) * u + uuv + d * (left[0] - 2.0 * u + right[0]);
+    out[1] = b * u - uuv + d * (left[1] - 2.0 * v + right[1]);
+  }
+};
+
+// Stencil kernel of the jacobian times a vector. The stencil runs over the
+// vector, the reaction part needs the local state y.
+struct BrusselatorJv {
+  realtype b, d;
+  const realtype *y;
+
+  void operator()(sunindextype i, const realtype *left, const realtype *cell,
+                  const realtype *right, realtype *out) const {
+    realtype u = y[2 * i], v = y[2 * i + 1];
+    out[0] = (-(b + 1.0) + 2.0 * u * v) * cell[0] + u * u * cell[1] +
+             d * (left[0] - 2.0 * cell[0] + right[0]);
+    out[1] = (b - 2.0 * u * v) * cell[0] - u * u * cell[1] +
+             d * (left[1] - 2.0 * cell[1] + right[1]);
+  }
+};
+
+// Struct for holding the nessesary additional variables for the problem.
+struct UserData {
+  HaloGrid1D grid;
+  realtype a, b, d;
+  bool allgather; // use MPI_Allgatherv instead of the halo exchange
+  // Buffers of the allgather version.
+  std::vector < realtype > global;
+  std::vector < int > counts, displs;
+  // Time spent in f and jtv on this rank.
+  double rhs_seconds;
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+template <class Kernel>
+static int apply_allgather(UserData *data, const realtype *u, realtype *out,
+                           Kernel &kernel);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+UserData* alloc_user_data(MPI_Comm comm, sunindextype n_global, bool allgather);
+
+int main(int argc, char** argv) {
+  int flag; // For checking if functions have run properly
+  realtype abstol = 1e-5; // real tolerance of system
+  realtype reltol = 1e-5; // absolute tolerance of system
+
+  // 1. Initialize parallel or multi-threaded environment, if appropriate.
+  // ---------------------------------------------------------------------------
+  // Initialize the MPI environment
+  MPI_Init(&argc, &argv);
+
+  // Get the number of processes
+  int world_size;
+  MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+  // Get the rank of the process
+  int world_rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+  bool weak = (argc > 1 && strcmp(argv[1], "weak") == 0);
+  long int cells = (argc > 2) ? std::atol(argv[2]) : (weak ? 10000 : 100000);
+  bool allgather = (argc > 3 && strcmp(argv[3], "allgather") == 0);
+  realtype end_time = (argc > 4) ? std::atof(argv[4]) : 1.0;
+  bool csv = (argc > 5 && strcmp(argv[5], "csv") == 0);
+  // ---------------------------------------------------------------------------
+
+  // 2. Defining the length of the problem.
+  // ---------------------------------------------------------------------------
+  // Two unknowns (u, v) per grid cell. The user data splits the cells over the
+  // ranks and gives the length of the local block.
+  sunindextype n_cells = weak ? (sunindextype) cells * world_size : cells;
+  UserData *data = alloc_user_data(MPI_COMM_WORLD, n_cells, allgather);
+  if(check_flag((void *)data, "alloc_user_data", 2)) {
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  sunindextype n = data->grid.local_length();
+  sunindextype n_global = 2 * n_cells;
+  // ---------------------------------------------------------------------------
+
+  // 3. Set vector of initial values.
+  // ---------------------------------------------------------------------------
+  N_Vector y; // Problem vector.
+  y = N_VNew_Parallel(MPI_COMM_WORLD, n, n_global);
+  if(check_flag((void *)y, "N_VNew_Parallel", 0)) MPI_Abort(MPI_COMM_WORLD, 1);
+  // Each rank fills its own block, indexed by the global cell number.
+  realtype dx = 0.01;
+  for (sunindextype i = 0; i < data->grid.n_local(); i++) {
+    realtype x = (data->grid.first() + i) * dx;
+    NV_Ith_P(y, 2 * i) = data->a + 0.1 * std::sin(3.14159265358979 * x);
+    NV_Ith_P(y, 2 * i + 1) = data->b / data->a;
+  }
+  // ---------------------------------------------------------------------------
+
+  // 4. Create CVODE Object.
+  // ---------------------------------------------------------------------------
+  void *cvode_mem = NULL; // Problem dedicated memory.
+  cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  // ---------------------------------------------------------------------------
+
+  // 5. Initialize CVODE solver.
+  // ---------------------------------------------------------------------------
+  realtype t0 = 0; // Initiale value of time.
+  flag = CVodeInit(cvode_mem, f, t0, y);
+  if(check_flag(&flag, "CVodeInit", 1)) MPI_Abort(MPI_COMM_WORLD, 1);
+  // ---------------------------------------------------------------------------
+
+  // 6. Specify integration tolerances.
+  // ---------------------------------------------------------------------------
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) MPI_Abort(MPI_COMM_WORLD, 1);
+  // ---------------------------------------------------------------------------
+
+  // 7. Set Optional inputs.
+  // ---------------------------------------------------------------------------
+  /* Set the pointer to user-defined data */
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) MPI_Abort(MPI_COMM_WORLD, 1);
+  flag = CVodeSetMaxNumSteps(cvode_mem, 100000);
+  if (check_flag(&flag, "CVodeSetMaxNumSteps", 1)) MPI_Abort(MPI_COMM_WORLD, 1);
+  // ---------------------------------------------------------------------------
+
+  // 8. Create Matrix Object.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 9. Create Linear Solver Object.
+  // ---------------------------------------------------------------------------
+  SUNLinearSolver LS;
+  LS = SUNSPGMR(y, 0, 0);
+  if(check_flag((void *)LS, "SUNSPGMR", 0)) MPI_Abort(MPI_COMM_WORLD, 1);
+  // ---------------------------------------------------------------------------
+
+  // 10. Set linear solver optional inputs.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 11. Attach linear solver module.
+  // ---------------------------------------------------------------------------
+  // CVSpilsSetLinearSolver is for iterative linear solvers.
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) {
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  // ---------------------------------------------------------------------------
+
+  // 12. Set linear solver interface optional inputs.
+  // ---------------------------------------------------------------------------
+  // Sets the jacobian-times-vector function.
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if(check_flag(&flag, "CVSpilsSetJacTimes", 1)) MPI_Abort(MPI_COMM_WORLD, 1);
+  // ---------------------------------------------------------------------------
+
+  // 13. Specify rootfinding problem.
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  // 14. Advance solution in time.
+  // ---------------------------------------------------------------------------
+  // One call to the end time, the output is the timing summary below.
+  realtype t = 0;
+  MPI_Barrier(MPI_COMM_WORLD);
+  double start = MPI_Wtime();
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  double seconds = MPI_Wtime() - start;
+  if(check_flag(&flag, "CVode", 1)) MPI_Abort(MPI_COMM_WORLD, 1);
+  // ---------------------------------------------------------------------------
+
+  // 15. Get optional outputs.
+  // ---------------------------------------------------------------------------
+  long int nsteps, nfevals, njvevals;
+  CVodeGetNumSteps(cvode_mem, &nsteps);
+  CVodeGetNumRhsEvals(cvode_mem, &nfevals);
+  CVSpilsGetNumJtimesEvals(cvode_mem, &njvevals);
+
+  // The slowest rank determines the run time, so the maxima are reported.
+  double local_times[3] = {seconds, data->rhs_seconds,
+                           data->grid.wait_seconds()};
+  double max_times[3];
+  MPI_Reduce(local_times, max_times, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  // Collective, so every rank calls it. Lets runs with different rank counts
+  // and right hand sides be compared.
+  realtype l1_norm = N_VL1Norm(y);
+
+  if (world_rank == 0) {
+    const char *mode = weak ? "weak" : "strong";
+    const char *rhs = allgather ? "allgather" : "halo";
+    if (csv) {
+      std::cout << world_size << "," << mode << "," << rhs << "," << n_cells
+                << "," << max_times[0] << "," << nsteps << "," << nfevals
+                << "," << njvevals << "," << max_times[1] << ","
+                << max_times[2] << "," << l1_norm << "\n";
+    } else {
+      std::cout << "ranks:             " << world_size << "\n";
+      std::cout << "scaling:           " << mode << "\n";
+      std::cout << "rhs:               " << rhs << "\n";
+      std::cout << "cells:             " << n_cells << " ("
+                << n_cells / world_size << " per rank)\n";
+      std::cout << "t:                 " << t << "\n";
+      std::cout << "seconds:           " << max_times[0] << "\n";
+      std::cout << "steps:             " << nsteps << "\n";
+      std::cout << "f evals:           " << nfevals << "\n";
+      std::cout << "Jv evals:          " << njvevals << "\n";
+      std::cout << "f + Jv seconds:    " << max_times[1] << "\n";
+      std::cout << "halo wait seconds: " << max_times[2] << "\n";
+      std::cout << "|y|_1:             " << l1_norm << "\n";
+    }
+  }
+  // ---------------------------------------------------------------------------
+
+  // 16. Deallocate memory for solution vector.
+  // ---------------------------------------------------------------------------
+  N_VDestroy(y);
+  // ---------------------------------------------------------------------------
+
+  // 17. Free solver memory.
+  // ---------------------------------------------------------------------------
+  CVodeFree(&cvode_mem);
+  // ---------------------------------------------------------------------------
+
+  // 18. Free linear solver and matrix memory.
+  // ---------------------------------------------------------------------------
+  SUNLinSolFree(LS);
+  delete data;
+  // ---------------------------------------------------------------------------
+
+  // 19. Finalize MPI, if used
+  // ---------------------------------------------------------------------------
+  // MPI_Finalize is collective, no barrier is needed before it.
+  MPI_Finalize();
+  // ---------------------------------------------------------------------------
+
+  return(0);
+}
+
+// Right hand side, computed cell by cell with the halo exchange (or the
+// allgather for comparison).
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  double start = MPI_Wtime();
+
+  BrusselatorRhs kernel = {data->a, data->b, data->d};
+  int flag = data->allgather
+      ? apply_allgather(data, NV_DATA_P(u), NV_DATA_P(u_dot), kernel)
+      : data->grid.apply(NV_DATA_P(u), NV_DATA_P(u_dot), kernel);
+
+  data->rhs_seconds += MPI_Wtime() - start;
+  return(flag);
+}
+
+// Jacobian function vector routine. Only v needs ghost cells, the reaction
+// part of the jacobian is local to a cell.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  UserData *data = (UserData*) user_data;
+  double start = MPI_Wtime();
+
+  BrusselatorJv kernel = {data->b, data->d, NV_DATA_P(u)};
+  int flag = data->allgather
+      ? apply_allgather(data, NV_DATA_P(v), NV_DATA_P(Jv), kernel)
+      : data->grid.apply(NV_DATA_P(v), NV_DATA_P(Jv), kernel);
+
+  data->rhs_seconds += MPI_Wtime() - start;
+  return(flag);
+}
+
+// The same stencil as HaloGrid1D::apply, but every rank first gathers the
+// whole vector. Every call is a global synchronization and moves the full
+// vector to every rank.
+template <class Kernel>
+static int apply_allgather(UserData *data, const realtype *u, realtype *out,
+                           Kernel &kernel) {
+  HaloGrid1D &grid = data->grid;
+  const int nc = grid.ncomp();
+  realtype *global = &data->global[0];
+
+  if (MPI_Allgatherv((void *) u, (int) grid.local_length(), PVEC_REAL_MPI_TYPE,
+                     global, &data->counts[0], &data->displs[0],
+                     PVEC_REAL_MPI_TYPE, grid.comm()) != MPI_SUCCESS) {
+    return(-1);
+  }
+
+  // Zero flux at the ends, the missing neighbour is the cell itself.
+  sunindextype last = grid.n_global() - 1;
+  for (sunindextype i = 0; i < grid.n_local(); i++) {
+    sunindextype g = grid.first() + i;
+    const realtype *left = global + ((g > 0) ? g - 1 : g) * nc;
+    const realtype *right = global + ((g < last) ? g + 1 : g) * nc;
+    kernel(i, left, global + g * nc, right, out + i * nc);
+  }
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
+
+// Initalizes the grid and the coefficients for the user data pointer. Returns
+// NULL if the cells cannot be split over the ranks.
+UserData* alloc_user_data(MPI_Comm comm, sunindextype n_global,
+                          bool allgather) {
+  UserData *data = new UserData();
+
+  if (data->grid.create(comm, n_global, 2, false) != 0) {
+    delete data;
+    return NULL;
+  }
+
+  realtype alpha = 0.01, dx = 0.01;
+  data->a = 1.0;
+  data->b = 3.0;
+  data->d = alpha / (dx * dx);
+  data->allgather = allgather;
+  data->rhs_seconds = 0;
+
+  // Block lengths and offsets of all ranks for MPI_Allgatherv.
+  if (allgather) {
+    int size = data->grid.size();
+    int local = (int) data->grid.local_length();
+    data->counts.resize(size);
+    data->displs.resize(size);
+    MPI_Allgather(&local, 1, MPI_INT, &data->counts[0], 1, MPI_INT, comm);
+    data->displs[0] = 0;
+    for (int r = 1; r < size; r++) {
+      data->displs[r] = data->displs[r - 1] + data->counts[r - 1];
+    }
+    data->global.resize(2 * n_global);
+  }
+
+  return data;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+# Strong and weak scaling of the halo exchange and the allgather right hand
+# side for 1 to 16 ranks. Prints one comma separated line per run.
+#
+# Usage: ./scaling.sh [max_ranks] [strong_cells] [weak_cells_per_rank]
+# Extra mpirun options (e.g. --oversubscribe) can be given in MPIRUN_FLAGS.
+
+MAX_RANKS=${1:-16}
+STRONG_CELLS=${2:-100000}
+WEAK_CELLS=${3:-10000}
+MPIRUN=${MPIRUN:-mpirun}
+
+echo "ranks,scaling,rhs,cells,seconds,steps,f_evals,jv_evals,rhs_seconds,halo_wait_seconds,l1_norm"
+for rhs in halo allgather; do
+  for np in 1 2 4 8 16; do
+    if [ "$np" -gt "$MAX_RANKS" ]; then break; fi
+    $MPIRUN $MPIRUN_FLAGS -np $np ./halo strong $STRONG_CELLS $rhs 1 csv
+    $MPIRUN $MPIRUN_FLAGS -np $np ./halo weak $WEAK_CELLS $rhs 1 csv
+  done
+done
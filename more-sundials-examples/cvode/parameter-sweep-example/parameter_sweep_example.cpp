@@ -0,0 +1,222 @@
+/*
+A parameter sweep over the coefficients of the user data example: every row
+of a parameter table holds (c_0, c_1) and is solved as
+
+  u_0' = -101*u_0 - 100*u_1 + c_0
+  u_1' = u_0 + c_1
+
+from u(0) = (2, 1) up to tout = 50. The results go to a columnar file that
+can be resumed after an interruption (see sweep.h).
+
+Usage: ./executable --make-table table rows            write a table (.bin or
+                                                       CSV)
+       ./executable table results [threads] [stop_after_rows]
+                                                       run or resume a sweep
+       ./executable --print results [rows]             print results as text
+*/
+
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "parameter_table.h"
+#include "sweep.h"
+
+// Struct for holding the nessesary additional variables for the problem.
+struct UserData {
+  std::vector < realtype > coeffs;
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static void *new_user_data(int64_t num_params);
+static void delete_user_data(void *user_data);
+static void set_parameters(void *user_data, const realtype *params);
+static int make_table(const char *path, int64_t rows);
+static int print_results(const char *path, int64_t max_rows);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 3 && strcmp(argv[1], "--make-table") == 0) {
+    return(make_table(argv[2], std::atol(argv[3])));
+  }
+  if (argc > 2 && strcmp(argv[1], "--print") == 0) {
+    return(print_results(argv[2], (argc > 3) ? std::atol(argv[3]) : 10));
+  }
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s table results [threads] [stop_after_rows]\n",
+            argv[0]);
+    return(1);
+  }
+
+  int flag;
+  ParameterTable table;
+  flag = read_parameter_table(argv[1], &table);
+  if (check_flag(&flag, "read_parameter_table", 1)) return(1);
+  if (table.columns() != 2) {
+    fprintf(stderr, "\nTABLE_ERROR: %s needs the columns c_0,c_1\n\n",
+            argv[1]);
+    return(1);
+  }
+
+  SweepModel model;
+  model.N = 2;
+  model.f = f;
+  model.jtv = jtv;
+  model.y0.push_back(2.0);
+  model.y0.push_back(1.0);
+  model.t0 = 0;
+  model.tout = 50;
+  model.reltol = 1e-5;
+  model.abstol = 1e-5;
+  model.new_user_data = new_user_data;
+  model.delete_user_data = delete_user_data;
+  model.set_parameters = set_parameters;
+
+  SweepOptions options;
+  options.num_threads = (argc > 3) ? std::atoi(argv[3]) :
+      std::thread::hardware_concurrency();
+  options.chunk_rows = 1024;
+  options.checkpoint_chunks = 16;
+  options.stop_after_rows = (argc > 4) ? std::atol(argv[4]) : 0;
+  if (options.num_threads < 1) options.num_threads = 1;
+
+  SweepSummary summary;
+  flag = run_sweep(table, model, options, argv[2], &summary);
+  if (check_flag(&flag, "run_sweep", 1)) return(1);
+
+  printf("rows:      %ld\n", (long) summary.rows);
+  printf("resumed:   %ld\n", (long) summary.resumed_rows);
+  printf("solved:    %ld (%ld failed)\n", (long) summary.solved_rows,
+         (long) summary.failed_rows);
+  printf("remaining: %ld\n", (long) summary.remaining_rows);
+  printf("seconds:   %.3f (%.0f rows/s, %d threads)\n", summary.seconds,
+         summary.solved_rows / summary.seconds, options.num_threads);
+  return(0);
+}
+
+// A rows x 2 grid of coefficients, c_0 in [-10, 10] and c_1 in [-1, 1].
+static int make_table(const char *path, int64_t rows) {
+  if (rows < 1) rows = 1;
+  int64_t side = (int64_t) ceil(sqrt((double) rows));
+
+  ParameterTable table;
+  table.names.push_back("c_0");
+  table.names.push_back("c_1");
+  table.rows = rows;
+  table.values.resize(2 * rows);
+  for (int64_t i = 0; i < rows; i++) {
+    realtype a = (side > 1) ? (realtype) (i % side) / (side - 1) : 0;
+    realtype b = (side > 1) ? (realtype) (i / side) / (side - 1) : 0;
+    table.values[2 * i] = -10 + 20 * a;
+    table.values[2 * i + 1] = -1 + 2 * b;
+  }
+
+  int flag = write_parameter_table(path, table);
+  if (check_flag(&flag, "write_parameter_table", 1)) return(1);
+  return(0);
+}
+
+static int print_results(const char *path, int64_t max_rows) {
+  std::vector < std::string > names;
+  int64_t rows;
+  std::vector < realtype > values;
+  int flag = read_sweep_output(path, names, rows, values);
+  if (check_flag(&flag, "read_sweep_output", 1)) return(1);
+
+  int64_t columns = names.size();
+  for (int64_t c = 0; c < columns; c++) printf("%14s", names[c].c_str());
+  printf("\n");
+  for (int64_t i = 0; i < SUNMIN(rows, max_rows); i++) {
+    for (int64_t c = 0; c < columns; c++) {
+      printf("%14.6g", (double) values[c * rows + i]);
+    }
+    printf("\n");
+  }
+  return(0);
+}
+
+static void *new_user_data(int64_t num_params) {
+  UserData *data = new UserData;
+  data->coeffs.resize(num_params);
+  return(data);
+}
+
+static void delete_user_data(void *user_data) {
+  delete (UserData*) user_data;
+}
+
+// Copies into the coefficients sized by new_user_data, no allocation.
+static void set_parameters(void *user_data, const realtype *params) {
+  UserData *data = (UserData*) user_data;
+  for (size_t k = 0; k < data->coeffs.size(); k++) data->coeffs[k] = params[k];
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  UserData *u_data = (UserData*) user_data;
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1] + u_data->coeffs[0];
+  dudata[1] = udata[0] + u_data->coeffs[1];
+
+  return(0);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
+  Jvdata[1] = vdata[0] + 0 * vdata[1];
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
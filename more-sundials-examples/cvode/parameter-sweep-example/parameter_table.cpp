@@ -0,0 +1,157 @@
+#include "parameter_table.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char table_magic[8] = {'S', 'W', 'E', 'E', 'P', 'T', 'A', 'B'};
+static const int32_t table_version = 1;
+
+static int read_binary_table(FILE *file, const char *path,
+                             ParameterTable *table);
+static int read_csv_table(FILE *file, const char *path,
+                          ParameterTable *table);
+
+
+int read_parameter_table(const char *path, ParameterTable *table) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return(-1);
+
+  char magic[8];
+  bool binary = (fread(magic, sizeof(magic), 1, file) == 1 &&
+                 memcmp(magic, table_magic, sizeof(magic)) == 0);
+  rewind(file);
+  int flag = binary ? read_binary_table(file, path, table) :
+      read_csv_table(file, path, table);
+  fclose(file);
+  return(flag);
+}
+
+int write_parameter_table(const char *path, const ParameterTable &table) {
+  size_t length = strlen(path);
+  bool binary = (length > 4 && strcmp(path + length - 4, ".bin") == 0);
+  int64_t columns = table.columns();
+
+  FILE *file = fopen(path, binary ? "wb" : "w");
+  if (file == NULL) return(-1);
+
+  bool ok = true;
+  if (binary) {
+    ParameterTableHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, table_magic, sizeof(header.magic));
+    header.version = table_version;
+    header.real_size = sizeof(realtype);
+    header.rows = table.rows;
+    header.columns = columns;
+    ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+    for (int64_t c = 0; ok && c < columns; c++) {
+      char name[SWEEP_NAME_SIZE];
+      memset(name, 0, sizeof(name));
+      strncpy(name, table.names[c].c_str(), sizeof(name) - 1);
+      ok = (fwrite(name, sizeof(name), 1, file) == 1);
+    }
+    size_t values = table.values.size();
+    if (ok && values > 0) {
+      ok = (fwrite(&table.values[0], sizeof(realtype), values, file) ==
+            values);
+    }
+  } else {
+    for (int64_t c = 0; c < columns; c++) {
+      fprintf(file, "%s%s", (c > 0) ? "," : "", table.names[c].c_str());
+    }
+    fprintf(file, "\n");
+    for (int64_t i = 0; i < table.rows; i++) {
+      const realtype *row = table.row(i);
+      for (int64_t c = 0; c < columns; c++) {
+        fprintf(file, "%s%.17g", (c > 0) ? "," : "", (double) row[c]);
+      }
+      fprintf(file, "\n");
+    }
+    ok = !ferror(file);
+  }
+
+  if (fclose(file) != 0) ok = false;
+  return(ok ? 0 : -1);
+}
+
+static int read_binary_table(FILE *file, const char *path,
+                             ParameterTable *table) {
+  ParameterTableHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      header.version != table_version ||
+      header.real_size != (int32_t) sizeof(realtype) || header.rows < 0 ||
+      header.columns < 1) {
+    fprintf(stderr, "\nTABLE_ERROR: %s is not a parameter table\n\n", path);
+    return(-1);
+  }
+
+  table->names.resize(header.columns);
+  for (int64_t c = 0; c < header.columns; c++) {
+    char name[SWEEP_NAME_SIZE];
+    if (fread(name, sizeof(name), 1, file) != 1) return(-1);
+    name[sizeof(name) - 1] = 0;
+    table->names[c] = name;
+  }
+  table->rows = header.rows;
+  table->values.resize(header.rows * header.columns);
+  size_t values = table->values.size();
+  if (values > 0 &&
+      fread(&table->values[0], sizeof(realtype), values, file) != values) {
+    fprintf(stderr, "\nTABLE_ERROR: %s is truncated\n\n", path);
+    return(-1);
+  }
+  return(0);
+}
+
+static int read_csv_table(FILE *file, const char *path,
+                          ParameterTable *table) {
+  std::string line;
+  std::vector < std::string > lines;
+  int c;
+  while ((c = fgetc(file)) != EOF) {
+    if (c == '\n') {
+      lines.push_back(line);
+      line.clear();
+    } else if (c != '\r') {
+      line += (char) c;
+    }
+  }
+  if (!line.empty()) lines.push_back(line);
+  if (lines.empty()) {
+    fprintf(stderr, "\nTABLE_ERROR: %s is empty\n\n", path);
+    return(-1);
+  }
+
+  // Column names.
+  table->names.clear();
+  size_t start = 0;
+  for (;;) {
+    size_t comma = lines[0].find(',', start);
+    table->names.push_back(lines[0].substr(start, comma - start));
+    if (comma == std::string::npos) break;
+    start = comma + 1;
+  }
+  int64_t columns = table->columns();
+
+  table->values.clear();
+  table->rows = 0;
+  for (size_t l = 1; l < lines.size(); l++) {
+    if (lines[l].empty()) continue;
+    const char *p = lines[l].c_str();
+    for (int64_t k = 0; k < columns; k++) {
+      char *end;
+      double value = strtod(p, &end);
+      if (end == p || (k < columns - 1 && *end != ',') ||
+          (k == columns - 1 && *end != 0)) {
+        fprintf(stderr, "\nTABLE_ERROR: %s line %ld is not %ld numbers\n\n",
+                path, (long) l + 1, (long) columns);
+        return(-1);
+      }
+      table->values.push_back(value);
+      p = end + 1;
+    }
+    table->rows++;
+  }
+  return(0);
+}
@@ -0,0 +1,50 @@
+/*
+A table of parameter sets, one row per solve, read from a CSV or a binary
+file.
+
+CSV: a first line with the column names, then one line of numbers per row,
+separated by commas.
+
+Binary (native byte order):
+  header:  char magic[8] = "SWEEPTAB", int32 version, int32 real_size,
+           int64 rows, int64 columns
+  names:   char name[32] per column
+  values:  realtype values[rows][columns]
+
+read_parameter_table tells the two apart by the magic. Both functions return
+0, or -1 when the file cannot be read or written.
+*/
+
+#ifndef PARAMETER_TABLE_H
+#define PARAMETER_TABLE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#define SWEEP_NAME_SIZE 32
+
+struct ParameterTableHeader {
+  char magic[8];
+  int32_t version;
+  int32_t real_size; // sizeof(realtype) of the writer
+  int64_t rows;
+  int64_t columns;
+};
+
+struct ParameterTable {
+  std::vector < std::string > names;
+  int64_t rows;
+  std::vector < realtype > values; // row major
+
+  int64_t columns() const { return (int64_t) names.size(); }
+  const realtype *row(int64_t i) const { return &values[i * names.size()]; }
+};
+
+int read_parameter_table(const char *path, ParameterTable *table);
+
+// Writes a binary table if path ends with ".bin", CSV otherwise.
+int write_parameter_table(const char *path, const ParameterTable &table);
+
+#endif
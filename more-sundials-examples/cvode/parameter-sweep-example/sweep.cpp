@@ -0,0 +1,374 @@
+#include "sweep.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+#include "solver_stats.h"  // stats_now
+
+static const char column_magic[8] = {'S', 'W', 'E', 'E', 'P', 'C', 'O', 'L'};
+static const int32_t column_version = 1;
+
+// State shared by the threads of one sweep.
+struct SweepState {
+  const ParameterTable *table;
+  const SweepModel *model;
+  const SweepOptions *options;
+  int64_t columns; // of the output
+  int64_t num_chunks;
+  std::vector < char > done; // 1 for every finished chunk
+  std::string checkpoint_path;
+  std::atomic < int64_t > next_chunk;
+  std::atomic < int64_t > rows_started; // by this run, for stop_after_rows
+
+  std::mutex lock; // guards everything below
+  FILE *file;
+  long int data_offset; // of the first value in the file
+  int64_t since_checkpoint; // chunks finished since the last checkpoint
+  int64_t solved_rows, failed_rows;
+  bool failed;
+};
+
+static void sweep_thread(SweepState *s);
+static int write_chunk(SweepState *s, int64_t chunk, int64_t n,
+                       const std::vector < realtype > &buffer);
+static int write_checkpoint(SweepState *s);
+static int read_checkpoint(SweepState *s);
+static int open_output(SweepState *s, const char *path, bool resume);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int run_sweep(const ParameterTable &table, const SweepModel &model,
+              const SweepOptions &options, const char *output_path,
+              SweepSummary *summary) {
+  if (model.N < 1 || (sunindextype) model.y0.size() != model.N) return(-1);
+  if (options.num_threads < 1 || options.chunk_rows < 1) return(-1);
+  double start = stats_now();
+
+  SweepState s;
+  s.table = &table;
+  s.model = &model;
+  s.options = &options;
+  s.columns = 2 + model.N;
+  s.num_chunks = (table.rows + options.chunk_rows - 1) / options.chunk_rows;
+  s.done.assign(s.num_chunks, 0);
+  s.checkpoint_path = std::string(output_path) + ".ckpt";
+  s.next_chunk = 0;
+  s.rows_started = 0;
+  s.file = NULL;
+  s.since_checkpoint = 0;
+  s.solved_rows = 0;
+  s.failed_rows = 0;
+  s.failed = false;
+
+  // A checkpoint of this sweep means the output file is already there.
+  int resume = read_checkpoint(&s);
+  if (resume < 0) return(-1);
+  if (open_output(&s, output_path, resume == 1) != 0) return(-1);
+
+  int64_t resumed_rows = 0;
+  for (int64_t k = 0; k < s.num_chunks; k++) {
+    if (!s.done[k]) continue;
+    int64_t first = k * options.chunk_rows;
+    resumed_rows += SUNMIN(options.chunk_rows, table.rows - first);
+  }
+
+  std::vector < std::thread > threads;
+  for (int p = 0; p < options.num_threads; p++) {
+    threads.push_back(std::thread(sweep_thread, &s));
+  }
+  for (size_t p = 0; p < threads.size(); p++) threads[p].join();
+
+  int flag = write_checkpoint(&s);
+  if (fclose(s.file) != 0) flag = -1;
+
+  summary->rows = table.rows;
+  summary->resumed_rows = resumed_rows;
+  summary->solved_rows = s.solved_rows;
+  summary->failed_rows = s.failed_rows;
+  summary->remaining_rows = table.rows - resumed_rows - s.solved_rows;
+  summary->seconds = stats_now() - start;
+  return((s.failed || flag != 0) ? -1 : 0);
+}
+
+int read_sweep_output(const char *path, std::vector < std::string > &names,
+                      int64_t &rows, std::vector < realtype > &values) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return(-1);
+
+  SweepColumnHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, column_magic, sizeof(header.magic)) != 0 ||
+      header.version != column_version ||
+      header.real_size != (int32_t) sizeof(realtype) || header.rows < 0 ||
+      header.columns < 1) {
+    fprintf(stderr, "\nSWEEP_ERROR: %s is not a sweep output file\n\n", path);
+    fclose(file);
+    return(-1);
+  }
+
+  bool ok = true;
+  names.resize(header.columns);
+  for (int64_t c = 0; ok && c < header.columns; c++) {
+    char name[SWEEP_NAME_SIZE];
+    ok = (fread(name, sizeof(name), 1, file) == 1);
+    name[sizeof(name) - 1] = 0;
+    names[c] = name;
+  }
+  rows = header.rows;
+  values.resize(header.rows * header.columns);
+  size_t count = values.size();
+  if (ok && count > 0) {
+    ok = (fread(&values[0], sizeof(realtype), count, file) == count);
+  }
+  fclose(file);
+  return(ok ? 0 : -1);
+}
+
+// Body of every thread: creates its solver objects once and solves chunks
+// until none are left.
+static void sweep_thread(SweepState *s) {
+  int flag;
+  const SweepModel &model = *s->model;
+  const ParameterTable &table = *s->table;
+  int64_t chunk_rows = s->options->chunk_rows;
+  int64_t stop_after = s->options->stop_after_rows;
+  sunindextype N = model.N;
+  bool ok = false;
+
+  void *user_data = model.new_user_data(table.columns());
+  std::vector < realtype > buffer(s->columns * chunk_rows);
+  void *cvode_mem = NULL;
+  SUNLinearSolver LS = NULL;
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) goto cleanup;
+  for (sunindextype j = 0; j < N; j++) NV_DATA_S(y)[j] = model.y0[j];
+
+  cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) goto cleanup;
+  flag = CVodeInit(cvode_mem, model.f, model.t0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) goto cleanup;
+  flag = CVodeSStolerances(cvode_mem, model.reltol, model.abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) goto cleanup;
+  flag = CVodeSetUserData(cvode_mem, user_data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) goto cleanup;
+  LS = SUNSPGMR(y, 0, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) goto cleanup;
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) goto cleanup;
+  if (model.jtv != NULL) {
+    flag = CVSpilsSetJacTimes(cvode_mem, NULL, model.jtv);
+    if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) goto cleanup;
+  }
+
+  for (;;) {
+    int64_t chunk = s->next_chunk++;
+    if (chunk >= s->num_chunks) break;
+    if (s->done[chunk]) continue;
+    int64_t first = chunk * chunk_rows;
+    int64_t n = SUNMIN(chunk_rows, table.rows - first);
+    if (stop_after > 0 && s->rows_started.fetch_add(n) >= stop_after) break;
+
+    realtype *ydata = NV_DATA_S(y);
+    for (int64_t r = 0; r < n; r++) {
+      model.set_parameters(user_data, table.row(first + r));
+      for (sunindextype j = 0; j < N; j++) ydata[j] = model.y0[j];
+      realtype t = model.t0;
+      flag = CVodeReInit(cvode_mem, model.t0, y);
+      if (flag >= 0) flag = CVode(cvode_mem, model.tout, y, &t, CV_NORMAL);
+      long int steps = 0;
+      CVodeGetNumSteps(cvode_mem, &steps);
+
+      buffer[r] = flag;
+      buffer[chunk_rows + r] = steps;
+      for (sunindextype j = 0; j < N; j++) {
+        buffer[(2 + j) * chunk_rows + r] = ydata[j];
+      }
+    }
+    if (write_chunk(s, chunk, n, buffer) != 0) goto cleanup;
+  }
+  ok = true;
+
+cleanup:
+  if (!ok) {
+    std::lock_guard < std::mutex > guard(s->lock);
+    s->failed = true;
+  }
+  if (y != NULL) N_VDestroy(y);
+  if (cvode_mem != NULL) CVodeFree(&cvode_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+  model.delete_user_data(user_data);
+}
+
+// Writes the chunk's part of every column and marks it done.
+static int write_chunk(SweepState *s, int64_t chunk, int64_t n,
+                       const std::vector < realtype > &buffer) {
+  int64_t chunk_rows = s->options->chunk_rows;
+  int64_t first = chunk * chunk_rows;
+  std::lock_guard < std::mutex > guard(s->lock);
+
+  for (int64_t c = 0; c < s->columns; c++) {
+    long int offset = s->data_offset +
+        (long int) ((c * s->table->rows + first) * sizeof(realtype));
+    if (fseek(s->file, offset, SEEK_SET) != 0 ||
+        fwrite(&buffer[c * chunk_rows], sizeof(realtype), n, s->file) !=
+        (size_t) n) {
+      return(-1);
+    }
+  }
+  for (int64_t r = 0; r < n; r++) {
+    if (buffer[r] < 0) s->failed_rows++;
+  }
+  s->solved_rows += n;
+  s->done[chunk] = 1;
+  s->since_checkpoint++;
+
+  if (s->since_checkpoint >= s->options->checkpoint_chunks) {
+    return(write_checkpoint(s));
+  }
+  return(0);
+}
+
+// Called with s->lock held or after the threads finished. The results have
+// to be on disk before the checkpoint says they are.
+static int write_checkpoint(SweepState *s) {
+  if (fflush(s->file) != 0 || fsync(fileno(s->file)) != 0) return(-1);
+
+  std::string tmp = s->checkpoint_path + ".tmp";
+  FILE *file = fopen(tmp.c_str(), "w");
+  if (file == NULL) return(-1);
+  fprintf(file, "SWEEPCKPT %d %ld %ld %ld\n", (int) column_version,
+          (long) s->table->rows, (long) s->options->chunk_rows,
+          (long) s->columns);
+  for (int64_t k = 0; k < s->num_chunks; k++) {
+    fputc(s->done[k] ? '1' : '0', file);
+  }
+  fputc('\n', file);
+  bool ok = (fflush(file) == 0 && fsync(fileno(file)) == 0);
+  if (fclose(file) != 0) ok = false;
+  if (!ok || rename(tmp.c_str(), s->checkpoint_path.c_str()) != 0) return(-1);
+
+  s->since_checkpoint = 0;
+  return(0);
+}
+
+// Returns 1 with s->done filled from the checkpoint, 0 if there is none and
+// -1 if it belongs to a different sweep.
+static int read_checkpoint(SweepState *s) {
+  FILE *file = fopen(s->checkpoint_path.c_str(), "r");
+  if (file == NULL) return(0);
+
+  int version;
+  long rows, chunk_rows, columns;
+  bool ok = (fscanf(file, "SWEEPCKPT %d %ld %ld %ld ", &version, &rows,
+                    &chunk_rows, &columns) == 4 &&
+             version == column_version && rows == s->table->rows &&
+             chunk_rows == s->options->chunk_rows &&
+             columns == s->columns);
+  for (int64_t k = 0; ok && k < s->num_chunks; k++) {
+    int c = fgetc(file);
+    ok = (c == '0' || c == '1');
+    s->done[k] = (c == '1');
+  }
+  fclose(file);
+
+  if (!ok) {
+    fprintf(stderr, "\nSWEEP_ERROR: %s belongs to a different sweep\n\n",
+            s->checkpoint_path.c_str());
+    return(-1);
+  }
+  return(1);
+}
+
+// Opens the output of a resumed sweep, or creates it at its full size.
+static int open_output(SweepState *s, const char *path, bool resume) {
+  int64_t rows = s->table->rows;
+  s->data_offset = sizeof(SweepColumnHeader) + s->columns * SWEEP_NAME_SIZE;
+
+  if (resume) {
+    s->file = fopen(path, "r+b");
+    SweepColumnHeader header;
+    if (s->file == NULL || fread(&header, sizeof(header), 1, s->file) != 1 ||
+        memcmp(header.magic, column_magic, sizeof(header.magic)) != 0 ||
+        header.rows != rows || header.columns != s->columns) {
+      fprintf(stderr, "\nSWEEP_ERROR: cannot resume %s\n\n", path);
+      if (s->file != NULL) fclose(s->file);
+      return(-1);
+    }
+    return(0);
+  }
+
+  s->file = fopen(path, "w+b");
+  if (s->file == NULL) return(-1);
+
+  SweepColumnHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, column_magic, sizeof(header.magic));
+  header.version = column_version;
+  header.real_size = sizeof(realtype);
+  header.rows = rows;
+  header.columns = s->columns;
+  bool ok = (fwrite(&header, sizeof(header), 1, s->file) == 1);
+  for (int64_t c = 0; ok && c < s->columns; c++) {
+    char name[SWEEP_NAME_SIZE];
+    memset(name, 0, sizeof(name));
+    if (c == 0) strcpy(name, "flag");
+    else if (c == 1) strcpy(name, "steps");
+    else snprintf(name, sizeof(name), "y_%ld", (long) (c - 2));
+    ok = (fwrite(name, sizeof(name), 1, s->file) == 1);
+  }
+
+  // The last byte gives the file its full size, the chunks are written
+  // into it in any order.
+  long int size = s->data_offset +
+      (long int) (s->columns * rows * sizeof(realtype));
+  if (ok && rows > 0) {
+    ok = (fseek(s->file, size - 1, SEEK_SET) == 0 && fputc(0, s->file) == 0);
+  }
+  if (!ok) {
+    fclose(s->file);
+    return(-1);
+  }
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,93 @@
+/*
+A parameter sweep: every row of a ParameterTable is solved as an
+independent initial value problem, and the solutions at tout go to a
+columnar file.
+
+The rows are split into chunks of chunk_rows rows that the threads take one
+after the other. Each thread creates its N_Vector, CVODE memory, SPGMR
+linear solver, user data (with the model's new_user_data) and a result
+buffer for one chunk once. For every row it only fills the user data with
+set_parameters, copies y0 and calls CVodeReInit and CVode, so the solve of a
+row does not allocate.
+
+Columnar file (native byte order):
+  header:  char magic[8] = "SWEEPCOL", int32 version, int32 real_size,
+           int64 rows, int64 columns
+  names:   char name[32] per column
+  values:  realtype values[columns][rows]
+The columns are flag (return flag of CVode), steps and y_0 .. y_{N-1}. The
+file has its full size from the start, a finished chunk writes its part of
+every column in place.
+
+Checkpoints: every checkpoint_chunks finished chunks the file is flushed to
+disk and the list of finished chunks is written to output_path + ".ckpt"
+(through a temporary file and rename, so it is never half written). A sweep
+started again with the same table, output path and chunk_rows skips the
+chunks in the checkpoint. A crash loses at most the chunks finished after
+the last checkpoint.
+
+run_sweep and read_sweep_output return 0, or -1 on failure.
+*/
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "parameter_table.h"
+
+struct SweepColumnHeader {
+  char magic[8];
+  int32_t version;
+  int32_t real_size; // sizeof(realtype) of the writer
+  int64_t rows;
+  int64_t columns;
+};
+
+// The model solved for every row. jtv may be NULL to use CVODE's difference
+// quotient.
+struct SweepModel {
+  sunindextype N;
+  CVRhsFn f;
+  CVSpilsJacTimesVecFn jtv;
+  std::vector < realtype > y0;
+  realtype t0, tout;
+  realtype reltol, abstol;
+  // Called once per thread, with the number of parameters of a row.
+  void *(*new_user_data)(int64_t num_params);
+  void (*delete_user_data)(void *user_data);
+  // Called for every row, must not allocate.
+  void (*set_parameters)(void *user_data, const realtype *params);
+};
+
+struct SweepOptions {
+  int num_threads;
+  int64_t chunk_rows;
+  int64_t checkpoint_chunks; // chunks between checkpoints
+  int64_t stop_after_rows; // stop after this many rows of this run, 0 for all
+};
+
+struct SweepSummary {
+  int64_t rows; // rows of the table
+  int64_t resumed_rows; // rows already done by an earlier run
+  int64_t solved_rows; // rows solved by this run
+  int64_t failed_rows; // rows of this run with a negative flag
+  int64_t remaining_rows; // rows left for another run
+  double seconds;
+};
+
+int run_sweep(const ParameterTable &table, const SweepModel &model,
+              const SweepOptions &options, const char *output_path,
+              SweepSummary *summary);
+
+// Reads a whole columnar file, column c of row i is
+// values[c * rows + i].
+int read_sweep_output(const char *path, std::vector < std::string > &names,
+                      int64_t &rows, std::vector < realtype > &values);
+
+#endif
@@ -0,0 +1,246 @@
+#include "preconditioner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sundials/sundials_dense.h>  // denseGETRF, denseGETRS
+#include <sundials/sundials_band.h>  // bandGBTRF, bandGBTRS
+
+
+Preconditioner::Preconditioner()
+    : type_(PRECOND_ILU0), N_(0), nnz_(0), width_(0), jac_(NULL),
+      have_jac_(false), mu_(0), ml_(0), smu_(0), have_pattern_(false),
+      num_jac_evals_(0), num_factorizations_(0) {}
+
+int Preconditioner::create(PrecondType type, sunindextype N, sunindextype nnz,
+                           PrecJacFn jac, sunindextype width) {
+  if (N < 1 || nnz < 0 || jac == NULL) return(-1);
+  if (type != PRECOND_ILU0 && width < 1) return(-1);
+
+  type_ = type;
+  N_ = N;
+  nnz_ = nnz;
+  width_ = std::min(width, N);
+  jac_ = jac;
+  have_jac_ = false;
+  have_pattern_ = false;
+  num_jac_evals_ = 0;
+  num_factorizations_ = 0;
+
+  colptr_.assign(N + 1, 0);
+  rowind_.assign(nnz, 0);
+  jvals_.assign(nnz, 0);
+  pivots_.assign(N, 0);
+
+  if (type == PRECOND_BLOCK_JACOBI) {
+    // All blocks but the last have width_*width_ entries.
+    factors_.assign(N * width_, 0);
+    cols_.resize(N);
+    for (sunindextype start = 0; start < N; start += width_) {
+      sunindextype m = std::min(width_, N - start);
+      for (sunindextype j = start; j < start + m; j++) {
+        cols_[j] = &factors_[start * width_ + (j - start) * m];
+      }
+    }
+  } else if (type == PRECOND_BAND) {
+    // The LU factors need room for ml extra upper diagonals.
+    mu_ = ml_ = std::min(width_, N - 1);
+    smu_ = std::min(N - 1, mu_ + ml_);
+    sunindextype ldim = smu_ + ml_ + 1;
+    factors_.assign(N * ldim, 0);
+    cols_.resize(N);
+    for (sunindextype j = 0; j < N; j++) cols_[j] = &factors_[j * ldim];
+  }
+
+  return(0);
+}
+
+const char *Preconditioner::name() const {
+  switch (type_) {
+    case PRECOND_BLOCK_JACOBI: return "block-jacobi";
+    case PRECOND_BAND: return "band";
+    default: return "ilu0";
+  }
+}
+
+int Preconditioner::setup(realtype t, N_Vector y, N_Vector fy,
+                          booleantype jok, booleantype *jcurPtr,
+                          realtype gamma, void *user_data) {
+  // A new jacobian only when CVODE asks for one.
+  if (!jok || !have_jac_) {
+    int flag = jac_(t, y, fy, &colptr_[0], &rowind_[0], &jvals_[0], user_data);
+    if (flag != 0) return(flag);
+    num_jac_evals_++;
+    have_jac_ = true;
+    *jcurPtr = SUNTRUE;
+  } else {
+    *jcurPtr = SUNFALSE;
+  }
+
+  // Refactor I - gamma*J, gamma changes between calls.
+  num_factorizations_++;
+  switch (type_) {
+    case PRECOND_BLOCK_JACOBI: return factor_block_jacobi(gamma);
+    case PRECOND_BAND: return factor_band(gamma);
+    default:
+      if (!have_pattern_) build_ilu0_pattern();
+      return factor_ilu0(gamma);
+  }
+}
+
+int Preconditioner::solve(N_Vector r, N_Vector z) {
+  const realtype *rdata = N_VGetArrayPointer(r);
+  realtype *zdata = N_VGetArrayPointer(z);
+  if (zdata != rdata) memcpy(zdata, rdata, N_ * sizeof(realtype));
+
+  if (type_ == PRECOND_BLOCK_JACOBI) {
+    for (sunindextype start = 0; start < N_; start += width_) {
+      denseGETRS(&cols_[start], std::min(width_, N_ - start), &pivots_[start],
+                 zdata + start);
+    }
+    return(0);
+  }
+
+  if (type_ == PRECOND_BAND) {
+    bandGBTRS(&cols_[0], N_, smu_, ml_, &pivots_[0], zdata);
+    return(0);
+  }
+
+  // ILU(0): unit lower triangle forward, upper triangle backward.
+  const sunindextype *rowptr = &rowptr_[0];
+  const sunindextype *colind = &colind_[0];
+  const sunindextype *diag = &diag_[0];
+  const realtype *lu = &factors_[0];
+  for (sunindextype i = 0; i < N_; i++) {
+    realtype sum = zdata[i];
+    for (sunindextype p = rowptr[i]; p < diag[i]; p++) {
+      sum -= lu[p] * zdata[colind[p]];
+    }
+    zdata[i] = sum;
+  }
+  for (sunindextype i = N_ - 1; i >= 0; i--) {
+    realtype sum = zdata[i];
+    for (sunindextype p = diag[i] + 1; p < rowptr[i + 1]; p++) {
+      sum -= lu[p] * zdata[colind[p]];
+    }
+    zdata[i] = sum / lu[diag[i]];
+  }
+  return(0);
+}
+
+int Preconditioner::factor_block_jacobi(realtype gamma) {
+  std::fill(factors_.begin(), factors_.end(), 0);
+  for (sunindextype j = 0; j < N_; j++) {
+    sunindextype start = (j / width_) * width_;
+    sunindextype end = std::min(start + width_, N_);
+    realtype *col = cols_[j];
+    col[j - start] = 1;
+    for (sunindextype k = colptr_[j]; k < colptr_[j + 1]; k++) {
+      sunindextype i = rowind_[k];
+      if (i >= start && i < end) col[i - start] -= gamma * jvals_[k];
+    }
+  }
+
+  for (sunindextype start = 0; start < N_; start += width_) {
+    sunindextype m = std::min(width_, N_ - start);
+    if (denseGETRF(&cols_[start], m, m, &pivots_[start]) != 0) return(1);
+  }
+  return(0);
+}
+
+int Preconditioner::factor_band(realtype gamma) {
+  std::fill(factors_.begin(), factors_.end(), 0);
+  for (sunindextype j = 0; j < N_; j++) {
+    realtype *col = cols_[j] + smu_; // col[i - j] is entry (i, j)
+    col[0] = 1;
+    for (sunindextype k = colptr_[j]; k < colptr_[j + 1]; k++) {
+      sunindextype i = rowind_[k];
+      if (i >= j - mu_ && i <= j + ml_) {
+        col[i - j] -= gamma * jvals_[k];
+      }
+    }
+  }
+
+  if (bandGBTRF(&cols_[0], N_, mu_, ml_, smu_, &pivots_[0]) != 0) return(1);
+  return(0);
+}
+
+// Builds the row-wise pattern of I - gamma*J from the CSC pattern of the
+// first jacobian. Going through the columns in order leaves the column
+// indices of every row sorted, which the factorization relies on.
+void Preconditioner::build_ilu0_pattern() {
+  sunindextype nnz = colptr_[N_];
+
+  // Rows without a diagonal entry in J get one.
+  std::vector < bool > has_diag(N_, false);
+  std::vector < sunindextype > count(N_, 0);
+  for (sunindextype j = 0; j < N_; j++) {
+    for (sunindextype k = colptr_[j]; k < colptr_[j + 1]; k++) {
+      count[rowind_[k]]++;
+      if (rowind_[k] == j) has_diag[j] = true;
+    }
+  }
+  for (sunindextype i = 0; i < N_; i++) {
+    if (!has_diag[i]) count[i]++;
+  }
+
+  rowptr_.assign(N_ + 1, 0);
+  for (sunindextype i = 0; i < N_; i++) rowptr_[i + 1] = rowptr_[i] + count[i];
+  colind_.assign(rowptr_[N_], 0);
+  csc_to_csr_.assign(nnz, 0);
+  diag_.assign(N_, 0);
+
+  std::vector < sunindextype > next(rowptr_.begin(), rowptr_.end() - 1);
+  for (sunindextype j = 0; j < N_; j++) {
+    for (sunindextype k = colptr_[j]; k < colptr_[j + 1]; k++) {
+      sunindextype i = rowind_[k];
+      if (i == j) diag_[j] = next[i];
+      csc_to_csr_[k] = next[i];
+      colind_[next[i]++] = j;
+    }
+    if (!has_diag[j]) {
+      diag_[j] = next[j];
+      colind_[next[j]++] = j;
+    }
+  }
+
+  factors_.assign(rowptr_[N_], 0);
+  work_.assign(N_, -1);
+  have_pattern_ = true;
+}
+
+// ILU(0) in the IKJ form: row i is eliminated with the rows above it, fill-in
+// outside the pattern is dropped.
+int Preconditioner::factor_ilu0(realtype gamma) {
+  realtype *lu = &factors_[0];
+  const sunindextype *rowptr = &rowptr_[0];
+  const sunindextype *colind = &colind_[0];
+  const sunindextype *diag = &diag_[0];
+  sunindextype *position = &work_[0]; // position of column j in row i or -1
+
+  std::fill(factors_.begin(), factors_.end(), 0);
+  for (sunindextype i = 0; i < N_; i++) lu[diag[i]] = 1;
+  for (sunindextype k = 0; k < colptr_[N_]; k++) {
+    lu[csc_to_csr_[k]] -= gamma * jvals_[k];
+  }
+
+  for (sunindextype i = 0; i < N_; i++) {
+    for (sunindextype p = rowptr[i]; p < rowptr[i + 1]; p++) {
+      position[colind[p]] = p;
+    }
+
+    for (sunindextype p = rowptr[i]; p < diag[i]; p++) {
+      sunindextype k = colind[p];
+      lu[p] /= lu[diag[k]];
+      for (sunindextype q = diag[k] + 1; q < rowptr[k + 1]; q++) {
+        sunindextype pos = position[colind[q]];
+        if (pos >= 0) lu[pos] -= lu[p] * lu[q];
+      }
+    }
+
+    for (sunindextype p = rowptr[i]; p < rowptr[i + 1]; p++) {
+      position[colind[p]] = -1;
+    }
+    if (lu[diag[i]] == 0) return(1);
+  }
+  return(0);
+}
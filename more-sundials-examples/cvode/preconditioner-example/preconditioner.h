@@ -0,0 +1,113 @@
+/*
+Preconditioners for the matrix-free SPGMR path, built from a sparse
+approximation of the jacobian J of the right hand side.
+
+CVODE's Newton iteration solves systems with M = I - gamma*J. A
+Preconditioner approximates M and solves with the approximation:
+
+  PRECOND_BLOCK_JACOBI  the diagonal blocks of M of size width (the last one
+                        may be smaller), each LU factored with denseGETRF.
+  PRECOND_BAND          the entries of M with |i - j| <= width, LU factored
+                        with bandGBTRF.
+  PRECOND_ILU0          incomplete LU factorization of M with the sparsity
+                        pattern of J (plus the diagonal), no fill-in.
+
+The jacobian is given by a PrecJacFn in compressed sparse column (CSC) form.
+Entries outside the blocks or the band are dropped. setup() only evaluates
+the jacobian when CVODE says the saved one is no longer good enough
+(jok == SUNFALSE), otherwise it reuses it and only refactors M for the new
+gamma.
+
+setup() and solve() are meant to be called from the CVSpilsPrecSetupFn and
+CVSpilsPrecSolveFn of the problem, which find the Preconditioner in their
+user data:
+
+  static int psetup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+                    booleantype *jcurPtr, realtype gamma, void *user_data) {
+    UserData *data = (UserData*) user_data;
+    return data->prec->setup(t, y, fy, jok, jcurPtr, gamma, user_data);
+  }
+
+setup() follows the SUNDIALS convention for preconditioner setup: 0 on
+success, 1 (recoverable, CVODE retries with a smaller step) for a zero pivot,
+or the value of a failing PrecJacFn. The other functions returning int return
+0 on success or -1 on failure.
+*/
+
+#ifndef PRECONDITIONER_H
+#define PRECONDITIONER_H
+
+#include <vector>
+#include <sundials/sundials_nvector.h>  // N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+enum PrecondType { PRECOND_BLOCK_JACOBI, PRECOND_BAND, PRECOND_ILU0 };
+
+// Fills the jacobian approximation at (t, y) in CSC form: column j has the
+// rows rowind[colptr[j]] .. rowind[colptr[j+1]-1] with values vals[...]. At
+// most nnz entries, and the pattern must not change between calls. Returns 0
+// on success, a positive value for a recoverable and a negative value for an
+// unrecoverable failure.
+typedef int (*PrecJacFn)(realtype t, N_Vector y, N_Vector fy,
+                         sunindextype *colptr, sunindextype *rowind,
+                         realtype *vals, void *user_data);
+
+class Preconditioner {
+ public:
+  Preconditioner();
+
+  // N unknowns, a jacobian with up to nnz entries. width is the block size
+  // for PRECOND_BLOCK_JACOBI and the half bandwidth for PRECOND_BAND, it is
+  // not used by PRECOND_ILU0.
+  int create(PrecondType type, sunindextype N, sunindextype nnz,
+             PrecJacFn jac, sunindextype width);
+
+  // Body of the CVSpilsPrecSetupFn: approximates and factors I - gamma*J.
+  int setup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+            booleantype *jcurPtr, realtype gamma, void *user_data);
+
+  // Body of the CVSpilsPrecSolveFn: z = P^-1 r with the factors of the last
+  // setup(). r and z may be the same vector.
+  int solve(N_Vector r, N_Vector z);
+
+  PrecondType type() const { return type_; }
+  const char *name() const;
+  long int num_jac_evals() const { return num_jac_evals_; }
+  long int num_factorizations() const { return num_factorizations_; }
+
+ private:
+  // The column pointers point into the storage of this object.
+  Preconditioner(const Preconditioner&);
+  Preconditioner& operator=(const Preconditioner&);
+
+  int factor_block_jacobi(realtype gamma);
+  int factor_band(realtype gamma);
+  void build_ilu0_pattern();
+  int factor_ilu0(realtype gamma);
+
+  PrecondType type_;
+  sunindextype N_, nnz_, width_;
+  PrecJacFn jac_;
+  bool have_jac_;
+
+  // Saved jacobian in CSC form.
+  std::vector < sunindextype > colptr_, rowind_;
+  std::vector < realtype > jvals_;
+
+  // Block Jacobi and band: column major factors, a pointer to every column
+  // as denseGETRF/bandGBTRF expect, and the pivots.
+  std::vector < realtype > factors_;
+  std::vector < realtype* > cols_;
+  std::vector < sunindextype > pivots_;
+  sunindextype mu_, ml_, smu_;
+
+  // ILU(0): the factors in compressed sparse row form, the position of every
+  // CSC entry of J in it and the position of the diagonal of every row.
+  std::vector < sunindextype > rowptr_, colind_, csc_to_csr_, diag_;
+  std::vector < sunindextype > work_;
+  bool have_pattern_;
+
+  long int num_jac_evals_, num_factorizations_;
+};
+
+#endif
@@ -0,0 +1,331 @@
+/*
+Benchmark of the preconditioners of preconditioner.h on a stiff 2D
+reaction-diffusion problem, the Brusselator
+
+  u_t = d*lap(u) + a - (b + 1)*u + u^2*v
+  v_t = d*lap(v) + b*u - u^2*v
+
+on nx*nx cells of the unit square with zero flux at the boundary. u and v of a
+cell are next to each other in the N_Vector, so N = 2*nx*nx and the
+jacobian has a bandwidth of 2*nx.
+
+The problem is solved with SPGMR and the analytic jacobian-times-vector
+function, first without a preconditioner like the simple example and then
+with each of
+  block-jacobi  blocks of block_size unknowns (default 2*nx, one grid row)
+  band          half bandwidth band_width (default 2, the x neighbours)
+  ilu0          ILU(0) with the full pattern of the jacobian
+For every run the time, steps, linear iterations, preconditioner setups,
+jacobian evaluations and the largest difference to the unpreconditioned
+solution are printed.
+
+Usage: ./executable [nx] [end_time] [block_size] [band_width]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "preconditioner.h"
+#include "cvode_stats.h"  // SolveRecord, collect_cvode_stats
+
+// Parameters of the Brusselator.
+#define BRUSS_A 1.0
+#define BRUSS_B 3.4
+#define BRUSS_D 0.1
+
+struct UserData {
+  sunindextype nx; // cells per direction
+  realtype diff; // d/h^2
+  Preconditioner *prec; // NULL without preconditioner
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int jac(realtype t, N_Vector y, N_Vector fy, sunindextype *colptr,
+               sunindextype *rowind, realtype *vals, void *user_data);
+static int psetup(realtype t, N_Vector u, N_Vector fu, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data);
+static int psolve(realtype t, N_Vector u, N_Vector fu, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data);
+static int run(UserData *data, realtype end_time, realtype *y_out,
+               SolveRecord *stats);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  sunindextype nx = (argc > 1) ? std::atol(argv[1]) : 64;
+  realtype end_time = (argc > 2) ? std::atof(argv[2]) : 10.0;
+  sunindextype block_size = (argc > 3) ? std::atol(argv[3]) : 2 * nx;
+  sunindextype band_width = (argc > 4) ? std::atol(argv[4]) : 2;
+  if (nx < 2) nx = 2;
+  sunindextype N = 2 * nx * nx;
+
+  UserData data;
+  data.nx = nx;
+  data.diff = BRUSS_D * nx * nx;
+  data.prec = NULL;
+
+  // Reference run without a preconditioner.
+  std::vector < realtype > y_none(N), y(N);
+  SolveRecord stats;
+  if (run(&data, end_time, &y_none[0], &stats) != 0) return(1);
+
+  printf("%-13s %9s %7s %9s %9s %9s %9s %10s\n", "preconditioner", "seconds",
+         "steps", "lin_iters", "lin_fails", "setups", "jac_evals", "max_diff");
+  printf("%-13s %9.3f %7ld %9ld %9ld %9s %9s %10s\n", "none", stats.seconds,
+         stats.steps, stats.lin_iters, stats.lin_conv_fails, "-", "-", "-");
+
+  const PrecondType types[3] = {PRECOND_BLOCK_JACOBI, PRECOND_BAND,
+                                PRECOND_ILU0};
+  const sunindextype widths[3] = {block_size, band_width, 0};
+  for (int k = 0; k < 3; k++) {
+    // At most 4 neighbours and the other component per column.
+    Preconditioner prec;
+    if (prec.create(types[k], N, 6 * N, jac, widths[k]) != 0) {
+      fprintf(stderr, "\nERROR: Preconditioner::create() failed\n\n");
+      return(1);
+    }
+    data.prec = &prec;
+    if (run(&data, end_time, &y[0], &stats) != 0) return(1);
+
+    realtype max_diff = 0;
+    for (sunindextype i = 0; i < N; i++) {
+      max_diff = SUNMAX(max_diff, SUNRabs(y[i] - y_none[i]));
+    }
+    printf("%-13s %9.3f %7ld %9ld %9ld %9ld %9ld %10.2e\n", prec.name(),
+           stats.seconds, stats.steps, stats.lin_iters, stats.lin_conv_fails,
+           stats.prec_evals, prec.num_jac_evals(), (double) max_diff);
+  }
+
+  return(0);
+}
+
+// One solve from the initial values to end_time, preconditioned with
+// data->prec if it is set.
+static int run(UserData *data, realtype end_time, realtype *y_out,
+               SolveRecord *stats) {
+  int flag;
+  realtype reltol = 1e-6;
+  realtype abstol = 1e-9;
+  sunindextype nx = data->nx;
+  sunindextype N = 2 * nx * nx;
+
+  double start = stats_now();
+
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  realtype *ydata = N_VGetArrayPointer(y);
+  for (sunindextype j = 0; j < nx; j++) {
+    for (sunindextype i = 0; i < nx; i++) {
+      realtype x = (i + 0.5) / nx;
+      realtype z = (j + 0.5) / nx;
+      sunindextype c = 2 * (j * nx + i);
+      ydata[c] = BRUSS_A + 0.5 * cos(M_PI * x) * cos(M_PI * z);
+      ydata[c + 1] = BRUSS_B / BRUSS_A;
+    }
+  }
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  flag = CVodeSetMaxNumSteps(cvode_mem, 100000);
+  if (check_flag(&flag, "CVodeSetMaxNumSteps", 1)) return(1);
+
+  // Left preconditioning when there is a preconditioner.
+  int prectype = (data->prec != NULL) ? PREC_LEFT : PREC_NONE;
+  SUNLinearSolver LS = SUNSPGMR(y, prectype, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+  if (data->prec != NULL) {
+    flag = CVSpilsSetPreconditioner(cvode_mem, psetup, psolve);
+    if (check_flag(&flag, "CVSpilsSetPreconditioner", 1)) return(1);
+  }
+
+  realtype t;
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(1);
+  stats->reset();
+  stats->seconds = stats_now() - start;
+  stats->flag = flag;
+  collect_cvode_stats(cvode_mem, LS, stats);
+
+  for (sunindextype i = 0; i < N; i++) y_out[i] = ydata[i];
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  return(0);
+}
+
+// Right hand side. Missing neighbours at the boundary count as the cell
+// itself (zero flux).
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype nx = data->nx;
+  realtype diff = data->diff;
+  const realtype *y = N_VGetArrayPointer(u);
+  realtype *dy = N_VGetArrayPointer(u_dot);
+
+  for (sunindextype j = 0; j < nx; j++) {
+    for (sunindextype i = 0; i < nx; i++) {
+      sunindextype c = 2 * (j * nx + i);
+      sunindextype left = (i > 0) ? c - 2 : c;
+      sunindextype right = (i < nx - 1) ? c + 2 : c;
+      sunindextype down = (j > 0) ? c - 2 * nx : c;
+      sunindextype up = (j < nx - 1) ? c + 2 * nx : c;
+      for (int s = 0; s < 2; s++) {
+        dy[c + s] = diff * (y[left + s] + y[right + s] + y[down + s] +
+                            y[up + s] - 4 * y[c + s]);
+      }
+      realtype uu = y[c];
+      realtype vv = y[c + 1];
+      realtype uuv = uu * uu * vv;
+      dy[c] += BRUSS_A - (BRUSS_B + 1) * uu + uuv;
+      dy[c + 1] += BRUSS_B * uu - uuv;
+    }
+  }
+
+  return(0);
+}
+
+// Jacobian-times-vector: the diffusion stencil applied to v plus the 2x2
+// reaction jacobian of every cell.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  UserData *data = (UserData*) user_data;
+  sunindextype nx = data->nx;
+  realtype diff = data->diff;
+  const realtype *y = N_VGetArrayPointer(u);
+  const realtype *vd = N_VGetArrayPointer(v);
+  realtype *Jvd = N_VGetArrayPointer(Jv);
+
+  for (sunindextype j = 0; j < nx; j++) {
+    for (sunindextype i = 0; i < nx; i++) {
+      sunindextype c = 2 * (j * nx + i);
+      sunindextype left = (i > 0) ? c - 2 : c;
+      sunindextype right = (i < nx - 1) ? c + 2 : c;
+      sunindextype down = (j > 0) ? c - 2 * nx : c;
+      sunindextype up = (j < nx - 1) ? c + 2 * nx : c;
+      for (int s = 0; s < 2; s++) {
+        Jvd[c + s] = diff * (vd[left + s] + vd[right + s] + vd[down + s] +
+                             vd[up + s] - 4 * vd[c + s]);
+      }
+      realtype uu = y[c];
+      realtype vv = y[c + 1];
+      Jvd[c] += (-(BRUSS_B + 1) + 2 * uu * vv) * vd[c] + uu * uu * vd[c + 1];
+      Jvd[c + 1] += (BRUSS_B - 2 * uu * vv) * vd[c] - uu * uu * vd[c + 1];
+    }
+  }
+
+  return(0);
+}
+
+// The same jacobian in CSC form for the preconditioner. Column c + s holds
+// the diffusion couplings to the existing neighbours, the diagonal and the
+// reaction coupling to the other component of the cell.
+static int jac(realtype t, N_Vector y, N_Vector fy, sunindextype *colptr,
+               sunindextype *rowind, realtype *vals, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype nx = data->nx;
+  realtype diff = data->diff;
+  const realtype *yd = N_VGetArrayPointer(y);
+
+  sunindextype k = 0;
+  for (sunindextype j = 0; j < nx; j++) {
+    for (sunindextype i = 0; i < nx; i++) {
+      sunindextype c = 2 * (j * nx + i);
+      sunindextype neighbours[4];
+      int num = 0;
+      if (i > 0) neighbours[num++] = c - 2;
+      if (i < nx - 1) neighbours[num++] = c + 2;
+      if (j > 0) neighbours[num++] = c - 2 * nx;
+      if (j < nx - 1) neighbours[num++] = c + 2 * nx;
+
+      realtype uu = yd[c];
+      realtype vv = yd[c + 1];
+      // d f_row / d y_col of the reaction for (row, col) in the cell.
+      realtype react[2][2] = {{-(BRUSS_B + 1) + 2 * uu * vv, uu * uu},
+                              {BRUSS_B - 2 * uu * vv, -uu * uu}};
+
+      for (int s = 0; s < 2; s++) {
+        colptr[c + s] = k;
+        for (int n = 0; n < num; n++) {
+          rowind[k] = neighbours[n] + s;
+          vals[k++] = diff;
+        }
+        rowind[k] = c + s;
+        vals[k++] = -num * diff + react[s][s];
+        rowind[k] = c + 1 - s;
+        vals[k++] = react[1 - s][s];
+      }
+    }
+  }
+  colptr[2 * nx * nx] = k;
+
+  return(0);
+}
+
+// Preconditioner setup and solve, handed on to the Preconditioner.
+static int psetup(realtype t, N_Vector u, N_Vector fu, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  return data->prec->setup(t, u, fu, jok, jcurPtr, gamma, user_data);
+}
+
+static int psolve(realtype t, N_Vector u, N_Vector fu, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  return data->prec->solve(r, z);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,293 @@
+/*
+The stiff 2d system of the ensemble example,
+
+  u0' = a00 * u0 + a01 * u1 + c0
+  u1' = u0 + c1,
+
+with its right hand side written once as a template (StiffModel below) and
+evaluated by simd_rhs.h over SIMD_LANES members at a time. The same
+definition gives f, the jacobian-times-vector product and the block
+preconditioner of the ensemble and f and jtv of a single member.
+
+1. f and jtv of all members, evals times, one member at a time with
+   T = realtype and Dual<1> and with simd_rhs and simd_jtv, in ns per member.
+2. The ensemble solve with simd_rhs, simd_jtv, simd_psetup and simd_psolve.
+3. The first baseline members solved one at a time, each with a SimdBatch of
+   one member, and the largest difference to the ensemble.
+
+Usage: ./executable [members] [evals] [baseline_members]
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+#include "dual.h"  // Dual, for the one member at a time jtv
+#include "simd_rhs.h"  // SimdBatch, simd_rhs, simd_jtv, simd_psetup
+#include "solver_stats.h"  // stats_now
+
+// The system of one member, p = (a00, a01, c0, c1).
+struct StiffModel {
+  static const int N = 2;
+  static const int NP = 4;
+
+  template <class T>
+  static int rhs(realtype t, const T *y, const T *p, T *ydot) {
+    ydot[0] = p[0] * y[0] + p[1] * y[1] + p[2];
+    ydot[1] = y[0] + p[3];
+    return(0);
+  }
+};
+
+static void fill_ensemble(SimdBatch *batch, N_Vector y);
+static int scalar_rhs(SimdBatch *batch, N_Vector y, N_Vector ydot);
+static int scalar_jtv(SimdBatch *batch, N_Vector v, N_Vector Jv,
+                      N_Vector y);
+static int solve(SimdBatch *batch, N_Vector y, realtype end_time,
+                 booleantype precondition, long int *nsteps);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  sunindextype members = (argc > 1) ? std::atol(argv[1]) : 10000;
+  int evals = (argc > 2) ? std::atoi(argv[2]) : 1000;
+  sunindextype baseline_members = (argc > 3) ? std::atol(argv[3]) : 1000;
+  if (members < 1) members = 1;
+  if (evals < 1) evals = 1;
+  if (baseline_members > members) baseline_members = members;
+  realtype end_time = 50;
+  int flag = 0;
+
+  SimdBatch batch;
+  simd_batch_resize<StiffModel>(&batch, members);
+  N_Vector y = N_VNew_Serial(StiffModel::N * members);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  N_Vector v = N_VClone(y);
+  if (check_flag((void *)v, "N_VClone", 0)) return(1);
+  N_Vector out = N_VClone(y);
+  if (check_flag((void *)out, "N_VClone", 0)) return(1);
+  N_Vector out_simd = N_VClone(y);
+  if (check_flag((void *)out_simd, "N_VClone", 0)) return(1);
+  fill_ensemble(&batch, y);
+  for (sunindextype i = 0; i < StiffModel::N * members; i++) {
+    NV_DATA_S(v)[i] = 1.0 + (realtype) (i % 7);
+  }
+  std::vector < realtype > y_init(NV_DATA_S(y),
+                                  NV_DATA_S(y) + StiffModel::N * members);
+
+  // 1. The kernels, one member at a time and SIMD_LANES at a time.
+  double per_eval = 1e9 / ((double) evals * members);
+  double seconds[4];
+  realtype max_diff = 0;
+  for (int kind = 0; kind < 4; kind++) {
+    double start = stats_now();
+    for (int e = 0; e < evals && flag == 0; e++) {
+      switch (kind) {
+        case 0: flag = scalar_rhs(&batch, y, out); break;
+        case 1: flag = simd_rhs<StiffModel>(0, y, out_simd, &batch); break;
+        case 2: flag = scalar_jtv(&batch, v, out, y); break;
+        default: flag = simd_jtv<StiffModel>(v, out_simd, 0, y, NULL, &batch,
+                                              NULL);
+      }
+    }
+    seconds[kind] = stats_now() - start;
+    if (check_flag(&flag, "kernel", 1)) return(1);
+    if (kind % 2 == 1) {
+      for (sunindextype i = 0; i < StiffModel::N * members; i++) {
+        max_diff = SUNMAX(max_diff, SUNRabs(NV_DATA_S(out)[i] -
+                                            NV_DATA_S(out_simd)[i]));
+      }
+    }
+  }
+  printf("SIMD_LANES %d, %ld members, %d evaluations\n\n", SIMD_LANES,
+         (long) members, evals);
+  printf("%-4s %14s %14s %9s\n", "", "scalar ns", "simd ns", "speedup");
+  printf("%-4s %14.3f %14.3f %9.2f\n", "f", seconds[0] * per_eval,
+         seconds[1] * per_eval, seconds[0] / seconds[1]);
+  printf("%-4s %14.3f %14.3f %9.2f\n", "jtv", seconds[2] * per_eval,
+         seconds[3] * per_eval, seconds[2] / seconds[3]);
+  printf("max |scalar-simd|: %g\n\n", (double) max_diff);
+
+  // 2. The ensemble, one CVODE object for all members together.
+  long int nsteps;
+  double start = stats_now();
+  flag = solve(&batch, y, end_time, SUNTRUE, &nsteps);
+  if (check_flag(&flag, "solve", 1)) return(1);
+  double ensemble_seconds = stats_now() - start;
+  printf("ensemble: %ld steps, %.6f s, %.0f members/s\n", nsteps,
+         ensemble_seconds, members / ensemble_seconds);
+  printf("first member y: %g %g\n", (double) NV_DATA_S(y)[0],
+         (double) NV_DATA_S(y)[members]);
+
+  // 3. The same callbacks on a batch of one member, the serial f.
+  SimdBatch single;
+  simd_batch_resize<StiffModel>(&single, 1);
+  N_Vector y_single = N_VNew_Serial(StiffModel::N);
+  if (check_flag((void *)y_single, "N_VNew_Serial", 0)) return(1);
+  max_diff = 0;
+  start = stats_now();
+  for (sunindextype m = 0; m < baseline_members; m++) {
+    for (int k = 0; k < StiffModel::NP; k++) {
+      simd_param(&single, k, 0) = simd_param(&batch, k, m);
+    }
+    for (int i = 0; i < StiffModel::N; i++) {
+      NV_DATA_S(y_single)[i] = y_init[i * members + m];
+    }
+    flag = solve(&single, y_single, end_time, SUNFALSE, &nsteps);
+    if (check_flag(&flag, "solve", 1)) return(1);
+    for (int i = 0; i < StiffModel::N; i++) {
+      max_diff = SUNMAX(max_diff, SUNRabs(NV_DATA_S(y_single)[i] -
+                                          NV_DATA_S(y)[i * members + m]));
+    }
+  }
+  if (baseline_members > 0) {
+    double baseline_seconds = stats_now() - start;
+    printf("one at a time: %ld members, %.6f s, %.0f members/s\n",
+           (long) baseline_members, baseline_seconds,
+           baseline_members / baseline_seconds);
+    printf("max |ensemble-single|: %g\n", (double) max_diff);
+  }
+
+  N_VDestroy(y_single);
+  N_VDestroy(out_simd);
+  N_VDestroy(out);
+  N_VDestroy(v);
+  N_VDestroy(y);
+
+  return(0);
+}
+
+// Coefficients and initial values of the ensemble example.
+static void fill_ensemble(SimdBatch *batch, N_Vector y) {
+  sunindextype M = batch->members;
+  for (sunindextype m = 0; m < M; m++) {
+    realtype s = (M > 1) ? (realtype) m / (M - 1) : 0;
+    simd_param(batch, 0, m) = -101.0 * (1.0 + 0.1 * s);
+    simd_param(batch, 1, m) = -100.0 * (1.0 + 0.1 * s);
+    simd_param(batch, 2, m) = 0.01 * s;
+    simd_param(batch, 3, m) = 0.02 * s;
+    NV_DATA_S(y)[m] = 2.0 + s;
+    NV_DATA_S(y)[M + m] = 1.0 - s;
+  }
+}
+
+// f of every member with the kernel on realtype, one member per call.
+static int scalar_rhs(SimdBatch *batch, N_Vector y, N_Vector ydot) {
+  const int N = StiffModel::N, NP = StiffModel::NP;
+  sunindextype M = batch->members;
+  const realtype *ydata = N_VGetArrayPointer(y);
+  realtype *fdata = N_VGetArrayPointer(ydot);
+  realtype x[N], fx[N], p[NP];
+
+  for (sunindextype m = 0; m < M; m++) {
+    for (int i = 0; i < N; i++) x[i] = ydata[i * M + m];
+    for (int k = 0; k < NP; k++) p[k] = batch->params[k * M + m];
+    int flag = StiffModel::rhs(0, (const realtype *) x, (const realtype *) p,
+                               fx);
+    if (flag != 0) return(flag);
+    for (int i = 0; i < N; i++) fdata[i * M + m] = fx[i];
+  }
+
+  return(0);
+}
+
+// J*v of every member with the kernel on Dual<1>, one member per call.
+static int scalar_jtv(SimdBatch *batch, N_Vector v, N_Vector Jv,
+                      N_Vector y) {
+  const int N = StiffModel::N, NP = StiffModel::NP;
+  sunindextype M = batch->members;
+  const realtype *ydata = N_VGetArrayPointer(y);
+  const realtype *vdata = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  Dual<1> x[N], fx[N], p[NP];
+
+  for (sunindextype m = 0; m < M; m++) {
+    for (int i = 0; i < N; i++) {
+      x[i].v = ydata[i * M + m];
+      x[i].d[0] = vdata[i * M + m];
+    }
+    for (int k = 0; k < NP; k++) p[k] = Dual<1>(batch->params[k * M + m]);
+    int flag = StiffModel::rhs(0, (const Dual<1> *) x, (const Dual<1> *) p,
+                               fx);
+    if (flag != 0) return(flag);
+    for (int i = 0; i < N; i++) Jvdata[i * M + m] = fx[i].d[0];
+  }
+
+  return(0);
+}
+
+// Advances y, the members of batch, from 0 to end_time with BDF and SPGMR,
+// with the block preconditioner if precondition is set.
+static int solve(SimdBatch *batch, N_Vector y, realtype end_time,
+                 booleantype precondition, long int *nsteps) {
+  int flag = -1;
+  realtype t = 0;
+  SUNLinearSolver LS = NULL;
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(-1);
+
+  LS = SUNSPGMR(y, precondition ? PREC_LEFT : PREC_NONE, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) goto cleanup;
+  if (CVodeInit(cvode_mem, simd_rhs<StiffModel>, 0, y) < 0 ||
+      CVodeSStolerances(cvode_mem, 1e-5, 1e-5) < 0 ||
+      CVodeSetUserData(cvode_mem, batch) < 0 ||
+      CVSpilsSetLinearSolver(cvode_mem, LS) < 0 ||
+      CVSpilsSetJacTimes(cvode_mem, NULL, simd_jtv<StiffModel>) < 0) {
+    goto cleanup;
+  }
+  if (precondition &&
+      CVSpilsSetPreconditioner(cvode_mem, simd_psetup<StiffModel>,
+                               simd_psolve<StiffModel>) < 0) {
+    goto cleanup;
+  }
+
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  if (flag >= 0) flag = CVodeGetNumSteps(cvode_mem, nsteps);
+
+cleanup:
+  CVodeFree(&cvode_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+  return(flag);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -132,10 +132,12 @@ int main(int argc, char** argv) {
   int print_steps = 100;
   realtype tout;
   realtype end_time = 50;
-  realtype step_length = 0.5;
+  realtype step_length = end_time / print_steps;
   realtype t = 0;
   // loop over output points, call CVode, print results, test for error
-  for (tout = step_length; tout <= end_time; tout += step_length) {
+  for (int k = 1; k <= print_steps; k++) {
+    // Output times from k, summing up step_length would drift.
+    tout = k * step_length;
     flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
     std::cout << "t: " << t;
     std::cout << "\ny:";
@@ -192,8 +194,8 @@ static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
     send_data = udata[0];
   }
 
-  // Puting the calculations together.
-  MPI_Barrier(MPI_COMM_WORLD);
+  // Puting the calculations together. MPI_Allgather is collective and already
+  // waits for every process, so no MPI_Barrier is needed before it.
   MPI_Allgather(&send_data, 1, MPI_DOUBLE, dudata, 1, MPI_DOUBLE, MPI_COMM_WORLD);
 
   return(0);
@@ -206,7 +208,6 @@ static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
   realtype *udata  = N_VGetArrayPointer(u);
   realtype *vdata  = N_VGetArrayPointer(v);
   realtype *Jvdata = N_VGetArrayPointer(Jv);
-  realtype *fudata = N_VGetArrayPointer(fu);
 
   // Access inforation in user_data.
   UserData *u_data;
@@ -219,13 +220,10 @@ static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
     send_data = vdata[0] + 0 * vdata[1];
   }
 
-  // Puting the calculations together.
-  MPI_Barrier(MPI_COMM_WORLD);
+  // Puting the calculations together. MPI_Allgather is collective and already
+  // waits for every process, so no MPI_Barrier is needed before it.
   MPI_Allgather(&send_data, 1, MPI_DOUBLE, Jvdata, 1, MPI_DOUBLE, MPI_COMM_WORLD);
 
-  fudata[0] = 0;
-  fudata[1] = 0;
-
   return(0);
 }
 
@@ -126,10 +126,12 @@ int main() {
   int print_steps = 100;
   realtype tout;
   realtype end_time = 50;
-  realtype step_length = 0.5;
+  realtype step_length = end_time / print_steps;
   realtype t = 0;
   // loop over output points, call CVode, print results, test for error
-  for (tout = step_length; tout <= end_time; tout += step_length) {
+  for (int k = 1; k <= print_steps; k++) {
+    // Output times from k, summing up step_length would drift.
+    tout = k * step_length;
     flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
     std::cout << "t: " << t;
     std::cout << "\ny:";
@@ -183,14 +185,10 @@ static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
   realtype *udata  = N_VGetArrayPointer(u);
   realtype *vdata  = N_VGetArrayPointer(v);
   realtype *Jvdata = N_VGetArrayPointer(Jv);
-  realtype *fudata = N_VGetArrayPointer(fu);
 
   Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
   Jvdata[1] = vdata[0] + 0 * vdata[1];
 
-  fudata[0] = 0;
-  fudata[1] = 0;
-
   return(0);
 }
 
@@ -0,0 +1,126 @@
+#include "solver_context.h"
+
+#include <cstdio>
+
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+SolverContext::SolverContext()
+    : N_(0), y_(NULL), cvode_mem_(NULL), LS_(NULL), num_solves_(0) {
+}
+
+SolverContext::~SolverContext() {
+  destroy();
+}
+
+int SolverContext::create(sunindextype N, CVRhsFn f, CVSpilsJacTimesVecFn jtv,
+                          realtype reltol, realtype abstol) {
+  int flag;
+
+  destroy();
+  N_ = N;
+
+  // 3. Set vector of initial values. The values are overwritten by solve().
+  y_ = N_VNew_Serial(N);
+  if (check_flag((void *)y_, "N_VNew_Serial", 0)) return(CV_MEM_FAIL);
+  N_VConst(0, y_);
+
+  // 4. Create CVODE Object.
+  cvode_mem_ = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem_, "CVodeCreate", 0)) return(CV_MEM_FAIL);
+
+  // 5. Initialize CVODE solver.
+  flag = CVodeInit(cvode_mem_, f, 0, y_);
+  if (check_flag(&flag, "CVodeInit", 1)) return(flag);
+
+  // 6. Specify integration tolerances, these survive CVodeReInit.
+  flag = CVodeSStolerances(cvode_mem_, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(flag);
+
+  // 9. Create Linear Solver Object.
+  LS_ = SUNSPGMR(y_, 0, 0);
+  if (check_flag((void *)LS_, "SUNSPGMR", 0)) return(CV_MEM_FAIL);
+
+  // 11. Attach linear solver module.
+  flag = CVSpilsSetLinearSolver(cvode_mem_, LS_);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(flag);
+
+  // 12. Set linear solver interface optional inputs.
+  flag = CVSpilsSetJacTimes(cvode_mem_, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(flag);
+
+  return(0);
+}
+
+int SolverContext::solve(realtype t0, const realtype *y0, realtype tout,
+                         realtype *y_out, void *user_data) {
+  int flag;
+
+  if (cvode_mem_ == NULL) return(CV_MEM_NULL);
+
+  realtype *ydata = NV_DATA_S(y_);
+  for (sunindextype i = 0; i < N_; i++) ydata[i] = y0[i];
+
+  // CVodeReInit keeps the tolerances, the linear solver and its workspace,
+  // only the integrator history is reset.
+  flag = CVodeReInit(cvode_mem_, t0, y_);
+  if (check_flag(&flag, "CVodeReInit", 1)) return(flag);
+
+  flag = CVodeSetUserData(cvode_mem_, user_data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(flag);
+
+  realtype t = t0;
+  flag = CVode(cvode_mem_, tout, y_, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(flag);
+
+  for (sunindextype i = 0; i < N_; i++) y_out[i] = ydata[i];
+  num_solves_++;
+
+  return(flag);
+}
+
+void SolverContext::destroy() {
+  if (y_ != NULL) N_VDestroy(y_);
+  if (cvode_mem_ != NULL) CVodeFree(&cvode_mem_);
+  if (LS_ != NULL) SUNLinSolFree(LS_);
+  y_ = NULL;
+  cvode_mem_ = NULL;
+  LS_ = NULL;
+  N_ = 0;
+  num_solves_ = 0;
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
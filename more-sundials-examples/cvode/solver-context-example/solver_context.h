@@ -0,0 +1,56 @@
+/*
+A reusable solver context around the main() sequence of the simple CVODE
+example. create() runs the setup steps once (vector, CVODE memory, SPGMR linear
+solver, jacobian-times-vector function). Every call to solve() then only
+copies in the new initial values and resets the integrator with CVodeReInit,
+so the N_Vector, the linear solver workspace and its Krylov basis vectors are
+kept alive from one solve to the next.
+*/
+
+#ifndef SOLVER_CONTEXT_H
+#define SOLVER_CONTEXT_H
+
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+class SolverContext {
+ public:
+  SolverContext();
+  ~SolverContext(); // frees everything created by create()
+
+  // Steps 3 to 12 of the simple example. jtv may be NULL to use CVODE's
+  // difference quotient. Returns 0, or the negative flag of the failing
+  // SUNDIALS function.
+  int create(sunindextype N, CVRhsFn f, CVSpilsJacTimesVecFn jtv,
+             realtype reltol, realtype abstol);
+
+  // Integrates from (t0, y0) to tout and copies the solution into y_out.
+  // user_data is handed to f and jtv for this solve only. Returns the flag
+  // of CVode, negative on failure.
+  int solve(realtype t0, const realtype *y0, realtype tout, realtype *y_out,
+            void *user_data);
+
+  // Gives access to the CVODE memory, e.g. for CVodeGet* optional outputs
+  // of the last solve.
+  void *cvode_mem() const { return cvode_mem_; }
+  SUNLinearSolver linear_solver() const { return LS_; }
+  long int num_solves() const { return num_solves_; }
+
+ private:
+  // The context owns SUNDIALS objects, copying it would free them twice.
+  SolverContext(const SolverContext&);
+  SolverContext& operator=(const SolverContext&);
+
+  void destroy();
+
+  sunindextype N_;
+  N_Vector y_;
+  void *cvode_mem_;
+  SUNLinearSolver LS_;
+  long int num_solves_;
+};
+
+#endif
@@ -0,0 +1,222 @@
+/*
+Benchmark of the SolverContext from solver_context.h against the setup and
+teardown sequence of the simple CVODE example.
+
+The same set of initial value problems (the stiff 2d system from different
+initial values) is solved twice:
+  before: every solve creates and frees its own N_Vector, CVODE object and
+          SPGMR linear solver, like main() in the simple example.
+  after:  one SolverContext is created and reset with CVodeReInit for every
+          solve.
+The solves per second of both are printed.
+
+With a file name ending in .csv or .json as third argument the statistics of
+every solve of the SolverContext (see common/solver_stats.h) are written to
+it, labelled with the initial values of the solve.
+
+Usage: ./executable [solves] [tout] [stats.csv|stats.json]
+*/
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "solver_context.h"
+#include "cvode_stats.h"  // SolveRecord, SolveLog, collect_cvode_stats
+
+// This macro gives access to the individual components of the data array of an
+// N Vector.
+#define NV_Ith_S(v,i) ( NV_DATA_S(v)[i] )
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int solve_fresh(const realtype y0[2], realtype tout, realtype y_out[2]);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  int flag; // For checking if functions have run properly
+  realtype abstol = 1e-5; // real tolerance of system
+  realtype reltol = 1e-5; // absolute tolerance of system
+
+  long int solves = (argc > 1) ? std::atol(argv[1]) : 100000;
+  realtype tout = (argc > 2) ? std::atof(argv[2]) : 1.0;
+  const char *stats_path = (argc > 3) ? argv[3] : NULL;
+  if (solves < 1) solves = 1;
+
+  // Initial values spread around (2, 1) of the simple example.
+  std::vector < realtype > y0(2 * solves);
+  for (long int i = 0; i < solves; i++) {
+    realtype s = (realtype) i / solves;
+    y0[2 * i] = 2.0 + s;
+    y0[2 * i + 1] = 1.0 - s;
+  }
+  std::vector < realtype > y_before(2 * solves);
+  std::vector < realtype > y_after(2 * solves);
+
+  // Before: full setup and teardown for every solve.
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long int i = 0; i < solves; i++) {
+    flag = solve_fresh(&y0[2 * i], tout, &y_before[2 * i]);
+    if (flag != 0) return(1);
+  }
+  double before_seconds = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+
+  // After: one context reused for every solve.
+  SolveLog log;
+  if (stats_path != NULL) log.reserve(solves);
+  start = std::chrono::steady_clock::now();
+  SolverContext context;
+  flag = context.create(2, f, jtv, reltol, abstol);
+  if (check_flag(&flag, "SolverContext::create", 1)) return(1);
+  for (long int i = 0; i < solves; i++) {
+    double solve_start = (stats_path != NULL) ? stats_now() : 0;
+    flag = context.solve(0, &y0[2 * i], tout, &y_after[2 * i], NULL);
+    if (check_flag(&flag, "SolverContext::solve", 1)) return(1);
+    if (stats_path != NULL) {
+      SolveRecord rec;
+      rec.seconds = stats_now() - solve_start;
+      rec.flag = flag;
+      char label[64];
+      snprintf(label, sizeof(label), "%g %g", (double) y0[2 * i],
+               (double) y0[2 * i + 1]);
+      rec.label = label;
+      flag = collect_cvode_stats(context.cvode_mem(),
+                                 context.linear_solver(), &rec);
+      if (check_flag(&flag, "collect_cvode_stats", 1)) return(1);
+      log.add(rec);
+    }
+  }
+  double after_seconds = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+
+  realtype max_diff = 0;
+  for (long int i = 0; i < 2 * solves; i++) {
+    max_diff = SUNMAX(max_diff, SUNRabs(y_before[i] - y_after[i]));
+  }
+
+  double before_rate = solves / before_seconds;
+  double after_rate = solves / after_seconds;
+  std::cout << "solves: " << solves << ", tout: " << tout << "\n";
+  std::cout << "before (setup per solve): " << before_rate << " solves/s\n";
+  std::cout << "after (SolverContext):    " << after_rate << " solves/s\n";
+  std::cout << "speedup:                  " << after_rate / before_rate << "\n";
+  std::cout << "max |before-after|:       " << max_diff << "\n";
+
+  if (stats_path != NULL) {
+    size_t length = strlen(stats_path);
+    bool json = length > 5 && strcmp(stats_path + length - 5, ".json") == 0;
+    flag = json ? log.write_json(stats_path) : log.write_csv(stats_path);
+    if (check_flag(&flag, json ? "SolveLog::write_json" :
+                   "SolveLog::write_csv", 1)) return(1);
+    std::cout << "statistics of " << solves << " solves written to " <<
+        stats_path << "\n";
+  }
+
+  return(0);
+}
+
+// One solve with the setup and teardown sequence of the simple example.
+static int solve_fresh(const realtype y0[2], realtype tout, realtype y_out[2]) {
+  int flag;
+
+  N_Vector y = N_VNew_Serial(2);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  NV_Ith_S(y, 0) = y0[0];
+  NV_Ith_S(y, 1) = y0[1];
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, 1e-5, 1e-5);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+
+  SUNLinearSolver LS = SUNSPGMR(y, 0, 0);
+  if (check_flag((void *)LS, "SUNSPGMR", 0)) return(1);
+  flag = CVSpilsSetLinearSolver(cvode_mem, LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+  flag = CVSpilsSetJacTimes(cvode_mem, NULL, jtv);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  realtype t = 0;
+  flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(1);
+  y_out[0] = NV_Ith_S(y, 0);
+  y_out[1] = NV_Ith_S(y, 1);
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+
+  return(0);
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
+  realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
+  realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
+  Jvdata[1] = vdata[0] + 0 * vdata[1];
+
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,163 @@
+#include "colored_jacobian.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sunmatrix/sunmatrix_dense.h>  // access to dense SUNMatrix
+#include <sunmatrix/sunmatrix_band.h>  // access to band SUNMatrix
+#include <sunmatrix/sunmatrix_sparse.h>  // access to sparse SUNMatrix
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+// Factor of the minimum increment, as in CVODE's difference quotients.
+#define MIN_INC_MULT 1000.0
+
+
+ColoredJacobian::ColoredJacobian()
+    : N_(0), num_colors_(0), mu_(0), ml_(0), f_(NULL), cvode_mem_(NULL),
+      num_rhs_evals_(0) {
+  colptr_.assign(1, 0);
+}
+
+int ColoredJacobian::create(sunindextype N, const sunindextype *colptr,
+                            const sunindextype *rowind, CVRhsFn f,
+                            void *cvode_mem) {
+  if (N < 1 || f == NULL || colptr[0] != 0) return(-1);
+  sunindextype nnz = colptr[N];
+  for (sunindextype k = 0; k < nnz; k++) {
+    if (rowind[k] < 0 || rowind[k] >= N) return(-1);
+  }
+
+  N_ = N;
+  f_ = f;
+  cvode_mem_ = cvode_mem;
+  num_rhs_evals_ = 0;
+  colptr_.assign(colptr, colptr + N + 1);
+  rowind_.assign(rowind, rowind + nnz);
+  vals_.assign(nnz, 0);
+  inc_.assign(N, 0);
+
+  // Bandwidths of the pattern.
+  mu_ = ml_ = 0;
+  for (sunindextype j = 0; j < N; j++) {
+    for (sunindextype k = colptr[j]; k < colptr[j + 1]; k++) {
+      mu_ = std::max(mu_, j - rowind[k]);
+      ml_ = std::max(ml_, rowind[k] - j);
+    }
+  }
+
+  // The columns of every row, to find the columns sharing a row.
+  std::vector < sunindextype > rowptr(N + 1, 0), colind(nnz);
+  for (sunindextype k = 0; k < nnz; k++) rowptr[rowind[k] + 1]++;
+  for (sunindextype i = 0; i < N; i++) rowptr[i + 1] += rowptr[i];
+  std::vector < sunindextype > next(rowptr.begin(), rowptr.end() - 1);
+  for (sunindextype j = 0; j < N; j++) {
+    for (sunindextype k = colptr[j]; k < colptr[j + 1]; k++) {
+      colind[next[rowind[k]]++] = j;
+    }
+  }
+
+  // Greedy coloring in column order: every column gets the smallest color
+  // not used by a column it shares a row with. forbidden[c] == j marks color
+  // c as taken for column j.
+  std::vector < int > color(N, -1);
+  std::vector < sunindextype > forbidden;
+  num_colors_ = 0;
+  for (sunindextype j = 0; j < N; j++) {
+    for (sunindextype k = colptr[j]; k < colptr[j + 1]; k++) {
+      sunindextype i = rowind[k];
+      for (sunindextype p = rowptr[i]; p < rowptr[i + 1]; p++) {
+        int c = color[colind[p]];
+        if (c >= 0) forbidden[c] = j;
+      }
+    }
+    int c = 0;
+    while (c < num_colors_ && forbidden[c] == j) c++;
+    if (c == num_colors_) {
+      num_colors_++;
+      forbidden.push_back(-1);
+    }
+    color[j] = c;
+  }
+
+  // Columns sorted by color.
+  color_start_.assign(num_colors_ + 1, 0);
+  for (sunindextype j = 0; j < N; j++) color_start_[color[j] + 1]++;
+  for (int c = 0; c < num_colors_; c++) color_start_[c + 1] += color_start_[c];
+  columns_.resize(N);
+  std::vector < sunindextype > fill(color_start_.begin(),
+                                    color_start_.end() - 1);
+  for (sunindextype j = 0; j < N; j++) columns_[fill[color[j]]++] = j;
+
+  return(0);
+}
+
+int ColoredJacobian::jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+                         void *user_data, N_Vector tmp1, N_Vector tmp2,
+                         N_Vector tmp3) {
+  const sunindextype N = N_;
+  const realtype *ydata = N_VGetArrayPointer(y);
+  const realtype *fydata = N_VGetArrayPointer(fy);
+  realtype *ypert = N_VGetArrayPointer(tmp1);
+  const realtype *fpert = N_VGetArrayPointer(tmp2);
+  const realtype *ewt = N_VGetArrayPointer(tmp3);
+
+  // Increments as in CVODE's dense difference quotient, with the step size
+  // being attempted. Without CVODE memory they are sqrt(uround)*max(|y_j|, 1).
+  realtype srur = SUNRsqrt(UNIT_ROUNDOFF);
+  realtype min_inc = srur;
+  if (cvode_mem_ != NULL) {
+    realtype h;
+    CVodeGetErrWeights(cvode_mem_, tmp3);
+    CVodeGetCurrentStep(cvode_mem_, &h);
+    realtype fnorm = N_VWrmsNorm(fy, tmp3);
+    min_inc = (fnorm != 0) ?
+        MIN_INC_MULT * SUNRabs(h) * UNIT_ROUNDOFF * N * fnorm : 1;
+  } else {
+    N_VConst(1, tmp3);
+  }
+  for (sunindextype j = 0; j < N; j++) {
+    inc_[j] = SUNMAX(srur * SUNRabs(ydata[j]), min_inc / ewt[j]);
+  }
+
+  // One right hand side per color.
+  N_VScale(1, y, tmp1);
+  for (int c = 0; c < num_colors_; c++) {
+    for (sunindextype p = color_start_[c]; p < color_start_[c + 1]; p++) {
+      sunindextype j = columns_[p];
+      ypert[j] += inc_[j];
+    }
+    int flag = f_(t, tmp1, tmp2, user_data);
+    num_rhs_evals_++;
+    if (flag != 0) return(flag);
+    for (sunindextype p = color_start_[c]; p < color_start_[c + 1]; p++) {
+      sunindextype j = columns_[p];
+      ypert[j] = ydata[j];
+      for (sunindextype k = colptr_[j]; k < colptr_[j + 1]; k++) {
+        sunindextype i = rowind_[k];
+        vals_[k] = (fpert[i] - fydata[i]) / inc_[j];
+      }
+    }
+  }
+
+  // Copy into the matrix CVODE gave us.
+  if (SUNMatGetID(J) == SUNMATRIX_SPARSE) {
+    if (SM_SPARSETYPE_S(J) != CSC_MAT || SM_NNZ_S(J) < nnz()) return(-1);
+    std::copy(colptr_.begin(), colptr_.end(), SM_INDEXPTRS_S(J));
+    std::copy(rowind_.begin(), rowind_.end(), SM_INDEXVALS_S(J));
+    std::copy(vals_.begin(), vals_.end(), SM_DATA_S(J));
+    return(0);
+  }
+
+  SUNMatZero(J);
+  bool dense = (SUNMatGetID(J) == SUNMATRIX_DENSE);
+  if (!dense && (SM_UBAND_B(J) < mu_ || SM_LBAND_B(J) < ml_)) return(-1);
+  for (sunindextype j = 0; j < N; j++) {
+    for (sunindextype k = colptr_[j]; k < colptr_[j + 1]; k++) {
+      if (dense) {
+        SM_ELEMENT_D(J, rowind_[k], j) = vals_[k];
+      } else {
+        SM_ELEMENT_B(J, rowind_[k], j) = vals_[k];
+      }
+    }
+  }
+  return(0);
+}
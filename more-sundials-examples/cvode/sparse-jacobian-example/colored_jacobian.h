@@ -0,0 +1,77 @@
+/*
+Finite difference jacobian for CVODE's direct solvers from only the sparsity
+pattern of the jacobian.
+
+CVODE's own difference quotient for a dense matrix perturbs one component of
+y at a time and so needs N calls of the right hand side per jacobian. When
+the jacobian is sparse, columns that have no row in common can be perturbed
+together: every row of the difference f(y + increments) - f(y) then belongs
+to exactly one of the perturbed columns. create() groups the columns that way
+(a greedy coloring of the column intersection graph, done once), and jac()
+needs one call of f per group. For a band of width mu + ml + 1 that is at
+most mu + ml + 1 calls, for a 5-point stencil on a grid a handful, whatever
+the size of the problem.
+
+jac() is the body of a CVDlsJacFn and fills a SUNSparseMatrix (CSC, e.g. for
+KLU), a SUNBandMatrix or a SUNDenseMatrix:
+
+  static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+                 void *user_data, N_Vector tmp1, N_Vector tmp2,
+                 N_Vector tmp3) {
+    UserData *data = (UserData*) user_data;
+    return data->colored->jac(t, y, fy, J, user_data, tmp1, tmp2, tmp3);
+  }
+
+The increments are the ones of CVODE's dense difference quotient, using the
+error weights and the current step size of the CVODE memory given to create()
+(or sqrt(uround)*max(|y_j|, 1) if it is NULL).
+
+The functions returning int return 0 on success and -1 on invalid input;
+jac() passes on the value of a failing right hand side.
+*/
+
+#ifndef COLORED_JACOBIAN_H
+#define COLORED_JACOBIAN_H
+
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <sundials/sundials_matrix.h>  // SUNMatrix
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+class ColoredJacobian {
+ public:
+  ColoredJacobian();
+
+  // The pattern in CSC form: column j has the rows
+  // rowind[colptr[j]] .. rowind[colptr[j+1]-1]. f is the right hand side
+  // given to CVodeInit and cvode_mem the memory it was given to.
+  int create(sunindextype N, const sunindextype *colptr,
+             const sunindextype *rowind, CVRhsFn f, void *cvode_mem);
+
+  // Body of the CVDlsJacFn, see above.
+  int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data,
+          N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+
+  int num_colors() const { return num_colors_; }
+  sunindextype nnz() const { return colptr_[N_]; }
+  // Upper and lower bandwidth of the pattern, for SUNBandMatrix.
+  sunindextype mu() const { return mu_; }
+  sunindextype ml() const { return ml_; }
+  // Calls of f made by jac() so far.
+  long int num_rhs_evals() const { return num_rhs_evals_; }
+
+ private:
+  sunindextype N_;
+  std::vector < sunindextype > colptr_, rowind_;
+  // The columns of color c are columns_[color_start_[c]] ..
+  // columns_[color_start_[c+1]-1].
+  std::vector < sunindextype > color_start_, columns_;
+  int num_colors_;
+  sunindextype mu_, ml_;
+  CVRhsFn f_;
+  void *cvode_mem_;
+  std::vector < realtype > vals_, inc_;
+  long int num_rhs_evals_;
+};
+
+#endif
@@ -0,0 +1,305 @@
+/*
+Finite difference jacobians from a sparsity pattern, see colored_jacobian.h,
+compared with CVODE's built-in difference quotients.
+
+The problem is the 2D Allen-Cahn equation
+
+  u_t = d*lap(u) + u - u^3
+
+on nx*nx cells of the unit square with zero flux at the boundary (N = nx*nx,
+5-point stencil). Only f and the pattern of its jacobian are given, no
+jacobian. It is solved with BDF and Newton iteration and
+  dense:        SUNDenseMatrix, CVODE's dense difference quotient (N calls of
+                f per jacobian). Skipped for N > 4000.
+  band:         SUNBandMatrix with mu = ml = nx, CVODE's band difference
+                quotient (mu + ml + 1 calls).
+  band-colored: the same band matrix filled by ColoredJacobian.
+  klu-colored:  SUNSparseMatrix filled by ColoredJacobian and KLU, only when
+                compiled with -D SPARSE_WITH_KLU.
+For every run the time, steps, jacobian evaluations, calls of f for the
+jacobians, all calls of f and the largest difference to the first solution
+are printed.
+
+Usage: ./executable [nx] [end_time]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_direct.h> // access to CVDls interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
+#include <sunmatrix/sunmatrix_band.h> // access to band SUNMatrix
+#include <sunmatrix/sunmatrix_sparse.h> // access to sparse SUNMatrix
+#include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
+#include <sunlinsol/sunlinsol_band.h> // access to band SUNLinearSolver
+#ifdef SPARSE_WITH_KLU
+#include <sunlinsol/sunlinsol_klu.h> // access to KLU SUNLinearSolver
+#endif
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "colored_jacobian.h"
+#include "solver_stats.h"  // stats_now
+
+// Diffusion coefficient.
+#define DIFFUSION 0.05
+
+struct UserData {
+  sunindextype nx;
+  realtype diff; // d/h^2
+  ColoredJacobian *colored; // NULL for CVODE's difference quotients
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+static void stencil_pattern(sunindextype nx,
+                            std::vector < sunindextype > &colptr,
+                            std::vector < sunindextype > &rowind);
+static int run(const char *name, UserData *data, realtype end_time,
+               const std::vector < sunindextype > &colptr,
+               const std::vector < sunindextype > &rowind,
+               const realtype *y_first, realtype *y_out);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  sunindextype nx = (argc > 1) ? std::atol(argv[1]) : 32;
+  realtype end_time = (argc > 2) ? std::atof(argv[2]) : 5.0;
+  if (nx < 2) nx = 2;
+  sunindextype N = nx * nx;
+
+  UserData data;
+  data.nx = nx;
+  data.diff = DIFFUSION * nx * nx;
+  data.colored = NULL;
+
+  std::vector < sunindextype > colptr, rowind;
+  stencil_pattern(nx, colptr, rowind);
+  ColoredJacobian coloring;
+  if (coloring.create(N, &colptr[0], &rowind[0], f, NULL) != 0) return(1);
+  printf("N = %ld, band width %ld, %d colors\n\n", (long int) N,
+         (long int) (coloring.mu() + coloring.ml() + 1), coloring.num_colors());
+
+  const char *names[4] = {"dense", "band", "band-colored", "klu-colored"};
+  std::vector < realtype > y_first, y(N);
+  printf("%-13s %9s %7s %9s %9s %9s %10s\n", "jacobian", "seconds", "steps",
+         "jac_evals", "jac_rhs", "rhs_evals", "max_diff");
+  for (int k = 0; k < 4; k++) {
+    if (strcmp(names[k], "dense") == 0 && N > 4000) {
+      printf("%-13s skipped for N > 4000\n", names[k]);
+      continue;
+    }
+#ifndef SPARSE_WITH_KLU
+    if (strcmp(names[k], "klu-colored") == 0) {
+      printf("%-13s not compiled in (-D SPARSE_WITH_KLU)\n", names[k]);
+      continue;
+    }
+#endif
+    const realtype *ref = y_first.empty() ? NULL : &y_first[0];
+    if (run(names[k], &data, end_time, colptr, rowind, ref, &y[0]) != 0) {
+      return(1);
+    }
+    if (y_first.empty()) y_first = y;
+  }
+
+  return(0);
+}
+
+// One solve with the named jacobian, prints its line. y_first is the
+// solution to compare with, NULL for the first run.
+static int run(const char *name, UserData *data, realtype end_time,
+               const std::vector < sunindextype > &colptr,
+               const std::vector < sunindextype > &rowind,
+               const realtype *y_first, realtype *y_out) {
+  int flag;
+  realtype reltol = 1e-6;
+  realtype abstol = 1e-9;
+  sunindextype nx = data->nx;
+  sunindextype N = nx * nx;
+  std::string kind(name);
+
+  double start = stats_now();
+
+  N_Vector y = N_VNew_Serial(N);
+  if (check_flag((void *)y, "N_VNew_Serial", 0)) return(1);
+  realtype *ydata = N_VGetArrayPointer(y);
+  for (sunindextype j = 0; j < nx; j++) {
+    for (sunindextype i = 0; i < nx; i++) {
+      realtype x = (i + 0.5) / nx;
+      realtype z = (j + 0.5) / nx;
+      ydata[j * nx + i] = 0.9 * cos(3 * M_PI * x) * cos(2 * M_PI * z);
+    }
+  }
+
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
+  flag = CVodeInit(cvode_mem, f, 0, y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  flag = CVodeSetUserData(cvode_mem, data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+
+  // The coloring is done once, before the integration.
+  ColoredJacobian colored;
+  data->colored = NULL;
+  if (kind == "band-colored" || kind == "klu-colored") {
+    if (colored.create(N, &colptr[0], &rowind[0], f, cvode_mem) != 0) {
+      fprintf(stderr, "\nERROR: ColoredJacobian::create() failed\n\n");
+      return(1);
+    }
+    data->colored = &colored;
+  }
+
+  SUNMatrix A = NULL;
+  SUNLinearSolver LS = NULL;
+  if (kind == "dense") {
+    A = SUNDenseMatrix(N, N);
+    if (check_flag((void *)A, "SUNDenseMatrix", 0)) return(1);
+    LS = SUNDenseLinearSolver(y, A);
+  } else if (kind == "band" || kind == "band-colored") {
+    // The LU factors need room for ml extra upper diagonals.
+    A = SUNBandMatrix(N, nx, nx, 2 * nx);
+    if (check_flag((void *)A, "SUNBandMatrix", 0)) return(1);
+    LS = SUNBandLinearSolver(y, A);
+  }
+#ifdef SPARSE_WITH_KLU
+  else {
+    A = SUNSparseMatrix(N, N, colored.nnz(), CSC_MAT);
+    if (check_flag((void *)A, "SUNSparseMatrix", 0)) return(1);
+    LS = SUNKLU(y, A);
+  }
+#endif
+  if (check_flag((void *)LS, "SUNLinearSolver", 0)) return(1);
+  flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+  if (check_flag(&flag, "CVDlsSetLinearSolver", 1)) return(1);
+  if (data->colored != NULL) {
+    flag = CVDlsSetJacFn(cvode_mem, jac);
+    if (check_flag(&flag, "CVDlsSetJacFn", 1)) return(1);
+  }
+
+  realtype t;
+  flag = CVode(cvode_mem, end_time, y, &t, CV_NORMAL);
+  if (check_flag(&flag, "CVode", 1)) return(1);
+  double seconds = stats_now() - start;
+
+  // Calls of f for the jacobians, by CVODE or by the ColoredJacobian.
+  long int steps, jac_evals, jac_rhs, rhs_evals;
+  CVodeGetNumSteps(cvode_mem, &steps);
+  CVodeGetNumRhsEvals(cvode_mem, &rhs_evals);
+  CVDlsGetNumJacEvals(cvode_mem, &jac_evals);
+  if (data->colored != NULL) {
+    jac_rhs = colored.num_rhs_evals();
+  } else {
+    CVDlsGetNumRhsEvals(cvode_mem, &jac_rhs);
+  }
+
+  for (sunindextype i = 0; i < N; i++) y_out[i] = ydata[i];
+  realtype max_diff = 0;
+  if (y_first != NULL) {
+    for (sunindextype i = 0; i < N; i++) {
+      max_diff = SUNMAX(max_diff, SUNRabs(y_out[i] - y_first[i]));
+    }
+  }
+  printf("%-13s %9.3f %7ld %9ld %9ld %9ld %10.2e\n", name, seconds, steps,
+         jac_evals, jac_rhs, rhs_evals + jac_rhs, (double) max_diff);
+
+  N_VDestroy(y);
+  CVodeFree(&cvode_mem);
+  SUNLinSolFree(LS);
+  SUNMatDestroy(A);
+  return(0);
+}
+
+// Right hand side. Missing neighbours at the boundary count as the cell
+// itself (zero flux).
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype nx = data->nx;
+  realtype diff = data->diff;
+  const realtype *y = N_VGetArrayPointer(u);
+  realtype *dy = N_VGetArrayPointer(u_dot);
+
+  for (sunindextype j = 0; j < nx; j++) {
+    for (sunindextype i = 0; i < nx; i++) {
+      sunindextype c = j * nx + i;
+      realtype left = (i > 0) ? y[c - 1] : y[c];
+      realtype right = (i < nx - 1) ? y[c + 1] : y[c];
+      realtype down = (j > 0) ? y[c - nx] : y[c];
+      realtype up = (j < nx - 1) ? y[c + nx] : y[c];
+      dy[c] = diff * (left + right + down + up - 4 * y[c]) + y[c] -
+          y[c] * y[c] * y[c];
+    }
+  }
+
+  return(0);
+}
+
+// Jacobian function, handed on to the ColoredJacobian.
+static int jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
+               void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+  UserData *data = (UserData*) user_data;
+  return data->colored->jac(t, y, fy, J, user_data, tmp1, tmp2, tmp3);
+}
+
+// Sparsity pattern of the 5-point stencil in CSC form: column c has the
+// rows of the cell and its neighbours.
+static void stencil_pattern(sunindextype nx,
+                            std::vector < sunindextype > &colptr,
+                            std::vector < sunindextype > &rowind) {
+  colptr.assign(nx * nx + 1, 0);
+  rowind.clear();
+  for (sunindextype j = 0; j < nx; j++) {
+    for (sunindextype i = 0; i < nx; i++) {
+      sunindextype c = j * nx + i;
+      colptr[c] = rowind.size();
+      if (j > 0) rowind.push_back(c - nx);
+      if (i > 0) rowind.push_back(c - 1);
+      rowind.push_back(c);
+      if (i < nx - 1) rowind.push_back(c + 1);
+      if (j < nx - 1) rowind.push_back(c + nx);
+    }
+  }
+  colptr[nx * nx] = rowind.size();
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,282 @@
+#include "solve_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+
+static int rhs_trampoline(realtype t, N_Vector y, N_Vector ydot,
+                          void *user_data);
+static int jtv_trampoline(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                          N_Vector fy, void *user_data, N_Vector tmp);
+static int create_context(WorkerContext &ctx, const Problem &p);
+static void free_context(WorkerContext &ctx);
+static int solve_problem(WorkerContext &ctx, const Problem &p, Result &r);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+SolvePool::SolvePool(int num_workers)
+    : problems_(NULL), results_(NULL), generation_(0), active_(0),
+      shutdown_(false), batch_seconds_(0) {
+  if (num_workers < 1) num_workers = 1;
+  for (int i = 0; i < num_workers; i++) {
+    Worker *w = new Worker();
+    w->ctx.N = 0;
+    w->ctx.y = NULL;
+    w->ctx.cvode_mem = NULL;
+    w->ctx.LS = NULL;
+    w->ctx.problem = NULL;
+    w->busy_seconds = 0;
+    w->solved = 0;
+    w->stolen = 0;
+    workers_.push_back(w);
+  }
+  // Threads are started after every worker exists since they steal from each
+  // other.
+  for (int i = 0; i < num_workers; i++) {
+    workers_[i]->thread = std::thread(&SolvePool::worker_loop, this, i);
+  }
+}
+
+SolvePool::~SolvePool() {
+  {
+    std::lock_guard < std::mutex > guard(batch_lock_);
+    shutdown_ = true;
+  }
+  batch_start_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++) {
+    workers_[i]->thread.join();
+    free_context(workers_[i]->ctx);
+    delete workers_[i];
+  }
+}
+
+void SolvePool::solve(const std::vector < Problem > &problems,
+                      std::vector < Result > &results) {
+  results.resize(problems.size());
+
+  // Deal the problems out round robin, stealing evens out whatever imbalance
+  // is left.
+  size_t nw = workers_.size();
+  for (size_t i = 0; i < nw; i++) {
+    std::lock_guard < std::mutex > guard(workers_[i]->lock);
+    workers_[i]->queue.clear();
+    workers_[i]->busy_seconds = 0;
+    workers_[i]->solved = 0;
+    workers_[i]->stolen = 0;
+  }
+  for (size_t i = 0; i < problems.size(); i++) {
+    std::lock_guard < std::mutex > guard(workers_[i % nw]->lock);
+    workers_[i % nw]->queue.push_back(i);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::unique_lock < std::mutex > lock(batch_lock_);
+  problems_ = &problems;
+  results_ = &results;
+  active_ = (int) nw;
+  generation_++;
+  batch_start_.notify_all();
+  while (active_ > 0) batch_done_.wait(lock);
+  batch_seconds_ = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+}
+
+void SolvePool::print_utilization(std::ostream &out) const {
+  out << "worker   solved   stolen   utilization\n";
+  for (size_t i = 0; i < workers_.size(); i++) {
+    double utilization = (batch_seconds_ > 0) ?
+        workers_[i]->busy_seconds / batch_seconds_ : 0;
+    out << std::setw(6) << i << std::setw(9) << workers_[i]->solved
+        << std::setw(9) << workers_[i]->stolen
+        << std::setw(13) << std::fixed << std::setprecision(3) << utilization
+        << "\n";
+    out.unsetf(std::ios::fixed);
+  }
+}
+
+void SolvePool::worker_loop(int id) {
+  Worker *w = workers_[id];
+  long int seen = 0;
+
+  for (;;) {
+    const std::vector < Problem > *problems;
+    std::vector < Result > *results;
+    {
+      std::unique_lock < std::mutex > lock(batch_lock_);
+      while (!shutdown_ && generation_ == seen) batch_start_.wait(lock);
+      if (shutdown_) return;
+      seen = generation_;
+      problems = problems_;
+      results = results_;
+    }
+
+    size_t task;
+    while (next_task(id, task)) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      solve_problem(w->ctx, (*problems)[task], (*results)[task]);
+      (*results)[task].worker = id;
+      w->busy_seconds += std::chrono::duration < double > (
+          std::chrono::steady_clock::now() - start).count();
+      w->solved++;
+    }
+
+    std::lock_guard < std::mutex > guard(batch_lock_);
+    if (--active_ == 0) batch_done_.notify_all();
+  }
+}
+
+// Takes the next problem from the front of the worker's own queue, or steals
+// one from the back of another worker's queue. Problems are never added while
+// a batch runs, so empty queues everywhere means the worker is done.
+bool SolvePool::next_task(int id, size_t &task) {
+  Worker *w = workers_[id];
+  {
+    std::lock_guard < std::mutex > guard(w->lock);
+    if (!w->queue.empty()) {
+      task = w->queue.front();
+      w->queue.pop_front();
+      return true;
+    }
+  }
+
+  size_t nw = workers_.size();
+  for (size_t k = 1; k < nw; k++) {
+    Worker *victim = workers_[(id + k) % nw];
+    std::lock_guard < std::mutex > guard(victim->lock);
+    if (!victim->queue.empty()) {
+      task = victim->queue.back();
+      victim->queue.pop_back();
+      w->stolen++;
+      return true;
+    }
+  }
+  return false;
+}
+
+// CVODE always calls these two with the worker context as user data, they
+// forward to the functions of the problem being solved.
+static int rhs_trampoline(realtype t, N_Vector y, N_Vector ydot,
+                          void *user_data) {
+  WorkerContext *ctx = (WorkerContext*) user_data;
+  return ctx->problem->f(t, y, ydot, ctx->problem->user_data);
+}
+
+static int jtv_trampoline(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                          N_Vector fy, void *user_data, N_Vector tmp) {
+  WorkerContext *ctx = (WorkerContext*) user_data;
+  return ctx->problem->jtv(v, Jv, t, y, fy, ctx->problem->user_data, tmp);
+}
+
+// Builds the vector, CVODE object and linear solver for problems of size p.N,
+// following steps 3 to 11 of the simple example.
+static int create_context(WorkerContext &ctx, const Problem &p) {
+  int flag;
+
+  free_context(ctx);
+  ctx.N = p.N;
+
+  ctx.y = N_VNew_Serial(p.N);
+  if (check_flag((void *)ctx.y, "N_VNew_Serial", 0)) return(1);
+  for (sunindextype i = 0; i < p.N; i++) NV_DATA_S(ctx.y)[i] = p.y0[i];
+
+  ctx.cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (check_flag((void *)ctx.cvode_mem, "CVodeCreate", 0)) return(1);
+
+  flag = CVodeInit(ctx.cvode_mem, rhs_trampoline, p.t0, ctx.y);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
+
+  flag = CVodeSetUserData(ctx.cvode_mem, &ctx);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+
+  ctx.LS = SUNSPGMR(ctx.y, 0, 0);
+  if (check_flag((void *)ctx.LS, "SUNSPGMR", 0)) return(1);
+
+  flag = CVSpilsSetLinearSolver(ctx.cvode_mem, ctx.LS);
+  if (check_flag(&flag, "CVSpilsSetLinearSolver", 1)) return(1);
+
+  return(0);
+}
+
+static void free_context(WorkerContext &ctx) {
+  if (ctx.y != NULL) N_VDestroy(ctx.y);
+  if (ctx.cvode_mem != NULL) CVodeFree(&ctx.cvode_mem);
+  if (ctx.LS != NULL) SUNLinSolFree(ctx.LS);
+  ctx.y = NULL;
+  ctx.cvode_mem = NULL;
+  ctx.LS = NULL;
+  ctx.N = 0;
+}
+
+// Solves one problem, reusing the worker's CVODE objects when the size
+// matches the previous problem.
+static int solve_problem(WorkerContext &ctx, const Problem &p, Result &r) {
+  int flag;
+
+  r.flag = CV_MEM_NULL;
+  r.t = p.t0;
+  r.nsteps = 0;
+  ctx.problem = &p;
+
+  if (ctx.cvode_mem == NULL || ctx.N != p.N) {
+    if (create_context(ctx, p)) {
+      free_context(ctx);
+      return(1);
+    }
+  } else {
+    for (sunindextype i = 0; i < p.N; i++) NV_DATA_S(ctx.y)[i] = p.y0[i];
+    flag = CVodeReInit(ctx.cvode_mem, p.t0, ctx.y);
+    if (check_flag(&flag, "CVodeReInit", 1)) return(1);
+  }
+
+  flag = CVodeSStolerances(ctx.cvode_mem, p.reltol, p.abstol);
+  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+
+  // NULL restores CVODE's difference quotient jacobian-times-vector.
+  flag = CVSpilsSetJacTimes(ctx.cvode_mem, NULL,
+                            (p.jtv != NULL) ? jtv_trampoline : NULL);
+  if (check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+
+  r.flag = CVode(ctx.cvode_mem, p.tout, ctx.y, &r.t, CV_NORMAL);
+  check_flag(&r.flag, "CVode", 1);
+
+  r.y.assign(NV_DATA_S(ctx.y), NV_DATA_S(ctx.y) + p.N);
+  CVodeGetNumSteps(ctx.cvode_mem, &r.nsteps);
+
+  return(r.flag < 0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
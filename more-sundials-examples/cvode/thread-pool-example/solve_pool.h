@@ -0,0 +1,101 @@
+/*
+A pool of worker threads that solves batches of independent initial value
+problems with CVODE. Each worker owns one set of CVODE memory, N_Vector and
+SPGMR linear solver which is reused (with CVodeReInit) for every problem it
+solves, and has its own queue of problems. A worker whose queue runs dry steals
+problems from the back of the other workers' queues.
+*/
+
+#ifndef SOLVE_POOL_H
+#define SOLVE_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include <cvode/cvode.h> // prototypes for CVODE fcts., consts.
+#include <cvode/cvode_spils.h> // access to CVSpils interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+// One initial value problem. f and jtv have the same signatures as in the
+// simple example, jtv may be NULL to use CVODE's difference quotient.
+struct Problem {
+  sunindextype N;
+  CVRhsFn f;
+  CVSpilsJacTimesVecFn jtv;
+  void *user_data;
+  std::vector < realtype > y0;
+  realtype t0;
+  realtype tout;
+  realtype reltol;
+  realtype abstol;
+};
+
+// Solution of one problem at tout.
+struct Result {
+  int flag; // return flag of CVode
+  realtype t;
+  std::vector < realtype > y;
+  long int nsteps;
+  int worker; // which worker solved the problem
+};
+
+// CVODE objects owned by a worker, rebuilt only when the problem size changes.
+struct WorkerContext {
+  sunindextype N;
+  N_Vector y;
+  void *cvode_mem;
+  SUNLinearSolver LS;
+  const Problem *problem; // problem currently being solved
+};
+
+class SolvePool {
+ public:
+  // Starts num_workers threads, they sleep until solve is called.
+  explicit SolvePool(int num_workers);
+  ~SolvePool();
+
+  // Solves every problem and fills results (resized to match problems).
+  // Blocks until the whole batch is done.
+  void solve(const std::vector < Problem > &problems,
+             std::vector < Result > &results);
+
+  // Prints the problems solved, problems stolen and the fraction of the last
+  // batch's wall time each worker spent inside CVODE.
+  void print_utilization(std::ostream &out) const;
+
+  int num_workers() const { return (int) workers_.size(); }
+  double batch_seconds() const { return batch_seconds_; }
+
+ private:
+  struct Worker {
+    std::mutex lock; // guards queue
+    std::deque < size_t > queue; // indices into the current batch
+    WorkerContext ctx;
+    double busy_seconds;
+    long int solved;
+    long int stolen;
+    std::thread thread;
+  };
+
+  void worker_loop(int id);
+  bool next_task(int id, size_t &task);
+
+  std::vector < Worker* > workers_;
+
+  std::mutex batch_lock_; // guards everything below
+  std::condition_variable batch_start_;
+  std::condition_variable batch_done_;
+  const std::vector < Problem > *problems_;
+  std::vector < Result > *results_;
+  long int generation_; // incremented for every batch
+  int active_; // workers still working on the current batch
+  bool shutdown_;
+  double batch_seconds_;
+};
+
+#endif
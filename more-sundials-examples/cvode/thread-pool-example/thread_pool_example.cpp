@@ -0,0 +1,191 @@
+/*
+Solves many independent initial value problems on every core with the
+SolvePool from solve_pool.h. Two families of problems are used: the stiff 2d
+system of the simple CVODE example with different initial values, and a larger
+1d diffusion-reaction problem standing in for a user-supplied rhs.
+
+Each family is solved once with a single worker and once with all workers, and
+the throughput, speedup and per-worker utilization are printed.
+
+Usage: ./executable [workers] [small_problems] [large_problems]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <thread>
+#include "solve_pool.h"
+
+// Struct for holding the variables of the diffusion-reaction problem.
+struct DiffusionData {
+  sunindextype N;
+  realtype d; // diffusion coefficient divided by the grid spacing squared
+  realtype k; // reaction rate
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int f_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                       void *user_data);
+static int jtv_diffusion(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                         N_Vector fu, void *user_data, N_Vector tmp);
+static void run_family(const char *name, const std::vector < Problem > &problems,
+                       int workers);
+
+
+int main(int argc, char *argv[]) {
+  // 1. Initialize parallel or multi-threaded environment, if appropriate.
+  // ---------------------------------------------------------------------------
+  int workers = (argc > 1) ? std::atoi(argv[1]) :
+      (int) std::thread::hardware_concurrency();
+  if (workers < 1) workers = 1;
+  int small_problems = (argc > 2) ? std::atoi(argv[2]) : 20000;
+  int large_problems = (argc > 3) ? std::atoi(argv[3]) : 200;
+  // ---------------------------------------------------------------------------
+
+  // 2./3. Define the problems and their initial values.
+  // ---------------------------------------------------------------------------
+  // The stiff 2d system with initial values spread around (2, 1).
+  std::vector < Problem > small(small_problems);
+  for (int i = 0; i < small_problems; i++) {
+    realtype s = (realtype) i / small_problems;
+    small[i].N = 2;
+    small[i].f = f;
+    small[i].jtv = jtv;
+    small[i].user_data = NULL;
+    small[i].y0.resize(2);
+    small[i].y0[0] = 2.0 + s;
+    small[i].y0[1] = 1.0 - s;
+    small[i].t0 = 0;
+    small[i].tout = 50;
+    small[i].reltol = 1e-5;
+    small[i].abstol = 1e-5;
+  }
+
+  // The diffusion-reaction problem on 100 grid points, with a different
+  // initial amplitude for every problem.
+  DiffusionData diffusion;
+  diffusion.N = 100;
+  diffusion.d = 0.01 * (diffusion.N + 1) * (diffusion.N + 1);
+  diffusion.k = 1.0;
+
+  std::vector < Problem > large(large_problems);
+  for (int i = 0; i < large_problems; i++) {
+    realtype amplitude = 1.0 + (realtype) i / large_problems;
+    large[i].N = diffusion.N;
+    large[i].f = f_diffusion;
+    large[i].jtv = jtv_diffusion;
+    large[i].user_data = &diffusion;
+    large[i].y0.resize(diffusion.N);
+    for (sunindextype j = 0; j < diffusion.N; j++) {
+      realtype x = (realtype) (j + 1) / (diffusion.N + 1);
+      large[i].y0[j] = amplitude * x * (1.0 - x) * 4.0;
+    }
+    large[i].t0 = 0;
+    large[i].tout = 1;
+    large[i].reltol = 1e-5;
+    large[i].abstol = 1e-8;
+  }
+  // ---------------------------------------------------------------------------
+
+  // 4.-14. Solve every family on one worker and on all workers.
+  // ---------------------------------------------------------------------------
+  run_family("stiff 2d system", small, workers);
+  run_family("diffusion-reaction, N = 100", large, workers);
+  // ---------------------------------------------------------------------------
+
+  return(0);
+}
+
+// Solves a family of problems with one worker and with "workers" workers and
+// prints the throughput of each.
+static void run_family(const char *name, const std::vector < Problem > &problems,
+                       int workers) {
+  std::vector < Result > results;
+
+  std::cout << "\n" << name << ", " << problems.size() << " problems\n";
+
+  SolvePool serial(1);
+  serial.solve(problems, results);
+  double serial_rate = problems.size() / serial.batch_seconds();
+  std::cout << "1 worker:  " << serial_rate << " solves/s\n";
+
+  SolvePool pool(workers);
+  pool.solve(problems, results);
+  double pool_rate = problems.size() / pool.batch_seconds();
+  std::cout << workers << " workers: " << pool_rate << " solves/s, speedup "
+            << pool_rate / serial_rate << "\n";
+  pool.print_utilization(std::cout);
+
+  int failed = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].flag < 0) failed++;
+  }
+  if (failed > 0) std::cout << failed << " problems failed\n";
+  if (!results.empty()) {
+    std::cout << "first problem at t = " << results[0].t << ": y[0] = "
+              << results[0].y[0] << "\n";
+  }
+}
+
+// Simple function that calculates the differential equation.
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
+  realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
+  realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
+
+  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[1] = udata[0];
+
+  return(0);
+}
+
+// Jacobian function vector routine.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+
+  Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
+  Jvdata[1] = vdata[0] + 0 * vdata[1];
+
+  return(0);
+}
+
+// 1d diffusion with a quadratic decay, zero at both ends of the domain.
+static int f_diffusion(realtype t, N_Vector u, N_Vector u_dot,
+                       void *user_data) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  sunindextype N = data->N;
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left  = (i > 0) ? udata[i - 1] : 0;
+    realtype right = (i < N - 1) ? udata[i + 1] : 0;
+    dudata[i] = data->d * (left - 2.0 * udata[i] + right)
+                - data->k * udata[i] * udata[i];
+  }
+
+  return(0);
+}
+
+// Jacobian function vector routine of the diffusion-reaction problem.
+static int jtv_diffusion(N_Vector v, N_Vector Jv, realtype t, N_Vector u,
+                         N_Vector fu, void *user_data, N_Vector tmp) {
+  DiffusionData *data = (DiffusionData*) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  sunindextype N = data->N;
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left  = (i > 0) ? vdata[i - 1] : 0;
+    realtype right = (i < N - 1) ? vdata[i + 1] : 0;
+    Jvdata[i] = data->d * (left - 2.0 * vdata[i] + right)
+                - 2.0 * data->k * udata[i] * vdata[i];
+  }
+
+  return(0);
+}
@@ -0,0 +1,306 @@
+/*
+Adjoint gradient of a long-horizon diffusion-reaction problem with the
+SegmentedAdjoint from segmented_adjoint.h, to compare memory use and run time
+of checkpoint settings.
+
+The problem is the Fisher-KPP equation u_t = d*u_xx + r*u*(1-u) on [0, 1]
+with zero flux at both ends, discretized on a grid of equal cells. A front
+starts at the left end and travels to the right. The objective is the
+integral over time of the total amount of u,
+
+  G(p) = integral from 0 to end_time of sum(u)*dx dt,   p = (d, r)
+
+and the adjoint problem gives dG/dd and dG/dr.
+
+Every run prints the gradient, the run time, the number of right hand side
+evaluations and the peak resident memory of the process. As the peak can only
+grow during a process, compare.sh runs every setting in its own process.
+
+Usage: ./executable [segments] [snapshots] [memory|file] [csv]
+       ./executable check
+
+segments and snapshots default to 1, which is the plain CVODES adjoint with
+the interpolation data of the whole horizon in memory. With file the snapshots
+are kept in a memory-mapped file checkpoints.bin in the working directory.
+check compares the adjoint gradient with central finite differences of G.
+*/
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+#include <cvodes/cvodes.h> // prototypes for CVODE fcts., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "segmented_adjoint.h"
+
+struct UserData {
+  sunindextype cells;
+  realtype dx;
+  realtype d, r; // the parameters p
+  long int f_evals, fB_evals; // work of the forward and backward problem
+};
+
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp);
+static int fQ(realtype t, N_Vector u, N_Vector q_dot, void *user_data);
+static int fB(realtype t, N_Vector u, N_Vector uB, N_Vector uB_dot,
+              void *user_data);
+static int jtvB(N_Vector vB, N_Vector JvB, realtype t, N_Vector u,
+                N_Vector uB, N_Vector fuB, void *user_data, N_Vector tmpB);
+static int fQB(realtype t, N_Vector u, N_Vector uB, N_Vector qB_dot,
+               void *user_data);
+static long int peak_rss_kb();
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int main(int argc, char *argv[]) {
+  int flag; // For checking if functions have run properly
+  realtype abstol = 1e-8; // absolute tolerance of system
+  realtype reltol = 1e-6; // relative tolerance of system
+
+  bool check = (argc > 1 && strcmp(argv[1], "check") == 0);
+  int segments = (argc > 1 && !check) ? std::atoi(argv[1]) : 1;
+  int snapshots = (argc > 2) ? std::atoi(argv[2]) : segments;
+  bool in_file = (argc > 3 && strcmp(argv[3], "file") == 0);
+  bool csv = (argc > 4 && strcmp(argv[4], "csv") == 0);
+
+  // Problem size, parameters and initial front.
+  UserData data;
+  data.cells = check ? 200 : 1000;
+  data.dx = 1.0 / data.cells;
+  data.d = 1e-4;
+  data.r = 1.0;
+  data.f_evals = data.fB_evals = 0;
+  realtype end_time = check ? 10 : 40;
+  long int nsteps = 100; // steps between the CVODES checkpoints
+
+  std::vector < realtype > u0(data.cells);
+  for (sunindextype i = 0; i < data.cells; i++) {
+    realtype x = (i + 0.5) * data.dx;
+    u0[i] = std::exp(-(x / 0.05) * (x / 0.05));
+  }
+
+  AdjointProblem problem;
+  problem.f = f;
+  problem.jtv = jtv;
+  problem.fQ = fQ;
+  problem.num_objectives = 1;
+  problem.fB = fB;
+  problem.jtvB = jtvB;
+  problem.fQB = fQB;
+  problem.num_params = 2;
+  problem.user_data = &data;
+
+  SegmentedAdjoint adjoint;
+  flag = adjoint.create(problem, data.cells, reltol, abstol, nsteps);
+  if (check_flag(&flag, "SegmentedAdjoint::create", 1)) return(1);
+  flag = adjoint.set_checkpoints(segments, snapshots,
+                                 in_file ? "checkpoints.bin" : NULL);
+  if (check_flag(&flag, "SegmentedAdjoint::set_checkpoints", 1)) return(1);
+
+  realtype G, gradient[2];
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  flag = adjoint.solve(0, &u0[0], end_time, &G, gradient);
+  if (check_flag(&flag, "SegmentedAdjoint::solve", 1)) return(1);
+  double seconds = std::chrono::duration < double > (
+      std::chrono::steady_clock::now() - start).count();
+
+  if (check) {
+    // Central differences of G with a relative step in each parameter.
+    realtype *p[2] = {&data.d, &data.r};
+    const char *names[2] = {"dG/dd", "dG/dr"};
+    for (int k = 0; k < 2; k++) {
+      realtype value = *p[k];
+      realtype h = 1e-4 * value;
+      realtype G_plus, G_minus, unused[2];
+      *p[k] = value + h;
+      flag = adjoint.solve(0, &u0[0], end_time, &G_plus, unused);
+      if (check_flag(&flag, "SegmentedAdjoint::solve", 1)) return(1);
+      *p[k] = value - h;
+      flag = adjoint.solve(0, &u0[0], end_time, &G_minus, unused);
+      if (check_flag(&flag, "SegmentedAdjoint::solve", 1)) return(1);
+      *p[k] = value;
+      realtype fd = (G_plus - G_minus) / (2 * h);
+      std::cout << names[k] << ": adjoint " << gradient[k] <<
+          ", finite differences " << fd << ", relative difference " <<
+          SUNRabs(gradient[k] - fd) / SUNRabs(fd) << "\n";
+    }
+    return(0);
+  }
+
+  const char *store = in_file ? "file" : "memory";
+  if (csv) {
+    std::cout << segments << "," << SUNMIN(snapshots, segments) << "," <<
+        store << "," << seconds << "," << peak_rss_kb() << "," <<
+        adjoint.forward_segments() << "," << data.f_evals << "," <<
+        data.fB_evals << "," << G << "," << gradient[0] << "," <<
+        gradient[1] << "\n";
+    return(0);
+  }
+  std::cout << "cells: " << data.cells << ", end_time: " << end_time << "\n";
+  std::cout << "segments: " << segments << ", snapshots: " <<
+      SUNMIN(snapshots, segments) << " (" << store << ")\n";
+  std::cout << "G:                   " << G << "\n";
+  std::cout << "dG/dd:               " << gradient[0] << "\n";
+  std::cout << "dG/dr:               " << gradient[1] << "\n";
+  std::cout << "seconds:             " << seconds << "\n";
+  std::cout << "peak RSS:            " << peak_rss_kb() / 1024.0 << " MB\n";
+  std::cout << "forward segments:    " << adjoint.forward_segments() << "\n";
+  std::cout << "f evaluations:       " << data.f_evals << "\n";
+  std::cout << "fB evaluations:      " << data.fB_evals << "\n";
+
+  return(0);
+}
+
+// Second difference of u at cell i with zero flux at both ends.
+static inline realtype laplacian(const realtype *u, sunindextype i,
+                                 sunindextype n, realtype dx) {
+  realtype left = (i > 0) ? u[i - 1] : u[i];
+  realtype right = (i < n - 1) ? u[i + 1] : u[i];
+  return (left - 2 * u[i] + right) / (dx * dx);
+}
+
+// Right hand side of the forward problem, u' = d*u_xx + r*u*(1-u).
+static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  UserData *data = (UserData *) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *dudata = N_VGetArrayPointer(u_dot);
+  sunindextype n = data->cells;
+
+  for (sunindextype i = 0; i < n; i++) {
+    dudata[i] = data->d * laplacian(udata, i, n, data->dx) +
+        data->r * udata[i] * (1 - udata[i]);
+  }
+  data->f_evals++;
+
+  return(0);
+}
+
+// Jacobian times vector, J*v = d*v_xx + r*(1-2u)*v.
+static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
+               void *user_data, N_Vector tmp) {
+  UserData *data = (UserData *) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *vdata  = N_VGetArrayPointer(v);
+  realtype *Jvdata = N_VGetArrayPointer(Jv);
+  sunindextype n = data->cells;
+
+  for (sunindextype i = 0; i < n; i++) {
+    Jvdata[i] = data->d * laplacian(vdata, i, n, data->dx) +
+        data->r * (1 - 2 * udata[i]) * vdata[i];
+  }
+
+  return(0);
+}
+
+// Integrand g = sum(u)*dx of the objective.
+static int fQ(realtype t, N_Vector u, N_Vector q_dot, void *user_data) {
+  UserData *data = (UserData *) user_data;
+  realtype *udata = N_VGetArrayPointer(u);
+
+  realtype sum = 0;
+  for (sunindextype i = 0; i < data->cells; i++) sum += udata[i];
+  NV_DATA_S(q_dot)[0] = sum * data->dx;
+
+  return(0);
+}
+
+// Right hand side of the backward problem, lambda' = -J^T lambda - dg/du.
+// The zero flux second difference is symmetric, so J^T = J.
+static int fB(realtype t, N_Vector u, N_Vector uB, N_Vector uB_dot,
+              void *user_data) {
+  UserData *data = (UserData *) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *uBdata = N_VGetArrayPointer(uB);
+  realtype *duBdata = N_VGetArrayPointer(uB_dot);
+  sunindextype n = data->cells;
+
+  for (sunindextype i = 0; i < n; i++) {
+    duBdata[i] = -data->d * laplacian(uBdata, i, n, data->dx) -
+        data->r * (1 - 2 * udata[i]) * uBdata[i] - data->dx;
+  }
+  data->fB_evals++;
+
+  return(0);
+}
+
+// Jacobian of fB with respect to lambda times vector, -J^T*v.
+static int jtvB(N_Vector vB, N_Vector JvB, realtype t, N_Vector u,
+                N_Vector uB, N_Vector fuB, void *user_data, N_Vector tmpB) {
+  int flag = jtv(vB, JvB, t, u, NULL, user_data, tmpB);
+  N_VScale(-1, JvB, JvB);
+  return(flag);
+}
+
+// Integrand of the gradient, -lambda^T df/dp with df/dd = u_xx and
+// df/dr = u*(1-u). See the simple adjoint example for the sign.
+static int fQB(realtype t, N_Vector u, N_Vector uB, N_Vector qB_dot,
+               void *user_data) {
+  UserData *data = (UserData *) user_data;
+  realtype *udata  = N_VGetArrayPointer(u);
+  realtype *uBdata = N_VGetArrayPointer(uB);
+  sunindextype n = data->cells;
+
+  realtype dd = 0, dr = 0;
+  for (sunindextype i = 0; i < n; i++) {
+    dd -= uBdata[i] * laplacian(udata, i, n, data->dx);
+    dr -= uBdata[i] * udata[i] * (1 - udata[i]);
+  }
+  NV_DATA_S(qB_dot)[0] = dd;
+  NV_DATA_S(qB_dot)[1] = dr;
+
+  return(0);
+}
+
+// Peak resident memory of the process so far. ru_maxrss is in kilobytes on
+// Linux and in bytes on macOS.
+static long int peak_rss_kb() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return(-1);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
@@ -0,0 +1,85 @@
+#include "checkpoint_store.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+CheckpointStore::CheckpointStore()
+    : num_slots_(0), N_(0), slot_bytes_(0), map_(NULL), fd_(-1) {}
+
+CheckpointStore::~CheckpointStore() { close(); }
+
+int CheckpointStore::create(int num_slots, sunindextype N, const char *path) {
+  close();
+  if (num_slots < 1 || N < 1) return(-1);
+  num_slots_ = num_slots;
+  N_ = N;
+  slot_bytes_ = (N + 1) * sizeof(realtype);
+
+  if (path == NULL) {
+    memory_.assign((size_t) num_slots * (N + 1), 0);
+    return(0);
+  }
+
+  // Whole pages per slot, so dropping one slot never touches its neighbours.
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  slot_bytes_ = (slot_bytes_ + page - 1) / page * page;
+
+  fd_ = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd_ < 0) {
+    num_slots_ = 0;
+    return(-1);
+  }
+  unlink(path);
+  if (ftruncate(fd_, (off_t) bytes()) != 0) {
+    close();
+    return(-1);
+  }
+  void *map = mmap(NULL, bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    close();
+    return(-1);
+  }
+  map_ = (char *) map;
+  return(0);
+}
+
+realtype *CheckpointStore::slot_data(int slot) {
+  if (map_ != NULL) return (realtype *) (map_ + slot * slot_bytes_);
+  return &memory_[(size_t) slot * (N_ + 1)];
+}
+
+int CheckpointStore::write(int slot, realtype t, const realtype *y) {
+  if (slot < 0 || slot >= num_slots_) return(-1);
+  realtype *data = slot_data(slot);
+  data[0] = t;
+  memcpy(data + 1, y, N_ * sizeof(realtype));
+  // The pages of a shared file mapping are written back by the OS, dropping
+  // them here only releases them from this process.
+  if (map_ != NULL && madvise(data, slot_bytes_, MADV_DONTNEED) != 0) {
+    return(-1);
+  }
+  return(0);
+}
+
+int CheckpointStore::read(int slot, realtype *t, realtype *y) {
+  if (slot < 0 || slot >= num_slots_) return(-1);
+  realtype *data = slot_data(slot);
+  *t = data[0];
+  memcpy(y, data + 1, N_ * sizeof(realtype));
+  if (map_ != NULL && madvise(data, slot_bytes_, MADV_DONTNEED) != 0) {
+    return(-1);
+  }
+  return(0);
+}
+
+void CheckpointStore::close() {
+  if (map_ != NULL) munmap(map_, bytes());
+  if (fd_ >= 0) ::close(fd_);
+  map_ = NULL;
+  fd_ = -1;
+  std::vector < realtype >().swap(memory_);
+  num_slots_ = 0;
+}
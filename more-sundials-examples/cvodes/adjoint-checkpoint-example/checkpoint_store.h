@@ -0,0 +1,55 @@
+/*
+Fixed number of slots, each holding a time and a state vector, for the
+checkpoints of a segmented adjoint computation.
+
+The slots either live in memory or in a memory-mapped file. In a file every
+slot covers whole pages, and after a slot is written or read its pages are
+dropped from the process with madvise. The data stays in the file (and in the
+page cache while the OS has room for it), so the checkpoints do not count
+against the resident memory of the process and a long run can keep more of
+them than fits in RAM. The file is unlinked right after it is created, so it
+disappears when the store is closed or the process ends.
+
+The functions returning int return 0 on success or -1 on failure.
+*/
+
+#ifndef CHECKPOINT_STORE_H
+#define CHECKPOINT_STORE_H
+
+#include <cstddef>
+#include <vector>
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+class CheckpointStore {
+ public:
+  CheckpointStore();
+  ~CheckpointStore(); // closes the store
+
+  // Makes room for num_slots states of length N. With path NULL the slots are
+  // kept in memory, otherwise in a new file at path.
+  int create(int num_slots, sunindextype N, const char *path);
+
+  int write(int slot, realtype t, const realtype *y);
+  int read(int slot, realtype *t, realtype *y);
+
+  void close();
+
+  int num_slots() const { return num_slots_; }
+  bool in_file() const { return map_ != NULL; }
+  size_t bytes() const { return (size_t) num_slots_ * slot_bytes_; }
+
+ private:
+  CheckpointStore(const CheckpointStore&);
+  CheckpointStore& operator=(const CheckpointStore&);
+
+  realtype *slot_data(int slot);
+
+  int num_slots_;
+  sunindextype N_;
+  size_t slot_bytes_; // t and y, rounded up to whole pages in a file
+  std::vector < realtype > memory_;
+  char *map_; // NULL for a store in memory
+  int fd_;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#!/bin/bash
+# Runs the adjoint example with a range of checkpoint settings, each in its own
+# process so the peak resident memory is measured per setting. Prints one comma
+# separated line per run.
+#
+# Usage: ./compare.sh [executable]
+
+EXE=${1:-./executable}
+
+echo "segments,snapshots,store,seconds,peak_rss_kb,forward_segments,f_evals,fB_evals,G,dG_dd,dG_dr"
+# Plain CVODES, all interpolation data in memory.
+$EXE 1 1 memory csv
+# Uniform spacing, every segment boundary stored.
+for segments in 4 16 64 256; do
+  $EXE $segments $segments memory csv
+  $EXE $segments $segments file csv
+done
+# Binomial spacing with a fixed number of snapshots.
+for snapshots in 2 4 8 16; do
+  $EXE 256 $snapshots memory csv
+done
@@ -0,0 +1,251 @@
+#include "segmented_adjoint.h"
+
+// Number of segments revolve can reverse with s snapshots, counting the one the
+// reversal starts from, when every segment is integrated forward at most r
+// extra times: (s + r)! / (s! r!).
+static double binomial(int s, int r) {
+  double beta = 1;
+  for (int i = 1; i <= s; i++) beta = beta * (r + i) / i;
+  return beta;
+}
+
+
+SegmentedAdjoint::SegmentedAdjoint()
+    : N_(0), reltol_(0), abstol_(0), cvode_mem_(NULL), indexB_(0),
+      backward_ready_(false), y_(NULL), yB_(NULL), q_(NULL), qB_(NULL),
+      LS_(NULL), LSB_(NULL), segments_(1), snapshots_(1), path_(NULL),
+      t0_(0), tf_(0), at_(-1), forward_segments_(0) {}
+
+SegmentedAdjoint::~SegmentedAdjoint() { destroy(); }
+
+void SegmentedAdjoint::destroy() {
+  if (cvode_mem_ != NULL) CVodeFree(&cvode_mem_);
+  if (LS_ != NULL) SUNLinSolFree(LS_);
+  if (LSB_ != NULL) SUNLinSolFree(LSB_);
+  if (y_ != NULL) N_VDestroy(y_);
+  if (yB_ != NULL) N_VDestroy(yB_);
+  if (q_ != NULL) N_VDestroy(q_);
+  if (qB_ != NULL) N_VDestroy(qB_);
+  cvode_mem_ = NULL;
+  LS_ = LSB_ = NULL;
+  y_ = yB_ = q_ = qB_ = NULL;
+  backward_ready_ = false;
+  store_.close();
+}
+
+int SegmentedAdjoint::create(const AdjointProblem &problem, sunindextype N,
+                             realtype reltol, realtype abstol,
+                             long int nsteps) {
+  destroy();
+  problem_ = problem;
+  N_ = N;
+  reltol_ = reltol;
+  abstol_ = abstol;
+
+  y_ = N_VNew_Serial(N);
+  yB_ = N_VNew_Serial(N);
+  q_ = N_VNew_Serial(problem.num_objectives);
+  qB_ = N_VNew_Serial(problem.num_params);
+  if (y_ == NULL || yB_ == NULL || q_ == NULL || qB_ == NULL) return(-1);
+  N_VConst(0, y_);
+  N_VConst(0, q_);
+
+  // Forward problem, as in steps 5 to 13 of the simple adjoint example.
+  int flag;
+  cvode_mem_ = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (cvode_mem_ == NULL) return(-1);
+  flag = CVodeInit(cvode_mem_, problem.f, 0, y_);
+  if (flag < 0) return(flag);
+  flag = CVodeSStolerances(cvode_mem_, reltol, abstol);
+  if (flag < 0) return(flag);
+  flag = CVodeSetUserData(cvode_mem_, problem.user_data);
+  if (flag < 0) return(flag);
+  LS_ = SUNSPGMR(y_, 0, 0);
+  if (LS_ == NULL) return(-1);
+  flag = CVSpilsSetLinearSolver(cvode_mem_, LS_);
+  if (flag < 0) return(flag);
+  flag = CVSpilsSetJacTimes(cvode_mem_, NULL, problem.jtv);
+  if (flag < 0) return(flag);
+  flag = CVodeQuadInit(cvode_mem_, problem.fQ, q_);
+  if (flag < 0) return(flag);
+
+  // The backward problem is initialized in the first reverse_segment, CVODES
+  // needs a forward pass to check its initial time against.
+  flag = CVodeAdjInit(cvode_mem_, nsteps, CV_HERMITE);
+  if (flag < 0) return(flag);
+  flag = CVodeCreateB(cvode_mem_, CV_BDF, CV_NEWTON, &indexB_);
+  if (flag < 0) return(flag);
+  LSB_ = SUNSPGMR(yB_, 0, 0);
+  if (LSB_ == NULL) return(-1);
+
+  return(0);
+}
+
+int SegmentedAdjoint::set_checkpoints(int segments, int snapshots,
+                                      const char *path) {
+  if (segments < 1 || snapshots < 1) return(-1);
+  segments_ = segments;
+  snapshots_ = (snapshots < segments) ? snapshots : segments;
+  path_ = path;
+  return(0);
+}
+
+realtype SegmentedAdjoint::boundary(int k) const {
+  if (k == segments_) return tf_;
+  return t0_ + (tf_ - t0_) * k / segments_;
+}
+
+int SegmentedAdjoint::solve(realtype t0, const realtype *y0, realtype tf,
+                            realtype *G, realtype *gradient) {
+  if (cvode_mem_ == NULL) return(-1);
+  t0_ = t0;
+  tf_ = tf;
+  forward_segments_ = 0;
+
+  if (store_.create(snapshots_, N_, path_) != 0) return(-1);
+  if (store_.write(0, t0, y0) != 0) return(-1);
+
+  // The first forward pass starts here and runs without restarts up to the
+  // last segment, so the quadrature of g covers the whole interval.
+  int flag;
+  realtype *ydata = N_VGetArrayPointer(y_);
+  for (sunindextype i = 0; i < N_; i++) ydata[i] = y0[i];
+  flag = CVodeReInit(cvode_mem_, t0, y_);
+  if (flag < 0) return(flag);
+  N_VConst(0, q_);
+  flag = CVodeQuadReInit(cvode_mem_, q_);
+  if (flag < 0) return(flag);
+  at_ = 0;
+
+  N_VConst(0, yB_);
+  N_VConst(0, qB_);
+  flag = reverse(0, segments_, 0);
+  store_.close();
+  if (flag < 0) return(flag);
+
+  realtype *qdata = N_VGetArrayPointer(q_);
+  realtype *qBdata = N_VGetArrayPointer(qB_);
+  for (int i = 0; i < problem_.num_objectives; i++) G[i] = qdata[i];
+  for (int i = 0; i < problem_.num_params; i++) gradient[i] = qBdata[i];
+  return(0);
+}
+
+// Puts the forward solver at boundary k, restarting it from the state in slot
+// unless it already continues from there.
+int SegmentedAdjoint::load(int slot, int k) {
+  if (at_ == k) return(0);
+  realtype t;
+  if (store_.read(slot, &t, N_VGetArrayPointer(y_)) != 0) return(-1);
+  int flag = CVodeReInit(cvode_mem_, t, y_);
+  if (flag < 0) return(flag);
+  at_ = k;
+  return(0);
+}
+
+// Integrates forward from the current boundary to boundary k.
+int SegmentedAdjoint::advance(int k) {
+  realtype t;
+  int flag = CVodeSetStopTime(cvode_mem_, boundary(k));
+  if (flag < 0) return(flag);
+  flag = CVode(cvode_mem_, boundary(k), y_, &t, CV_NORMAL);
+  if (flag < 0) return(flag);
+  forward_segments_ += k - at_;
+  at_ = k;
+  return(0);
+}
+
+// Reverses segments a to b-1. The state at boundary a is in slot, the slots
+// after it are free.
+int SegmentedAdjoint::reverse(int a, int b, int slot) {
+  int flag;
+  while (b - a > 1) {
+    int free = snapshots_ - 1 - slot;
+    if (free == 0) {
+      // No room left, every boundary is recomputed from a.
+      for (int k = b - 1; k > a; k--) {
+        flag = load(slot, a);
+        if (flag < 0) return(flag);
+        flag = advance(k);
+        if (flag < 0) return(flag);
+        flag = reverse_segment(k);
+        if (flag < 0) return(flag);
+      }
+      break;
+    }
+
+    // Smallest number of recomputations r that reverses b - a segments with
+    // the snapshots left, then the split that leaves the right part
+    // reversible with one snapshot less.
+    int r = 1;
+    while (binomial(free + 1, r) < b - a) r++;
+    int c = b - (int) binomial(free, r);
+    if (c <= a) c = a + 1;
+
+    flag = load(slot, a);
+    if (flag < 0) return(flag);
+    flag = advance(c);
+    if (flag < 0) return(flag);
+    if (store_.write(slot + 1, boundary(c), N_VGetArrayPointer(y_)) != 0) {
+      return(-1);
+    }
+    flag = reverse(c, b, slot + 1);
+    if (flag < 0) return(flag);
+    b = c;
+  }
+
+  flag = load(slot, a);
+  if (flag < 0) return(flag);
+  return(reverse_segment(a));
+}
+
+// Records segment k with CVodeF and integrates the backward problem over it.
+int SegmentedAdjoint::reverse_segment(int k) {
+  realtype ta = boundary(k);
+  realtype tb = boundary(k + 1);
+  realtype t;
+  int ncheck;
+
+  // CVODES keeps the backward problems but drops its checkpoints. CVodeF
+  // steps past tb, so tb lies inside the recorded interval.
+  int flag = CVodeAdjReInit(cvode_mem_);
+  if (flag < 0) return(flag);
+  flag = CVodeF(cvode_mem_, tb, y_, &t, CV_NORMAL, &ncheck);
+  if (flag < 0) return(flag);
+  forward_segments_++;
+  at_ = -1;
+  if (k == segments_ - 1) {
+    flag = CVodeGetQuad(cvode_mem_, &t, q_);
+    if (flag < 0) return(flag);
+  }
+
+  if (!backward_ready_) {
+    flag = CVodeInitB(cvode_mem_, indexB_, problem_.fB, tb, yB_);
+    if (flag < 0) return(flag);
+    flag = CVodeSStolerancesB(cvode_mem_, indexB_, reltol_, abstol_);
+    if (flag < 0) return(flag);
+    flag = CVodeSetUserDataB(cvode_mem_, indexB_, problem_.user_data);
+    if (flag < 0) return(flag);
+    flag = CVSpilsSetLinearSolverB(cvode_mem_, indexB_, LSB_);
+    if (flag < 0) return(flag);
+    flag = CVSpilsSetJacTimesB(cvode_mem_, indexB_, NULL, problem_.jtvB);
+    if (flag < 0) return(flag);
+    flag = CVodeQuadInitB(cvode_mem_, indexB_, problem_.fQB, qB_);
+    if (flag < 0) return(flag);
+    flag = CVodeSetQuadErrConB(cvode_mem_, indexB_, SUNTRUE);
+    if (flag < 0) return(flag);
+    flag = CVodeQuadSStolerancesB(cvode_mem_, indexB_, reltol_, abstol_);
+    if (flag < 0) return(flag);
+    backward_ready_ = true;
+  } else {
+    flag = CVodeReInitB(cvode_mem_, indexB_, tb, yB_);
+    if (flag < 0) return(flag);
+    flag = CVodeQuadReInitB(cvode_mem_, indexB_, qB_);
+    if (flag < 0) return(flag);
+  }
+
+  flag = CVodeB(cvode_mem_, ta, CV_NORMAL);
+  if (flag < 0) return(flag);
+  flag = CVodeGetB(cvode_mem_, indexB_, &t, yB_);
+  if (flag < 0) return(flag);
+  return(CVodeGetQuadB(cvode_mem_, indexB_, &t, qB_));
+}
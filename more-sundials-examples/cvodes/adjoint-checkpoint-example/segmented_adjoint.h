@@ -0,0 +1,112 @@
+/*
+Adjoint sensitivity analysis of an integral objective
+
+  G = integral from t0 to tf of g(t, y) dt
+
+with two levels of checkpoints. The interval is split into equal segments. The
+outer level keeps the forward state at some segment boundaries in a
+CheckpointStore, in memory or in a memory-mapped file. The inner level is the
+usual CVODES one: every segment is integrated once more with CVodeF and then
+backward with CVodeB, so CVODES only ever holds the interpolation data of one
+segment. Memory use is therefore bounded by the segment length instead of the
+whole time horizon.
+
+With segments == snapshots every boundary is stored during the first forward
+pass (uniform spacing). With fewer snapshots than segments the boundaries are
+placed with the binomial rule of Griewank's revolve: the forward pass is
+recomputed from the stored boundaries as needed, with the smallest number of
+recomputed segments for the given number of snapshots. One segment and one
+snapshot is the plain CVODES adjoint with all interpolation data in memory.
+
+The backward problem solves lambda' = fB(t, y, lambda) from lambda(tf) = 0
+with quadratures qB' = fQB(t, y, lambda) from qB(tf) = 0. With fB and fQB as in
+the simple adjoint example qB(t0) is the gradient of G. The backward solution
+and the quadratures are handed from one segment to the next with
+CVodeReInitB and CVodeQuadReInitB.
+*/
+
+#ifndef SEGMENTED_ADJOINT_H
+#define SEGMENTED_ADJOINT_H
+
+#include <cvodes/cvodes.h> // prototypes for CVODE fcts., consts.
+#include <cvodes/cvodes_spils.h> // access to CVSpils interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "checkpoint_store.h"
+
+struct AdjointProblem {
+  CVRhsFn f; // forward right hand side
+  CVSpilsJacTimesVecFn jtv; // NULL for CVODES' difference quotient
+  CVQuadRhsFn fQ; // integrand g of the objective
+  int num_objectives; // length of the quadrature of g
+  CVRhsFnB fB; // backward right hand side
+  CVSpilsJacTimesVecFnB jtvB;
+  CVQuadRhsFnB fQB; // integrand of the gradient
+  int num_params; // length of the gradient
+  void *user_data; // handed to every function above
+};
+
+class SegmentedAdjoint {
+ public:
+  SegmentedAdjoint();
+  ~SegmentedAdjoint();
+
+  // Creates the forward and backward solvers for vectors of length N. nsteps
+  // is the number of steps between the CVODES checkpoints inside a segment.
+  // Returns 0, the negative flag of the failing CVODES function, or -1 when
+  // memory cannot be allocated.
+  int create(const AdjointProblem &problem, sunindextype N, realtype reltol,
+             realtype abstol, long int nsteps);
+
+  // Splits [t0, tf] into segments and keeps at most snapshots of the segment
+  // boundaries, in memory with path NULL or in a file at path. Returns 0, or
+  // -1 for fewer than one segment or snapshot.
+  int set_checkpoints(int segments, int snapshots, const char *path);
+
+  // Integrates from y0 at t0 to tf and back. G gets num_objectives values,
+  // gradient gets num_params values. Returns 0, the negative flag of the
+  // failing CVODES function, or -1 before create() or when the snapshots
+  // cannot be stored.
+  int solve(realtype t0, const realtype *y0, realtype tf, realtype *G,
+            realtype *gradient);
+
+  // Number of segments integrated forward in the last solve. The CVodeF
+  // recording of every segment counts, so with a snapshot for every boundary
+  // it is 2*segments - 1: segments - 1 to reach the last boundary, then one
+  // recording per segment. With fewer snapshots it grows by the segments
+  // recomputed from earlier boundaries.
+  long int forward_segments() const { return forward_segments_; }
+  const CheckpointStore &store() const { return store_; }
+  void *cvode_mem() const { return cvode_mem_; }
+
+ private:
+  SegmentedAdjoint(const SegmentedAdjoint&);
+  SegmentedAdjoint& operator=(const SegmentedAdjoint&);
+
+  realtype boundary(int k) const;
+  int load(int slot, int k);
+  int advance(int k);
+  int reverse(int a, int b, int slot);
+  int reverse_segment(int k);
+  void destroy();
+
+  AdjointProblem problem_;
+  sunindextype N_;
+  realtype reltol_, abstol_;
+  void *cvode_mem_;
+  int indexB_;
+  bool backward_ready_; // CVodeInitB was called
+  N_Vector y_, yB_, q_, qB_;
+  SUNLinearSolver LS_, LSB_;
+
+  int segments_, snapshots_;
+  const char *path_;
+  CheckpointStore store_;
+  realtype t0_, tf_;
+  int at_; // boundary the forward solver continues from, -1 if none
+  long int forward_segments_;
+};
+
+#endif
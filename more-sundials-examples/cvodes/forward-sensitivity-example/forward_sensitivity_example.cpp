@@ -0,0 +1,177 @@
+/*
+Forward sensitivity analysis with CVODES, next to the adjoint method of the
+simple adjoint example (see gradient.h).
+
+Without arguments the gradient of G = integral of y1 dt of the simple
+adjoint example with respect to its coefficients p = (101, 100) is computed
+with forward sensitivities, simultaneous and staggered, and with the adjoint
+method, and printed with the exact values for an infinite time horizon.
+
+With --bench the gradient of the decay chain of gradient_problems.h with N
+compartments is computed for the first Ns = 1, 2, 4, ... N rates with all
+three methods. For every Ns the best time of repeats runs, the memory of the
+forward (staggered) and the adjoint method and the largest relative
+difference of the two gradients are printed, then the Ns from which on the
+adjoint method is faster than both forward methods.
+
+Usage: ./executable
+       ./executable --bench [N] [repeats]
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <cvodes/cvodes.h> // prototypes for CVODE fcts., consts.
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "gradient.h"
+#include "gradient_problems.h"
+
+static int run_simple();
+static int run_bench(sunindextype N, int repeats);
+static int best_of(const GradientProblem &problem, int Ns, int method,
+                   int repeats, GradientResult *result);
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+// Methods of best_of: the two forward corrector strategies and the adjoint.
+enum { FORWARD_SIMULTANEOUS, FORWARD_STAGGERED, ADJOINT };
+
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    sunindextype N = (argc > 2) ? std::atol(argv[2]) : 64;
+    int repeats = (argc > 3) ? std::atoi(argv[3]) : 5;
+    if (N < 1) N = 1;
+    if (repeats < 1) repeats = 1;
+    return(run_bench(N, repeats));
+  }
+  return(run_simple());
+}
+
+static int run_simple() {
+  SimpleData data;
+  GradientProblem problem = make_simple_problem(&data);
+  const char *names[3] = {"simultaneous", "staggered", "adjoint"};
+
+  printf("%-13s %9s %12s %12s %9s %6s %6s %6s %8s\n", "method", "G",
+         "dG/dp0", "dG/dp1", "seconds", "steps", "f", "fS", "memory");
+  for (int method = FORWARD_SIMULTANEOUS; method <= ADJOINT; method++) {
+    GradientResult result;
+    int flag = best_of(problem, 2, method, 1, &result);
+    if (check_flag(&flag, names[method], 1)) return(1);
+    printf("%-13s %9.6f %12.6e %12.6e %9.6f %6ld %6ld %6ld %8ld\n",
+           names[method], (double) result.G, (double) result.gradient[0],
+           (double) result.gradient[1], result.seconds, result.forward.steps,
+           result.forward.rhs_evals, result.sens_rhs_evals, result.memory);
+  }
+
+  // For end_time -> infinity, G = (y0(0) + p0*y1(0))/p1.
+  realtype y0 = problem.y0[0], y1 = problem.y0[1];
+  printf("%-13s %9.6f %12.6e %12.6e\n", "exact", (double) ((y0 + data.p[0] *
+         y1) / data.p[1]), (double) (1.0 / data.p[1]),
+         (double) (-(y0 + data.p[0] * y1) / (data.p[1] * data.p[1])));
+  printf("\nfS is -1 for the adjoint method, its steps and f are those of "
+         "CVodeF.\n");
+  return(0);
+}
+
+static int run_bench(sunindextype N, int repeats) {
+  ChainData data;
+  GradientProblem problem = make_chain_problem(&data, N);
+
+  printf("decay chain, N = %ld, best of %d\n\n", (long) N, repeats);
+  printf("%5s %13s %13s %13s %11s %11s %10s\n", "Ns", "simultaneous",
+         "staggered", "adjoint", "mem fwd", "mem adj", "max_diff");
+  int crossover = -1;
+  std::vector < int > counts;
+  for (int Ns = 1; Ns < N; Ns *= 2) counts.push_back(Ns);
+  counts.push_back(N);
+
+  for (size_t c = 0; c < counts.size(); c++) {
+    int Ns = counts[c];
+    GradientResult result[3];
+    for (int method = FORWARD_SIMULTANEOUS; method <= ADJOINT; method++) {
+      int flag = best_of(problem, Ns, method, repeats, &result[method]);
+      if (check_flag(&flag, "best_of", 1)) return(1);
+    }
+
+    realtype max_diff = 0;
+    for (int k = 0; k < Ns; k++) {
+      realtype a = result[FORWARD_STAGGERED].gradient[k];
+      realtype b = result[ADJOINT].gradient[k];
+      realtype scale = SUNMAX(SUNRabs(a), SUNRabs(b));
+      if (scale > 0) max_diff = SUNMAX(max_diff, SUNRabs(a - b) / scale);
+    }
+    double forward = SUNMIN(result[FORWARD_SIMULTANEOUS].seconds,
+                            result[FORWARD_STAGGERED].seconds);
+    if (crossover < 0 && result[ADJOINT].seconds < forward) crossover = Ns;
+
+    printf("%5d %13.6f %13.6f %13.6f %11ld %11ld %10.2e\n", Ns,
+           result[FORWARD_SIMULTANEOUS].seconds,
+           result[FORWARD_STAGGERED].seconds, result[ADJOINT].seconds,
+           result[FORWARD_STAGGERED].memory, result[ADJOINT].memory,
+           (double) max_diff);
+  }
+
+  if (crossover > 0) {
+    printf("\nadjoint is faster from Ns = %d on\n", crossover);
+  } else {
+    printf("\nforward is faster for every Ns up to %ld\n", (long) N);
+  }
+  return(0);
+}
+
+// Runs a method repeats times and keeps the result of the fastest run.
+static int best_of(const GradientProblem &problem, int Ns, int method,
+                   int repeats, GradientResult *result) {
+  for (int r = 0; r < repeats; r++) {
+    GradientResult run;
+    int flag;
+    if (method == ADJOINT) {
+      flag = adjoint_gradient(problem, Ns, (problem.N > 2) ? 100 : 1000, &run);
+    } else {
+      flag = forward_gradient(problem, Ns, (method == FORWARD_STAGGERED) ?
+                              CV_STAGGERED : CV_SIMULTANEOUS, &run);
+    }
+    if (flag != 0) return(flag);
+    if (r == 0 || run.seconds < result->seconds) *result = run;
+  }
+  return(0);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
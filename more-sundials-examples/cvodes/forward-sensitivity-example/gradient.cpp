@@ -0,0 +1,204 @@
+#include "gradient.h"
+
+#include <cstdio>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+#include "cvode_stats.h"  // collect_cvode_stats
+
+// Vectors of a CVODES checkpoint, the Nordsieck array of BDF up to order 5.
+#define CHECKPOINT_VECTORS 6
+
+static void *create_forward(const GradientProblem &problem, N_Vector y,
+                            N_Vector q, SUNLinearSolver *LS);
+
+
+int forward_gradient(const GradientProblem &problem, int Ns, int ism,
+                     GradientResult *result) {
+  if (Ns < 1 || Ns > problem.num_params) return(-1);
+  int flag = -1;
+  double start = stats_now();
+
+  N_Vector y = N_VNew_Serial(problem.N);
+  N_Vector q = N_VNew_Serial(1);
+  N_Vector *yS = N_VCloneVectorArray_Serial(Ns, y);
+  N_Vector *qS = N_VCloneVectorArray_Serial(Ns, q);
+  SUNLinearSolver LS = NULL;
+  void *cvode_mem = NULL;
+  // The sensitivity tolerances are scaled with |p_k|.
+  std::vector < realtype > pbar(Ns);
+  std::vector < int > plist(Ns);
+  realtype t;
+  long int lenrw, leniw;
+
+  if (y == NULL || q == NULL || yS == NULL || qS == NULL) goto cleanup;
+  for (sunindextype i = 0; i < problem.N; i++) {
+    NV_DATA_S(y)[i] = problem.y0[i];
+  }
+  NV_DATA_S(q)[0] = 0;
+  for (int k = 0; k < Ns; k++) {
+    N_VConst(0, yS[k]);
+    N_VConst(0, qS[k]);
+    pbar[k] = (problem.p[k] != 0) ? SUNRabs(problem.p[k]) : 1;
+    plist[k] = k;
+  }
+
+  cvode_mem = create_forward(problem, y, q, &LS);
+  if (cvode_mem == NULL) goto cleanup;
+  if (CVodeSensInit(cvode_mem, Ns, ism, problem.fS, yS) < 0 ||
+      CVodeSensEEtolerances(cvode_mem) < 0 ||
+      CVodeSetSensErrCon(cvode_mem, SUNTRUE) < 0 ||
+      CVodeSetSensParams(cvode_mem, NULL, &pbar[0], &plist[0]) < 0 ||
+      CVodeQuadSensInit(cvode_mem, problem.fQS, qS) < 0 ||
+      CVodeQuadSensEEtolerances(cvode_mem) < 0 ||
+      CVodeSetQuadSensErrCon(cvode_mem, SUNTRUE) < 0) {
+    goto cleanup;
+  }
+
+  result->forward.flag = CVode(cvode_mem, problem.tout, y, &t, CV_NORMAL);
+  if (result->forward.flag < 0 ||
+      CVodeGetQuad(cvode_mem, &t, q) < 0 ||
+      CVodeGetQuadSens(cvode_mem, &t, qS) < 0) {
+    goto cleanup;
+  }
+  result->seconds = stats_now() - start;
+
+  result->G = NV_DATA_S(q)[0];
+  result->gradient.resize(Ns);
+  for (int k = 0; k < Ns; k++) result->gradient[k] = NV_DATA_S(qS[k])[0];
+  result->backward.reset();
+  result->checkpoints = 0;
+  if (collect_cvode_stats(cvode_mem, LS, &result->forward) < 0 ||
+      CVodeGetSensNumRhsEvals(cvode_mem, &result->sens_rhs_evals) < 0 ||
+      CVodeGetWorkSpace(cvode_mem, &lenrw, &leniw) < 0) {
+    goto cleanup;
+  }
+  result->memory = lenrw;
+  flag = 0;
+
+cleanup:
+  if (cvode_mem != NULL) CVodeFree(&cvode_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+  if (yS != NULL) N_VDestroyVectorArray_Serial(yS, Ns);
+  if (qS != NULL) N_VDestroyVectorArray_Serial(qS, Ns);
+  if (y != NULL) N_VDestroy(y);
+  if (q != NULL) N_VDestroy(q);
+  return(flag);
+}
+
+int adjoint_gradient(const GradientProblem &problem, int Ns, long int steps,
+                     GradientResult *result) {
+  if (Ns < 1 || Ns > problem.num_params) return(-1);
+  int flag = -1;
+  double start = stats_now();
+
+  N_Vector y = N_VNew_Serial(problem.N);
+  N_Vector q = N_VNew_Serial(1);
+  N_Vector yB = N_VNew_Serial(problem.N);
+  N_Vector qB = N_VNew_Serial(Ns);
+  SUNLinearSolver LS = NULL, LSB = NULL;
+  void *cvode_mem = NULL;
+  void *cvode_memB;
+  int indexB, ncheck;
+  realtype t;
+  long int lenrw, leniw, lenrwB, leniwB;
+
+  if (y == NULL || q == NULL || yB == NULL || qB == NULL) goto cleanup;
+  for (sunindextype i = 0; i < problem.N; i++) {
+    NV_DATA_S(y)[i] = problem.y0[i];
+  }
+  NV_DATA_S(q)[0] = 0;
+  N_VConst(0, yB);
+  N_VConst(0, qB);
+
+  cvode_mem = create_forward(problem, y, q, &LS);
+  if (cvode_mem == NULL) goto cleanup;
+  if (CVodeAdjInit(cvode_mem, steps, CV_HERMITE) < 0) goto cleanup;
+  result->forward.flag = CVodeF(cvode_mem, problem.tout, y, &t, CV_NORMAL,
+                                &ncheck);
+  if (result->forward.flag < 0 || CVodeGetQuad(cvode_mem, &t, q) < 0) {
+    goto cleanup;
+  }
+
+  if (CVodeCreateB(cvode_mem, CV_BDF, CV_NEWTON, &indexB) < 0 ||
+      CVodeInitB(cvode_mem, indexB, problem.fB, problem.tout, yB) < 0 ||
+      CVodeSStolerancesB(cvode_mem, indexB, problem.reltol,
+                         problem.abstol) < 0 ||
+      CVodeSetUserDataB(cvode_mem, indexB, problem.user_data) < 0 ||
+      CVodeSetMaxNumStepsB(cvode_mem, indexB, 100000) < 0) {
+    goto cleanup;
+  }
+  LSB = SUNSPGMR(yB, 0, 0);
+  if (LSB == NULL ||
+      CVSpilsSetLinearSolverB(cvode_mem, indexB, LSB) < 0 ||
+      (problem.jtvB != NULL &&
+       CVSpilsSetJacTimesB(cvode_mem, indexB, NULL, problem.jtvB) < 0) ||
+      CVodeQuadInitB(cvode_mem, indexB, problem.fQB, qB) < 0 ||
+      CVodeSetQuadErrConB(cvode_mem, indexB, SUNTRUE) < 0 ||
+      CVodeQuadSStolerancesB(cvode_mem, indexB, problem.reltol,
+                             problem.abstol) < 0) {
+    goto cleanup;
+  }
+
+  result->backward.flag = CVodeB(cvode_mem, problem.t0, CV_NORMAL);
+  if (result->backward.flag < 0 ||
+      CVodeGetQuadB(cvode_mem, indexB, &t, qB) < 0) {
+    goto cleanup;
+  }
+  result->seconds = stats_now() - start;
+
+  result->G = NV_DATA_S(q)[0];
+  result->gradient.assign(NV_DATA_S(qB), NV_DATA_S(qB) + Ns);
+  result->sens_rhs_evals = -1;
+  result->checkpoints = ncheck;
+  cvode_memB = CVodeGetAdjCVodeBmem(cvode_mem, indexB);
+  if (collect_cvode_stats(cvode_mem, LS, &result->forward) < 0 ||
+      collect_cvode_stats(cvode_memB, LSB, &result->backward) < 0 ||
+      CVodeGetWorkSpace(cvode_mem, &lenrw, &leniw) < 0 ||
+      CVodeGetWorkSpace(cvode_memB, &lenrwB, &leniwB) < 0) {
+    goto cleanup;
+  }
+  // The checkpoints stay in memory, the interpolation data is kept for the
+  // steps of one checkpoint interval.
+  result->memory = lenrw + lenrwB +
+      (long int) problem.N * (CHECKPOINT_VECTORS * (ncheck + 1) +
+                              2 * (steps + 1));
+  flag = 0;
+
+cleanup:
+  if (cvode_mem != NULL) CVodeFree(&cvode_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+  if (LSB != NULL) SUNLinSolFree(LSB);
+  if (y != NULL) N_VDestroy(y);
+  if (q != NULL) N_VDestroy(q);
+  if (yB != NULL) N_VDestroy(yB);
+  if (qB != NULL) N_VDestroy(qB);
+  return(flag);
+}
+
+// CVODES memory for y and the quadrature of g, with SPGMR. Returns NULL on
+// failure, with everything created so far freed.
+static void *create_forward(const GradientProblem &problem, N_Vector y,
+                            N_Vector q, SUNLinearSolver *LS) {
+  void *cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if (cvode_mem == NULL) return(NULL);
+  *LS = SUNSPGMR(y, 0, 0);
+  if (*LS == NULL ||
+      CVodeInit(cvode_mem, problem.f, problem.t0, y) < 0 ||
+      CVodeSStolerances(cvode_mem, problem.reltol, problem.abstol) < 0 ||
+      CVodeSetUserData(cvode_mem, problem.user_data) < 0 ||
+      CVodeSetMaxNumSteps(cvode_mem, 100000) < 0 ||
+      CVSpilsSetLinearSolver(cvode_mem, *LS) < 0 ||
+      (problem.jtv != NULL &&
+       CVSpilsSetJacTimes(cvode_mem, NULL, problem.jtv) < 0) ||
+      CVodeQuadInit(cvode_mem, problem.fQ, q) < 0 ||
+      CVodeSetQuadErrCon(cvode_mem, SUNTRUE) < 0 ||
+      CVodeQuadSStolerances(cvode_mem, problem.reltol, problem.abstol) < 0) {
+    CVodeFree(&cvode_mem);
+    if (*LS != NULL) SUNLinSolFree(*LS);
+    *LS = NULL;
+    return(NULL);
+  }
+  return(cvode_mem);
+}
@@ -0,0 +1,82 @@
+/*
+Gradient of an integral objective
+
+  G(p) = integral from t0 to tout of g(t, y) dt,   y' = f(t, y, p)
+
+with respect to the first Ns parameters p_0 .. p_{Ns-1}, by forward
+sensitivities or by the adjoint method.
+
+forward_gradient: CVodeSensInit integrates the sensitivities s_k = dy/dp_k,
+
+  s_k' = J s_k + df/dp_k,   s_k(t0) = 0,
+
+with the user's fS, and dG/dp_k is the quadrature sensitivity of G
+(integrand dg/dy s_k, the user's fQS). Every step solves Ns more systems of
+size N, so the cost grows with Ns, but nothing has to be stored. ism is
+  CV_SIMULTANEOUS: y and all s_k are corrected in one Newton iteration whose
+                   convergence and error tests cover all of them.
+  CV_STAGGERED:    the s_k are corrected after the iteration for y has
+                   converged, reusing its Jacobian. A step whose y fails
+                   costs nothing for the sensitivities.
+
+adjoint_gradient: CVodeF and CVodeB as in the simple adjoint example, one
+backward problem lambda' = fB = -J^T lambda - (dg/dy)^T from lambda(tout) = 0
+with the quadratures qB' = fQB = -lambda^T df/dp_k, so qB(t0) is the
+gradient. The backward problem has size N whatever Ns is, but the forward
+solution is kept in checkpoints and Hermite interpolation data.
+
+The functions get the same user_data. fS and fQS are called with Ns, fQB
+finds Ns as the length of qBdot.
+*/
+
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include <vector>
+#include <cvodes/cvodes.h> // prototypes for CVODE fcts., consts.
+#include <cvodes/cvodes_spils.h> // access to CVSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "solver_stats.h"  // SolveRecord
+
+struct GradientProblem {
+  sunindextype N;
+  int num_params;
+  const realtype *p; // scales of the sensitivity tolerances, |p_k|
+  CVRhsFn f;
+  CVSpilsJacTimesVecFn jtv; // NULL for CVODES' difference quotient
+  CVQuadRhsFn fQ; // integrand g of G
+  CVSensRhsFn fS; // forward sensitivities
+  CVQuadSensRhsFn fQS;
+  CVRhsFnB fB; // backward problem
+  CVSpilsJacTimesVecFnB jtvB; // NULL for CVODES' difference quotient
+  CVQuadRhsFnB fQB;
+  void *user_data;
+  std::vector < realtype > y0;
+  realtype t0, tout;
+  realtype reltol, abstol;
+};
+
+struct GradientResult {
+  realtype G;
+  std::vector < realtype > gradient; // Ns values
+  double seconds; // setup and integration
+  SolveRecord forward; // counters of CVode or CVodeF
+  SolveRecord backward; // counters of CVodeB, -1 for forward_gradient
+  long int sens_rhs_evals; // calls to fS, -1 for adjoint_gradient
+  // Reals held by the solvers (CVodeGetWorkSpace) plus, for the adjoint, an
+  // estimate of the checkpoints and interpolation data.
+  long int memory;
+  int checkpoints; // adjoint only
+};
+
+// Both return 0, or -1 for an invalid Ns or when a solver fails; the flag of
+// a failing CVode, CVodeF or CVodeB is left in the SolveRecord.
+int forward_gradient(const GradientProblem &problem, int Ns, int ism,
+                     GradientResult *result);
+
+// steps is the number of steps between checkpoints (CVodeAdjInit).
+int adjoint_gradient(const GradientProblem &problem, int Ns, long int steps,
+                     GradientResult *result);
+
+#endif
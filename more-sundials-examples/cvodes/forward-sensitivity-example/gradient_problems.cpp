@@ -0,0 +1,278 @@
+#include "gradient_problems.h"
+
+#include <cmath>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+
+static int simple_f(realtype t, N_Vector y, N_Vector ydot, void *user_data);
+static int simple_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                      N_Vector fy, void *user_data, N_Vector tmp);
+static int simple_fQ(realtype t, N_Vector y, N_Vector qdot, void *user_data);
+static int simple_fS(int Ns, realtype t, N_Vector y, N_Vector ydot,
+                     N_Vector *yS, N_Vector *ySdot, void *user_data,
+                     N_Vector tmp1, N_Vector tmp2);
+static int simple_fQS(int Ns, realtype t, N_Vector y, N_Vector *yS,
+                      N_Vector qdot, N_Vector *qSdot, void *user_data,
+                      N_Vector tmp, N_Vector tmpQ);
+static int simple_fB(realtype t, N_Vector y, N_Vector yB, N_Vector yBdot,
+                     void *user_data);
+static int simple_jtvB(N_Vector vB, N_Vector JvB, realtype t, N_Vector y,
+                       N_Vector yB, N_Vector fyB, void *user_data,
+                       N_Vector tmpB);
+static int simple_fQB(realtype t, N_Vector y, N_Vector yB, N_Vector qBdot,
+                      void *user_data);
+
+static int chain_f(realtype t, N_Vector y, N_Vector ydot, void *user_data);
+static int chain_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                     N_Vector fy, void *user_data, N_Vector tmp);
+static int chain_fQ(realtype t, N_Vector y, N_Vector qdot, void *user_data);
+static int chain_fS(int Ns, realtype t, N_Vector y, N_Vector ydot,
+                    N_Vector *yS, N_Vector *ySdot, void *user_data,
+                    N_Vector tmp1, N_Vector tmp2);
+static int chain_fQS(int Ns, realtype t, N_Vector y, N_Vector *yS,
+                     N_Vector qdot, N_Vector *qSdot, void *user_data,
+                     N_Vector tmp, N_Vector tmpQ);
+static int chain_fB(realtype t, N_Vector y, N_Vector yB, N_Vector yBdot,
+                    void *user_data);
+static int chain_jtvB(N_Vector vB, N_Vector JvB, realtype t, N_Vector y,
+                      N_Vector yB, N_Vector fyB, void *user_data,
+                      N_Vector tmpB);
+static int chain_fQB(realtype t, N_Vector y, N_Vector yB, N_Vector qBdot,
+                     void *user_data);
+
+
+GradientProblem make_simple_problem(SimpleData *data) {
+  data->p[0] = 101.0;
+  data->p[1] = 100.0;
+
+  GradientProblem problem;
+  problem.N = 2;
+  problem.num_params = 2;
+  problem.p = data->p;
+  problem.f = simple_f;
+  problem.jtv = simple_jtv;
+  problem.fQ = simple_fQ;
+  problem.fS = simple_fS;
+  problem.fQS = simple_fQS;
+  problem.fB = simple_fB;
+  problem.jtvB = simple_jtvB;
+  problem.fQB = simple_fQB;
+  problem.user_data = data;
+  problem.y0.push_back(2.0);
+  problem.y0.push_back(1.0);
+  problem.t0 = 0;
+  problem.tout = 50;
+  problem.reltol = 1e-5;
+  problem.abstol = 1e-5;
+  return(problem);
+}
+
+GradientProblem make_chain_problem(ChainData *data, sunindextype N) {
+  data->N = N;
+  data->p.resize(N);
+  data->w.resize(N);
+  for (sunindextype i = 0; i < N; i++) {
+    data->p[i] = (N > 1) ? pow(10.0, 2.0 * i / (N - 1)) : 1.0;
+    data->w[i] = (i + 1.0) / N;
+  }
+
+  GradientProblem problem;
+  problem.N = N;
+  problem.num_params = N;
+  problem.p = &data->p[0];
+  problem.f = chain_f;
+  problem.jtv = chain_jtv;
+  problem.fQ = chain_fQ;
+  problem.fS = chain_fS;
+  problem.fQS = chain_fQS;
+  problem.fB = chain_fB;
+  problem.jtvB = chain_jtvB;
+  problem.fQB = chain_fQB;
+  problem.user_data = data;
+  problem.y0.assign(N, 0.0);
+  problem.y0[0] = 1.0;
+  problem.t0 = 0;
+  problem.tout = 10;
+  problem.reltol = 1e-6;
+  problem.abstol = 1e-10;
+  return(problem);
+}
+
+// -----------------------------------------------------------------------------
+// simple: J = [-p0 -p1; 1 0], df/dp0 = [-y0 0], df/dp1 = [-y1 0], g = y1.
+// -----------------------------------------------------------------------------
+
+static int simple_f(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
+  SimpleData *data = (SimpleData *) user_data;
+  realtype *yd = NV_DATA_S(y), *dyd = NV_DATA_S(ydot);
+  dyd[0] = -data->p[0] * yd[0] - data->p[1] * yd[1];
+  dyd[1] = yd[0];
+  return(0);
+}
+
+static int simple_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                      N_Vector fy, void *user_data, N_Vector tmp) {
+  SimpleData *data = (SimpleData *) user_data;
+  realtype *vd = NV_DATA_S(v), *Jvd = NV_DATA_S(Jv);
+  Jvd[0] = -data->p[0] * vd[0] - data->p[1] * vd[1];
+  Jvd[1] = vd[0];
+  return(0);
+}
+
+static int simple_fQ(realtype t, N_Vector y, N_Vector qdot, void *user_data) {
+  NV_DATA_S(qdot)[0] = NV_DATA_S(y)[1];
+  return(0);
+}
+
+// s_k' = J s_k + df/dp_k
+static int simple_fS(int Ns, realtype t, N_Vector y, N_Vector ydot,
+                     N_Vector *yS, N_Vector *ySdot, void *user_data,
+                     N_Vector tmp1, N_Vector tmp2) {
+  SimpleData *data = (SimpleData *) user_data;
+  realtype *yd = NV_DATA_S(y);
+  for (int k = 0; k < Ns; k++) {
+    realtype *sd = NV_DATA_S(yS[k]), *dsd = NV_DATA_S(ySdot[k]);
+    dsd[0] = -data->p[0] * sd[0] - data->p[1] * sd[1] - yd[k];
+    dsd[1] = sd[0];
+  }
+  return(0);
+}
+
+static int simple_fQS(int Ns, realtype t, N_Vector y, N_Vector *yS,
+                      N_Vector qdot, N_Vector *qSdot, void *user_data,
+                      N_Vector tmp, N_Vector tmpQ) {
+  for (int k = 0; k < Ns; k++) NV_DATA_S(qSdot[k])[0] = NV_DATA_S(yS[k])[1];
+  return(0);
+}
+
+// lambda' = -J^T lambda - dg/dy
+static int simple_fB(realtype t, N_Vector y, N_Vector yB, N_Vector yBdot,
+                     void *user_data) {
+  SimpleData *data = (SimpleData *) user_data;
+  realtype *yBd = NV_DATA_S(yB), *dyBd = NV_DATA_S(yBdot);
+  dyBd[0] = data->p[0] * yBd[0] - yBd[1];
+  dyBd[1] = data->p[1] * yBd[0] - 1.0;
+  return(0);
+}
+
+static int simple_jtvB(N_Vector vB, N_Vector JvB, realtype t, N_Vector y,
+                       N_Vector yB, N_Vector fyB, void *user_data,
+                       N_Vector tmpB) {
+  SimpleData *data = (SimpleData *) user_data;
+  realtype *vd = NV_DATA_S(vB), *Jvd = NV_DATA_S(JvB);
+  Jvd[0] = data->p[0] * vd[0] - vd[1];
+  Jvd[1] = data->p[1] * vd[0];
+  return(0);
+}
+
+// qB' = -lambda^T df/dp_k
+static int simple_fQB(realtype t, N_Vector y, N_Vector yB, N_Vector qBdot,
+                      void *user_data) {
+  realtype *yd = NV_DATA_S(y), *yBd = NV_DATA_S(yB);
+  sunindextype Ns = NV_LENGTH_S(qBdot);
+  for (sunindextype k = 0; k < Ns; k++) {
+    NV_DATA_S(qBdot)[k] = yBd[0] * yd[k];
+  }
+  return(0);
+}
+
+// -----------------------------------------------------------------------------
+// chain: (J v)_i = p_{i-1}*v_{i-1} - p_i*v_i, df/dp_k = y_k*(e_{k+1} - e_k),
+// g = sum_i w_i*y_i.
+// -----------------------------------------------------------------------------
+
+// z = J v
+static void chain_times(const ChainData *data, const realtype *v,
+                        realtype *z) {
+  const realtype *p = &data->p[0];
+  z[0] = -p[0] * v[0];
+  for (sunindextype i = 1; i < data->N; i++) {
+    z[i] = p[i - 1] * v[i - 1] - p[i] * v[i];
+  }
+}
+
+// z = J^T v
+static void chain_times_transpose(const ChainData *data, const realtype *v,
+                                  realtype *z) {
+  const realtype *p = &data->p[0];
+  sunindextype N = data->N;
+  for (sunindextype i = 0; i < N - 1; i++) z[i] = p[i] * (v[i + 1] - v[i]);
+  z[N - 1] = -p[N - 1] * v[N - 1];
+}
+
+static int chain_f(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
+  chain_times((ChainData *) user_data, NV_DATA_S(y), NV_DATA_S(ydot));
+  return(0);
+}
+
+static int chain_jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector y,
+                     N_Vector fy, void *user_data, N_Vector tmp) {
+  chain_times((ChainData *) user_data, NV_DATA_S(v), NV_DATA_S(Jv));
+  return(0);
+}
+
+static int chain_fQ(realtype t, N_Vector y, N_Vector qdot, void *user_data) {
+  ChainData *data = (ChainData *) user_data;
+  realtype *yd = NV_DATA_S(y);
+  realtype sum = 0;
+  for (sunindextype i = 0; i < data->N; i++) sum += data->w[i] * yd[i];
+  NV_DATA_S(qdot)[0] = sum;
+  return(0);
+}
+
+static int chain_fS(int Ns, realtype t, N_Vector y, N_Vector ydot,
+                    N_Vector *yS, N_Vector *ySdot, void *user_data,
+                    N_Vector tmp1, N_Vector tmp2) {
+  ChainData *data = (ChainData *) user_data;
+  realtype *yd = NV_DATA_S(y);
+  for (int k = 0; k < Ns; k++) {
+    realtype *dsd = NV_DATA_S(ySdot[k]);
+    chain_times(data, NV_DATA_S(yS[k]), dsd);
+    dsd[k] -= yd[k];
+    if (k + 1 < data->N) dsd[k + 1] += yd[k];
+  }
+  return(0);
+}
+
+static int chain_fQS(int Ns, realtype t, N_Vector y, N_Vector *yS,
+                     N_Vector qdot, N_Vector *qSdot, void *user_data,
+                     N_Vector tmp, N_Vector tmpQ) {
+  ChainData *data = (ChainData *) user_data;
+  for (int k = 0; k < Ns; k++) {
+    realtype *sd = NV_DATA_S(yS[k]);
+    realtype sum = 0;
+    for (sunindextype i = 0; i < data->N; i++) sum += data->w[i] * sd[i];
+    NV_DATA_S(qSdot[k])[0] = sum;
+  }
+  return(0);
+}
+
+static int chain_fB(realtype t, N_Vector y, N_Vector yB, N_Vector yBdot,
+                    void *user_data) {
+  ChainData *data = (ChainData *) user_data;
+  realtype *dyBd = NV_DATA_S(yBdot);
+  chain_times_transpose(data, NV_DATA_S(yB), dyBd);
+  for (sunindextype i = 0; i < data->N; i++) dyBd[i] = -dyBd[i] - data->w[i];
+  return(0);
+}
+
+static int chain_jtvB(N_Vector vB, N_Vector JvB, realtype t, N_Vector y,
+                      N_Vector yB, N_Vector fyB, void *user_data,
+                      N_Vector tmpB) {
+  ChainData *data = (ChainData *) user_data;
+  realtype *Jvd = NV_DATA_S(JvB);
+  chain_times_transpose(data, NV_DATA_S(vB), Jvd);
+  for (sunindextype i = 0; i < data->N; i++) Jvd[i] = -Jvd[i];
+  return(0);
+}
+
+static int chain_fQB(realtype t, N_Vector y, N_Vector yB, N_Vector qBdot,
+                     void *user_data) {
+  ChainData *data = (ChainData *) user_data;
+  realtype *yd = NV_DATA_S(y), *yBd = NV_DATA_S(yB);
+  sunindextype Ns = NV_LENGTH_S(qBdot);
+  for (sunindextype k = 0; k < Ns; k++) {
+    realtype next = (k + 1 < data->N) ? yBd[k + 1] : 0;
+    NV_DATA_S(qBdot)[k] = yd[k] * (yBd[k] - next);
+  }
+  return(0);
+}
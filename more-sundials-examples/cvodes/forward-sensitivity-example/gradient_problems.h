@@ -0,0 +1,39 @@
+/*
+Problems for forward_gradient and adjoint_gradient (gradient.h), with every
+function the two need.
+
+simple: the system of the simple adjoint example,
+          y0' = -p0*y0 - p1*y1,  y1' = y0,  y(0) = (2, 1),
+        p = (101, 100) and G = integral from 0 to 50 of y1 dt. For
+        end_time -> infinity G = (y0(0) + p0*y1(0))/p1, the gradient is
+        (1/p1, -(y0(0) + p0*y1(0))/p1^2).
+chain:  a decay chain of N compartments with one rate per compartment,
+          y_0' = -p_0*y_0,  y_i' = p_{i-1}*y_{i-1} - p_i*y_i,  y(0) = e_0,
+        rates from 1 to 100 and G = integral from 0 to 10 of
+        sum_i w_i*y_i dt with w_i = (i + 1)/N. It has N parameters, for
+        the crossover of the forward and the adjoint method.
+*/
+
+#ifndef GRADIENT_PROBLEMS_H
+#define GRADIENT_PROBLEMS_H
+
+#include <vector>
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "gradient.h"
+
+struct SimpleData {
+  realtype p[2];
+};
+
+struct ChainData {
+  sunindextype N;
+  std::vector < realtype > p; // rates
+  std::vector < realtype > w; // weights of g
+};
+
+// The problems keep a pointer to data, which has to outlive them.
+GradientProblem make_simple_problem(SimpleData *data);
+GradientProblem make_chain_problem(ChainData *data, sunindextype N);
+
+#endif
@@ -1,6 +1,19 @@
 /*
 A simple example with the CVODES library using adjoint backward sensitivity
 analysis to solve a simple ODE system.
+
+The system is y0' = -p0*y0 - p1*y1, y1' = y0 with p = (101, 100). The adjoint
+problem computes the gradient of
+
+  G(p) = integral from 0 to end_time of y1 dt
+
+with respect to p. With lambda the backward solution it is
+
+  lambda' = -J^T lambda - (dg/dy)^T,  lambda(end_time) = 0
+  dG/dp   = integral from 0 to end_time of lambda^T df/dp dt
+
+where g = y1 and J = df/dy. The integral is a quadrature of the backward
+problem.
 */
 
 // 1. Include nessesary header files.
@@ -13,15 +26,27 @@ analysis to solve a simple ODE system.
 #include <sundials/sundials_dense.h>  // use generic dense solver in precond
 #include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
 #include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "cvode_stats.h"  // SolveRecord, collect_cvode_stats
 // -----------------------------------------------------------------------------
 
 // This macro gives access to the individual components of the data array of an
 // N Vector.
 #define NV_Ith_S(v,i) ( NV_DATA_S(v)[i] )
 
+// Parameters p of the problem. The same data is used as user data of the
+// forward and the backward problem. f and fb time themselves into the
+// statistics of their problem.
+struct UserData {
+  realtype p[2];
+  SolveRecord forward_stats, backward_stats;
+};
+
 static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data);
+static int fQ(realtype t, N_Vector u, N_Vector q_dot, void *user_data);
 static int fb(realtype t, N_Vector y, N_Vector yB, N_Vector yBdot,
               void *user_data);
+static int fQb(realtype t, N_Vector y, N_Vector yB, N_Vector qBdot,
+               void *user_data);
 static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
                void *user_data, N_Vector tmp);
 static int check_flag(void *flagvalue, const char *funcname, int opt);
@@ -41,6 +66,9 @@ int main() {
   // 3. Set problem dimensions etc. for the forward problem.
   // ---------------------------------------------------------------------------
   sunindextype N_forward = 2;
+  UserData data;
+  data.p[0] = 101.0;
+  data.p[1] = 100.0;
   // ---------------------------------------------------------------------------
 
   // 4. Set initial conditions for the forward problem.
@@ -61,7 +89,7 @@ int main() {
   // ---------------------------------------------------------------------------
   realtype t0 = 0; // Initiale value of time.
   flag = CVodeInit(cvode_mem, f, t0, y_forward);
-  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  if (check_flag(&flag, "CVodeInit", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 7. Specify integration tolerances for the forward problem.
@@ -72,6 +100,8 @@ int main() {
 
   // 8. Set optional inputs for the forward problem.
   // ---------------------------------------------------------------------------
+  flag = CVodeSetUserData(cvode_mem, &data);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 9. Create matrix object for the forward problem.
@@ -103,10 +133,18 @@ int main() {
   // 13. Initialize quadrature problem or problems for forward problems, using
   // CVodeQuadInit and/or CVodeQuadSensInit.
   // ---------------------------------------------------------------------------
+  // The quadrature q' = y1 gives the value of G at the end time.
+  N_Vector q = N_VNew_Serial(1);
+  NV_Ith_S(q, 0) = 0;
+  flag = CVodeQuadInit(cvode_mem, fQ, q);
+  if (check_flag(&flag, "CVodeQuadInit", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 14. Initialize forward sensitivity problem.
   // ---------------------------------------------------------------------------
+  // Not used here, the gradient comes from the adjoint problem below. The
+  // forward sensitivity example computes the same gradient with
+  // CVodeSensInit, which is cheaper for a handful of parameters.
   // ---------------------------------------------------------------------------
 
 
@@ -133,7 +171,9 @@ int main() {
   int ncheck = 0;
   // loop over output points, call CVode, print results, test for error
   std::cout << "Performing Forward Integration: \n\n";
-  for (tout = step_length; tout <= end_time; tout += step_length) {
+  double start = stats_now();
+  for (int i = 1; i * step_length <= end_time; i++) {
+    tout = i * step_length;
     // CVodeF is similar to the CVode advance in time operation, but it also
     // stores checkpoint data every Nd integration steps.
     flag = CVodeF(
@@ -145,11 +185,16 @@ int main() {
                    // reached or just passed the user-speciﬁed tout parameter
         &ncheck //  the number of (internal) checkpoints stored so far
         );
+    if (check_flag(&flag, "CVodeF", 1)) return(1);
     std::cout << "t: " << t;
     std::cout << "\ny:";
     N_VPrint_Serial(y_forward);
-    if (check_flag(&flag, "CVodeF", 1)) break;
   }
+  data.forward_stats.seconds = stats_now() - start;
+  flag = CVodeGetQuad(cvode_mem, &t, q);
+  if (check_flag(&flag, "CVodeGetQuad", 1)) return(1);
+  std::cout << "G = " << NV_Ith_S(q, 0) << " (" << ncheck <<
+      " checkpoints)\n\n";
   // ---------------------------------------------------------------------------
 
   /* Backward Problem */
@@ -161,10 +206,11 @@ int main() {
 
   // 19. Set initial values for the backward problem.
   // ---------------------------------------------------------------------------
+  // The adjoint variables lambda start from zero at the end time.
   N_Vector y_backward; // Problem vector.
   y_backward = N_VNew_Serial(N_backward);
-  NV_Ith_S(y_backward, 0) = 2.0;
-  NV_Ith_S(y_backward, 1) = 1.0;
+  NV_Ith_S(y_backward, 0) = 0.0;
+  NV_Ith_S(y_backward, 1) = 0.0;
   // ---------------------------------------------------------------------------
 
   // 20. Create the backward problem.
@@ -189,6 +235,8 @@ int main() {
 
   // 23. Set optional inputs for the backward problem.
   // ---------------------------------------------------------------------------
+  flag = CVodeSetUserDataB(cvode_mem, indexB, &data);
+  if (check_flag(&flag, "CVodeSetUserDataB", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 24. Create matrix object for the backward problem.
@@ -210,66 +258,89 @@ int main() {
 
   // 27. initialize quadrature calculation.
   // ---------------------------------------------------------------------------
+  // One quadrature per parameter, integrated backward from zero.
+  N_Vector qB = N_VNew_Serial(2);
+  NV_Ith_S(qB, 0) = 0;
+  NV_Ith_S(qB, 1) = 0;
+  flag = CVodeQuadInitB(cvode_mem, indexB, fQb, qB);
+  if (check_flag(&flag, "CVodeQuadInitB", 1)) return(1);
+
+  // Include the quadratures in the error test of the backward problem.
+  flag = CVodeSetQuadErrConB(cvode_mem, indexB, SUNTRUE);
+  if (check_flag(&flag, "CVodeSetQuadErrConB", 1)) return(1);
+  flag = CVodeQuadSStolerancesB(cvode_mem, indexB, reltol, abstol);
+  if (check_flag(&flag, "CVodeQuadSStolerancesB", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 28. Integrate backward problem.
   // ---------------------------------------------------------------------------
-  // flag = CVodeB(cvode_mem, T0, CV_NORMAL);
-  // if (check_flag(&flag, "CVodeB", 1)) return(1);
-
-  // Have the solution advance over time, but stop to log 100 of the steps.
-  // int print_steps = 100;
-  // realtype tout;
-  // realtype end_time = 50;
-  // realtype step_length = 0.5;
-  // realtype t = 0;
-  // int ncheck = 0;
-  // loop over output points, call CVode, print results, test for error
   std::cout << "Performing Backward Integration: \n\n";
-  // for (tout = step_length; tout <= end_time; tout += step_length) {
-  //   // CVodeB is essentially a wrapper for CVode but does not directly return
-  //   // the solution (need to call CVodeGetB).
-  //   flag = CVodeB(
-  //       cvode_mem, // pointer to the cvodes memory block
-  //       tout, // the next time at which a computed solution is desired
-  //       CV_NORMAL // CV_NORMAL has the solver take internal steps until it has
-  //                 // reached or just passed the user-speciﬁed tout parameter
-  //       );
-  //   std::cout << "t: " << t;
-  //   std::cout << "\ny:";
-  //   flag = CVodeGetB(cvode_mem, indexB, &t, y_backward);
-  //   if (check_flag(&flag, "CVodeGetB", 1)) return(1);
-  //   N_VPrint_Serial(y_backward);
-  //   if (check_flag(&flag, "CVodeF", 1)) break;
-  //
-  //
-  // }
-    std::cout << "t: " << t;
-    std::cout << "\ny:\n";
+  start = stats_now();
+  for (int i = (int)(end_time / step_length) - 1; i >= 0; i--) {
+    tout = i * step_length;
+    // CVodeB is essentially a wrapper for CVode but does not directly return
+    // the solution (need to call CVodeGetB). It integrates all backward
+    // problems, using the checkpoints of CVodeF to recompute the forward
+    // solution where the backward problem needs it.
+    flag = CVodeB(
+        cvode_mem, // pointer to the cvodes memory block
+        tout, // the next time at which a computed solution is desired
+        CV_NORMAL // CV_NORMAL has the solver take internal steps until it has
+                  // reached or just passed the user-speciﬁed tout parameter
+        );
+    if (check_flag(&flag, "CVodeB", 1)) return(1);
     flag = CVodeGetB(cvode_mem, indexB, &t, y_backward);
     if (check_flag(&flag, "CVodeGetB", 1)) return(1);
+    std::cout << "t: " << t;
+    std::cout << "\nlambda:";
     N_VPrint_Serial(y_backward);
-    std::cout << "The value is the same as the initial value." <<
-        " Thus returned properly\n";
-
-    
+  }
+  // ---------------------------------------------------------------------------
 
+  // The backward time includes the recomputation of the forward solution
+  // between checkpoints, whose f calls go to the forward statistics.
+  data.backward_stats.seconds = stats_now() - start;
   // ---------------------------------------------------------------------------
 
   // 29. Extract quadrature variables.
   // ---------------------------------------------------------------------------
+  flag = CVodeGetQuadB(cvode_mem, indexB, &t, qB);
+  if (check_flag(&flag, "CVodeGetQuadB", 1)) return(1);
+
+  // For end_time -> infinity, G = (y0(0) + p0*y1(0))/p1, which gives the
+  // gradient below. At end_time = 50 the solution has long decayed.
+  realtype exact0 = 1.0 / data.p[1];
+  realtype exact1 = -(2.0 + data.p[0] * 1.0) / (data.p[1] * data.p[1]);
+  std::cout << "\ndG/dp0 = " << NV_Ith_S(qB, 0) << " (exact " << exact0 <<
+      ")\n";
+  std::cout << "dG/dp1 = " << NV_Ith_S(qB, 1) << " (exact " << exact1 <<
+      ")\n\n";
+
+  // Solver statistics of both problems.
+  data.forward_stats.label = "forward";
+  flag = collect_cvode_stats(cvode_mem, LS, &data.forward_stats);
+  if (check_flag(&flag, "collect_cvode_stats", 1)) return(1);
+  print_solve_record(stdout, data.forward_stats);
+  data.backward_stats.label = "backward";
+  flag = collect_cvode_stats(CVodeGetAdjCVodeBmem(cvode_mem, indexB), LSB,
+                             &data.backward_stats);
+  if (check_flag(&flag, "collect_cvode_stats", 1)) return(1);
+  print_solve_record(stdout, data.backward_stats);
   // ---------------------------------------------------------------------------
 
   // 30. Deallocate memory.
   // ---------------------------------------------------------------------------
   N_VDestroy(y_forward);
   N_VDestroy(y_backward);
+  N_VDestroy(q);
+  N_VDestroy(qB);
   CVodeFree(&cvode_mem);
   // ---------------------------------------------------------------------------
 
   // 31. Free linear solver and matrix memory for the backward problem.
   // ---------------------------------------------------------------------------
   SUNLinSolFree(LS);
+  SUNLinSolFree(LSB);
   // ---------------------------------------------------------------------------
 
   // 32. Finalize MPI, if used.
@@ -284,26 +355,49 @@ static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
   // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
   realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
   realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
+  UserData *data = (UserData *) user_data;
+  StatsTimer timer(data->forward_stats.f_calls, data->forward_stats.f_seconds);
 
-  dudata[0] = -101.0 * udata[0] - 100.0 * udata[1];
+  dudata[0] = -data->p[0] * udata[0] - data->p[1] * udata[1];
   dudata[1] = udata[0];
 
   return(0);
 }
 
-// The calculates for the right hand side of the backward problem.
+// Integrand g of G for the forward quadrature.
+static int fQ(realtype t, N_Vector u, N_Vector q_dot, void *user_data) {
+  NV_Ith_S(q_dot, 0) = NV_Ith_S(u, 1);
+  return(0);
+}
+
+// The right hand side of the backward problem, lambda' = -J^T lambda - dg/dy.
 static int fb(realtype t, N_Vector y, N_Vector yB, N_Vector yBdot,
               void *user_data) {
   // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
-  realtype *ydata  = N_VGetArrayPointer(y);
   realtype *yBdata  = N_VGetArrayPointer(yB);
   realtype *dyBdata = N_VGetArrayPointer(yBdot);
+  UserData *data = (UserData *) user_data;
+  StatsTimer timer(data->backward_stats.f_calls,
+                   data->backward_stats.f_seconds);
 
-  realtype y0_dot = -101.0 * ydata[0] - 100.0 * ydata[1];
-  realtype y1_dot = ydata[0];
+  // J = [-p0 -p1; 1 0] and dg/dy = [0 1].
+  dyBdata[0] = data->p[0] * yBdata[0] - yBdata[1];
+  dyBdata[1] = data->p[1] * yBdata[0] - 1.0;
 
-  dyBdata[0] = -1 * (y0_dot + y1_dot) * yBdata[0];
-  dyBdata[1] = -1 * (y0_dot + y1_dot) * yBdata[1];
+  return(0);
+}
+
+// Integrand of the gradient. CVODES integrates it from end_time back to 0, so
+// the sign is flipped to get lambda^T df/dp integrated forward in time.
+static int fQb(realtype t, N_Vector y, N_Vector yB, N_Vector qBdot,
+               void *user_data) {
+  realtype *ydata  = N_VGetArrayPointer(y);
+  realtype *yBdata  = N_VGetArrayPointer(yB);
+  realtype *dqBdata = N_VGetArrayPointer(qBdot);
+
+  // df/dp0 = [-y0 0] and df/dp1 = [-y1 0].
+  dqBdata[0] = yBdata[0] * ydata[0];
+  dqBdata[1] = yBdata[0] * ydata[1];
 
   return(0);
 }
@@ -314,14 +408,10 @@ static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
   realtype *udata  = N_VGetArrayPointer(u);
   realtype *vdata  = N_VGetArrayPointer(v);
   realtype *Jvdata = N_VGetArrayPointer(Jv);
-  realtype *fudata = N_VGetArrayPointer(fu);
 
   Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
   Jvdata[1] = vdata[0] + 0 * vdata[1];
 
-  fudata[0] = 0;
-  fudata[1] = 0;
-
   return(0);
 }
 
@@ -11,14 +11,15 @@ as a stiff system.
 #include <sundials/sundials_dense.h>  // use generic dense solver in precond
 #include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
 #include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "kinsol_stats.h"  // SolveRecord, collect_kinsol_stats
 
 // This macro gives access to the individual components of the data array of an
 // N Vector.
 #define NV_Ith_S(v,i) ( NV_DATA_S(v)[i] )
 
 static int f(N_Vector u, N_Vector u_dot, void *user_data);
-static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
-               void *user_data, N_Vector tmp);
+static int jtv(N_Vector v, N_Vector Jv, N_Vector u, booleantype *new_u,
+               void *user_data);
 static int check_flag(void *flagvalue, const char *funcname, int opt);
 
 
@@ -59,6 +60,11 @@ int main() {
 
   // 5. Set Optional Inputs.
   // ---------------------------------------------------------------------------
+  // The statistics of the solve are the user data, so f and jtv can time
+  // themselves.
+  SolveRecord stats;
+  flag = KINSetUserData(kin_mem, &stats);
+  if (check_flag(&flag, "KINSetUserData", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 6. Allocate Internal Memory .
@@ -88,27 +94,31 @@ int main() {
 
   // 10. Attach linear solver module.
   // ---------------------------------------------------------------------------
-  // CVSpilsSetLinearSolver is for iterative linear solvers.
+  // KINSpilsSetLinearSolver is for iterative linear solvers.
   flag = KINSpilsSetLinearSolver(kin_mem, LS);
   if (check_flag(&flag, "KINSpilsSetLinearSolver", 1)) return 1;
   // ---------------------------------------------------------------------------
 
   // 11. Set linear solver interface optional inputs.
   // ---------------------------------------------------------------------------
-  // Sets the jacobian-times-vector function.
-  // flag = CVSpilsSetJacTimes(kin_mem, NULL, jtv);
-  // if(check_flag(&flag, "CVSpilsSetJacTimes", 1)) return(1);
+  // Sets the jacobian-times-vector function. Without it KINSOL uses a
+  // difference quotient of f.
+  flag = KINSpilsSetJacTimesVecFn(kin_mem, jtv);
+  if(check_flag(&flag, "KINSpilsSetJacTimesVecFn", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 12. Solve problem,
   // ---------------------------------------------------------------------------
 
   /* Call KINSol and print output concentration profile */
+  double start = stats_now();
   flag = KINSol(kin_mem,           /* KINSol memory block */
                 y0,             /* initial guess on input; solution vector */
                 KIN_LINESEARCH, /* global strategy choice */
                 sc,             /* scaling vector for the variable cc */
                 sc);            /* scaling vector for function values fval */
+  stats.seconds = stats_now() - start;
+  stats.flag = flag;
   if (check_flag(&flag, "KINSol", 1)) return(1);
 
   // Printing output.
@@ -119,6 +129,9 @@ int main() {
 
   // 13. Get optional outputs.
   // ---------------------------------------------------------------------------
+  flag = collect_kinsol_stats(kin_mem, LS, &stats);
+  if (check_flag(&flag, "collect_kinsol_stats", 1)) return(1);
+  print_solve_record(stdout, stats);
   // ---------------------------------------------------------------------------
 
   // 14. Deallocate memory for solution vector.
@@ -145,6 +158,9 @@ int main() {
 
 // Simple function that calculates the differential equation.
 static int f(N_Vector u, N_Vector f_val, void *user_data) {
+  SolveRecord *stats = (SolveRecord *) user_data;
+  StatsTimer timer(stats->f_calls, stats->f_seconds);
+
   // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
   realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
   realtype *fdata = N_VGetArrayPointer(f_val); // pointer to udot vector data
@@ -155,19 +171,19 @@ static int f(N_Vector u, N_Vector f_val, void *user_data) {
   return(0);
 }
 
-// Jacobian function vector routine.
-static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
-               void *user_data, N_Vector tmp) {
-  realtype *udata  = N_VGetArrayPointer(u);
+// Jacobian function vector routine. The jacobian does not depend on u, so
+// there is nothing to update when new_u is set.
+static int jtv(N_Vector v, N_Vector Jv, N_Vector u, booleantype *new_u,
+               void *user_data) {
+  SolveRecord *stats = (SolveRecord *) user_data;
+  StatsTimer timer(stats->jtv_calls, stats->jtv_seconds);
+
   realtype *vdata  = N_VGetArrayPointer(v);
   realtype *Jvdata = N_VGetArrayPointer(Jv);
-  realtype *fudata = N_VGetArrayPointer(fu);
 
   Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
   Jvdata[1] = vdata[0] + 0 * vdata[1];
-
-  fudata[0] = 0;
-  fudata[1] = 0;
+  *new_u = SUNFALSE;
 
   return(0);
 }
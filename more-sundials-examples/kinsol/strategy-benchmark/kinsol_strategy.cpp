@@ -0,0 +1,129 @@
+#include "kinsol_strategy.h"
+
+#include <cstdio>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+
+#include "kinsol_stats.h"  // collect_kinsol_stats
+
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+int kinsol_strategy_solve(const KinsolProblem &problem,
+                          const KinsolStrategy &strategy, long int max_iters,
+                          realtype fnormtol, int maxl, realtype *u,
+                          SolveRecord *rec) {
+  int flag;
+  sunindextype N = problem.N;
+  bool fixed_point = (strategy.strategy == KIN_FP);
+  bool picard = (strategy.strategy == KIN_PICARD);
+
+  rec->reset();
+  rec->label = strategy.name;
+  rec->flag = KIN_ILL_INPUT;
+  if (fixed_point && problem.G == NULL) return(KIN_ILL_INPUT);
+  if (!fixed_point && problem.F == NULL) return(KIN_ILL_INPUT);
+  if (picard && problem.lop == NULL) return(KIN_ILL_INPUT);
+  if (strategy.use_jtv && problem.jtv == NULL) return(KIN_ILL_INPUT);
+
+  N_Vector uu = N_VNew_Serial(N);
+  if (check_flag((void *)uu, "N_VNew_Serial", 0)) return(KIN_MEM_FAIL);
+  realtype *udata = NV_DATA_S(uu);
+  for (sunindextype i = 0; i < N; i++) udata[i] = u[i];
+
+  // No scaling of u and F.
+  N_Vector scale = N_VNew_Serial(N);
+  if (check_flag((void *)scale, "N_VNew_Serial", 0)) return(KIN_MEM_FAIL);
+  N_VConst(1, scale);
+
+  void *kin_mem = KINCreate();
+  if (check_flag((void *)kin_mem, "KINCreate", 0)) return(KIN_MEM_FAIL);
+
+  // Iterations that do not converge are part of the benchmark, KINSOL should
+  // not print an error message for them.
+  flag = KINSetErrFile(kin_mem, NULL);
+  if (check_flag(&flag, "KINSetErrFile", 1)) return(flag);
+  flag = KINSetUserData(kin_mem, problem.user_data);
+  if (check_flag(&flag, "KINSetUserData", 1)) return(flag);
+  flag = KINSetNumMaxIters(kin_mem, max_iters);
+  if (check_flag(&flag, "KINSetNumMaxIters", 1)) return(flag);
+  flag = KINSetFuncNormTol(kin_mem, fnormtol);
+  if (check_flag(&flag, "KINSetFuncNormTol", 1)) return(flag);
+
+  // The Anderson acceleration memory is allocated by KINInit, so its depth
+  // has to be set before.
+  if (strategy.maa > 0) {
+    flag = KINSetMAA(kin_mem, strategy.maa);
+    if (check_flag(&flag, "KINSetMAA", 1)) return(flag);
+  }
+
+  flag = KINInit(kin_mem, fixed_point ? problem.G : problem.F, uu);
+  if (check_flag(&flag, "KINInit", 1)) return(flag);
+
+  // Newton and Picard solve their linear systems with SPGMR, for Picard the
+  // jacobian-times-vector function is the product with L.
+  SUNLinearSolver LS = NULL;
+  if (!fixed_point) {
+    LS = SUNSPGMR(uu, PREC_NONE, maxl);
+    if (check_flag((void *)LS, "SUNSPGMR", 0)) return(KIN_MEM_FAIL);
+    flag = KINSpilsSetLinearSolver(kin_mem, LS);
+    if (check_flag(&flag, "KINSpilsSetLinearSolver", 1)) return(flag);
+
+    KINSpilsJacTimesVecFn jtimes = picard ? problem.lop :
+        (strategy.use_jtv ? problem.jtv : NULL);
+    if (jtimes != NULL) {
+      flag = KINSpilsSetJacTimesVecFn(kin_mem, jtimes);
+      if (check_flag(&flag, "KINSpilsSetJacTimesVecFn", 1)) return(flag);
+    }
+  }
+
+  double start = stats_now();
+  flag = KINSol(kin_mem, uu, strategy.strategy, scale, scale);
+  rec->seconds = stats_now() - start;
+  rec->flag = flag;
+  collect_kinsol_stats(kin_mem, LS, rec);
+
+  for (sunindextype i = 0; i < N; i++) u[i] = udata[i];
+
+  N_VDestroy(uu);
+  N_VDestroy(scale);
+  KINFree(&kin_mem);
+  if (LS != NULL) SUNLinSolFree(LS);
+
+  return(flag);
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
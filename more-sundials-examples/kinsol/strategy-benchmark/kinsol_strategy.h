@@ -0,0 +1,55 @@
+/*
+Solves a nonlinear system with one of KINSOL's strategies:
+
+  Newton (KIN_NONE or KIN_LINESEARCH): F(u) = 0 with SPGMR, J*v from the
+      problem's jtv or from KINSOL's difference quotient of F.
+  Picard (KIN_PICARD): F(u) = L*u - N(u) = 0 by u_{k+1} = u_k - L^-1 F(u_k),
+      with the constant linear part L given as the product L*v (lop) and
+      solved with SPGMR. KINSOL has no difference quotient for L.
+  Fixed point (KIN_FP): u = G(u) by u_{k+1} = G(u_k), no linear solves.
+
+Picard and fixed point iterations take Anderson acceleration of depth maa,
+which mixes the last maa iterates into the next one.
+
+A problem provides the functions of the strategies it can be solved with,
+the others are NULL. kinsol_strategy_solve returns the flag of KINSol, or
+KIN_ILL_INPUT when the problem lacks a function the strategy needs.
+*/
+
+#ifndef KINSOL_STRATEGY_H
+#define KINSOL_STRATEGY_H
+
+#include <kinsol/kinsol.h> // access to KINSOL func., consts.
+#include <kinsol/kinsol_spils.h> // access to KINSpils interface
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "solver_stats.h"  // SolveRecord
+
+struct KinsolStrategy {
+  const char *name;
+  int strategy; // KIN_NONE, KIN_LINESEARCH, KIN_PICARD or KIN_FP
+  long int maa; // depth of Anderson acceleration, 0 for none
+  bool use_jtv; // Newton: the problem's jtv instead of the difference quotient
+};
+
+struct KinsolProblem {
+  const char *name;
+  sunindextype N;
+  KINSysFn F; // residual F(u), for Newton and Picard
+  KINSysFn G; // fixed point function G(u), for KIN_FP
+  KINSpilsJacTimesVecFn jtv; // J(u)*v of F, for Newton
+  KINSpilsJacTimesVecFn lop; // L*v of the linear part of F, for Picard
+  void *user_data;
+};
+
+// Solves problem from the initial guess in u, the solution is written back
+// into u. At most max_iters iterations with ||F||_inf (or ||G(u) - u||_inf)
+// below fnormtol to converge, maxl is the Krylov dimension of SPGMR (0 for
+// the default). Fills the counters, flag, label and seconds (of KINSol only)
+// of rec.
+int kinsol_strategy_solve(const KinsolProblem &problem,
+                          const KinsolStrategy &strategy, long int max_iters,
+                          realtype fnormtol, int maxl, realtype *u,
+                          SolveRecord *rec);
+
+#endif
@@ -0,0 +1,105 @@
+/*
+Benchmark of KINSOL's strategies on problem classes of different
+nonlinearity (see strategy_problems.h), to pick the cheapest one for each.
+
+Every problem is solved from u = 0 with
+  newton-dq:  Newton with line search, SPGMR, J*v by difference quotient
+  newton:     Newton with line search, SPGMR, exact J*v
+  picard:     Picard iteration with the linear part L, solved with SPGMR
+  picard-aa:  the same with Anderson acceleration of depth maa
+  fp:         fixed point iteration u = G(u)
+  fp-aa:      the same with Anderson acceleration of depth maa
+Each solve is repeated and the shortest time is kept. For every strategy the
+status, iterations, calls of F or G, Krylov iterations, time and the largest
+entry of F at the solution are printed, then the fastest strategy that
+converged.
+
+Usage: ./executable [N] [maa] [max_iters] [repeats]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "kinsol_strategy.h"
+#include "strategy_problems.h"
+
+static realtype residual(const KinsolProblem &problem, const realtype *u);
+
+
+int main(int argc, char *argv[]) {
+  sunindextype N = (argc > 1) ? std::atol(argv[1]) : 64;
+  long int maa = (argc > 2) ? std::atol(argv[2]) : 5;
+  long int max_iters = (argc > 3) ? std::atol(argv[3]) : 2000;
+  int repeats = (argc > 4) ? std::atoi(argv[4]) : 5;
+  if (N < 1) N = 1;
+  if (maa < 1) maa = 1;
+  if (repeats < 1) repeats = 1;
+  realtype fnormtol = 1e-10;
+
+  const int num_strategies = 6;
+  KinsolStrategy strategies[num_strategies] = {
+    {"newton-dq", KIN_LINESEARCH, 0, false},
+    {"newton", KIN_LINESEARCH, 0, true},
+    {"picard", KIN_PICARD, 0, false},
+    {"picard-aa", KIN_PICARD, maa, false},
+    {"fp", KIN_FP, 0, false},
+    {"fp-aa", KIN_FP, maa, false}
+  };
+  const char *problems[3] = {"contraction", "bratu-mild", "bratu-fold"};
+
+  printf("N = %ld, maa = %ld, max_iters = %ld, fnormtol = %g\n", (long) N,
+         maa, max_iters, (double) fnormtol);
+  for (int p = 0; p < 3; p++) {
+    StrategyData data;
+    KinsolProblem problem;
+    if (make_strategy_problem(problems[p], N, &data, &problem) != 0) return(1);
+
+    printf("\n%s\n", problems[p]);
+    printf("%-10s %6s %7s %8s %9s %10s %10s\n", "strategy", "flag", "iters",
+           "f_evals", "lin_iters", "seconds", "residual");
+    int best = -1;
+    double best_seconds = 0;
+    for (int s = 0; s < num_strategies; s++) {
+      std::vector < realtype > u(N);
+      SolveRecord rec;
+      double seconds = 0;
+      for (int r = 0; r < repeats; r++) {
+        for (sunindextype i = 0; i < N; i++) u[i] = 0;
+        kinsol_strategy_solve(problem, strategies[s], max_iters, fnormtol,
+                              (int) N, &u[0], &rec);
+        if (r == 0 || rec.seconds < seconds) seconds = rec.seconds;
+      }
+
+      bool converged = (rec.flag >= 0);
+      printf("%-10s %6d %7ld %8ld %9ld %10.6f %10.2e\n", strategies[s].name,
+             rec.flag, rec.nonlin_iters, rec.rhs_evals, rec.lin_iters,
+             seconds, (double) residual(problem, &u[0]));
+      if (converged && (best < 0 || seconds < best_seconds)) {
+        best = s;
+        best_seconds = seconds;
+      }
+    }
+    printf("cheapest: %s\n", (best < 0) ? "none" : strategies[best].name);
+  }
+
+  return(0);
+}
+
+// Largest entry of F(u), the same measure for every strategy.
+static realtype residual(const KinsolProblem &problem, const realtype *u) {
+  N_Vector uu = N_VNew_Serial(problem.N);
+  N_Vector fu = N_VNew_Serial(problem.N);
+  realtype *udata = NV_DATA_S(uu);
+  for (sunindextype i = 0; i < problem.N; i++) udata[i] = u[i];
+
+  problem.F(uu, fu, problem.user_data);
+  realtype norm = N_VMaxNorm(fu);
+
+  N_VDestroy(uu);
+  N_VDestroy(fu);
+  return(norm);
+}
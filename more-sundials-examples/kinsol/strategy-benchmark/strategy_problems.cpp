@@ -0,0 +1,167 @@
+#include "strategy_problems.h"
+
+#include <cmath>
+#include <string>
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+// Sum of the two neighbours of point i, zero outside the grid.
+static inline realtype neighbours(const realtype *x, sunindextype i,
+                                  sunindextype N) {
+  realtype left = (i > 0) ? x[i - 1] : 0;
+  realtype right = (i < N - 1) ? x[i + 1] : 0;
+  return left + right;
+}
+
+// contraction --------------------------------------------------------------
+
+static int contraction_G(N_Vector u, N_Vector g, void *user_data) {
+  StrategyData *data = (StrategyData*) user_data;
+  sunindextype N = data->N;
+  realtype *udata = NV_DATA_S(u);
+  realtype *gdata = NV_DATA_S(g);
+
+  for (sunindextype i = 0; i < N; i++) {
+    gdata[i] = data->source[i] + data->a * neighbours(udata, i, N) +
+        data->eps * sin(udata[i]);
+  }
+
+  return(0);
+}
+
+static int contraction_F(N_Vector u, N_Vector fu, void *user_data) {
+  int flag = contraction_G(u, fu, user_data);
+  if (flag != 0) return(flag);
+  N_VLinearSum(1, u, -1, fu, fu);
+  return(0);
+}
+
+static int contraction_jtv(N_Vector v, N_Vector Jv, N_Vector u,
+                           booleantype *new_u, void *user_data) {
+  StrategyData *data = (StrategyData*) user_data;
+  sunindextype N = data->N;
+  realtype *udata = NV_DATA_S(u);
+  realtype *vdata = NV_DATA_S(v);
+  realtype *Jvdata = NV_DATA_S(Jv);
+
+  for (sunindextype i = 0; i < N; i++) {
+    Jvdata[i] = (1 - data->eps * cos(udata[i])) * vdata[i] -
+        data->a * neighbours(vdata, i, N);
+  }
+  *new_u = SUNFALSE;
+
+  return(0);
+}
+
+// F(u) = L*u - N(u) with L*u = u - a*(u_{i-1} + u_{i+1}).
+static int contraction_lop(N_Vector v, N_Vector Lv, N_Vector u,
+                           booleantype *new_u, void *user_data) {
+  StrategyData *data = (StrategyData*) user_data;
+  sunindextype N = data->N;
+  realtype *vdata = NV_DATA_S(v);
+  realtype *Lvdata = NV_DATA_S(Lv);
+
+  for (sunindextype i = 0; i < N; i++) {
+    Lvdata[i] = vdata[i] - data->a * neighbours(vdata, i, N);
+  }
+  *new_u = SUNFALSE;
+
+  return(0);
+}
+
+// Bratu --------------------------------------------------------------------
+
+static int bratu_F(N_Vector u, N_Vector fu, void *user_data) {
+  StrategyData *data = (StrategyData*) user_data;
+  sunindextype N = data->N;
+  realtype *udata = NV_DATA_S(u);
+  realtype *fdata = NV_DATA_S(fu);
+
+  for (sunindextype i = 0; i < N; i++) {
+    fdata[i] = neighbours(udata, i, N) - 2 * udata[i] + data->h2 *
+        (data->lambda * SUNRexp(udata[i]) + data->mu * data->source[i]);
+  }
+
+  return(0);
+}
+
+// One Jacobi sweep for the second difference, G(u) = u + F(u)/2.
+static int bratu_G(N_Vector u, N_Vector g, void *user_data) {
+  int flag = bratu_F(u, g, user_data);
+  if (flag != 0) return(flag);
+  N_VLinearSum(1, u, 0.5, g, g);
+  return(0);
+}
+
+static int bratu_jtv(N_Vector v, N_Vector Jv, N_Vector u, booleantype *new_u,
+                     void *user_data) {
+  StrategyData *data = (StrategyData*) user_data;
+  sunindextype N = data->N;
+  realtype *udata = NV_DATA_S(u);
+  realtype *vdata = NV_DATA_S(v);
+  realtype *Jvdata = NV_DATA_S(Jv);
+
+  for (sunindextype i = 0; i < N; i++) {
+    Jvdata[i] = neighbours(vdata, i, N) +
+        (data->h2 * data->lambda * SUNRexp(udata[i]) - 2) * vdata[i];
+  }
+  *new_u = SUNFALSE;
+
+  return(0);
+}
+
+// F(u) = L*u - N(u) with L the second difference.
+static int bratu_lop(N_Vector v, N_Vector Lv, N_Vector u, booleantype *new_u,
+                     void *user_data) {
+  StrategyData *data = (StrategyData*) user_data;
+  sunindextype N = data->N;
+  realtype *vdata = NV_DATA_S(v);
+  realtype *Lvdata = NV_DATA_S(Lv);
+
+  for (sunindextype i = 0; i < N; i++) {
+    Lvdata[i] = neighbours(vdata, i, N) - 2 * vdata[i];
+  }
+  *new_u = SUNFALSE;
+
+  return(0);
+}
+
+int make_strategy_problem(const char *name, sunindextype N,
+                          StrategyData *data, KinsolProblem *p) {
+  std::string kind(name);
+  if (N < 1) return(-1);
+
+  data->N = N;
+  data->source.resize(N);
+  realtype h = 1.0 / (N + 1);
+  p->name = name;
+  p->N = N;
+  p->user_data = data;
+
+  if (kind == "contraction") {
+    data->a = 0.25;
+    data->eps = 0.1;
+    for (sunindextype i = 0; i < N; i++) {
+      data->source[i] = cos(4 * M_PI * (i + 1) * h);
+    }
+    p->F = contraction_F;
+    p->G = contraction_G;
+    p->jtv = contraction_jtv;
+    p->lop = contraction_lop;
+  } else if (kind == "bratu-mild" || kind == "bratu-fold") {
+    data->h2 = h * h;
+    data->lambda = (kind == "bratu-mild") ? 0.5 : 3.3;
+    data->mu = (kind == "bratu-mild") ? 1.0 : 0.0;
+    for (sunindextype i = 0; i < N; i++) {
+      data->source[i] = sin(M_PI * (i + 1) * h);
+    }
+    p->F = bratu_F;
+    p->G = bratu_G;
+    p->jtv = bratu_jtv;
+    p->lop = bratu_lop;
+  } else {
+    return(-1);
+  }
+
+  return(0);
+}
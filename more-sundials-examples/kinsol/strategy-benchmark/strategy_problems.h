@@ -0,0 +1,39 @@
+/*
+Problem classes for the KINSOL strategy benchmark, all on N points of a 1D
+grid. Each gives F and J*v for Newton, the linear part L*v of F for Picard
+and a fixed point function G for KIN_FP.
+
+  contraction: u = G(u) with G(u)_i = b_i + a*(u_{i-1} + u_{i+1}) +
+               eps*sin(u_i), a = 0.25 and eps = 0.1, so G is a contraction
+               and F(u) = u - G(u) is weakly nonlinear.
+  bratu-mild:  the Bratu problem u_{i-1} - 2*u_i + u_{i+1} +
+               h^2*(lambda*exp(u_i) + mu*sin(pi*x_i)) = 0 with lambda = 0.5,
+               mu = 1. Weakly nonlinear but with the stiff linear part of a
+               second derivative. G(u) = u + F(u)/2 is a Jacobi sweep.
+  bratu-fold:  the same with lambda = 3.3, mu = 0, close to the fold at
+               lambda = 3.51 where the solution stops existing. Strongly
+               nonlinear.
+*/
+
+#ifndef STRATEGY_PROBLEMS_H
+#define STRATEGY_PROBLEMS_H
+
+#include <vector>
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+#include "kinsol_strategy.h"
+
+// User data of every problem.
+struct StrategyData {
+  sunindextype N;
+  realtype a, eps; // contraction
+  realtype h2, lambda, mu; // Bratu
+  std::vector < realtype > source; // b_i or sin(pi*x_i)
+};
+
+// The problem called name with N unknowns, data becomes its user data.
+// Returns 0 on success or -1 for an unknown name.
+int make_strategy_problem(const char *name, sunindextype N,
+                          StrategyData *data, KinsolProblem *p);
+
+#endif
@@ -0,0 +1,208 @@
+#include "kinsol_service.h"
+
+#include <cstdio>
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+
+static int check_flag(void *flagvalue, const char *funcname, int opt);
+
+
+KinsolService::KinsolService()
+    : N_(0), num_params_(0), cache_size_(0), u_(NULL), scale_(NULL),
+      kin_mem_(NULL), LS_(NULL), cache_count_(0), cache_next_(0),
+      last_warm_(false), last_distance_(0), num_solves_(0),
+      num_warm_starts_(0), num_warm_failures_(0), wasted_nonlin_iters_(0),
+      wasted_lin_iters_(0), wasted_f_evals_(0) {
+}
+
+KinsolService::~KinsolService() {
+  destroy();
+}
+
+int KinsolService::create(sunindextype N, KINSysFn f,
+                          KINSpilsJacTimesVecFn jtv, int maxl, int num_params,
+                          int cache_size) {
+  int flag;
+
+  destroy();
+  if (N < 1 || num_params < 0 || cache_size < 0) return(-1);
+  N_ = N;
+  num_params_ = num_params;
+  cache_size_ = cache_size;
+  cache_params_.assign((size_t) cache_size * num_params, 0);
+  cache_solutions_.assign((size_t) cache_size * N, 0);
+
+  // Solution vector, overwritten with the initial guess by solve().
+  u_ = N_VNew_Serial(N);
+  if (check_flag((void *)u_, "N_VNew_Serial", 0)) return(KIN_MEM_FAIL);
+  N_VConst(0, u_);
+
+  // No scaling of u and f.
+  scale_ = N_VNew_Serial(N);
+  if (check_flag((void *)scale_, "N_VNew_Serial", 0)) return(KIN_MEM_FAIL);
+  N_VConst(1, scale_);
+
+  kin_mem_ = KINCreate();
+  if (check_flag((void *)kin_mem_, "KINCreate", 0)) return(KIN_MEM_FAIL);
+
+  flag = KINInit(kin_mem_, f, u_);
+  if (check_flag(&flag, "KINInit", 1)) return(flag);
+
+  LS_ = SUNSPGMR(u_, PREC_NONE, maxl);
+  if (check_flag((void *)LS_, "SUNSPGMR", 0)) return(KIN_MEM_FAIL);
+
+  flag = KINSpilsSetLinearSolver(kin_mem_, LS_);
+  if (check_flag(&flag, "KINSpilsSetLinearSolver", 1)) return(flag);
+
+  if (jtv != NULL) {
+    flag = KINSpilsSetJacTimesVecFn(kin_mem_, jtv);
+    if (check_flag(&flag, "KINSpilsSetJacTimesVecFn", 1)) return(flag);
+  }
+
+  return(0);
+}
+
+int KinsolService::solve(const realtype *params, void *user_data,
+                         const realtype *cold_guess, realtype *u_out) {
+  int flag;
+
+  if (kin_mem_ == NULL) return(KIN_MEM_NULL);
+
+  flag = KINSetUserData(kin_mem_, user_data);
+  if (check_flag(&flag, "KINSetUserData", 1)) return(flag);
+
+  realtype *udata = NV_DATA_S(u_);
+  int entry = nearest(params, &last_distance_);
+  last_warm_ = (entry >= 0);
+  wasted_nonlin_iters_ = 0;
+  wasted_lin_iters_ = 0;
+  wasted_f_evals_ = 0;
+  if (last_warm_) {
+    const realtype *cached = &cache_solutions_[(size_t) entry * N_];
+    for (sunindextype i = 0; i < N_; i++) udata[i] = cached[i];
+    flag = KINSol(kin_mem_, u_, KIN_LINESEARCH, scale_, scale_);
+    // A guess from parameters too far away may not converge, the cold guess
+    // is tried before giving up. The retry resets the counters of kin_mem, so
+    // the work of the failed attempt is read first.
+    if (flag < 0) {
+      last_warm_ = false;
+      num_warm_failures_++;
+      count_wasted();
+    }
+  }
+  if (!last_warm_) {
+    for (sunindextype i = 0; i < N_; i++) udata[i] = cold_guess[i];
+    flag = KINSol(kin_mem_, u_, KIN_LINESEARCH, scale_, scale_);
+  }
+  num_solves_++;
+  if (check_flag(&flag, "KINSol", 1)) return(flag);
+  if (last_warm_) num_warm_starts_++;
+
+  for (sunindextype i = 0; i < N_; i++) u_out[i] = udata[i];
+  remember(params, udata);
+
+  return(flag);
+}
+
+// Keeps the counters of the KINSol call that just failed. A counter that
+// cannot be read stays 0.
+void KinsolService::count_wasted() {
+  long int count;
+  if (KINGetNumNonlinSolvIters(kin_mem_, &count) == KIN_SUCCESS) {
+    wasted_nonlin_iters_ = count;
+  }
+  if (KINSpilsGetNumLinIters(kin_mem_, &count) == KINSPILS_SUCCESS) {
+    wasted_lin_iters_ = count;
+  }
+  if (KINGetNumFuncEvals(kin_mem_, &count) == KIN_SUCCESS) {
+    wasted_f_evals_ = count;
+  }
+}
+
+// Index of the cached entry with the parameters nearest to params, -1 if the
+// cache is empty.
+int KinsolService::nearest(const realtype *params, realtype *distance) const {
+  int best = -1;
+  realtype best_dist2 = 0;
+  for (int e = 0; e < cache_count_; e++) {
+    const realtype *p = &cache_params_[(size_t) e * num_params_];
+    realtype dist2 = 0;
+    for (int k = 0; k < num_params_; k++) {
+      dist2 += SUNSQR(params[k] - p[k]);
+    }
+    if (best < 0 || dist2 < best_dist2) {
+      best = e;
+      best_dist2 = dist2;
+    }
+  }
+  *distance = SUNRsqrt(best_dist2);
+  return(best);
+}
+
+void KinsolService::remember(const realtype *params, const realtype *u) {
+  if (cache_size_ == 0) return;
+  realtype *p = &cache_params_[(size_t) cache_next_ * num_params_];
+  realtype *s = &cache_solutions_[(size_t) cache_next_ * N_];
+  for (int k = 0; k < num_params_; k++) p[k] = params[k];
+  for (sunindextype i = 0; i < N_; i++) s[i] = u[i];
+  cache_next_ = (cache_next_ + 1) % cache_size_;
+  if (cache_count_ < cache_size_) cache_count_++;
+}
+
+void KinsolService::destroy() {
+  if (u_ != NULL) N_VDestroy(u_);
+  if (scale_ != NULL) N_VDestroy(scale_);
+  if (kin_mem_ != NULL) KINFree(&kin_mem_);
+  if (LS_ != NULL) SUNLinSolFree(LS_);
+  u_ = NULL;
+  scale_ = NULL;
+  kin_mem_ = NULL;
+  LS_ = NULL;
+  N_ = 0;
+  cache_params_.clear();
+  cache_solutions_.clear();
+  cache_count_ = 0;
+  cache_next_ = 0;
+  last_warm_ = false;
+  last_distance_ = 0;
+  num_solves_ = 0;
+  num_warm_starts_ = 0;
+  num_warm_failures_ = 0;
+  wasted_nonlin_iters_ = 0;
+  wasted_lin_iters_ = 0;
+  wasted_f_evals_ = 0;
+}
+
+// check_flag function is from the cvDiurnals_ky.c example from the CVODE
+// package.
+/* Check function return value...
+     opt == 0 means SUNDIALS function allocates memory so check if
+              returned NULL pointer
+     opt == 1 means SUNDIALS function returns a flag so check if
+              flag >= 0
+     opt == 2 means function allocates memory so check if returned
+              NULL pointer */
+static int check_flag(void *flagvalue, const char *funcname, int opt) {
+  int *errflag;
+
+  /* Check if SUNDIALS function returned NULL pointer - no memory allocated */
+  if (opt == 0 && flagvalue == NULL) {
+    fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  /* Check if flag < 0 */
+  else if (opt == 1) {
+    errflag = (int *) flagvalue;
+    if (*errflag < 0) {
+      fprintf(stderr, "\nSUNDIALS_ERROR: %s() failed with flag = %d\n\n",
+              funcname, *errflag);
+      return(1); }}
+
+  /* Check if function returned NULL pointer - no memory allocated */
+  else if (opt == 2 && flagvalue == NULL) {
+    fprintf(stderr, "\nMEMORY_ERROR: %s() failed - returned NULL pointer\n\n",
+            funcname);
+    return(1); }
+
+  return(0);
+}
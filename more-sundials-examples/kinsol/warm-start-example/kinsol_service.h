@@ -0,0 +1,96 @@
+/*
+A persistent KINSOL solver for the same nonlinear system f(u) = 0 solved
+over and over with slowly changing parameters.
+
+create() runs the setup of the simple KINSOL example once (vectors,
+KINCreate, KINInit, SPGMR, jacobian-times-vector function). Every call to
+solve() then only calls KINSol again, so kin_mem and the SPGMR workspace are
+kept from one solve to the next.
+
+The solutions of the last cache_size solves are kept together with their
+parameters. A solve starts from the cached solution whose parameters are
+nearest (Euclidean distance) to the new ones, which for slowly changing
+parameters is already close to the new solution and saves most of the Newton
+iterations of a cold start. Only when the cache is empty, or when the warm
+start fails, the solve starts from the cold guess. The parameters are only
+used as the key of the cache; f and jtv get theirs from the user data.
+
+The cold retry reuses kin_mem, and KINSol resets its counters, so after a
+failed warm start the KINGet* outputs only describe the cold attempt. The
+iterations and calls of f of the failed attempt are read before the retry and
+kept as the wasted work of the solve.
+*/
+
+#ifndef KINSOL_SERVICE_H
+#define KINSOL_SERVICE_H
+
+#include <vector>
+#include <kinsol/kinsol.h> // access to KINSOL func., consts.
+#include <kinsol/kinsol_spils.h> // access to KINSpils interface
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sunlinsol/sunlinsol_spgmr.h>  //access to SPGMR SUNLinearSolver
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+
+class KinsolService {
+ public:
+  KinsolService();
+  ~KinsolService(); // frees everything created by create()
+
+  // N unknowns, num_params parameters per solve. jtv may be NULL to use
+  // KINSOL's difference quotient, maxl is the Krylov dimension of SPGMR (0
+  // for the default). cache_size 0 turns warm starts off. Returns 0, or the
+  // negative flag of the failing SUNDIALS function.
+  int create(sunindextype N, KINSysFn f, KINSpilsJacTimesVecFn jtv, int maxl,
+             int num_params, int cache_size);
+
+  // Solves f(u) = 0 for the parameter set params and copies the solution
+  // into u_out. user_data is handed to f and jtv for this solve. Returns the
+  // flag of KINSol, negative on failure.
+  int solve(const realtype *params, void *user_data,
+            const realtype *cold_guess, realtype *u_out);
+
+  // Gives access to the KINSOL memory, e.g. for KINGet* optional outputs of
+  // the last solve.
+  void *kin_mem() const { return kin_mem_; }
+  SUNLinearSolver linear_solver() const { return LS_; }
+  // Whether the last solve was started from the cache, and how far its
+  // parameters were from the cached ones.
+  bool last_warm() const { return last_warm_; }
+  realtype last_distance() const { return last_distance_; }
+  long int num_solves() const { return num_solves_; }
+  long int num_warm_starts() const { return num_warm_starts_; }
+  // Warm starts that failed and were retried from the cold guess.
+  long int num_warm_failures() const { return num_warm_failures_; }
+  // Work of the failed warm start of the last solve, 0 if there was none.
+  // KINGet* on kin_mem() does not include it.
+  long int last_wasted_nonlin_iters() const { return wasted_nonlin_iters_; }
+  long int last_wasted_lin_iters() const { return wasted_lin_iters_; }
+  long int last_wasted_f_evals() const { return wasted_f_evals_; }
+
+ private:
+  // The service owns SUNDIALS objects, copying it would free them twice.
+  KinsolService(const KinsolService&);
+  KinsolService& operator=(const KinsolService&);
+
+  void destroy();
+  int nearest(const realtype *params, realtype *distance) const;
+  void count_wasted();
+  void remember(const realtype *params, const realtype *u);
+
+  sunindextype N_;
+  int num_params_, cache_size_;
+  N_Vector u_, scale_;
+  void *kin_mem_;
+  SUNLinearSolver LS_;
+
+  // Ring buffer of parameters and solutions, oldest overwritten first.
+  std::vector < realtype > cache_params_, cache_solutions_;
+  int cache_count_, cache_next_;
+
+  bool last_warm_;
+  realtype last_distance_;
+  long int num_solves_, num_warm_starts_, num_warm_failures_;
+  long int wasted_nonlin_iters_, wasted_lin_iters_, wasted_f_evals_;
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*
+A stream of nonlinear solves with slowly changing parameters, solved by one
+KinsolService, first with cold starts and then with warm starts from its
+cache of previous solutions.
+
+The system is the 1D Bratu problem with a source term,
+
+  u_{i-1} - 2*u_i + u_{i+1} + h^2*(lambda*exp(u_i) + mu*sin(pi*x_i)) = 0
+
+for i = 1..N, x_i = i*h, h = 1/(N+1) and u_0 = u_{N+1} = 0. The parameters
+(lambda, mu) of solve k follow a slow closed curve, so neighbouring solves
+have close solutions. Every solve uses Newton with a line search and SPGMR,
+the jacobian-times-vector function is exact.
+
+For both runs the totals of Newton iterations, Krylov iterations, calls of f
+and the time are printed, then the iterations the warm starts saved and the
+largest difference between the solutions of the two runs. The totals include
+the work of warm starts that failed and were retried from the cold guess,
+which is also printed on its own.
+
+Usage: ./executable [solves] [N] [cache_size]
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "kinsol/kinsol.h" // access to KINSOL func., consts.
+#include <nvector/nvector_serial.h>  // access to serial N_Vector
+#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "kinsol_service.h"
+#include "kinsol_stats.h"  // SolveRecord, collect_kinsol_stats
+
+struct UserData {
+  sunindextype N;
+  realtype h2; // h^2
+  realtype lambda, mu;
+  std::vector < realtype > source; // sin(pi*x_i)
+};
+
+// Totals over all solves of one run.
+struct RunTotals {
+  long int nonlin_iters, lin_iters, f_evals, warm_starts;
+  long int warm_failures, wasted_nonlin_iters, wasted_f_evals;
+  double seconds;
+};
+
+static int f(N_Vector u, N_Vector fu, void *user_data);
+static int jtv(N_Vector v, N_Vector Jv, N_Vector u, booleantype *new_u,
+               void *user_data);
+static int run(int solves, int cache_size, UserData *data,
+               std::vector < realtype > &solutions, RunTotals *totals);
+static void print_totals(const char *name, const RunTotals &totals);
+
+
+int main(int argc, char *argv[]) {
+  int solves = (argc > 1) ? std::atoi(argv[1]) : 2000;
+  sunindextype N = (argc > 2) ? std::atol(argv[2]) : 50;
+  int cache_size = (argc > 3) ? std::atoi(argv[3]) : 16;
+  if (solves < 1) solves = 1;
+  if (N < 1) N = 1;
+  if (cache_size < 1) cache_size = 1;
+
+  UserData data;
+  data.N = N;
+  realtype h = 1.0 / (N + 1);
+  data.h2 = h * h;
+  data.source.resize(N);
+  for (sunindextype i = 0; i < N; i++) {
+    data.source[i] = sin(M_PI * (i + 1) * h);
+  }
+
+  std::vector < realtype > cold, warm;
+  RunTotals cold_totals, warm_totals;
+  if (run(solves, 0, &data, cold, &cold_totals) != 0) return(1);
+  if (run(solves, cache_size, &data, warm, &warm_totals) != 0) return(1);
+
+  printf("%d solves, N = %ld, cache of %d solutions\n\n", solves, (long) N,
+         cache_size);
+  printf("%-5s %11s %10s %10s %9s %9s %9s\n", "start", "newton_its",
+         "lin_iters", "f_evals", "warm", "failed", "seconds");
+  print_totals("cold", cold_totals);
+  print_totals("warm", warm_totals);
+
+  realtype max_diff = 0;
+  for (size_t i = 0; i < cold.size(); i++) {
+    max_diff = SUNMAX(max_diff, SUNRabs(cold[i] - warm[i]));
+  }
+  long int saved = cold_totals.nonlin_iters - warm_totals.nonlin_iters;
+  printf("\nNewton iterations saved: %ld (%.1f%%), %.2f instead of %.2f per "
+         "solve\n", saved, 100.0 * saved / SUNMAX(cold_totals.nonlin_iters, 1),
+         (double) warm_totals.nonlin_iters / solves,
+         (double) cold_totals.nonlin_iters / solves);
+  printf("Krylov iterations saved: %ld\n",
+         cold_totals.lin_iters - warm_totals.lin_iters);
+  printf("Failed warm starts: %ld, wasting %ld Newton iterations and %ld "
+         "calls of f\n", warm_totals.warm_failures,
+         warm_totals.wasted_nonlin_iters, warm_totals.wasted_f_evals);
+  printf("Largest difference between cold and warm solutions: %.2e\n",
+         (double) max_diff);
+
+  return(0);
+}
+
+// Runs the stream of solves with one KinsolService, cache_size 0 for cold
+// starts. The solutions are appended to solutions.
+static int run(int solves, int cache_size, UserData *data,
+               std::vector < realtype > &solutions, RunTotals *totals) {
+  sunindextype N = data->N;
+  KinsolService service;
+  int flag = service.create(N, f, jtv, (int) N, 2, cache_size);
+  if (flag < 0) return(1);
+
+  std::vector < realtype > cold_guess(N, 0), u(N);
+  SolveRecord stats;
+  totals->nonlin_iters = 0;
+  totals->lin_iters = 0;
+  totals->f_evals = 0;
+  totals->wasted_nonlin_iters = 0;
+  totals->wasted_f_evals = 0;
+  solutions.clear();
+
+  double start = stats_now();
+  for (int k = 0; k < solves; k++) {
+    realtype s = 2 * M_PI * k / solves;
+    realtype params[2] = {1.5 + sin(3 * s), 1.0 + cos(2 * s)};
+    data->lambda = params[0];
+    data->mu = params[1];
+
+    flag = service.solve(params, data, &cold_guess[0], &u[0]);
+    if (flag < 0) {
+      fprintf(stderr, "solve %d (lambda = %g, mu = %g) failed\n", k,
+              (double) params[0], (double) params[1]);
+      return(1);
+    }
+    stats.reset();
+    collect_kinsol_stats(service.kin_mem(), service.linear_solver(),
+                         &stats);
+    totals->nonlin_iters += stats.nonlin_iters;
+    totals->lin_iters += stats.lin_iters;
+    totals->f_evals += stats.rhs_evals;
+    // kin_mem only counts the last KINSol call, the work of a failed warm
+    // start before it is added here.
+    totals->nonlin_iters += service.last_wasted_nonlin_iters();
+    totals->lin_iters += service.last_wasted_lin_iters();
+    totals->f_evals += service.last_wasted_f_evals();
+    totals->wasted_nonlin_iters += service.last_wasted_nonlin_iters();
+    totals->wasted_f_evals += service.last_wasted_f_evals();
+    solutions.insert(solutions.end(), u.begin(), u.end());
+  }
+  totals->seconds = stats_now() - start;
+  totals->warm_starts = service.num_warm_starts();
+  totals->warm_failures = service.num_warm_failures();
+
+  return(0);
+}
+
+static void print_totals(const char *name, const RunTotals &totals) {
+  printf("%-5s %11ld %10ld %10ld %9ld %9ld %9.3f\n", name,
+         totals.nonlin_iters, totals.lin_iters, totals.f_evals,
+         totals.warm_starts, totals.warm_failures, totals.seconds);
+}
+
+// Residual of the discretized Bratu problem.
+static int f(N_Vector u, N_Vector fu, void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype N = data->N;
+  realtype *udata = NV_DATA_S(u);
+  realtype *fdata = NV_DATA_S(fu);
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left = (i > 0) ? udata[i - 1] : 0;
+    realtype right = (i < N - 1) ? udata[i + 1] : 0;
+    fdata[i] = left - 2 * udata[i] + right + data->h2 *
+        (data->lambda * SUNRexp(udata[i]) + data->mu * data->source[i]);
+  }
+
+  return(0);
+}
+
+// Exact product of the tridiagonal jacobian with v.
+static int jtv(N_Vector v, N_Vector Jv, N_Vector u, booleantype *new_u,
+               void *user_data) {
+  UserData *data = (UserData*) user_data;
+  sunindextype N = data->N;
+  realtype *udata = NV_DATA_S(u);
+  realtype *vdata = NV_DATA_S(v);
+  realtype *Jvdata = NV_DATA_S(Jv);
+
+  for (sunindextype i = 0; i < N; i++) {
+    realtype left = (i > 0) ? vdata[i - 1] : 0;
+    realtype right = (i < N - 1) ? vdata[i + 1] : 0;
+    Jvdata[i] = left + right +
+        (data->h2 * data->lambda * SUNRexp(udata[i]) - 2) * vdata[i];
+  }
+  *new_u = SUNFALSE;
+
+  return(0);
+}
@@ -10,6 +10,7 @@ as a stiff system.
 #include <cvode/cvode_spils.h> // access to CVSpils interface
 #include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
 #include <sundials/sundials_math.h>  // contains the macros ABS, SUNSQR, EXP
+#include "cvode_stats.h"  // SolveRecord, collect_cvode_stats
 
 // This macro gives access to the individual components of the data array of an
 // N Vector.
@@ -66,6 +67,11 @@ int main() {
 
   // 7. Set Optional inputs.
   // ---------------------------------------------------------------------------
+  // The statistics of the solve are the user data, so f and jtv can time
+  // themselves.
+  SolveRecord stats;
+  flag = CVodeSetUserData(cvode_mem, &stats);
+  if (check_flag(&flag, "CVodeSetUserData", 1)) return(1);
   // ---------------------------------------------------------------------------
 
   // 8. Create Matrix Object.
@@ -112,11 +118,15 @@ int main() {
   int print_steps = 100;
   realtype tout;
   realtype end_time = 50;
-  realtype step_length = 0.5;
+  realtype step_length = end_time / print_steps;
   realtype t = 0;
+  double start = stats_now();
   // loop over output points, call CVode, print results, test for error
-  for (tout = step_length; tout <= end_time; tout += step_length) {
+  for (int k = 1; k <= print_steps; k++) {
+    // Output times from k, summing up step_length would drift.
+    tout = k * step_length;
     flag = CVode(cvode_mem, tout, y, &t, CV_NORMAL);
+    stats.flag = flag;
     std::cout << "t: " << t;
     std::cout << "\ny:";
     N_VPrint_Serial(y);
@@ -126,6 +136,11 @@ int main() {
 
   // 15. Get optional outputs.
   // ---------------------------------------------------------------------------
+  // The time includes printing the output points.
+  stats.seconds = stats_now() - start;
+  flag = collect_cvode_stats(cvode_mem, LS, &stats);
+  if (check_flag(&flag, "collect_cvode_stats", 1)) return(1);
+  print_solve_record(stdout, stats);
   // ---------------------------------------------------------------------------
 
   // 16. Deallocate memory for solution vector.
@@ -148,6 +163,9 @@ int main() {
 
 // Simple function that calculates the differential equation.
 static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
+  SolveRecord *stats = (SolveRecord *) user_data;
+  StatsTimer timer(stats->f_calls, stats->f_seconds);
+
   // N_VGetArrayPointer returns a pointer to the data in the N_Vector class.
   realtype *udata  = N_VGetArrayPointer(u); // pointer u vector data
   realtype *dudata = N_VGetArrayPointer(u_dot); // pointer to udot vector data
@@ -161,17 +179,16 @@ static int f(realtype t, N_Vector u, N_Vector u_dot, void *user_data) {
 // Jacobian function vector routine.
 static int jtv(N_Vector v, N_Vector Jv, realtype t, N_Vector u, N_Vector fu,
                void *user_data, N_Vector tmp) {
+  SolveRecord *stats = (SolveRecord *) user_data;
+  StatsTimer timer(stats->jtv_calls, stats->jtv_seconds);
+
   realtype *udata  = N_VGetArrayPointer(u);
   realtype *vdata  = N_VGetArrayPointer(v);
   realtype *Jvdata = N_VGetArrayPointer(Jv);
-  realtype *fudata = N_VGetArrayPointer(fu);
 
   Jvdata[0] = -101.0 * vdata[0] + -100.0 * vdata[1];
   Jvdata[1] = vdata[0] + 0 * vdata[1];
 
-  fudata[0] = 0;
-  fudata[1] = 0;
-
   return(0);
 }
 